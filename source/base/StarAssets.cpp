@@ -10,6 +10,9 @@
 #include "StarJsonPatch.hpp"
 #include "StarIterator.hpp"
 #include "StarImageProcessing.hpp"
+#include "StarImageDiskCache.hpp"
+#include "StarAssetsSnapshot.hpp"
+#include "StarEncode.hpp"
 #include "StarLogging.hpp"
 #include "StarRandom.hpp"
 #include "StarFont.hpp"
@@ -22,6 +25,7 @@
 #include "StarLuaConverters.hpp"
 #include "StarImageLuaBindings.hpp"
 #include "StarUtilityLuaBindings.hpp"
+#include "StarVersion.hpp"
 
 namespace Star {
 
@@ -198,6 +202,9 @@ Assets::Assets(Settings settings, StringList assetSources) {
   pushGlobalContext("assets", makeBaseAssetCallbacks());
 
   List<pair<String, AssetSourcePtr>> sources;
+  // Load scripts can change the file table in ways the snapshot key does not
+  // cover.
+  bool ranLoadScripts = false;
 
   auto addSource = [&](String const& sourcePath, AssetSourcePtr source) {
     m_assetSourcePaths.add(sourcePath, source);
@@ -236,6 +243,7 @@ Assets::Assets(Settings settings, StringList assetSources) {
     auto metadata = source->metadata();
     if (auto scripts = metadata.ptr("scripts")) {
       if (auto scriptGroup = scripts->optArray(groupName)) {
+        ranLoadScripts = true;
         auto sourceName = metadata.value("name", File::baseName(sourcePath));
 
         String sourceNameStr = strf("{}", sourceName);
@@ -282,11 +290,13 @@ Assets::Assets(Settings settings, StringList assetSources) {
                 auto& descriptor = m_files[path];
                 descriptor.sourceName = path;
                 descriptor.source = memoryAssets;
+                descriptor.digest.reset();
               } else {
                 m_files[path] = { // FezzedOne: Fixed MSVC compatibility.
                   path,
                   memoryAssets,
                   {},
+                  {},
                 };
               }
               m_filesByExtension[AssetPath::extension(path).toLower()].insert(path);
@@ -296,10 +306,12 @@ Assets::Assets(Settings settings, StringList assetSources) {
               if (auto file = m_files.ptr(path)) {
                 if (memoryAssets->contains(patchPath)) {
                   file->patchSources.append(make_pair(patchPath, memoryAssets));
+                  file->digest.reset();
                   return true;
                 } else {
                   if (auto asset = m_files.ptr(patchPath)) {
                     file->patchSources.append(make_pair(patchPath, asset->source));
+                    file->digest.reset();
                     return true;
                   }
                 }
@@ -373,28 +385,54 @@ Assets::Assets(Settings settings, StringList assetSources) {
   for (auto& pair : sources)
     runLoadScripts("postLoad", pair.first, pair.second, sources);
 
-  Sha256Hasher digest;
+  if (m_settings.snapshotFile) {
+    try {
+      m_snapshot = make_shared<AssetsSnapshot>(*m_settings.snapshotFile, snapshotKey());
+      for (auto const& sourcePath : m_assetSources)
+        m_snapshotSources.add(m_assetSourcePaths.getRight(sourcePath));
+    } catch (std::exception const& e) {
+      Logger::warn("Assets: Could not open snapshot '{}', disabling: {}", *m_settings.snapshotFile, outputException(e, false));
+      m_snapshot.reset();
+    }
+  }
 
-  for (auto const& assetPath : m_files.keys().sorted()) {
-    bool digestFile = true;
-    for (auto const& pattern : m_settings.digestIgnore) {
-      if (assetPath.regexMatch(pattern, false, false)) {
-        digestFile = false;
-        break;
+  if (auto snapshotDigest = m_snapshot && !ranLoadScripts ? m_snapshot->digest() : Maybe<ByteArray>()) {
+    m_digest = snapshotDigest.take();
+  } else {
+    Sha256Hasher digest;
+
+    for (auto const& assetPath : m_files.keys().sorted()) {
+      bool digestFile = true;
+      for (auto const& pattern : m_settings.digestIgnore) {
+        if (assetPath.regexMatch(pattern, false, false)) {
+          digestFile = false;
+          break;
+        }
       }
-    }
 
-    auto const& descriptor = m_files.get(assetPath);
+      auto const& descriptor = m_files.get(assetPath);
 
-    if (digestFile) {
-      digest.push(assetPath);
-      digest.push(DataStreamBuffer::serialize(descriptor.source->open(descriptor.sourceName)->size()));
-      for (auto const& pair : descriptor.patchSources)
-        digest.push(DataStreamBuffer::serialize(pair.second->open(pair.first)->size()));
+      if (digestFile) {
+        digest.push(assetPath);
+        digest.push(DataStreamBuffer::serialize(descriptor.source->open(descriptor.sourceName)->size()));
+        for (auto const& pair : descriptor.patchSources)
+          digest.push(DataStreamBuffer::serialize(pair.second->open(pair.first)->size()));
+      }
     }
+
+    m_digest = digest.compute();
+    if (m_snapshot && !ranLoadScripts)
+      m_snapshot->setDigest(m_digest);
   }
 
-  m_digest = digest.compute();
+  if (m_settings.imageCacheDirectory) {
+    try {
+      m_imageDiskCache = make_shared<ImageDiskCache>(*m_settings.imageCacheDirectory, m_settings.imageCacheSizeLimit);
+      Logger::info("Assets: Image cache contains {} images", m_imageDiskCache->count());
+    } catch (std::exception const& e) {
+      Logger::warn("Assets: Could not open image cache in '{}', disabling: {}", *m_settings.imageCacheDirectory, outputException(e, false));
+    }
+  }
 
   for (auto const& filename : m_files.keys())
     m_filesByExtension[AssetPath::extension(filename).toLower()].add(filename);
@@ -416,6 +454,16 @@ Assets::~Assets() {
 
   // Join them all
   m_workerThreads.clear();
+
+  flushImageDiskCache();
+
+  if (m_snapshot) {
+    try {
+      m_snapshot->write();
+    } catch (std::exception const& e) {
+      Logger::warn("Assets: Could not write snapshot '{}': {}", *m_settings.snapshotFile, outputException(e, false));
+    }
+  }
 }
 
 StringList Assets::assetSources() const {
@@ -657,6 +705,8 @@ void Assets::clearCache() {
     if (pair.second && !pair.second->shouldPersist() && !m_queue.contains(pair.first))
       it.remove();
   }
+
+  flushImageDiskCache();
 }
 
 void Assets::cleanup() {
@@ -1048,6 +1098,55 @@ ImageConstPtr Assets::readImage(String const& path) const {
   throw AssetException(strf("No such asset '{}'", path));
 }
 
+// Combines the digests of every source image with the frames used from them,
+// so that the key only needs to read files the first time they are used.
+Maybe<String> Assets::imageDiskCacheKey(AssetPath const& path, StringList const& referencePaths) const {
+  List<AssetPath> sources = {path};
+  for (auto const& ref : referencePaths)
+    sources.append(AssetPath::split(ref));
+
+  Sha256Hasher hasher;
+  hasher.push(xSbVersionString);
+  hasher.push(AssetPath::join(path));
+  for (auto const& source : sources) {
+    auto file = m_files.ptr(source.basePath);
+    if (!file)
+      return {};
+    hasher.push(fileDigest(*file));
+
+    if (source.subPath) {
+      auto frames = bestFramesSpecification(source.basePath);
+      if (auto rect = frames ? frames->getRect(*source.subPath) : Maybe<RectU>())
+        hasher.push(strf("{} {} {} {}", rect->xMin(), rect->yMin(), rect->xMax(), rect->yMax()));
+    }
+  }
+
+  return hexEncode(hasher.compute());
+}
+
+void Assets::flushImageDiskCache() const {
+  if (!m_imageDiskCache)
+    return;
+
+  try {
+    m_imageDiskCache->flush();
+  } catch (std::exception const& e) {
+    Logger::warn("Assets: Could not write image cache index: {}", outputException(e, false));
+  }
+}
+
+ByteArray Assets::fileDigest(AssetFileDescriptor const& file) const {
+  if (!file.digest) {
+    file.digest = unlockDuring([&]() {
+      Sha256Hasher hasher;
+      hasher.push(file.source->read(file.sourceName));
+      for (auto const& patch : file.patchSources)
+        hasher.push(patch.second->read(patch.first));
+      return hasher.compute();
+    });
+  }
+  return *file.digest;
+}
 
 // WasabiRaptor's recursive patch checking code, «downstreamed» from OpenStarbound.
 Json Assets::checkPatchArray(String const& path, AssetSourcePtr const& source, Json const result, JsonArray const patchData) const {
@@ -1075,6 +1174,12 @@ Json Assets::checkPatchArray(String const& path, AssetSourcePtr const& source, J
 }
 
 Json Assets::readJson(String const& path) const {
+  bool snapshotJson = m_snapshot && isSnapshotJson(path);
+  if (snapshotJson) {
+    if (auto json = m_snapshot->json(path))
+      return json.take();
+  }
+
   ByteArray streamData = read(path);
   try {
     Json result = inputUtf8Json(streamData.begin(), streamData.end(), false);
@@ -1109,12 +1214,48 @@ Json Assets::readJson(String const& path) const {
         }
       }
     }
+    if (snapshotJson)
+      m_snapshot->setJson(path, result);
     return result;
   } catch (std::exception const& e) {
     throw JsonParsingException(strf("Cannot parse json file: {}", path), e);
   }
 }
 
+ByteArray Assets::snapshotKey() const {
+  Sha256Hasher hasher;
+  hasher.push(xSbVersionString);
+  hasher.push(DataStreamBuffer::serializeContainer(m_settings.pathIgnore));
+  hasher.push(DataStreamBuffer::serializeContainer(m_settings.digestIgnore));
+
+  for (auto const& sourcePath : m_assetSources) {
+    hasher.push(sourcePath);
+    auto source = m_assetSourcePaths.getRight(sourcePath);
+    if (auto directorySource = as<DirectoryAssetSource>(source)) {
+      for (auto const& path : directorySource->assetPaths().sorted()) {
+        hasher.push(path);
+        hasher.push(DataStreamBuffer::serialize(File::modificationTime(directorySource->toFilesystem(path))));
+      }
+    } else {
+      hasher.push(DataStreamBuffer::serialize(File::fileSize(sourcePath)));
+      hasher.push(DataStreamBuffer::serialize(File::modificationTime(sourcePath)));
+    }
+  }
+
+  return hasher.compute();
+}
+
+bool Assets::isSnapshotJson(String const& path) const {
+  auto descriptor = m_files.ptr(path);
+  if (!descriptor || !m_snapshotSources.contains(descriptor->source))
+    return false;
+  for (auto const& pair : descriptor->patchSources) {
+    if (!m_snapshotSources.contains(pair.second))
+      return false;
+  }
+  return true;
+}
+
 bool Assets::doLoad(AssetId const& id) const {
   try {
     // loadAsset automatically manages the queue and freshens the asset
@@ -1253,11 +1394,6 @@ shared_ptr<Assets::AssetData> Assets::loadJson(AssetPath const& path) const {
 shared_ptr<Assets::AssetData> Assets::loadImage(AssetPath const& path) const {
   validatePath(path, true, true);
   if (!path.directives.empty()) {
-    shared_ptr<ImageData> source =
-        as<ImageData>(loadAsset(AssetId{AssetType::Image, {path.basePath, path.subPath, {}}}));
-    if (!source)
-      return {};
-    StringMap<ImageConstPtr> references;
     StringList referencePaths;
 
     for (auto& directives : path.directives.list())
@@ -1267,6 +1403,30 @@ shared_ptr<Assets::AssetData> Assets::loadImage(AssetPath const& path) const {
       addImageOperationReferences(entry.operation, referencePaths);
     }); // TODO: This can definitely be better, was changed quickly to support the new Directives.
 
+    Maybe<String> diskCacheKey;
+    if (m_imageDiskCache) {
+      diskCacheKey = imageDiskCacheKey(path, referencePaths);
+      if (diskCacheKey) {
+        Maybe<Image> image;
+        try {
+          image = unlockDuring([&]() { return m_imageDiskCache->load(*diskCacheKey); });
+        } catch (std::exception const& e) {
+          Logger::warn("Assets: Could not read image '{}' from the image cache: {}", AssetPath::join(path), outputException(e, false));
+        }
+        if (image) {
+          auto newData = make_shared<ImageData>();
+          newData->image = make_shared<Image>(image.take());
+          return newData;
+        }
+      }
+    }
+
+    shared_ptr<ImageData> source =
+        as<ImageData>(loadAsset(AssetId{AssetType::Image, {path.basePath, path.subPath, {}}}));
+    if (!source)
+      return {};
+    StringMap<ImageConstPtr> references;
+
 
     for (auto const& ref : referencePaths) {
       auto components = AssetPath::split(ref);
@@ -1286,6 +1446,13 @@ shared_ptr<Assets::AssetData> Assets::loadImage(AssetPath const& path) const {
         else
           processImageOperation(entry.operation, newImage, [&](String const& ref) { return references.get(ref).get(); });
       });
+      if (diskCacheKey) {
+        try {
+          m_imageDiskCache->store(*diskCacheKey, newImage);
+        } catch (std::exception const& e) {
+          Logger::warn("Assets: Could not write image '{}' to the image cache: {}", AssetPath::join(path), outputException(e, false));
+        }
+      }
       newData->image = make_shared<Image>(std::move(newImage));
       return newData;
     });
@@ -18,6 +18,8 @@ STAR_CLASS(Image);
 STAR_STRUCT(FramesSpecification);
 STAR_CLASS(Assets);
 STAR_CLASS(LuaContext);
+STAR_CLASS(ImageDiskCache);
+STAR_CLASS(AssetsSnapshot);
 
 STAR_EXCEPTION(AssetException, StarException);
 
@@ -74,6 +76,17 @@ public:
 
     // FezzedOne: The Lua garbage collector step multiplier value.
     float luaGcStepMultiplier;
+
+    // If given, images with directives are kept in this directory between
+    // sessions so they do not need to be processed again.
+    Maybe<String> imageCacheDirectory;
+
+    // Size limit in bytes of the image cache directory.
+    uint64_t imageCacheSizeLimit;
+
+    // If given, the digest and patched JSON assets are kept in this file
+    // between sessions, and used as long as no asset file has changed.
+    Maybe<String> snapshotFile;
   };
 
   enum class AssetType {
@@ -161,6 +174,8 @@ public:
     AssetSourcePtr source;
     // List of source names and sources for patches to this file.
     List<pair<String, AssetSourcePtr>> patchSources;
+    // Digest of the file and its patches, computed once when first needed.
+    mutable Maybe<ByteArray> digest;
   };
 
   Assets(Settings settings, StringList assetSources);
@@ -290,11 +305,30 @@ public:
   ByteArray read(String const& basePath) const;
   ImageConstPtr readImage(String const& path) const;
 
+  // Key for the disk cache of images with directives.  Digests the contents
+  // of every image the result is made from, along with their patches and
+  // frames, so that a cached image is never used once any of them change.
+  // Also includes the build version, since image operations may change
+  // between builds.  Returns nothing if any of those images does not exist.
+  Maybe<String> imageDiskCacheKey(AssetPath const& path, StringList const& referencePaths) const;
+  // The disk cache is best-effort, so failing to write it is only logged.
+  void flushImageDiskCache() const;
+  // SHA-256 of the contents of the file and all of its patches.  Only read and
+  // hashed the first time, since the sources do not change once loaded.
+  ByteArray fileDigest(AssetFileDescriptor const& file) const;
+
   // WasabiRaptor's recursive patch checking code, «downstreamed» from OpenStarbound.
   Json checkPatchArray(String const& path, AssetSourcePtr const& source, Json const result, JsonArray const patchData) const;
 
   Json readJson(String const& basePath) const;
 
+  // Identifies the asset sources and every file in them by path and
+  // modification time, for validating the snapshot.
+  ByteArray snapshotKey() const;
+  // Whether the JSON asset and all of its patches come from the sources
+  // covered by the snapshot key.
+  bool isSnapshotJson(String const& path) const;
+
   // Load / post process an asset and log any exception.  Returns true if the
   // work was performed (whether successful or not), false if the work is
   // blocking on something.
@@ -351,6 +385,13 @@ public:
 
   ByteArray m_digest;
 
+  // Only set if the image cache directory is given in the settings.
+  ImageDiskCachePtr m_imageDiskCache;
+
+  // Only set if the snapshot file is given in the settings.
+  AssetsSnapshotPtr m_snapshot;
+  HashSet<AssetSourcePtr> m_snapshotSources;
+
   List<ThreadFunction<void>> m_workerThreads;
   atomic<bool> m_stopThreads;
 };
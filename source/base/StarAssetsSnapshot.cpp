@@ -0,0 +1,143 @@
+#include "StarAssetsSnapshot.hpp"
+#include "StarMemoryMappedFile.hpp"
+#include "StarDataStreamDevices.hpp"
+#include "StarDataStreamExtra.hpp"
+#include "StarFile.hpp"
+#include "StarLogging.hpp"
+
+namespace Star {
+
+static char const AssetsSnapshotMagic[] = "SBASNP01";
+static size_t const AssetsSnapshotMagicSize = sizeof(AssetsSnapshotMagic) - 1;
+
+// The file starts with the magic, the key, the digest, and an index of every
+// JSON asset's path, offset and size, followed by the serialized JSON assets.
+// Offsets are relative to the end of the index.
+
+AssetsSnapshot::AssetsSnapshot(String path, ByteArray key)
+  : m_path(std::move(path)), m_key(std::move(key)), m_changed(false) {
+  if (!File::isFile(m_path))
+    return;
+
+  try {
+    auto file = make_unique<MemoryMappedFile>(m_path);
+    DataStreamExternalBuffer ds(file->data(), file->size());
+    if (ds.readBytes(AssetsSnapshotMagicSize) != ByteArray(AssetsSnapshotMagic, AssetsSnapshotMagicSize))
+      throw IOException("Bad magic");
+    if (ds.read<ByteArray>() != m_key) {
+      Logger::info("AssetsSnapshot: Asset files have changed, ignoring snapshot");
+      return;
+    }
+
+    auto digest = ds.read<Maybe<ByteArray>>();
+    auto count = ds.readVlqU();
+    StringMap<pair<size_t, size_t>> mappedJson;
+    for (uint64_t i = 0; i < count; ++i) {
+      String assetPath = ds.read<String>();
+      size_t offset = ds.readVlqU();
+      size_t size = ds.readVlqU();
+      mappedJson[std::move(assetPath)] = {offset, size};
+    }
+
+    size_t dataStart = ds.pos();
+    for (auto& entry : mappedJson) {
+      entry.second.first += dataStart;
+      if (entry.second.first > file->size() || entry.second.second > file->size() - entry.second.first)
+        throw IOException("Entry out of bounds");
+    }
+
+    m_file = std::move(file);
+    m_mappedJson = std::move(mappedJson);
+    m_digest = std::move(digest);
+    Logger::info("AssetsSnapshot: Using snapshot with {} JSON assets", m_mappedJson.size());
+  } catch (std::exception const& e) {
+    Logger::warn("AssetsSnapshot: Could not read '{}', ignoring: {}", m_path, outputException(e, false));
+  }
+}
+
+AssetsSnapshot::~AssetsSnapshot() {}
+
+Maybe<ByteArray> AssetsSnapshot::digest() const {
+  MutexLocker locker(m_mutex);
+  return m_digest;
+}
+
+void AssetsSnapshot::setDigest(ByteArray digest) {
+  MutexLocker locker(m_mutex);
+  if (m_digest != digest) {
+    m_digest = std::move(digest);
+    m_changed = true;
+  }
+}
+
+Maybe<Json> AssetsSnapshot::json(String const& path) const {
+  MutexLocker locker(m_mutex);
+  try {
+    if (auto entry = m_mappedJson.ptr(path))
+      return DataStreamExternalBuffer(m_file->data() + entry->first, entry->second).read<Json>();
+    if (auto data = m_addedJson.ptr(path))
+      return DataStreamBuffer::deserialize<Json>(*data);
+  } catch (std::exception const& e) {
+    Logger::warn("AssetsSnapshot: Could not read JSON asset '{}': {}", path, outputException(e, false));
+  }
+  return {};
+}
+
+void AssetsSnapshot::setJson(String const& path, Json const& json) {
+  ByteArray data = DataStreamBuffer::serialize(json);
+  MutexLocker locker(m_mutex);
+  if (m_mappedJson.contains(path))
+    return;
+  m_addedJson[path] = std::move(data);
+  m_changed = true;
+}
+
+void AssetsSnapshot::write() {
+  MutexLocker locker(m_mutex);
+  if (!m_changed)
+    return;
+
+  List<pair<String, ByteArray>> entries;
+  for (auto const& entry : m_mappedJson)
+    entries.append({entry.first, ByteArray(m_file->data() + entry.second.first, entry.second.second)});
+  for (auto& entry : m_addedJson)
+    entries.append({entry.first, std::move(entry.second)});
+  m_addedJson.clear();
+
+  DataStreamBuffer ds;
+  ds.writeData(AssetsSnapshotMagic, AssetsSnapshotMagicSize);
+  ds.write(m_key);
+  ds.write(m_digest);
+  ds.writeVlqU(entries.size());
+  size_t offset = 0;
+  for (auto const& entry : entries) {
+    ds.write(entry.first);
+    ds.writeVlqU(offset);
+    ds.writeVlqU(entry.second.size());
+    offset += entry.second.size();
+  }
+  size_t dataStart = ds.pos();
+  for (auto const& entry : entries)
+    ds.writeData(entry.second.ptr(), entry.second.size());
+
+  // Some platforms cannot replace a file that is still mapped.
+  m_file.reset();
+  m_mappedJson.clear();
+  File::overwriteFileWithRename(ds.data(), m_path);
+  m_changed = false;
+
+  // Keep serving entries from the new file.
+  m_file = make_unique<MemoryMappedFile>(m_path);
+  offset = dataStart;
+  for (auto const& entry : entries) {
+    m_mappedJson[entry.first] = {offset, entry.second.size()};
+    offset += entry.second.size();
+  }
+}
+
+size_t AssetsSnapshot::jsonCount() const {
+  MutexLocker locker(m_mutex);
+  return m_mappedJson.size() + m_addedJson.size();
+}
+
+}
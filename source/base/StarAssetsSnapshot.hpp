@@ -0,0 +1,55 @@
+#ifndef STAR_ASSETS_SNAPSHOT_HPP
+#define STAR_ASSETS_SNAPSHOT_HPP
+
+#include "StarJson.hpp"
+#include "StarThread.hpp"
+
+namespace Star {
+
+STAR_CLASS(MemoryMappedFile);
+STAR_CLASS(AssetsSnapshot);
+
+// Keeps the assets digest and fully patched JSON assets from an earlier
+// session in a single file, so that a later session with the exact same
+// asset files can skip parsing and patching them.  The snapshot is only used
+// if it was written with the same key, which should identify every asset
+// file.  The file is memory mapped, and each JSON asset is only decoded from
+// it when it is requested.
+//
+// AssetsSnapshot is thread safe.
+class AssetsSnapshot {
+public:
+  // Opens the snapshot at the given path, if there is one and it was written
+  // with the given key, otherwise starts empty.
+  AssetsSnapshot(String path, ByteArray key);
+  ~AssetsSnapshot();
+
+  Maybe<ByteArray> digest() const;
+  void setDigest(ByteArray digest);
+
+  Maybe<Json> json(String const& path) const;
+  void setJson(String const& path, Json const& json);
+
+  // Rewrites the snapshot file if anything was added since it was opened.
+  // Entries from the previous snapshot are kept.
+  void write();
+
+  // Number of JSON assets in the snapshot, including added ones.
+  size_t jsonCount() const;
+
+private:
+  String m_path;
+  ByteArray m_key;
+
+  mutable Mutex m_mutex;
+  MemoryMappedFileUPtr m_file;
+  // Offset and size of each serialized JSON asset in the mapped file.
+  StringMap<pair<size_t, size_t>> m_mappedJson;
+  StringMap<ByteArray> m_addedJson;
+  Maybe<ByteArray> m_digest;
+  bool m_changed;
+};
+
+}
+
+#endif
@@ -0,0 +1,418 @@
+#include "StarCellularLightArray.hpp"
+
+#if defined STAR_ARCHITECTURE_X86_64 || defined STAR_ARCHITECTURE_I386
+#define STAR_CELLULAR_LIGHT_X86 1
+#include <immintrin.h>
+#ifdef STAR_COMPILER_MSVC
+#include <intrin.h>
+#define STAR_TARGET_SSE2
+#define STAR_TARGET_AVX2
+#else
+#define STAR_TARGET_SSE2 __attribute__((target("sse2")))
+#define STAR_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace Star {
+
+static_assert(sizeof(CellularLightCell<float>) == 8 && offsetof(CellularLightCell<float>, obstacle) == 4,
+    "Vectorized light spread expects scalar cells to be a float followed by the obstacle flag");
+static_assert(sizeof(CellularLightCell<Vec3F>) == 16 && offsetof(CellularLightCell<Vec3F>, obstacle) == 12,
+    "Vectorized light spread expects colored cells to be three floats followed by the obstacle flag");
+
+namespace {
+  float const NoLight = -std::numeric_limits<float>::infinity();
+
+  CellularLightSimd detectCellularLightSimd() {
+#ifdef STAR_CELLULAR_LIGHT_X86
+#ifdef STAR_COMPILER_MSVC
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool sse2 = (info[3] & (1 << 26)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    bool avx2 = false;
+    if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 0x6) == 0x6) {
+      __cpuidex(info, 7, 0);
+      avx2 = (info[1] & (1 << 5)) != 0;
+    }
+    if (avx2)
+      return CellularLightSimd::AVX2;
+    if (sse2)
+      return CellularLightSimd::SSE2;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+      return CellularLightSimd::AVX2;
+    if (__builtin_cpu_supports("sse2"))
+      return CellularLightSimd::SSE2;
+#endif
+#endif
+    return CellularLightSimd::None;
+  }
+
+  atomic<CellularLightSimd>& currentCellularLightSimd() {
+    static atomic<CellularLightSimd> simd(cellularLightSimdSupported());
+    return simd;
+  }
+
+  // Spread terms are written into scratch space as the light that every
+  // source cell gives to the destination cell next to it (straight), and to
+  // the ones diagonal from it (diagonal), or NoLight if it gives none.  The
+  // straight terms are padded by one cell on each side, and the diagonal
+  // terms by two, so that the destination cells [yBegin - 1, yEnd + 1) can
+  // read them at fixed offsets.
+  struct ScratchLayout {
+    ScratchLayout(size_t count, size_t channels, List<float>& scratch) : count(count) {
+      scratch.resize(channels * (straightSize() + diagonalSize()));
+      for (size_t c = 0; c < channels; ++c) {
+        straight[c] = scratch.ptr() + c * straightSize();
+        diagonal[c] = scratch.ptr() + channels * straightSize() + c * diagonalSize();
+        straight[c][0] = straight[c][count + 1] = NoLight;
+        diagonal[c][0] = diagonal[c][1] = diagonal[c][count + 2] = diagonal[c][count + 3] = NoLight;
+      }
+    }
+
+    size_t straightSize() const {
+      return count + 2;
+    }
+
+    size_t diagonalSize() const {
+      return count + 4;
+    }
+
+    size_t count;
+    float* straight[3];
+    float* diagonal[3];
+  };
+
+  float scalarSpreadTerm(float light, float drop) {
+    return light - drop;
+  }
+
+  void coloredSpreadTerms(Vec3F const& light, float drop, float* terms[3], size_t i) {
+    float maxChannel = std::max(light[0], std::max(light[1], light[2]));
+    if (maxChannel <= 0.0f) {
+      for (size_t c = 0; c < 3; ++c)
+        terms[c][i] = NoLight;
+    } else {
+      drop /= maxChannel;
+      for (size_t c = 0; c < 3; ++c)
+        terms[c][i] = light[c] - light[c] * drop;
+    }
+  }
+
+  // Writes the spread terms of the source cells [begin, count), and applies
+  // them to the destination cells [begin, count + 2), both relative to the
+  // first cell.  Used for whatever is left over after the vector loops.
+
+  void scalarSpreadTail(CellularLightCell<float> const* source, size_t begin, ScratchLayout const& layout, CellularLightDropoff const& dropoff) {
+    for (size_t i = begin; i < layout.count; ++i) {
+      bool obstacle = source[i].obstacle;
+      layout.straight[0][i + 1] = scalarSpreadTerm(source[i].light, obstacle ? dropoff.straightObstacle : dropoff.straightAir);
+      layout.diagonal[0][i + 2] = scalarSpreadTerm(source[i].light, obstacle ? dropoff.diagonalObstacle : dropoff.diagonalAir);
+    }
+  }
+
+  void scalarApplyTail(CellularLightCell<float>* dest, size_t begin, ScratchLayout const& layout) {
+    for (size_t j = begin; j < layout.count + 2; ++j) {
+      float light = std::max(dest[j].light, layout.straight[0][j]);
+      light = std::max(light, layout.diagonal[0][j]);
+      dest[j].light = std::max(light, layout.diagonal[0][j + 2]);
+    }
+  }
+
+  void coloredSpreadTail(CellularLightCell<Vec3F> const* source, size_t begin, ScratchLayout const& layout, CellularLightDropoff const& dropoff) {
+    float* straight[3] = {layout.straight[0] + 1, layout.straight[1] + 1, layout.straight[2] + 1};
+    float* diagonal[3] = {layout.diagonal[0] + 2, layout.diagonal[1] + 2, layout.diagonal[2] + 2};
+    for (size_t i = begin; i < layout.count; ++i) {
+      bool obstacle = source[i].obstacle;
+      coloredSpreadTerms(source[i].light, obstacle ? dropoff.straightObstacle : dropoff.straightAir, straight, i);
+      coloredSpreadTerms(source[i].light, obstacle ? dropoff.diagonalObstacle : dropoff.diagonalAir, diagonal, i);
+    }
+  }
+
+  void coloredApplyTail(CellularLightCell<Vec3F>* dest, size_t begin, ScratchLayout const& layout) {
+    for (size_t j = begin; j < layout.count + 2; ++j) {
+      for (size_t c = 0; c < 3; ++c) {
+        float light = std::max(dest[j].light[c], layout.straight[c][j]);
+        light = std::max(light, layout.diagonal[c][j]);
+        dest[j].light[c] = std::max(light, layout.diagonal[c][j + 2]);
+      }
+    }
+  }
+
+#ifdef STAR_CELLULAR_LIGHT_X86
+  // Selects a where the mask is set and b elsewhere.
+  STAR_TARGET_SSE2 inline __m128 select128(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+  }
+
+  // Mask of lanes whose lowest byte, the obstacle flag, is set.
+  STAR_TARGET_SSE2 inline __m128 obstacleMask128(__m128 flags) {
+    __m128i bytes = _mm_and_si128(_mm_castps_si128(flags), _mm_set1_epi32(0xff));
+    return _mm_castsi128_ps(_mm_xor_si128(_mm_cmpeq_epi32(bytes, _mm_setzero_si128()), _mm_set1_epi32(-1)));
+  }
+
+  STAR_TARGET_SSE2 void scalarSpreadSSE2(CellularLightCell<float> const* source, CellularLightCell<float>* dest,
+      ScratchLayout const& layout, CellularLightDropoff const& dropoff) {
+    __m128 straightAir = _mm_set1_ps(dropoff.straightAir);
+    __m128 straightObstacle = _mm_set1_ps(dropoff.straightObstacle);
+    __m128 diagonalAir = _mm_set1_ps(dropoff.diagonalAir);
+    __m128 diagonalObstacle = _mm_set1_ps(dropoff.diagonalObstacle);
+
+    size_t i = 0;
+    for (; i + 4 <= layout.count; i += 4) {
+      __m128 low = _mm_loadu_ps((float const*)(source + i));
+      __m128 high = _mm_loadu_ps((float const*)(source + i + 2));
+      __m128 light = _mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0));
+      __m128 obstacle = obstacleMask128(_mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1)));
+      _mm_storeu_ps(layout.straight[0] + i + 1, _mm_sub_ps(light, select128(obstacle, straightObstacle, straightAir)));
+      _mm_storeu_ps(layout.diagonal[0] + i + 2, _mm_sub_ps(light, select128(obstacle, diagonalObstacle, diagonalAir)));
+    }
+    scalarSpreadTail(source, i, layout, dropoff);
+
+    size_t j = 0;
+    for (; j + 4 <= layout.count + 2; j += 4) {
+      float* cells = (float*)(dest + j);
+      __m128 low = _mm_loadu_ps(cells);
+      __m128 high = _mm_loadu_ps(cells + 4);
+      __m128 light = _mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0));
+      __m128 flags = _mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1));
+      light = _mm_max_ps(light, _mm_loadu_ps(layout.straight[0] + j));
+      light = _mm_max_ps(light, _mm_loadu_ps(layout.diagonal[0] + j));
+      light = _mm_max_ps(light, _mm_loadu_ps(layout.diagonal[0] + j + 2));
+      _mm_storeu_ps(cells, _mm_unpacklo_ps(light, flags));
+      _mm_storeu_ps(cells + 4, _mm_unpackhi_ps(light, flags));
+    }
+    scalarApplyTail(dest, j, layout);
+  }
+
+  STAR_TARGET_SSE2 void coloredSpreadSSE2(CellularLightCell<Vec3F> const* source, CellularLightCell<Vec3F>* dest,
+      ScratchLayout const& layout, CellularLightDropoff const& dropoff) {
+    __m128 straightAir = _mm_set1_ps(dropoff.straightAir);
+    __m128 straightObstacle = _mm_set1_ps(dropoff.straightObstacle);
+    __m128 diagonalAir = _mm_set1_ps(dropoff.diagonalAir);
+    __m128 diagonalObstacle = _mm_set1_ps(dropoff.diagonalObstacle);
+    __m128 noLight = _mm_set1_ps(NoLight);
+
+    size_t i = 0;
+    for (; i + 4 <= layout.count; i += 4) {
+      float const* cells = (float const*)(source + i);
+      __m128 red = _mm_loadu_ps(cells);
+      __m128 green = _mm_loadu_ps(cells + 4);
+      __m128 blue = _mm_loadu_ps(cells + 8);
+      __m128 flags = _mm_loadu_ps(cells + 12);
+      _MM_TRANSPOSE4_PS(red, green, blue, flags);
+
+      __m128 obstacle = obstacleMask128(flags);
+      __m128 maxChannel = _mm_max_ps(red, _mm_max_ps(green, blue));
+      __m128 lit = _mm_cmpgt_ps(maxChannel, _mm_setzero_ps());
+
+      __m128 straightDrop = _mm_div_ps(select128(obstacle, straightObstacle, straightAir), maxChannel);
+      __m128 diagonalDrop = _mm_div_ps(select128(obstacle, diagonalObstacle, diagonalAir), maxChannel);
+      __m128 channels[3] = {red, green, blue};
+      for (size_t c = 0; c < 3; ++c) {
+        __m128 straight = _mm_sub_ps(channels[c], _mm_mul_ps(channels[c], straightDrop));
+        __m128 diagonal = _mm_sub_ps(channels[c], _mm_mul_ps(channels[c], diagonalDrop));
+        _mm_storeu_ps(layout.straight[c] + i + 1, select128(lit, straight, noLight));
+        _mm_storeu_ps(layout.diagonal[c] + i + 2, select128(lit, diagonal, noLight));
+      }
+    }
+    coloredSpreadTail(source, i, layout, dropoff);
+
+    size_t j = 0;
+    for (; j + 4 <= layout.count + 2; j += 4) {
+      float* cells = (float*)(dest + j);
+      __m128 channels[4] = {_mm_loadu_ps(cells), _mm_loadu_ps(cells + 4), _mm_loadu_ps(cells + 8), _mm_loadu_ps(cells + 12)};
+      _MM_TRANSPOSE4_PS(channels[0], channels[1], channels[2], channels[3]);
+      for (size_t c = 0; c < 3; ++c) {
+        channels[c] = _mm_max_ps(channels[c], _mm_loadu_ps(layout.straight[c] + j));
+        channels[c] = _mm_max_ps(channels[c], _mm_loadu_ps(layout.diagonal[c] + j));
+        channels[c] = _mm_max_ps(channels[c], _mm_loadu_ps(layout.diagonal[c] + j + 2));
+      }
+      _MM_TRANSPOSE4_PS(channels[0], channels[1], channels[2], channels[3]);
+      for (size_t k = 0; k < 4; ++k)
+        _mm_storeu_ps(cells + k * 4, channels[k]);
+    }
+    coloredApplyTail(dest, j, layout);
+  }
+
+  STAR_TARGET_AVX2 inline __m256 obstacleMask256(__m256 flags) {
+    __m256i bytes = _mm256_and_si256(_mm256_castps_si256(flags), _mm256_set1_epi32(0xff));
+    return _mm256_castsi256_ps(_mm256_xor_si256(_mm256_cmpeq_epi32(bytes, _mm256_setzero_si256()), _mm256_set1_epi32(-1)));
+  }
+
+  // Transposes the 4x4 matrix in each 128 bit half of the given rows.
+  STAR_TARGET_AVX2 inline void transpose256(__m256& row0, __m256& row1, __m256& row2, __m256& row3) {
+    __m256 t0 = _mm256_unpacklo_ps(row0, row1);
+    __m256 t1 = _mm256_unpacklo_ps(row2, row3);
+    __m256 t2 = _mm256_unpackhi_ps(row0, row1);
+    __m256 t3 = _mm256_unpackhi_ps(row2, row3);
+    row0 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+    row1 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+    row2 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    row3 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+  }
+
+  STAR_TARGET_AVX2 inline __m256 load256(float const* low, float const* high) {
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(low)), _mm_loadu_ps(high), 1);
+  }
+
+  STAR_TARGET_AVX2 void scalarSpreadAVX2(CellularLightCell<float> const* source, CellularLightCell<float>* dest,
+      ScratchLayout const& layout, CellularLightDropoff const& dropoff) {
+    __m256 straightAir = _mm256_set1_ps(dropoff.straightAir);
+    __m256 straightObstacle = _mm256_set1_ps(dropoff.straightObstacle);
+    __m256 diagonalAir = _mm256_set1_ps(dropoff.diagonalAir);
+    __m256 diagonalObstacle = _mm256_set1_ps(dropoff.diagonalObstacle);
+
+    // Shuffling within 128 bit halves leaves the light values of 8 cells in
+    // the order 0 1 4 5 2 3 6 7, which is put right by swapping the middle
+    // 64 bit quarters.
+    size_t i = 0;
+    for (; i + 8 <= layout.count; i += 8) {
+      __m256 low = _mm256_loadu_ps((float const*)(source + i));
+      __m256 high = _mm256_loadu_ps((float const*)(source + i + 4));
+      __m256 light = _mm256_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0));
+      __m256 obstacle = obstacleMask256(_mm256_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1)));
+      __m256 straight = _mm256_sub_ps(light, _mm256_blendv_ps(straightAir, straightObstacle, obstacle));
+      __m256 diagonal = _mm256_sub_ps(light, _mm256_blendv_ps(diagonalAir, diagonalObstacle, obstacle));
+      _mm256_storeu_ps(layout.straight[0] + i + 1, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(straight), _MM_SHUFFLE(3, 1, 2, 0))));
+      _mm256_storeu_ps(layout.diagonal[0] + i + 2, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(diagonal), _MM_SHUFFLE(3, 1, 2, 0))));
+    }
+    scalarSpreadTail(source, i, layout, dropoff);
+
+    size_t j = 0;
+    for (; j + 8 <= layout.count + 2; j += 8) {
+      float* cells = (float*)(dest + j);
+      __m256 low = _mm256_loadu_ps(cells);
+      __m256 high = _mm256_loadu_ps(cells + 8);
+      __m256 light = _mm256_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0));
+      __m256 flags = _mm256_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1));
+      __m256 spread = _mm256_max_ps(_mm256_loadu_ps(layout.straight[0] + j), _mm256_loadu_ps(layout.diagonal[0] + j));
+      spread = _mm256_max_ps(spread, _mm256_loadu_ps(layout.diagonal[0] + j + 2));
+      light = _mm256_max_ps(light, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(spread), _MM_SHUFFLE(3, 1, 2, 0))));
+      _mm256_storeu_ps(cells, _mm256_unpacklo_ps(light, flags));
+      _mm256_storeu_ps(cells + 8, _mm256_unpackhi_ps(light, flags));
+    }
+    scalarApplyTail(dest, j, layout);
+  }
+
+  STAR_TARGET_AVX2 void coloredSpreadAVX2(CellularLightCell<Vec3F> const* source, CellularLightCell<Vec3F>* dest,
+      ScratchLayout const& layout, CellularLightDropoff const& dropoff) {
+    __m256 straightAir = _mm256_set1_ps(dropoff.straightAir);
+    __m256 straightObstacle = _mm256_set1_ps(dropoff.straightObstacle);
+    __m256 diagonalAir = _mm256_set1_ps(dropoff.diagonalAir);
+    __m256 diagonalObstacle = _mm256_set1_ps(dropoff.diagonalObstacle);
+    __m256 noLight = _mm256_set1_ps(NoLight);
+
+    // Cells k and k + 4 share a row, so that transposing each half gives the
+    // channels of all 8 cells in order.
+    size_t i = 0;
+    for (; i + 8 <= layout.count; i += 8) {
+      float const* cells = (float const*)(source + i);
+      __m256 red = load256(cells, cells + 16);
+      __m256 green = load256(cells + 4, cells + 20);
+      __m256 blue = load256(cells + 8, cells + 24);
+      __m256 flags = load256(cells + 12, cells + 28);
+      transpose256(red, green, blue, flags);
+
+      __m256 obstacle = obstacleMask256(flags);
+      __m256 maxChannel = _mm256_max_ps(red, _mm256_max_ps(green, blue));
+      __m256 lit = _mm256_cmp_ps(maxChannel, _mm256_setzero_ps(), _CMP_GT_OQ);
+
+      __m256 straightDrop = _mm256_div_ps(_mm256_blendv_ps(straightAir, straightObstacle, obstacle), maxChannel);
+      __m256 diagonalDrop = _mm256_div_ps(_mm256_blendv_ps(diagonalAir, diagonalObstacle, obstacle), maxChannel);
+      __m256 channels[3] = {red, green, blue};
+      for (size_t c = 0; c < 3; ++c) {
+        __m256 straight = _mm256_sub_ps(channels[c], _mm256_mul_ps(channels[c], straightDrop));
+        __m256 diagonal = _mm256_sub_ps(channels[c], _mm256_mul_ps(channels[c], diagonalDrop));
+        _mm256_storeu_ps(layout.straight[c] + i + 1, _mm256_blendv_ps(noLight, straight, lit));
+        _mm256_storeu_ps(layout.diagonal[c] + i + 2, _mm256_blendv_ps(noLight, diagonal, lit));
+      }
+    }
+    coloredSpreadTail(source, i, layout, dropoff);
+
+    size_t j = 0;
+    for (; j + 8 <= layout.count + 2; j += 8) {
+      float* cells = (float*)(dest + j);
+      __m256 channels[4];
+      for (size_t k = 0; k < 4; ++k)
+        channels[k] = load256(cells + k * 4, cells + 16 + k * 4);
+      transpose256(channels[0], channels[1], channels[2], channels[3]);
+      for (size_t c = 0; c < 3; ++c) {
+        channels[c] = _mm256_max_ps(channels[c], _mm256_loadu_ps(layout.straight[c] + j));
+        channels[c] = _mm256_max_ps(channels[c], _mm256_loadu_ps(layout.diagonal[c] + j));
+        channels[c] = _mm256_max_ps(channels[c], _mm256_loadu_ps(layout.diagonal[c] + j + 2));
+      }
+      transpose256(channels[0], channels[1], channels[2], channels[3]);
+      for (size_t k = 0; k < 4; ++k) {
+        _mm_storeu_ps(cells + k * 4, _mm256_castps256_ps128(channels[k]));
+        _mm_storeu_ps(cells + 16 + k * 4, _mm256_extractf128_ps(channels[k], 1));
+      }
+    }
+    coloredApplyTail(dest, j, layout);
+  }
+#endif
+}
+
+CellularLightSimd cellularLightSimdSupported() {
+  static CellularLightSimd const supported = detectCellularLightSimd();
+  return supported;
+}
+
+CellularLightSimd cellularLightSimd() {
+  return currentCellularLightSimd().load(std::memory_order_relaxed);
+}
+
+void setCellularLightSimd(CellularLightSimd simd) {
+  currentCellularLightSimd() = std::min(simd, cellularLightSimdSupported());
+}
+
+void ScalarLightTraits::spreadColumn(CellularLightSimd simd, CellularLightCell<float> const* source, CellularLightCell<float>* dest,
+    size_t yBegin, size_t yEnd, CellularLightDropoff const& dropoff, List<float>& scratch) {
+  if (yEnd <= yBegin)
+    return;
+
+  ScratchLayout layout(yEnd - yBegin, 1, scratch);
+  source += yBegin;
+  dest += yBegin - 1;
+
+#ifdef STAR_CELLULAR_LIGHT_X86
+  if (simd == CellularLightSimd::AVX2)
+    return scalarSpreadAVX2(source, dest, layout, dropoff);
+  if (simd == CellularLightSimd::SSE2)
+    return scalarSpreadSSE2(source, dest, layout, dropoff);
+#else
+  _unused(simd);
+#endif
+
+  scalarSpreadTail(source, 0, layout, dropoff);
+  scalarApplyTail(dest, 0, layout);
+}
+
+void ColoredLightTraits::spreadColumn(CellularLightSimd simd, CellularLightCell<Vec3F> const* source, CellularLightCell<Vec3F>* dest,
+    size_t yBegin, size_t yEnd, CellularLightDropoff const& dropoff, List<float>& scratch) {
+  if (yEnd <= yBegin)
+    return;
+
+  ScratchLayout layout(yEnd - yBegin, 3, scratch);
+  source += yBegin;
+  dest += yBegin - 1;
+
+#ifdef STAR_CELLULAR_LIGHT_X86
+  if (simd == CellularLightSimd::AVX2)
+    return coloredSpreadAVX2(source, dest, layout, dropoff);
+  if (simd == CellularLightSimd::SSE2)
+    return coloredSpreadSSE2(source, dest, layout, dropoff);
+#else
+  _unused(simd);
+#endif
+
+  coloredSpreadTail(source, 0, layout, dropoff);
+  coloredApplyTail(dest, 0, layout);
+}
+
+}
@@ -6,10 +6,50 @@
 
 namespace Star {
 
+// Instruction sets with vectorized implementations of the light spread passes.
+// The best one supported by the CPU is picked at runtime, None always uses the
+// plain scalar loops.
+enum class CellularLightSimd : uint8_t {
+  None,
+  SSE2,
+  AVX2
+};
+
+// The best instruction set supported by the running CPU.
+CellularLightSimd cellularLightSimdSupported();
+// The instruction set currently used by every CellularLightArray.  Defaults
+// to cellularLightSimdSupported().
+CellularLightSimd cellularLightSimd();
+// Overrides the instruction set used, clamped to the supported one.
+void setCellularLightSimd(CellularLightSimd simd);
+
+template <typename LightValue>
+struct CellularLightCell {
+  LightValue light;
+  bool obstacle;
+};
+
+// Light drop per cell when spreading light out of obstacle and non-obstacle
+// cells, in straight and diagonal directions.
+struct CellularLightDropoff {
+  float straightAir;
+  float straightObstacle;
+  float diagonalAir;
+  float diagonalObstacle;
+};
+
 // Operations for simple scalar lighting.
 struct ScalarLightTraits {
   typedef float Value;
 
+  // Vectorized light spread from the cells [yBegin, yEnd) of the source column
+  // into the same, the next higher and the next lower cells of the adjacent
+  // destination column.  The destination column must have a cell before
+  // yBegin and after yEnd - 1.  Gives the same result as calling spread() for
+  // every pair of cells in any order.
+  static void spreadColumn(CellularLightSimd simd, CellularLightCell<float> const* source, CellularLightCell<float>* dest,
+      size_t yBegin, size_t yEnd, CellularLightDropoff const& dropoff, List<float>& scratch);
+
   static float spread(float source, float dest, float drop);
   static float subtract(float value, float drop);
 
@@ -25,6 +65,9 @@ struct ScalarLightTraits {
 struct ColoredLightTraits {
   typedef Vec3F Value;
 
+  static void spreadColumn(CellularLightSimd simd, CellularLightCell<Vec3F> const* source, CellularLightCell<Vec3F>* dest,
+      size_t yBegin, size_t yEnd, CellularLightDropoff const& dropoff, List<float>& scratch);
+
   static Vec3F spread(Vec3F const& source, Vec3F const& dest, float drop);
   static Vec3F subtract(Vec3F value, float drop);
 
@@ -39,10 +82,7 @@ class CellularLightArray {
 public:
   typedef typename LightTraits::Value LightValue;
 
-  struct Cell {
-    LightValue light;
-    bool obstacle;
-  };
+  typedef CellularLightCell<LightValue> Cell;
 
   struct SpreadLight {
     Vec2F position;
@@ -69,6 +109,11 @@ public:
   // existing light and collision data.
   void begin(size_t newWidth, size_t newHeight);
 
+  // Begin a new calculation over the columns [xMin, xMax) of another array,
+  // copying its parameters, cell data and lights.  Light positions are moved
+  // so that xMin becomes the left edge of this array.
+  void beginColumns(CellularLightArray const& source, size_t xMin, size_t xMax);
+
   // Position is in index space, spread lights will have no effect if they are
   // outside of the array.  Integer points are assumed to be on the corners of
   // the grid (not the center)
@@ -120,6 +165,7 @@ private:
   unique_ptr<Cell[]> m_cells;
   List<SpreadLight> m_spreadLights;
   List<PointLight> m_pointLights;
+  List<float> m_spreadScratch;
 
   unsigned m_spreadPasses;
   float m_spreadMaxAir;
@@ -225,6 +271,40 @@ void CellularLightArray<LightTraits>::begin(size_t newWidth, size_t newHeight) {
   }
 }
 
+template <typename LightTraits>
+void CellularLightArray<LightTraits>::beginColumns(CellularLightArray const& source, size_t xMin, size_t xMax) {
+  starAssert(xMin < xMax && xMax <= source.m_width);
+
+  m_spreadPasses = source.m_spreadPasses;
+  m_spreadMaxAir = source.m_spreadMaxAir;
+  m_spreadMaxObstacle = source.m_spreadMaxObstacle;
+  m_pointMaxAir = source.m_pointMaxAir;
+  m_pointMaxObstacle = source.m_pointMaxObstacle;
+  m_pointObstacleBoost = source.m_pointObstacleBoost;
+
+  size_t newWidth = xMax - xMin;
+  if (!m_cells || newWidth != m_width || source.m_height != m_height) {
+    m_width = newWidth;
+    m_height = source.m_height;
+    m_cells.reset(new Cell[m_width * m_height]());
+  }
+
+  // Columns are contiguous, so the whole strip is a single copy.
+  std::copy(source.m_cells.get() + xMin * m_height, source.m_cells.get() + xMax * m_height, m_cells.get());
+
+  Vec2F offset((float)xMin, 0.0f);
+  m_spreadLights.clear();
+  for (SpreadLight spreadLight : source.m_spreadLights) {
+    spreadLight.position -= offset;
+    m_spreadLights.append(spreadLight);
+  }
+  m_pointLights.clear();
+  for (PointLight pointLight : source.m_pointLights) {
+    pointLight.position -= offset;
+    m_pointLights.append(pointLight);
+  }
+}
+
 template <typename LightTraits>
 void CellularLightArray<LightTraits>::addSpreadLight(SpreadLight const& spreadLight) {
   m_spreadLights.append(spreadLight);
@@ -333,6 +413,12 @@ void CellularLightArray<LightTraits>::calculateLightSpread(size_t xMin, size_t y
   float dropoffAirDiag = 1.0f / m_spreadMaxAir * Constants::sqrt2;
   float dropoffObstacleDiag = 1.0f / m_spreadMaxObstacle * Constants::sqrt2;
 
+  // The vectorized passes first spread light along each column, which has to
+  // be done cell by cell, then spread the final column into the next one all
+  // at once.
+  CellularLightSimd simd = cellularLightSimd();
+  CellularLightDropoff dropoff{dropoffAir, dropoffObstacle, dropoffAirDiag, dropoffObstacleDiag};
+
   // enlarge x/y min/max taking into ambient spread of light
   xMin = xMin - min(xMin, (size_t)ceil(m_spreadMaxAir));
   yMin = yMin - min(yMin, (size_t)ceil(m_spreadMaxAir));
@@ -345,6 +431,16 @@ void CellularLightArray<LightTraits>::calculateLightSpread(size_t xMin, size_t y
       size_t xCellOffset = x * m_height;
       size_t xRightCellOffset = (x + 1) * m_height;
 
+      if (simd != CellularLightSimd::None) {
+        for (size_t y = yMin + 1; y < yMax - 1; ++y) {
+          auto const& cell = cellAtIndex(xCellOffset + y);
+          auto& cellUp = cellAtIndex(xCellOffset + y + 1);
+          cellUp.light = LightTraits::spread(cell.light, cellUp.light, cell.obstacle ? dropoffObstacle : dropoffAir);
+        }
+        LightTraits::spreadColumn(simd, &m_cells[xCellOffset], &m_cells[xRightCellOffset], yMin + 1, yMax - 1, dropoff, m_spreadScratch);
+        continue;
+      }
+
       for (size_t y = yMin + 1; y < yMax - 1; ++y) {
         auto cell = cellAtIndex(xCellOffset + y);
         auto& cellRight = cellAtIndex(xRightCellOffset + y);
@@ -368,6 +464,16 @@ void CellularLightArray<LightTraits>::calculateLightSpread(size_t xMin, size_t y
       size_t xCellOffset = x * m_height;
       size_t xLeftCellOffset = (x - 1) * m_height;
 
+      if (simd != CellularLightSimd::None) {
+        for (size_t y = yMax - 2; y > yMin; --y) {
+          auto const& cell = cellAtIndex(xCellOffset + y);
+          auto& cellDown = cellAtIndex(xCellOffset + y - 1);
+          cellDown.light = LightTraits::spread(cell.light, cellDown.light, cell.obstacle ? dropoffObstacle : dropoffAir);
+        }
+        LightTraits::spreadColumn(simd, &m_cells[xCellOffset], &m_cells[xLeftCellOffset], yMin + 1, yMax - 1, dropoff, m_spreadScratch);
+        continue;
+      }
+
       for (size_t y = yMax - 2; y > yMin; --y) {
         auto cell = cellAtIndex(xCellOffset + y);
         auto& cellLeft = cellAtIndex(xLeftCellOffset + y);
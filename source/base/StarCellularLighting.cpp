@@ -2,7 +2,15 @@
 
 namespace Star {
 
-CellularLightingCalculator::CellularLightingCalculator(bool monochrome) {
+static Vec3B lightPixel(float light) {
+  return Color::grayf(light).toRgb();
+}
+
+static Vec3B lightPixel(Vec3F const& light) {
+  return Color::v3fToByte(light);
+}
+
+CellularLightingCalculator::CellularLightingCalculator(bool monochrome) : m_monochrome(false), m_tiles(1) {
   setMonochrome(monochrome);
 }
 
@@ -42,6 +50,25 @@ void CellularLightingCalculator::setParameters(Json const& config) {
       );
 }
 
+void CellularLightingCalculator::setTiles(unsigned tiles) {
+  tiles = max(tiles, 1u);
+  if (tiles == m_tiles)
+    return;
+
+  m_tiles = tiles;
+  m_coloredTiles.clear();
+  m_scalarTiles.clear();
+  // The calling thread calculates one of the tiles itself.
+  if (m_tiles > 1)
+    m_tilePool = make_shared<WorkerPool>("CellularLightingCalculator", m_tiles - 1);
+  else
+    m_tilePool.reset();
+}
+
+unsigned CellularLightingCalculator::tiles() const {
+  return m_tiles;
+}
+
 void CellularLightingCalculator::begin(RectI const& queryRegion) {
   m_queryRegion = queryRegion;
   if (m_monochrome) {
@@ -74,24 +101,12 @@ void CellularLightingCalculator::addPointLight(Vec2F const& position, Vec3F cons
 }
 
 void CellularLightingCalculator::calculate(Image& output) {
-  Vec2S arrayMin = Vec2S(m_queryRegion.min() - m_calculationRegion.min());
-  Vec2S arrayMax = Vec2S(m_queryRegion.max() - m_calculationRegion.min());
+  setupImage(output);
 
   if (m_monochrome)
-    m_lightArray.right().calculate(arrayMin[0], arrayMin[1], arrayMax[0], arrayMax[1]);
+    calculateTiles(m_lightArray.right(), m_scalarTiles, output);
   else
-    m_lightArray.left().calculate(arrayMin[0], arrayMin[1], arrayMax[0], arrayMax[1]);
-
-  output.reset(arrayMax[0] - arrayMin[0], arrayMax[1] - arrayMin[1], PixelFormat::RGB24);
-
-  for (size_t x = arrayMin[0]; x < arrayMax[0]; ++x) {
-    for (size_t y = arrayMin[1]; y < arrayMax[1]; ++y) {
-      if (m_monochrome)
-        output.set24(x - arrayMin[0], y - arrayMin[1], Color::grayf(m_lightArray.right().getLight(x, y)).toRgb());
-      else
-        output.set24(x - arrayMin[0], y - arrayMin[1], Color::v3fToByte(m_lightArray.left().getLight(x, y)));
-    }
-  }
+    calculateTiles(m_lightArray.left(), m_coloredTiles, output);
 }
 
 void CellularLightingCalculator::setupImage(Image& image, PixelFormat format) const {
@@ -101,6 +116,75 @@ void CellularLightingCalculator::setupImage(Image& image, PixelFormat format) co
   image.reset(arrayMax[0] - arrayMin[0], arrayMax[1] - arrayMin[1], format);
 }
 
+template <typename LightArray>
+void CellularLightingCalculator::calculateTiles(LightArray& lightArray, List<LightArray>& tiles, Image& output) {
+  Vec2S arrayMin = Vec2S(m_queryRegion.min() - m_calculationRegion.min());
+  Vec2S arrayMax = Vec2S(m_queryRegion.max() - m_calculationRegion.min());
+
+  // Writes the columns [xMin, xMax) of the light array to the output, where
+  // the given array starts at column xOffset of the full light array.
+  auto writeOutput = [&](LightArray const& array, size_t xOffset, size_t xMin, size_t xMax) {
+    for (size_t x = xMin; x < xMax; ++x) {
+      for (size_t y = arrayMin[1]; y < arrayMax[1]; ++y)
+        output.set24(x - arrayMin[0], y - arrayMin[1], lightPixel(array.getLight(x - xOffset, y)));
+    }
+  };
+
+  size_t queryWidth = arrayMax[0] - arrayMin[0];
+  size_t tileCount = min<size_t>(m_tiles, queryWidth);
+  if (tileCount <= 1 || !m_tilePool) {
+    lightArray.calculate(arrayMin[0], arrayMin[1], arrayMax[0], arrayMax[1]);
+    writeOutput(lightArray, 0, arrayMin[0], arrayMax[0]);
+    return;
+  }
+
+  // Light cannot travel further than the border distance, so a tile padded by
+  // it on both sides has all of the light that reaches its columns.  The
+  // extra cell keeps point lights in the last column of the padding, which
+  // the light array skips when they lie on its edge.  Dimmer colored channels
+  // can be carried along further by a brighter one, and are cut off at the
+  // tile edges the same way they are at the edges of the calculation region.
+  // Tiles write disjoint columns of the output, so they need no
+  // synchronization.
+  size_t border = lightArray.borderCells() + 1;
+  size_t arrayWidth = m_calculationRegion.width();
+  tiles.resize(tileCount);
+  auto calculateTile = [&](size_t i) {
+    size_t xMin = arrayMin[0] + queryWidth * i / tileCount;
+    size_t xMax = arrayMin[0] + queryWidth * (i + 1) / tileCount;
+    size_t tileXMin = xMin - min(xMin, border);
+    size_t tileXMax = min(arrayWidth, xMax + border);
+
+    LightArray& tile = tiles[i];
+    tile.beginColumns(lightArray, tileXMin, tileXMax);
+    tile.calculate(xMin - tileXMin, arrayMin[1], xMax - tileXMin, arrayMax[1]);
+    writeOutput(tile, tileXMin, xMin, xMax);
+  };
+
+  List<WorkerPoolHandle> handles;
+  for (size_t i = 1; i < tileCount; ++i)
+    handles.append(m_tilePool->addWork([&calculateTile, i]() { calculateTile(i); }, WorkerPoolPriority::High));
+
+  // Every tile must be finished before leaving, since they all reference this
+  // stack frame, so only the first exception is rethrown afterwards.
+  std::exception_ptr exception;
+  try {
+    calculateTile(0);
+  } catch (...) {
+    exception = std::current_exception();
+  }
+  for (auto const& handle : handles) {
+    try {
+      handle.finish();
+    } catch (...) {
+      if (!exception)
+        exception = std::current_exception();
+    }
+  }
+  if (exception)
+    std::rethrow_exception(exception);
+}
+
 void CellularLightIntensityCalculator::setParameters(Json const& config) {
   m_lightArray.setParameters(
       config.getInt("spreadPasses"),
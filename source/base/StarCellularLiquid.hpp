@@ -8,6 +8,7 @@
 #include "StarOrderedSet.hpp"
 #include "StarRandom.hpp"
 #include "StarBlockAllocator.hpp"
+#include "StarWorkerPool.hpp"
 
 namespace Star {
 
@@ -29,6 +30,8 @@ struct CellularLiquidSourceCell {
 template <typename LiquidId>
 using CellularLiquidCell = Variant<CellularLiquidCollisionCell, CellularLiquidFlowCell<LiquidId>, CellularLiquidSourceCell<LiquidId>>;
 
+// uniqueLocation, cell and drainLevel are only ever called from the thread
+// calling LiquidCellEngine::update, even when the update is parallel.
 template <typename LiquidId>
 struct CellularLiquidWorld {
   virtual ~CellularLiquidWorld();
@@ -81,6 +84,12 @@ public:
 
   void setProcessingLimit(Maybe<unsigned> processingLimit);
 
+  // Process independent regions of active cells in parallel on the given
+  // worker pool, split into at most the given number of batches at a time.  A
+  // null pool processes every active cell on the calling thread, bottom-up
+  // across the whole world.
+  void setWorkerPool(WorkerPoolPtr workerPool, unsigned batchCount);
+
   List<RectI> noProcessingLimitRegions() const;
   void setNoProcessingLimitRegions(List<RectI> noProcessingLimitRegions);
 
@@ -107,13 +116,51 @@ private:
     bool sourceCell;
     float level;
     float pressure;
+    // Only set for active cells
+    float drainLevel;
 
+    // Linked for active cells during setup, null if there is no adjacent flow
+    // or source cell.
     WorkingCell* leftCell;
     WorkingCell* rightCell;
     WorkingCell* topCell;
     WorkingCell* bottomCell;
   };
 
+  // Working cells are kept in flat arrays of RegionSize x RegionSize cells,
+  // which are reused between updates, rather than in a map of individual
+  // cells.  Regions are also the unit of parallel work.  An update only
+  // changes active cells and the cells adjacent to them, so regions that are
+  // at least one region apart never touch the same cells, and the active
+  // regions are split into four groups by the parity of their coordinates
+  // that can each be processed in parallel.  Regions with cells adjacent
+  // across a wrapping edge of the world go in a fifth group processed
+  // serially.  Without a worker pool, all active cells are instead gathered
+  // into a single serial region.
+  static int const RegionBits = 4;
+  static int const RegionSize = 1 << RegionBits;
+  static size_t const RegionGroupCount = 5;
+
+  struct WorkingRegion {
+    void reset();
+
+    Vec2I regionPosition;
+    bool used;
+    bool serial;
+
+    Array<Maybe<WorkingCell>, RegionSize * RegionSize> cells;
+    Array<bool, RegionSize * RegionSize> loaded;
+    List<uint16_t> loadedIndexes;
+
+    // Active cells in this region, and everything produced while processing
+    // them, which is only ever touched by the thread processing the region.
+    List<WorkingCell*> activeCells;
+    RandomSource random;
+    List<Vec2I> nextActiveCells;
+    List<tuple<Vec2I, LiquidId, Vec2I, LiquidId>> liquidInteractions;
+    List<tuple<Vec2I, LiquidId, Vec2I>> liquidCollisions;
+  };
+
   template <typename Key, typename Value>
   using BAHashMap = StableHashMap<Key, Value, hash<Key>, std::equal_to<Key>, BlockAllocator<pair<Key const, Value>, 4096>>;
 
@@ -124,22 +171,28 @@ private:
   using BAOrderedHashSet = OrderedHashSet<Value, hash<Value>, std::equal_to<Value>, BlockAllocator<Value, 4096>>;
 
   void setup();
-  void applyPressure();
-  void spreadPressure();
-  void limitPressure();
-  void pressureMove();
-  void spreadOverfill();
-  void levelMove();
-  void findInteractions();
+  void applyPressure(WorkingRegion& region);
+  void spreadPressure(WorkingRegion& region);
+  void limitPressure(WorkingRegion& region);
+  void pressureMove(WorkingRegion& region);
+  void spreadOverfill(WorkingRegion& region);
+  void levelMove(WorkingRegion& region);
+  void findInteractions(WorkingRegion& region);
   void finish();
 
+  // Runs the given pass over every active region, one region group at a time.
+  void processRegions(void (LiquidCellEngine::*pass)(WorkingRegion&));
+
+  static Vec2I regionPositionFor(Vec2I const& p);
+  WorkingRegion* workingRegion(Vec2I const& regionPosition);
+
   WorkingCell* workingCell(Vec2I p);
   WorkingCell* adjacentCell(WorkingCell* cell, Adjacency adjacency);
 
-  void setPressure(float pressure, WorkingCell& cell);
-  void transferPressure(float amount, WorkingCell& source, WorkingCell& dest, bool allowReverse);
-  void transferLevel(float amount, WorkingCell& source, WorkingCell& dest, bool allowReverse);
-  void setLevel(float level, WorkingCell& cell);
+  void setPressure(float pressure, WorkingCell& cell, WorkingRegion& region);
+  void transferPressure(float amount, WorkingCell& source, WorkingCell& dest, bool allowReverse, WorkingRegion& region);
+  void transferLevel(float amount, WorkingCell& source, WorkingCell& dest, bool allowReverse, WorkingRegion& region);
+  void setLevel(float level, WorkingCell& cell, WorkingRegion& region);
 
   RandomSource m_random;
   LiquidCellEngineParameters m_engineParameters;
@@ -151,8 +204,13 @@ private:
   List<RectI> m_noProcessingLimitRegions;
   uint64_t m_step;
 
-  BAHashMap<Vec2I, Maybe<WorkingCell>> m_workingCells;
-  List<WorkingCell*> m_currentActiveCells;
+  WorkerPoolPtr m_workerPool;
+  unsigned m_batchCount;
+
+  StableHashMap<Vec2I, unique_ptr<WorkingRegion>> m_workingRegions;
+  WorkingRegion* m_lastWorkingRegion;
+  Array<List<WorkingRegion*>, RegionGroupCount> m_regionGroups;
+  WorkingRegion m_serialRegion;
   BAHashSet<Vec2I> m_nextActiveCells;
   BAHashSet<tuple<Vec2I, LiquidId, Vec2I, LiquidId>> m_liquidInteractions;
   BAHashSet<tuple<Vec2I, LiquidId, Vec2I>> m_liquidCollisions;
@@ -179,7 +237,7 @@ void CellularLiquidWorld<LiquidId>::liquidCollision(Vec2I const&, LiquidId, Vec2
 
 template <typename LiquidId>
 LiquidCellEngine<LiquidId>::LiquidCellEngine(LiquidCellEngineParameters parameters, CellularLiquidWorldPtr cellWorld)
-  : m_engineParameters(parameters), m_cellWorld(cellWorld), m_step(0) {}
+  : m_engineParameters(parameters), m_cellWorld(cellWorld), m_step(0), m_batchCount(1), m_lastWorkingRegion(nullptr) {}
 
 template <typename LiquidId>
 unsigned LiquidCellEngine<LiquidId>::liquidTickDelta(LiquidId liquid) {
@@ -196,6 +254,12 @@ void LiquidCellEngine<LiquidId>::setProcessingLimit(Maybe<unsigned> processingLi
   m_processingLimit = processingLimit;
 }
 
+template <typename LiquidId>
+void LiquidCellEngine<LiquidId>::setWorkerPool(WorkerPoolPtr workerPool, unsigned batchCount) {
+  m_workerPool = std::move(workerPool);
+  m_batchCount = max(batchCount, 1u);
+}
+
 template <typename LiquidId>
 List<RectI> LiquidCellEngine<LiquidId>::noProcessingLimitRegions() const {
   return m_noProcessingLimitRegions;
@@ -222,13 +286,13 @@ void LiquidCellEngine<LiquidId>::visitRegion(RectI const& region) {
 template <typename LiquidId>
 void LiquidCellEngine<LiquidId>::update() {
   setup();
-  applyPressure();
-  spreadPressure();
-  limitPressure();
-  pressureMove();
-  spreadOverfill();
-  levelMove();
-  findInteractions();
+  processRegions(&LiquidCellEngine::applyPressure);
+  processRegions(&LiquidCellEngine::spreadPressure);
+  processRegions(&LiquidCellEngine::limitPressure);
+  processRegions(&LiquidCellEngine::pressureMove);
+  processRegions(&LiquidCellEngine::spreadOverfill);
+  processRegions(&LiquidCellEngine::levelMove);
+  processRegions(&LiquidCellEngine::findInteractions);
   finish();
 
   ++m_step;
@@ -256,13 +320,36 @@ bool LiquidCellEngine<LiquidId>::isActive(Vec2I const& pos) const {
   return false;
 }
 
+template <typename LiquidId>
+void LiquidCellEngine<LiquidId>::WorkingRegion::reset() {
+  serial = false;
+  for (auto index : loadedIndexes)
+    loaded[index] = false;
+  loadedIndexes.clear();
+  activeCells.clear();
+  nextActiveCells.clear();
+  liquidInteractions.clear();
+  liquidCollisions.clear();
+}
+
 template <typename LiquidId>
 void LiquidCellEngine<LiquidId>::setup() {
-  // In case an exception occurred during the last update, clear potentially
-  // stale data here
-  m_workingCells.clear();
-  m_currentActiveCells.clear();
+  // Regions not used by the last update are freed, the rest are kept for
+  // their storage.  In case an exception occurred during the last update,
+  // this also clears potentially stale data.
+  eraseWhere(m_workingRegions, [](auto const& p) {
+      return !p.second->used;
+    });
+  for (auto& p : m_workingRegions) {
+    p.second->used = false;
+    p.second->reset();
+  }
+  m_lastWorkingRegion = nullptr;
+  for (auto& group : m_regionGroups)
+    group.clear();
+  m_serialRegion.reset();
 
+  List<WorkingRegion*> activeRegions;
   for (auto& activeCellsPair : m_activeCells) {
     unsigned tickDelta = liquidTickDelta(activeCellsPair.first);
     if (tickDelta == 0 || m_step % tickDelta != 0)
@@ -288,45 +375,130 @@ void LiquidCellEngine<LiquidId>::setup() {
       }
 
       auto cell = workingCell(pos);
-      if (!cell || cell->liquid != activeCellsPair.first) {
-        activeCellsPair.second.remove(pos);
-      } else {
-        m_currentActiveCells.append(cell);
-        activeCellsPair.second.remove(pos);
+      if (cell && cell->liquid == activeCellsPair.first) {
+        auto region = workingRegion(regionPositionFor(cell->position));
+        if (region->activeCells.empty())
+          activeRegions.append(region);
+        region->activeCells.append(cell);
       }
+      activeCellsPair.second.remove(pos);
     }
   }
 
-  sort(m_currentActiveCells, [](WorkingCell* lhs, WorkingCell* rhs) {
-      return lhs->position[1] < rhs->position[1];
-    });
+  // Everything that needs the cell world is done here, so that the passes
+  // only ever touch working cells.
+  for (auto region : activeRegions) {
+    for (auto cell : region->activeCells) {
+      cell->leftCell = workingCell(cell->position + Vec2I(-1, 0));
+      cell->rightCell = workingCell(cell->position + Vec2I(1, 0));
+      cell->bottomCell = workingCell(cell->position + Vec2I(0, -1));
+      cell->topCell = workingCell(cell->position + Vec2I(0, 1));
+      cell->drainLevel = m_cellWorld->drainLevel(cell->position);
+
+      for (auto adjacent : {cell->leftCell, cell->rightCell, cell->bottomCell, cell->topCell}) {
+        if (!adjacent)
+          continue;
+        Vec2I adjacentRegionPosition = regionPositionFor(adjacent->position);
+        Vec2I offset = adjacentRegionPosition - region->regionPosition;
+        if (abs(offset[0]) > 1 || abs(offset[1]) > 1) {
+          region->serial = true;
+          workingRegion(adjacentRegionPosition)->serial = true;
+        }
+      }
+    }
+  }
+
+  auto sortActiveCells = [](WorkingRegion& region) {
+    sort(region.activeCells, [](WorkingCell* lhs, WorkingCell* rhs) {
+        return lhs->position[1] < rhs->position[1];
+      });
+  };
+
+  if (!m_workerPool) {
+    for (auto region : activeRegions)
+      m_serialRegion.activeCells.appendAll(take(region->activeCells));
+    sortActiveCells(m_serialRegion);
+    m_serialRegion.random.init(m_random.randu64());
+    m_regionGroups[RegionGroupCount - 1].append(&m_serialRegion);
+    return;
+  }
+
+  for (auto region : activeRegions) {
+    sortActiveCells(*region);
+    region->random.init(m_random.randu64());
+    if (region->serial)
+      m_regionGroups[RegionGroupCount - 1].append(region);
+    else
+      m_regionGroups[(region->regionPosition[0] & 1) + 2 * (region->regionPosition[1] & 1)].append(region);
+  }
+}
+
+template <typename LiquidId>
+void LiquidCellEngine<LiquidId>::processRegions(void (LiquidCellEngine::*pass)(WorkingRegion&)) {
+  for (size_t i = 0; i < RegionGroupCount; ++i) {
+    auto const& group = m_regionGroups[i];
+    size_t batchCount = min<size_t>(m_batchCount, group.size());
+    if (!m_workerPool || i == RegionGroupCount - 1 || batchCount <= 1) {
+      for (auto region : group)
+        (this->*pass)(*region);
+      continue;
+    }
+
+    auto runBatch = [&](size_t batch) {
+      for (size_t j = batch * group.size() / batchCount; j < (batch + 1) * group.size() / batchCount; ++j)
+        (this->*pass)(*group[j]);
+    };
+
+    List<WorkerPoolHandle> handles;
+    for (size_t batch = 1; batch < batchCount; ++batch)
+      handles.append(m_workerPool->addWork([&runBatch, batch]() { runBatch(batch); }));
+
+    // Every job references this stack frame, so all of them must be finished
+    // before an exception can be propagated.
+    std::exception_ptr exception;
+    try {
+      runBatch(0);
+    } catch (...) {
+      exception = std::current_exception();
+    }
+    for (auto const& handle : handles) {
+      try {
+        handle.finish();
+      } catch (...) {
+        if (!exception)
+          exception = std::current_exception();
+      }
+    }
+    if (exception)
+      std::rethrow_exception(exception);
+  }
 }
 
 template <typename LiquidId>
-void LiquidCellEngine<LiquidId>::applyPressure() {
-  for (auto const& selfCell : m_currentActiveCells) {
+void LiquidCellEngine<LiquidId>::applyPressure(WorkingRegion& region) {
+  for (auto const& selfCell : region.activeCells) {
     if (!selfCell->liquid || selfCell->sourceCell)
       continue;
 
     auto topCell = adjacentCell(selfCell, Adjacency::Top);
     if (topCell && selfCell->liquid == topCell->liquid)
-      setPressure(max(selfCell->pressure, topCell->pressure + min(topCell->level, 1.0f)), *selfCell);
+      setPressure(max(selfCell->pressure, topCell->pressure + min(topCell->level, 1.0f)), *selfCell, region);
   }
 }
 
 template <typename LiquidId>
-void LiquidCellEngine<LiquidId>::spreadPressure() {
-  for (auto const& selfCell : m_currentActiveCells) {
+void LiquidCellEngine<LiquidId>::spreadPressure(WorkingRegion& region) {
+  for (auto const& selfCell : region.activeCells) {
     if (!selfCell->liquid)
       continue;
 
     auto spreadPressure = [&](Adjacency adjacency, float bias) {
       auto targetCell = adjacentCell(selfCell, adjacency);
       if (targetCell && !targetCell->sourceCell)
-        transferPressure((selfCell->pressure + bias - targetCell->pressure) * m_engineParameters.pressureEqualizeFactor, *selfCell, *targetCell, true);
+        transferPressure((selfCell->pressure + bias - targetCell->pressure) * m_engineParameters.pressureEqualizeFactor, *selfCell, *targetCell, true, region);
     };
 
-    if (m_random.randb()) {
+    if (region.random.randb()) {
       spreadPressure(Adjacency::Left, 0.0f);
       spreadPressure(Adjacency::Right, 0.0f);
     } else {
@@ -340,23 +512,23 @@ void LiquidCellEngine<LiquidId>::spreadPressure() {
 }
 
 template <typename LiquidId>
-void LiquidCellEngine<LiquidId>::limitPressure() {
-  for (auto const& selfCell : m_currentActiveCells) {
+void LiquidCellEngine<LiquidId>::limitPressure(WorkingRegion& region) {
+  for (auto const& selfCell : region.activeCells) {
     float level = min(selfCell->level, 1.0f);
     auto topCell = adjacentCell(selfCell, Adjacency::Top);
 
     // Force the pressure to the cell level if there is empty space above,
     // otherwise simply make sure the pressure is at least the level
     if (topCell && !topCell->liquid)
-      setPressure(level, *selfCell);
+      setPressure(level, *selfCell, region);
     else
-      setPressure(max(selfCell->pressure, level), *selfCell);
+      setPressure(max(selfCell->pressure, level), *selfCell, region);
   }
 }
 
 template <typename LiquidId>
-void LiquidCellEngine<LiquidId>::pressureMove() {
-  for (auto const& selfCell : m_currentActiveCells) {
+void LiquidCellEngine<LiquidId>::pressureMove(WorkingRegion& region) {
+  for (auto const& selfCell : region.activeCells) {
     if (!selfCell->liquid)
       continue;
 
@@ -366,11 +538,11 @@ void LiquidCellEngine<LiquidId>::pressureMove() {
         float amount = (selfCell->pressure - targetCell->pressure) * m_engineParameters.pressureMoveFactor;
         amount = min(amount, selfCell->level - (1.0f - m_engineParameters.maximumPressureLevelImbalance));
         amount = min(amount, (1.0f + m_engineParameters.maximumPressureLevelImbalance) - targetCell->level);
-        transferLevel(amount, *selfCell, *targetCell, false);
+        transferLevel(amount, *selfCell, *targetCell, false, region);
       }
     };
 
-    if (m_random.randb()) {
+    if (region.random.randb()) {
       pressureMove(Adjacency::Left);
       pressureMove(Adjacency::Right);
     } else {
@@ -381,8 +553,8 @@ void LiquidCellEngine<LiquidId>::pressureMove() {
 }
 
 template <typename LiquidId>
-void LiquidCellEngine<LiquidId>::spreadOverfill() {
-  for (auto const& selfCell : m_currentActiveCells) {
+void LiquidCellEngine<LiquidId>::spreadOverfill(WorkingRegion& region) {
+  for (auto const& selfCell : region.activeCells) {
     if (!selfCell->liquid || selfCell->sourceCell)
       continue;
 
@@ -391,13 +563,13 @@ void LiquidCellEngine<LiquidId>::spreadOverfill() {
       if (overfill > 0.0f) {
         auto targetCell = adjacentCell(selfCell, adjacency);
         if (targetCell)
-          transferLevel(min(overfill, (selfCell->level - targetCell->level)) * factor, *selfCell, *targetCell, false);
+          transferLevel(min(overfill, (selfCell->level - targetCell->level)) * factor, *selfCell, *targetCell, false, region);
       }
     };
 
     spreadOverfill(Adjacency::Top, m_engineParameters.spreadOverfillUpFactor);
 
-    if (m_random.randb()) {
+    if (region.random.randb()) {
       spreadOverfill(Adjacency::Left, m_engineParameters.spreadOverfillLateralFactor);
       spreadOverfill(Adjacency::Right, m_engineParameters.spreadOverfillLateralFactor);
     } else {
@@ -410,24 +582,24 @@ void LiquidCellEngine<LiquidId>::spreadOverfill() {
 }
 
 template <typename LiquidId>
-void LiquidCellEngine<LiquidId>::levelMove() {
-  for (auto const& selfCell : m_currentActiveCells) {
+void LiquidCellEngine<LiquidId>::levelMove(WorkingRegion& region) {
+  for (auto const& selfCell : region.activeCells) {
     if (!selfCell->liquid)
       continue;
 
     auto belowCell = adjacentCell(selfCell, Adjacency::Bottom);
     if (belowCell)
-      transferLevel(min(1.0f - belowCell->level, selfCell->level), *selfCell, *belowCell, false);
+      transferLevel(min(1.0f - belowCell->level, selfCell->level), *selfCell, *belowCell, false, region);
 
-    setLevel(selfCell->level * (1.0f - m_cellWorld->drainLevel(selfCell->position)), *selfCell);
+    setLevel(selfCell->level * (1.0f - selfCell->drainLevel), *selfCell, region);
 
     auto lateralMove = [&](Adjacency adjacency) {
       auto targetCell = adjacentCell(selfCell, adjacency);
       if (targetCell)
-        transferLevel((selfCell->level - targetCell->level) * m_engineParameters.lateralMoveFactor, *selfCell, *targetCell, false);
+        transferLevel((selfCell->level - targetCell->level) * m_engineParameters.lateralMoveFactor, *selfCell, *targetCell, false, region);
     };
 
-    if (m_random.randb()) {
+    if (region.random.randb()) {
       lateralMove(Adjacency::Left);
       lateralMove(Adjacency::Right);
     } else {
@@ -438,8 +610,8 @@ void LiquidCellEngine<LiquidId>::levelMove() {
 }
 
 template <typename LiquidId>
-void LiquidCellEngine<LiquidId>::findInteractions() {
-  for (auto const& selfCell : m_currentActiveCells) {
+void LiquidCellEngine<LiquidId>::findInteractions(WorkingRegion& region) {
+  for (auto const& selfCell : region.activeCells) {
     if (!selfCell->liquid)
       continue;
 
@@ -455,7 +627,7 @@ void LiquidCellEngine<LiquidId>::findInteractions() {
           adjacentPos += Vec2I(0, -1);
         else if (adjacency == Adjacency::Top)
           adjacentPos += Vec2I(0, 1);
-        m_liquidCollisions.add(make_tuple(selfCell->position, *selfCell->liquid, adjacentPos));
+        region.liquidCollisions.append(make_tuple(selfCell->position, *selfCell->liquid, adjacentPos));
 
       } else if (targetCell->liquid && *targetCell->liquid != *selfCell->liquid) {
         if (targetCell->level <= m_engineParameters.interactTransformationLevel
@@ -468,9 +640,9 @@ void LiquidCellEngine<LiquidId>::findInteractions() {
           // Make sure to add the point pair in a predictable order so that any
           // combination of Vec2I points will be unique in m_liquidInteractions
           if (selfCell->position < targetCell->position)
-            m_liquidInteractions.add(make_tuple(selfCell->position, *selfCell->liquid, targetCell->position, *targetCell->liquid));
+            region.liquidInteractions.append(make_tuple(selfCell->position, *selfCell->liquid, targetCell->position, *targetCell->liquid));
           else
-            m_liquidInteractions.add(make_tuple(targetCell->position, *targetCell->liquid, selfCell->position, *selfCell->liquid));
+            region.liquidInteractions.append(make_tuple(targetCell->position, *targetCell->liquid, selfCell->position, *selfCell->liquid));
         }
       }
     }
@@ -479,26 +651,47 @@ void LiquidCellEngine<LiquidId>::findInteractions() {
 
 template <typename LiquidId>
 void LiquidCellEngine<LiquidId>::finish() {
-  m_currentActiveCells.clear();
-
-  for (auto& workingCellPair : take(m_workingCells)) {
-    if (workingCellPair.second && !workingCellPair.second->sourceCell) {
-      if (workingCellPair.second->liquid) {
-        if (workingCellPair.second->level < m_engineParameters.minimumLiquidLevel)
-          workingCellPair.second->level = 0.0f;
-      } else {
-        workingCellPair.second->level = 0.0f;
-      }
+  for (auto& group : m_regionGroups)
+    group.clear();
+
+  auto mergeRegionResults = [this](WorkingRegion& region) {
+    m_nextActiveCells.addAll(take(region.nextActiveCells));
+    for (auto& interaction : take(region.liquidInteractions))
+      m_liquidInteractions.add(std::move(interaction));
+    for (auto& collision : take(region.liquidCollisions))
+      m_liquidCollisions.add(std::move(collision));
+  };
 
-      if (workingCellPair.second->level == 0.0f) {
-        workingCellPair.second->liquid = {};
-        workingCellPair.second->pressure = 0.0f;
-      }
+  for (auto& regionPair : m_workingRegions) {
+    auto& region = *regionPair.second;
+    for (auto index : region.loadedIndexes) {
+      auto& workingCell = region.cells[index];
+      if (workingCell && !workingCell->sourceCell) {
+        if (workingCell->liquid) {
+          if (workingCell->level < m_engineParameters.minimumLiquidLevel)
+            workingCell->level = 0.0f;
+        } else {
+          workingCell->level = 0.0f;
+        }
+
+        if (workingCell->level == 0.0f) {
+          workingCell->liquid = {};
+          workingCell->pressure = 0.0f;
+        }
 
-      m_cellWorld->setFlow(workingCellPair.second->position, CellularLiquidFlowCell<LiquidId>{
-          workingCellPair.second->liquid, workingCellPair.second->level, workingCellPair.second->pressure});
+        m_cellWorld->setFlow(workingCell->position, CellularLiquidFlowCell<LiquidId>{
+            workingCell->liquid, workingCell->level, workingCell->pressure});
+      }
     }
+
+    mergeRegionResults(region);
+
+    // Cells needed from here on are loaded from the cell world again.
+    region.reset();
   }
+  m_lastWorkingRegion = nullptr;
+  mergeRegionResults(m_serialRegion);
+  m_serialRegion.reset();
 
   for (auto const& interaction : take(m_liquidInteractions))
     m_cellWorld->liquidInteraction(get<0>(interaction), get<1>(interaction), get<2>(interaction), get<3>(interaction));
@@ -526,57 +719,79 @@ void LiquidCellEngine<LiquidId>::finish() {
     });
 }
 
+template <typename LiquidId>
+Vec2I LiquidCellEngine<LiquidId>::regionPositionFor(Vec2I const& p) {
+  return Vec2I(p[0] >> RegionBits, p[1] >> RegionBits);
+}
+
+template <typename LiquidId>
+typename LiquidCellEngine<LiquidId>::WorkingRegion* LiquidCellEngine<LiquidId>::workingRegion(Vec2I const& regionPosition) {
+  if (m_lastWorkingRegion && m_lastWorkingRegion->regionPosition == regionPosition)
+    return m_lastWorkingRegion;
+
+  auto& region = m_workingRegions[regionPosition];
+  if (!region) {
+    region = make_unique<WorkingRegion>();
+    region->regionPosition = regionPosition;
+    region->used = false;
+    region->loaded.fill(false);
+    region->reset();
+  }
+  region->used = true;
+  m_lastWorkingRegion = region.get();
+  return m_lastWorkingRegion;
+}
+
 template <typename LiquidId>
 typename LiquidCellEngine<LiquidId>::WorkingCell* LiquidCellEngine<LiquidId>::workingCell(Vec2I p) {
   p = m_cellWorld->uniqueLocation(p);
 
-  auto res = m_workingCells.insert(make_pair(p, Maybe<WorkingCell>()));
-  if (res.second) {
+  auto region = workingRegion(regionPositionFor(p));
+  uint16_t index = (p[0] & (RegionSize - 1)) * RegionSize + (p[1] & (RegionSize - 1));
+  auto& cell = region->cells[index];
+  if (!region->loaded[index]) {
+    region->loaded[index] = true;
+    region->loadedIndexes.append(index);
+
+    cell.reset();
     auto cellData = m_cellWorld->cell(p);
     if (auto flowCell = cellData.template ptr<CellularLiquidFlowCell<LiquidId>>())
-      res.first->second = WorkingCell{p, flowCell->liquid, false, flowCell->level, flowCell->pressure, nullptr, nullptr, nullptr, nullptr};
+      cell = WorkingCell{p, flowCell->liquid, false, flowCell->level, flowCell->pressure, 0.0f, nullptr, nullptr, nullptr, nullptr};
     else if (auto sourceCell = cellData.template ptr<CellularLiquidSourceCell<LiquidId>>())
-      res.first->second = WorkingCell{p, sourceCell->liquid, true, 1.0f, sourceCell->pressure, nullptr, nullptr, nullptr, nullptr};
+      cell = WorkingCell{p, sourceCell->liquid, true, 1.0f, sourceCell->pressure, 0.0f, nullptr, nullptr, nullptr, nullptr};
   }
-  return res.first->second.ptr();
+  return cell.ptr();
 }
 
 template <typename LiquidId>
 typename LiquidCellEngine<LiquidId>::WorkingCell* LiquidCellEngine<LiquidId>::adjacentCell(
     WorkingCell* cell, Adjacency adjacency) {
-  auto getCell = [this](WorkingCell*& cellptr, Vec2I cellPos) {
-    if (cellptr)
-      return cellptr;
-    cellptr = workingCell(cellPos);
-    return cellptr;
-  };
-
   if (adjacency == Adjacency::Left)
-    return getCell(cell->leftCell, cell->position + Vec2I(-1, 0));
+    return cell->leftCell;
   else if (adjacency == Adjacency::Right)
-    return getCell(cell->rightCell, cell->position + Vec2I(1, 0));
+    return cell->rightCell;
   else if (adjacency == Adjacency::Bottom)
-    return getCell(cell->bottomCell, cell->position + Vec2I(0, -1));
+    return cell->bottomCell;
   else if (adjacency == Adjacency::Top)
-    return getCell(cell->topCell, cell->position + Vec2I(0, 1));
+    return cell->topCell;
 
   return nullptr;
 }
 
 template <typename LiquidId>
-void LiquidCellEngine<LiquidId>::setPressure(float pressure, WorkingCell& cell) {
+void LiquidCellEngine<LiquidId>::setPressure(float pressure, WorkingCell& cell, WorkingRegion& region) {
   if (!cell.liquid || cell.sourceCell)
     return;
 
   if (fabs(cell.pressure - pressure) > m_engineParameters.minimumLivenPressureChange)
-    m_nextActiveCells.add(cell.position);
+    region.nextActiveCells.append(cell.position);
   cell.pressure = pressure;
 }
 
 template <typename LiquidId>
-void LiquidCellEngine<LiquidId>::transferPressure(float amount, WorkingCell& source, WorkingCell& dest, bool allowReverse) {
+void LiquidCellEngine<LiquidId>::transferPressure(float amount, WorkingCell& source, WorkingCell& dest, bool allowReverse, WorkingRegion& region) {
   if (amount < 0.0f && allowReverse) {
-    return transferPressure(-amount, dest, source, false);
+    return transferPressure(-amount, dest, source, false, region);
   } else if (amount > 0.0f) {
     if (!source.liquid)
       return;
@@ -596,19 +811,19 @@ void LiquidCellEngine<LiquidId>::transferPressure(float amount, WorkingCell& sou
       dest.pressure += amount;
 
     if (amount > m_engineParameters.minimumLivenPressureChange) {
-      m_nextActiveCells.add(source.position);
-      m_nextActiveCells.add(dest.position);
+      region.nextActiveCells.append(source.position);
+      region.nextActiveCells.append(dest.position);
     }
   }
 }
 
 template <typename LiquidId>
-void LiquidCellEngine<LiquidId>::setLevel(float level, WorkingCell& cell) {
+void LiquidCellEngine<LiquidId>::setLevel(float level, WorkingCell& cell, WorkingRegion& region) {
   if (!cell.liquid || cell.sourceCell)
     return;
 
   if (fabs(cell.level - level) > m_engineParameters.minimumLivenLevelChange)
-    m_nextActiveCells.add(cell.position);
+    region.nextActiveCells.append(cell.position);
 
   cell.level = level;
 
@@ -620,9 +835,9 @@ void LiquidCellEngine<LiquidId>::setLevel(float level, WorkingCell& cell) {
 
 template <typename LiquidId>
 void LiquidCellEngine<LiquidId>::transferLevel(
-    float amount, WorkingCell& source, WorkingCell& dest, bool allowReverse) {
+    float amount, WorkingCell& source, WorkingCell& dest, bool allowReverse, WorkingRegion& region) {
   if (amount < 0.0f && allowReverse) {
-    transferLevel(-amount, dest, source, false);
+    transferLevel(-amount, dest, source, false, region);
 
   } else if (amount > 0.0f) {
     if (!source.liquid)
@@ -647,8 +862,8 @@ void LiquidCellEngine<LiquidId>::transferLevel(
       source.liquid = {};
 
     if (amount > m_engineParameters.minimumLivenLevelChange) {
-      m_nextActiveCells.add(source.position);
-      m_nextActiveCells.add(dest.position);
+      region.nextActiveCells.append(source.position);
+      region.nextActiveCells.append(dest.position);
     }
   }
 }
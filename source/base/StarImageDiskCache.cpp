@@ -0,0 +1,172 @@
+#include "StarImageDiskCache.hpp"
+#include "StarFile.hpp"
+#include "StarSha256.hpp"
+#include "StarEncode.hpp"
+#include "StarDataStreamDevices.hpp"
+#include "StarLogging.hpp"
+#include "StarRandom.hpp"
+
+namespace Star {
+
+static char const* const ImageDiskCacheIndexFile = "index";
+static char const* const ImageDiskCacheExtension = ".image";
+// Images are written to a temporary file first, which is left behind if the
+// write is interrupted.
+static char const* const ImageDiskCacheTemporaryExtension = ".new";
+static char const ImageDiskCacheMagic[] = "SBIMGC01";
+static size_t const ImageDiskCacheMagicSize = sizeof(ImageDiskCacheMagic) - 1;
+
+ImageDiskCache::ImageDiskCache(String directory, uint64_t sizeLimit)
+  : m_directory(std::move(directory)), m_sizeLimit(sizeLimit), m_totalSize(0), m_indexChanged(false) {
+  if (!File::isDirectory(m_directory))
+    File::makeDirectoryRecursive(m_directory);
+
+  StringList indexedFiles;
+  String indexPath = filePath(ImageDiskCacheIndexFile);
+  if (File::isFile(indexPath)) {
+    try {
+      DataStreamBuffer::deserializeContainer(indexedFiles, File::readFile(indexPath));
+    } catch (std::exception const& e) {
+      Logger::warn("ImageDiskCache: Could not read index in '{}', ignoring: {}", m_directory, outputException(e, false));
+      indexedFiles.clear();
+    }
+  }
+
+  // Images that are missing from the index, for example because the last
+  // session did not shut down cleanly, are treated as least recently used.
+  StringSet indexedFileSet = StringSet::from(indexedFiles);
+  for (auto const& entry : File::dirList(m_directory)) {
+    if (entry.second)
+      continue;
+    if (entry.first.endsWith(ImageDiskCacheExtension) && !indexedFileSet.contains(entry.first))
+      m_entries.set(entry.first, File::fileSize(filePath(entry.first)));
+    else if (entry.first.endsWith(ImageDiskCacheTemporaryExtension))
+      File::remove(filePath(entry.first));
+  }
+  for (auto const& fileName : indexedFiles) {
+    String path = filePath(fileName);
+    if (File::isFile(path))
+      m_entries.set(fileName, File::fileSize(path));
+  }
+
+  for (auto const& entry : m_entries)
+    m_totalSize += entry.second;
+
+  MutexLocker locker(m_mutex);
+  evict();
+}
+
+ImageDiskCache::~ImageDiskCache() {
+  try {
+    flush();
+  } catch (std::exception const& e) {
+    Logger::warn("ImageDiskCache: Could not write index in '{}': {}", m_directory, outputException(e, false));
+  }
+}
+
+Maybe<Image> ImageDiskCache::load(String const& key) {
+  String name = fileName(key);
+  {
+    MutexLocker locker(m_mutex);
+    if (!m_entries.contains(name))
+      return {};
+    m_entries.toBack(name);
+    m_indexChanged = true;
+  }
+
+  try {
+    DataStreamBuffer ds(File::readFile(filePath(name)));
+    if (ds.readBytes(ImageDiskCacheMagicSize) != ByteArray(ImageDiskCacheMagic, ImageDiskCacheMagicSize))
+      throw ImageException("Bad magic");
+
+    auto pixelFormat = (PixelFormat)ds.read<uint8_t>();
+    auto width = ds.read<uint32_t>();
+    auto height = ds.read<uint32_t>();
+    Image image(width, height, pixelFormat);
+    ds.readData((char*)image.data(), (size_t)width * height * image.bytesPerPixel());
+    return image;
+  } catch (std::exception const& e) {
+    // The file may have been removed by another thread since, otherwise it is
+    // unreadable and should not be tried again.
+    Logger::debug("ImageDiskCache: Could not read '{}': {}", name, outputException(e, false));
+    MutexLocker locker(m_mutex);
+    if (m_entries.contains(name))
+      remove(name);
+    return {};
+  }
+}
+
+void ImageDiskCache::store(String const& key, Image const& image) {
+  String name = fileName(key);
+
+  DataStreamBuffer ds;
+  ds.writeData(ImageDiskCacheMagic, ImageDiskCacheMagicSize);
+  ds.write<uint8_t>((uint8_t)image.pixelFormat());
+  ds.write<uint32_t>(image.width());
+  ds.write<uint32_t>(image.height());
+  ds.writeData((char const*)image.data(), (size_t)image.width() * image.height() * image.bytesPerPixel());
+
+  if (ds.size() > m_sizeLimit)
+    return;
+
+  // Written without holding the lock, through a temporary file of its own so
+  // that other threads storing the same image do not write to it as well.
+  File::overwriteFileWithRename(ds.data(), filePath(name), strf(".{:016x}{}", Random::randu64(), ImageDiskCacheTemporaryExtension));
+
+  MutexLocker locker(m_mutex);
+  if (auto size = m_entries.maybe(name))
+    m_totalSize -= *size;
+  m_entries.set(name, ds.size());
+  m_entries.toBack(name);
+  m_totalSize += ds.size();
+  m_indexChanged = true;
+
+  evict();
+}
+
+void ImageDiskCache::flush() {
+  MutexLocker locker(m_mutex);
+  if (!m_indexChanged)
+    return;
+
+  File::overwriteFileWithRename(DataStreamBuffer::serializeContainer(m_entries.keys()), filePath(ImageDiskCacheIndexFile));
+  m_indexChanged = false;
+}
+
+size_t ImageDiskCache::count() const {
+  MutexLocker locker(m_mutex);
+  return m_entries.size();
+}
+
+uint64_t ImageDiskCache::totalSize() const {
+  MutexLocker locker(m_mutex);
+  return m_totalSize;
+}
+
+String ImageDiskCache::fileName(String const& key) {
+  return hexEncode(sha256(key)) + ImageDiskCacheExtension;
+}
+
+String ImageDiskCache::filePath(String const& fileName) const {
+  return File::relativeTo(m_directory, fileName);
+}
+
+void ImageDiskCache::evict() {
+  while (m_totalSize > m_sizeLimit && !m_entries.empty()) {
+    // Copied, since removing the entry destroys the key.
+    String fileName = m_entries.firstKey();
+    remove(fileName);
+  }
+}
+
+void ImageDiskCache::remove(String const& fileName) {
+  m_totalSize -= m_entries.take(fileName);
+  m_indexChanged = true;
+  try {
+    File::remove(filePath(fileName));
+  } catch (IOException const& e) {
+    Logger::debug("ImageDiskCache: Could not remove '{}': {}", fileName, outputException(e, false));
+  }
+}
+
+}
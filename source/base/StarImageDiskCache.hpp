@@ -0,0 +1,56 @@
+#ifndef STAR_IMAGE_DISK_CACHE_HPP
+#define STAR_IMAGE_DISK_CACHE_HPP
+
+#include "StarImage.hpp"
+#include "StarOrderedMap.hpp"
+#include "StarThread.hpp"
+
+namespace Star {
+
+STAR_CLASS(ImageDiskCache);
+
+// Keeps images in a directory between sessions.  Each image is stored in its
+// own file named after the sha256 of its key, so keys should include
+// everything the image depends on.  Once the total size of the stored images
+// goes over the size limit, the least recently used ones are removed.  The
+// order in which images were used is saved to an index file in the same
+// directory on flush and on destruction.
+//
+// ImageDiskCache is thread safe.
+class ImageDiskCache {
+public:
+  ImageDiskCache(String directory, uint64_t sizeLimit);
+  ~ImageDiskCache();
+
+  // Returns the image stored under the given key, if there is one, and marks
+  // it as the most recently used.
+  Maybe<Image> load(String const& key);
+  void store(String const& key, Image const& image);
+
+  void flush();
+
+  size_t count() const;
+  uint64_t totalSize() const;
+
+private:
+  static String fileName(String const& key);
+  String filePath(String const& fileName) const;
+
+  // Removes the least recently used images until the total size is within
+  // the size limit.  Must be called with the mutex held.
+  void evict();
+  void remove(String const& fileName);
+
+  String m_directory;
+  uint64_t m_sizeLimit;
+
+  mutable Mutex m_mutex;
+  // Stored image file names and their sizes, least recently used first.
+  OrderedHashMap<String, uint64_t> m_entries;
+  uint64_t m_totalSize;
+  bool m_indexChanged;
+};
+
+}
+
+#endif
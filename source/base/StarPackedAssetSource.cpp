@@ -5,6 +5,9 @@
 #include "StarDataStreamExtra.hpp"
 #include "StarSha256.hpp"
 #include "StarFile.hpp"
+#include "StarBuffer.hpp"
+#include "StarMemoryMappedFile.hpp"
+#include "StarLogging.hpp"
 
 namespace Star {
 
@@ -68,8 +71,15 @@ void PackedAssetSource::build(DirectoryAssetSource& directorySource, String cons
   ds.write(indexStart);
 }
 
-PackedAssetSource::PackedAssetSource(String const& filename) {
+PackedAssetSource::PackedAssetSource(String const& filename, bool memoryMapped) {
   m_packedFile = File::open(filename, IOMode::Read);
+  if (memoryMapped) {
+    try {
+      m_mappedFile = make_shared<MemoryMappedFile>(filename);
+    } catch (IOException const& e) {
+      Logger::warn("PackedAssetSource: Could not memory map '{}', reading it instead: {}", filename, outputException(e, false));
+    }
+  }
 
   DataStreamIODevice ds(m_packedFile);
   if (ds.readBytes(8) != ByteArray("SBAsset6", 8))
@@ -83,6 +93,13 @@ PackedAssetSource::PackedAssetSource(String const& filename) {
     throw AssetSourceException("No index header found!");
   ds.read(m_metadata);
   ds.read(m_index);
+
+  if (m_mappedFile) {
+    for (auto const& entry : m_index) {
+      if (entry.second.first > m_mappedFile->size() || entry.second.second > m_mappedFile->size() - entry.second.first)
+        throw AssetSourceException::format("Packed file '{}' is out of bounds", entry.first);
+    }
+  }
 }
 
 JsonObject PackedAssetSource::metadata() const {
@@ -94,6 +111,19 @@ StringList PackedAssetSource::assetPaths() const {
 }
 
 IODevicePtr PackedAssetSource::open(String const& path) {
+  // Keeps the mapping alive for as long as the buffer is.
+  struct MappedAssetReader : public ExternalBuffer {
+    MappedAssetReader(MemoryMappedFilePtr mappedFile, String path, StreamOffset offset, StreamOffset size)
+      : ExternalBuffer(mappedFile->data() + offset, size), mappedFile(std::move(mappedFile)), path(std::move(path)) {}
+
+    String deviceName() const override {
+      return strf("{}:{}", mappedFile->fileName(), path);
+    }
+
+    MemoryMappedFilePtr mappedFile;
+    String path;
+  };
+
   struct AssetReader : public IODevice {
     AssetReader(FilePtr file, String path, StreamOffset offset, StreamOffset size)
       : file(file), path(path), fileOffset(offset), assetSize(size), assetPos(0) {
@@ -147,6 +177,8 @@ IODevicePtr PackedAssetSource::open(String const& path) {
   if (!p)
     throw AssetSourceException::format("Requested file '{}' does not exist in the packed assets file", path);
 
+  if (m_mappedFile)
+    return make_shared<MappedAssetReader>(m_mappedFile, path, p->first, p->second);
   return make_shared<AssetReader>(m_packedFile, path, p->first, p->second);
 }
 
@@ -155,9 +187,16 @@ ByteArray PackedAssetSource::read(String const& path) {
   if (!p)
     throw AssetSourceException::format("Requested file '{}' does not exist in the packed assets file", path);
 
+  if (m_mappedFile)
+    return ByteArray(m_mappedFile->data() + p->first, p->second);
+
   ByteArray data(p->second, 0);
   m_packedFile->readFullAbsolute(p->first, data.ptr(), p->second);
   return data;
 }
 
+bool PackedAssetSource::isMemoryMapped() const {
+  return (bool)m_mappedFile;
+}
+
 }
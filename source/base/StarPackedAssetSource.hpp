@@ -7,6 +7,7 @@
 
 namespace Star {
 
+STAR_CLASS(MemoryMappedFile);
 STAR_CLASS(PackedAssetSource);
 
 class PackedAssetSource : public AssetSource {
@@ -26,7 +27,11 @@ public:
   static void build(DirectoryAssetSource& directorySource, String const& targetPackedFile,
       StringList const& extensionSorting = {}, BuildProgressCallback progressCallback = {});
 
-  PackedAssetSource(String const& packedFileName);
+  // If 'memoryMapped' is true, the packed file is memory mapped, and open()
+  // returns ExternalBuffer devices that read straight from the mapping, so
+  // decoders can work on the mapped bytes without copying them.  Falls back to
+  // reading the file if it cannot be mapped.
+  PackedAssetSource(String const& packedFileName, bool memoryMapped = true);
 
   JsonObject metadata() const override;
   StringList assetPaths() const override;
@@ -34,8 +39,11 @@ public:
   IODevicePtr open(String const& path) override;
   ByteArray read(String const& path) override;
 
+  bool isMemoryMapped() const;
+
 private:
   FilePtr m_packedFile;
+  MemoryMappedFilePtr m_mappedFile;
   JsonObject m_metadata;
   OrderedHashMap<String, pair<uint64_t, uint64_t>> m_index;
 };
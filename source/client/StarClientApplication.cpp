@@ -27,7 +27,8 @@ namespace Star {
 Json const AdditionalAssetsSettings = Json::parseJson(R"JSON(
     {
       "missingImage" : "/assetmissing.png",
-      "missingAudio" : "/assetmissing.wav"
+      "missingAudio" : "/assetmissing.wav",
+      "imageCacheDirectory" : "imagecache"
     }
   )JSON");
 
@@ -10,6 +10,7 @@
 #include "StarFormat.hpp"
 #include "StarLogging.hpp"
 #include "StarDataStreamDevices.hpp"
+#include "StarCasting.hpp"
 
 namespace Star {
 
@@ -150,15 +151,23 @@ public:
 
   CompressedAudioImpl(CompressedAudioImpl const& impl) {
     m_audioData = impl.m_audioData;
-    m_memoryFile.reset(m_audioData->ptr(), m_audioData->size());
+    m_audioView = impl.m_audioView;
+    m_memoryFile.reset(impl.m_memoryFile.ptr(), impl.m_memoryFile.dataSize());
     m_vorbisInfo = nullptr;
   }
 
   CompressedAudioImpl(IODevicePtr audioData) {
     audioData->open(IOMode::Read);
-    audioData->seek(0);
-    m_audioData = make_shared<ByteArray>(audioData->readBytes((size_t)audioData->size()));
-    m_memoryFile.reset(m_audioData->ptr(), m_audioData->size());
+    // Audio that is already in memory, such as a memory mapped asset, is
+    // decoded in place rather than copied.
+    if (auto buffer = as<ExternalBuffer>(audioData)) {
+      m_audioView = buffer;
+      m_memoryFile.reset(buffer->ptr(), buffer->dataSize());
+    } else {
+      audioData->seek(0);
+      m_audioData = make_shared<ByteArray>(audioData->readBytes((size_t)audioData->size()));
+      m_memoryFile.reset(m_audioData->ptr(), m_audioData->size());
+    }
     m_vorbisInfo = nullptr;
   }
 
@@ -241,6 +250,8 @@ public:
 
 private:
   ByteArrayConstPtr m_audioData;
+  // Keeps the external data of m_memoryFile alive when not copied.
+  IODevicePtr m_audioView;
   ExternalBuffer m_memoryFile;
   ov_callbacks m_callbacks;
   OggVorbis_File m_vorbisFile;
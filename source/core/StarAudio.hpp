@@ -15,7 +15,9 @@ STAR_EXCEPTION(AudioException, StarException);
 // Reads and allows for decompression of a limited subset of ogg/vorbis.  Does
 // not handle multiple bitstreams, sample rate or channel number changes.
 // Entire stream is kept in memory, and is implicitly shared so copying Audio
-// instances is not expensive.
+// instances is not expensive.  Compressed audio read from an ExternalBuffer
+// is decoded from the buffer's data without copying it, and the device is
+// kept alive as long as the Audio is.
 class Audio {
 public:
   explicit Audio(IODevicePtr device);
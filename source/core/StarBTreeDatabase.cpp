@@ -2,6 +2,8 @@
 #include "StarSha256.hpp"
 #include "StarVlqEncoding.hpp"
 #include "StarLogging.hpp"
+#include "StarFile.hpp"
+#include "StarCasting.hpp"
 
 /* Added Kae's BTreeDB5 defragmenting code from OpenStarbound. */
 
@@ -16,6 +18,15 @@ BTreeDatabase::BTreeDatabase(float freeSpaceThreshold) : m_freeSpaceThreshold(fr
   m_keySize = 0;
   m_autoCommit = true;
   m_indexCache.setMaxSize(64);
+  m_leafCacheSize = 0;
+  m_memoryMapped = false;
+  m_backgroundCommit = false;
+  m_indexCacheHits = 0;
+  m_indexCacheMisses = 0;
+  m_leafCacheHits = 0;
+  m_leafCacheMisses = 0;
+  m_deviceBytesRead = 0;
+  m_mappedBytesRead = 0;
   m_root = InvalidBlockIndex;
   m_rootIsLeaf = false;
   m_usingAltRoot = false;
@@ -42,6 +53,15 @@ BTreeDatabase::~BTreeDatabase() {
         Logger::error("Exception caught while destroying BTreeDB5 backed by file '{}'! Exception: {}", m_device->deviceName(), outputException(e, true));
     }
   }
+
+  // A failed close may leave a background commit running, which must not
+  // outlive the database.
+  try {
+    WriteLocker writeLocker(m_lock);
+    finishBackgroundCommit();
+  } catch (std::exception const& e) {
+    Logger::error("Background commit of BTreeDB5 failed while destroying it! Exception: {}", outputException(e, true));
+  }
 }
 
 uint32_t BTreeDatabase::blockSize() const {
@@ -87,6 +107,31 @@ void BTreeDatabase::setIndexCacheSize(uint32_t indexCacheSize) {
   m_indexCache.setMaxSize(indexCacheSize);
 }
 
+uint32_t BTreeDatabase::leafCacheSize() const {
+  SpinLocker lock(m_leafCacheSpinLock);
+  return m_leafCacheSize;
+}
+
+void BTreeDatabase::setLeafCacheSize(uint32_t leafCacheSize) {
+  SpinLocker lock(m_leafCacheSpinLock);
+  m_leafCacheSize = leafCacheSize;
+  if (m_leafCacheSize == 0)
+    m_leafCache.clear();
+  else
+    m_leafCache.setMaxSize(m_leafCacheSize);
+}
+
+bool BTreeDatabase::memoryMapped() const {
+  ReadLocker readLocker(m_lock);
+  return m_memoryMapped;
+}
+
+void BTreeDatabase::setMemoryMapped(bool memoryMapped) {
+  WriteLocker writeLocker(m_lock);
+  checkIfOpen("setMemoryMapped", false);
+  m_memoryMapped = memoryMapped;
+}
+
 bool BTreeDatabase::autoCommit() const {
   ReadLocker readLocker(m_lock);
   return m_autoCommit;
@@ -99,6 +144,18 @@ void BTreeDatabase::setAutoCommit(bool autoCommit) {
     doCommit();
 }
 
+bool BTreeDatabase::backgroundCommit() const {
+  ReadLocker readLocker(m_lock);
+  return m_backgroundCommit;
+}
+
+void BTreeDatabase::setBackgroundCommit(bool backgroundCommit) {
+  WriteLocker writeLocker(m_lock);
+  m_backgroundCommit = backgroundCommit;
+  if (!m_backgroundCommit)
+    finishBackgroundCommit();
+}
+
 IODevicePtr BTreeDatabase::ioDevice() const {
   ReadLocker readLocker(m_lock);
   return m_device;
@@ -148,6 +205,8 @@ bool BTreeDatabase::open() {
     if (m_device->isWritable())
       m_device->resize(m_deviceSize);
 
+    mapDevice();
+
     return false;
 
   } else {
@@ -176,6 +235,7 @@ bool BTreeDatabase::open() {
 
     m_impl.createNewRoot();
     doCommit();
+    mapDevice();
 
     return true;
   }
@@ -336,16 +396,20 @@ void BTreeDatabase::commit() {
 
 void BTreeDatabase::rollback() {
   WriteLocker writeLocker(m_lock);
+  // The root on disk is only the last committed root once any background
+  // commit has finished.
+  finishBackgroundCommit();
 
   m_availableBlocks.clear();
   m_indexCache.clear();
+  m_leafCache.clear();
   m_uncommittedWrites.clear();
   m_uncommitted.clear();
 
   readRoot();
 
   if (m_device->isWritable())
-    m_device->resize(m_deviceSize);
+    resizeDevice(m_deviceSize);
 }
 
 void BTreeDatabase::close(bool closeDevice) {
@@ -354,8 +418,13 @@ void BTreeDatabase::close(bool closeDevice) {
     if (m_open) {
       if (!tryFlatten())
         doCommit();
+      finishBackgroundCommit();
+      if (m_device->isWritable() && m_device->size() > m_deviceSize)
+        resizeDevice(m_deviceSize);
 
       m_indexCache.clear();
+      m_leafCache.clear();
+      m_mappedFile.reset();
 
       m_open = false;
       if (closeDevice && m_device && m_device->isOpen())
@@ -367,6 +436,17 @@ void BTreeDatabase::close(bool closeDevice) {
   }
 }
 
+auto BTreeDatabase::statistics() const -> Statistics {
+  Statistics statistics;
+  statistics.indexCacheHits = m_indexCacheHits;
+  statistics.indexCacheMisses = m_indexCacheMisses;
+  statistics.leafCacheHits = m_leafCacheHits;
+  statistics.leafCacheMisses = m_leafCacheMisses;
+  statistics.deviceBytesRead = m_deviceBytesRead;
+  statistics.mappedBytesRead = m_mappedBytesRead;
+  return statistics;
+}
+
 BTreeDatabase::BlockIndex const BTreeDatabase::InvalidBlockIndex;
 uint32_t const BTreeDatabase::HeaderSize;
 char const* const BTreeDatabase::VersionMagic = "BTreeDB5";
@@ -569,9 +649,12 @@ auto BTreeDatabase::BTreeImpl::createIndex(Pointer beginPointer) -> Index {
 
 auto BTreeDatabase::BTreeImpl::loadIndex(Pointer pointer) -> Index {
   SpinLocker lock(parent->m_indexCacheSpinLock);
-  if (auto index = parent->m_indexCache.ptr(pointer))
+  if (auto index = parent->m_indexCache.ptr(pointer)) {
+    ++parent->m_indexCacheHits;
     return *index;
+  }
   lock.unlock();
+  ++parent->m_indexCacheMisses;
 
   auto index = make_shared<IndexNode>();
 
@@ -670,45 +753,55 @@ auto BTreeDatabase::BTreeImpl::createLeaf() -> Leaf {
 }
 
 auto BTreeDatabase::BTreeImpl::loadLeaf(Pointer pointer) -> Leaf {
+  SpinLocker lock(parent->m_leafCacheSpinLock);
+  bool useCache = parent->m_leafCacheSize != 0;
+  if (useCache) {
+    if (auto leaf = parent->m_leafCache.ptr(pointer)) {
+      ++parent->m_leafCacheHits;
+      return *leaf;
+    }
+    ++parent->m_leafCacheMisses;
+  }
+  lock.unlock();
+
   auto leaf = make_shared<LeafNode>();
   leaf->self = pointer;
 
-  BlockIndex currentLeafBlock = leaf->self;
-  DataStreamBuffer leafBuffer;
-  leafBuffer.reset(parent->m_blockSize);
-  parent->readBlock(currentLeafBlock, 0, leafBuffer.ptr(), parent->m_blockSize);
+  // Elements are read straight out of each block in the chain, which is only
+  // copied into blockBuffer if it is not already in memory.
+  uint32_t const blockEnd = parent->m_blockSize - sizeof(BlockIndex);
+  ByteArray blockBuffer;
+  char const* block = nullptr;
+  size_t blockPos = 0;
+
+  auto viewLeafBlock = [&](BlockIndex blockIndex) {
+    block = parent->blockView(blockIndex, blockBuffer);
+    if (memcmp(block, LeafMagic, 2) != 0)
+      throw DBException("Error, incorrect leaf block signature.");
+    blockPos = 2;
+  };
 
-  if (leafBuffer.readBytes(2) != ByteArray(LeafMagic, 2))
-    throw DBException("Error, incorrect leaf block signature.");
+  viewLeafBlock(leaf->self);
 
   DataStreamFunctions leafInput([&](char* data, size_t len) -> size_t {
       size_t pos = 0;
       size_t left = len;
 
       while (left > 0) {
-        if (leafBuffer.pos() + left < parent->m_blockSize - sizeof(BlockIndex)) {
-          leafBuffer.readData(data + pos, left);
-          pos += left;
-          left = 0;
-        } else {
-          size_t toRead = parent->m_blockSize - sizeof(BlockIndex) - leafBuffer.pos();
-          leafBuffer.readData(data + pos, toRead);
-          pos += toRead;
-          left -= toRead;
-        }
-
-        if (leafBuffer.pos() == (parent->m_blockSize - sizeof(BlockIndex)) && left > 0) {
-          currentLeafBlock = leafBuffer.read<BlockIndex>();
-          if (currentLeafBlock != InvalidBlockIndex) {
-            leafBuffer.reset(parent->m_blockSize);
-            parent->readBlock(currentLeafBlock, 0, leafBuffer.ptr(), parent->m_blockSize);
-
-            if (leafBuffer.readBytes(2) != ByteArray(LeafMagic, 2))
-              throw DBException("Error, incorrect leaf block signature.");
-
-          } else {
+        size_t toRead = min<size_t>(left, blockEnd - blockPos);
+        memcpy(data + pos, block + blockPos, toRead);
+        blockPos += toRead;
+        pos += toRead;
+        left -= toRead;
+
+        if (blockPos == blockEnd && left > 0) {
+          BlockIndex nextBlock;
+          memcpy(&nextBlock, block + blockEnd, sizeof(BlockIndex));
+          nextBlock = fromBigEndian(nextBlock);
+          if (nextBlock != InvalidBlockIndex)
+            viewLeafBlock(nextBlock);
+          else
             throw DBException("Leaf read off end of Leaf list.");
-          }
         }
       }
 
@@ -723,6 +816,10 @@ auto BTreeDatabase::BTreeImpl::loadLeaf(Pointer pointer) -> Leaf {
     element.data = leafInput.read<ByteArray>();
   }
 
+  if (useCache) {
+    lock.lock();
+    parent->m_leafCache.set(pointer, leaf);
+  }
   return leaf;
 }
 
@@ -852,6 +949,8 @@ auto BTreeDatabase::BTreeImpl::storeLeaf(Leaf leaf) -> Pointer {
   leafBuffer.write<BlockIndex>(InvalidBlockIndex);
   parent->updateBlock(currentLeafBlock, leafBuffer.data());
 
+  if (parent->m_leafCacheSize != 0)
+    parent->m_leafCache.set(leaf->self, leaf);
   return leaf->self;
 }
 
@@ -930,6 +1029,32 @@ void BTreeDatabase::readBlock(BlockIndex blockIndex, size_t blockOffset, char* b
   rawReadBlock(blockIndex, blockOffset, block, size);
 }
 
+ByteArray const* BTreeDatabase::inMemoryBlock(BlockIndex blockIndex) const {
+  if (auto block = m_uncommittedWrites.ptr(blockIndex))
+    return block;
+  if (m_pendingCommit)
+    return m_pendingCommit->writes.ptr(blockIndex);
+  return nullptr;
+}
+
+char const* BTreeDatabase::blockView(BlockIndex blockIndex, ByteArray& buffer) const {
+  checkBlockIndex(blockIndex);
+
+  if (auto block = inMemoryBlock(blockIndex))
+    return block->ptr();
+
+  StreamOffset blockStart = HeaderSize + blockIndex * (StreamOffset)m_blockSize;
+  if (m_mappedFile && blockStart + m_blockSize <= (StreamOffset)m_mappedFile->size()) {
+    m_mappedBytesRead += m_blockSize;
+    return m_mappedFile->data() + blockStart;
+  }
+
+  buffer.resize(m_blockSize);
+  m_device->readFullAbsolute(blockStart, buffer.ptr(), m_blockSize);
+  m_deviceBytesRead += m_blockSize;
+  return buffer.ptr();
+}
+
 ByteArray BTreeDatabase::readBlock(BlockIndex blockIndex) const {
   ByteArray block(m_blockSize, 0);
   readBlock(blockIndex, 0, block.ptr(), m_blockSize);
@@ -948,10 +1073,16 @@ void BTreeDatabase::rawReadBlock(BlockIndex blockIndex, size_t blockOffset, char
   if (size <= 0)
     return;
 
-  if (auto buffer = m_uncommittedWrites.ptr(blockIndex))
+  StreamOffset readStart = HeaderSize + blockIndex * (StreamOffset)m_blockSize + blockOffset;
+  if (auto buffer = inMemoryBlock(blockIndex)) {
     buffer->copyTo(block, blockOffset, size);
-  else
-    m_device->readFullAbsolute(HeaderSize + blockIndex * (StreamOffset)m_blockSize + blockOffset, block, size);
+  } else if (m_mappedFile && readStart + size <= m_mappedFile->size()) {
+    memcpy(block, m_mappedFile->data() + readStart, size);
+    m_mappedBytesRead += size;
+  } else {
+    m_device->readFullAbsolute(readStart, block, size);
+    m_deviceBytesRead += size;
+  }
 }
 
 void BTreeDatabase::rawWriteBlock(BlockIndex blockIndex, size_t blockOffset, char const* block, size_t size) {
@@ -961,10 +1092,12 @@ void BTreeDatabase::rawWriteBlock(BlockIndex blockIndex, size_t blockOffset, cha
   if (size <= 0)
     return;
 
-  StreamOffset blockStart = HeaderSize + blockIndex * (StreamOffset)m_blockSize;
   auto buffer = m_uncommittedWrites.find(blockIndex);
-  if (buffer == m_uncommittedWrites.end())
-    buffer = m_uncommittedWrites.emplace(blockIndex, m_device->readBytesAbsolute(blockStart, m_blockSize)).first;
+  if (buffer == m_uncommittedWrites.end()) {
+    ByteArray existing(m_blockSize, 0);
+    rawReadBlock(blockIndex, 0, existing.ptr(), m_blockSize);
+    buffer = m_uncommittedWrites.emplace(blockIndex, std::move(existing)).first;
+  }
 
   buffer->second.writeFrom(block, blockOffset, size);
 }
@@ -1050,7 +1183,46 @@ auto BTreeDatabase::leafTailBlocks(BlockIndex leafPointer) -> List<BlockIndex> {
   return tailBlocks;
 }
 
+void BTreeDatabase::resizeDevice(StreamOffset size) {
+  // A background commit must not write past the end of a truncated device.
+  // On Windows, resizing also moves the file position, which the absolute
+  // writes of a background commit are using at the same time.
+#ifdef STAR_SYSTEM_WINDOWS
+  finishBackgroundCommit();
+#else
+  if (size < m_device->size())
+    finishBackgroundCommit();
+#endif
+
+  if (m_mappedFile && size < (StreamOffset)m_mappedFile->size()) {
+    m_mappedFile->unmap();
+    m_device->resize(size);
+    m_mappedFile->map();
+  } else {
+    m_device->resize(size);
+  }
+}
+
+void BTreeDatabase::mapDevice() {
+  m_mappedFile.reset();
+  if (!m_memoryMapped)
+    return;
+
+  auto file = as<File>(m_device);
+  if (!file || file->fileName().empty()) {
+    Logger::warn("BTreeDatabase: Cannot memory map device '{}', it is not a named file; reading through the device instead", m_device->deviceName());
+    return;
+  }
+
+  try {
+    m_mappedFile = make_shared<MemoryMappedFile>(file->fileName());
+  } catch (IOException const& e) {
+    Logger::warn("BTreeDatabase: Cannot memory map '{}', reading through the device instead: {}", file->fileName(), outputException(e, false));
+  }
+}
+
 void BTreeDatabase::freeBlock(BlockIndex b) {
+  m_leafCache.remove(b);
   if (m_uncommitted.contains(b))
     m_uncommitted.remove(b);
   if (m_uncommittedWrites.contains(b))
@@ -1086,32 +1258,14 @@ auto BTreeDatabase::reserveBlock() -> BlockIndex {
 auto BTreeDatabase::makeEndBlock() -> BlockIndex {
   BlockIndex blockCount = (m_deviceSize - HeaderSize) / m_blockSize;
   m_deviceSize += m_blockSize;
-  m_device->resize(m_deviceSize);
+  // Grow the device ahead of the database, so that most new blocks do not
+  // need a resize.  The extra blocks are untracked until used, and are
+  // trimmed again on close.
+  if (m_device->size() < m_deviceSize)
+    resizeDevice(m_deviceSize + (StreamOffset)m_blockSize * (DeviceGrowthBlocks - 1));
   return blockCount;
 }
 
-void BTreeDatabase::writeRoot() {
-  DataStreamIODevice ds(m_device);
-  // First write the root info to whichever section we are not currently using
-  ds.seek(BTreeRootInfoStart + (m_usingAltRoot ? 0 : BTreeRootInfoSize));
-  ds.write<BlockIndex>(m_headFreeIndexBlock);
-  ds.write<StreamOffset>(m_deviceSize);
-  ds.write<BlockIndex>(m_root);
-  ds.write<bool>(m_rootIsLeaf);
-
-  // Then flush all the pending changes.
-  m_device->sync();
-
-  // Then switch headers by writing the single bit that switches them
-  m_usingAltRoot = !m_usingAltRoot;
-  ds.seek(BTreeRootSelectorBit);
-  ds.write(m_usingAltRoot);
-
-  // Then flush this single bit write to make sure it happens before anything
-  // else.
-  m_device->sync();
-}
-
 void BTreeDatabase::readRoot() {
   DataStreamIODevice ds(m_device);
   ds.seek(BTreeRootSelectorBit);
@@ -1128,6 +1282,9 @@ void BTreeDatabase::doCommit() {
   if (m_availableBlocks.empty() && m_uncommitted.empty())
     return;
 
+  // Commits must reach the device in order.
+  finishBackgroundCommit();
+
   if (!m_availableBlocks.empty()) {
     // First, read the existing head FreeIndexBlock, if it exists.
     FreeIndexBlock indexBlock = FreeIndexBlock{InvalidBlockIndex, {}};
@@ -1171,24 +1328,101 @@ void BTreeDatabase::doCommit() {
     }
   }
 
-  
-  commitWrites(); 
-  writeRoot();
+  auto commit = make_shared<PendingCommit const>(takeCommit());
+  if (m_backgroundCommit) {
+    m_pendingCommit = commit;
+    m_commitThread = Thread::invoke("BTreeDatabase::commit", [this, commit]() { writeCommit(*commit); });
+  } else {
+    writeCommit(*commit);
+    remapDevice();
+  }
+}
+
+auto BTreeDatabase::takeCommit() -> PendingCommit {
+  PendingCommit commit;
+  commit.writes = std::move(m_uncommittedWrites);
+  commit.headFreeIndexBlock = m_headFreeIndexBlock;
+  commit.deviceSize = m_deviceSize;
+  commit.root = m_root;
+  commit.rootIsLeaf = m_rootIsLeaf;
+  commit.usingAltRoot = !m_usingAltRoot;
+
+  m_uncommittedWrites.clear();
   m_uncommitted.clear();
+  m_usingAltRoot = commit.usingAltRoot;
+  return commit;
 }
 
-void BTreeDatabase::commitWrites() {
-  for (auto& write : m_uncommittedWrites)
+void BTreeDatabase::writeCommit(PendingCommit const& commit) {
+  for (auto const& write : commit.writes)
     m_device->writeFullAbsolute(HeaderSize + write.first * (StreamOffset)m_blockSize, write.second.ptr(), m_blockSize);
 
   m_device->sync();
-  m_uncommittedWrites.clear();
+
+  // First write the root info to whichever section we are not currently using.
+  // Everything is written at absolute offsets, so that a background commit
+  // never uses the file position shared with the main thread.
+  DataStreamBuffer rootInfo(BTreeRootInfoSize);
+  rootInfo.write<BlockIndex>(commit.headFreeIndexBlock);
+  rootInfo.write<StreamOffset>(commit.deviceSize);
+  rootInfo.write<BlockIndex>(commit.root);
+  rootInfo.write<bool>(commit.rootIsLeaf);
+  m_device->writeFullAbsolute(BTreeRootInfoStart + (commit.usingAltRoot ? BTreeRootInfoSize : 0), rootInfo.ptr(), rootInfo.pos());
+
+  // Then flush all the pending changes.
+  m_device->sync();
+
+  // Then switch headers by writing the single bit that switches them
+  char selector = commit.usingAltRoot;
+  m_device->writeFullAbsolute(BTreeRootSelectorBit, &selector, 1);
+
+  // Then flush this single bit write to make sure it happens before anything
+  // else.
+  m_device->sync();
+}
+
+void BTreeDatabase::finishBackgroundCommit() {
+  if (!m_pendingCommit)
+    return;
+
+  try {
+    m_commitThread.finish();
+  } catch (...) {
+    restoreFailedCommit();
+    throw;
+  }
+  m_pendingCommit.reset();
+  remapDevice();
+}
+
+void BTreeDatabase::restoreFailedCommit() {
+  auto commit = take(m_pendingCommit);
+
+  // The current root still refers to the blocks of the failed commit, so they
+  // are uncommitted again and are written by the next commit.  Blocks that
+  // have been written since take precedence.
+  for (auto const& write : commit->writes) {
+    m_uncommittedWrites.insert(write.first, write.second);
+    if (!m_availableBlocks.contains(write.first))
+      m_uncommitted.add(write.first);
+  }
+
+  // The next commit rewrites the same root section.
+  m_usingAltRoot = !commit->usingAltRoot;
+}
+
+void BTreeDatabase::remapDevice() {
+  // Blocks appended since the file was last mapped are read through the
+  // device until the mapping is extended here.
+  if (m_mappedFile && (StreamOffset)m_mappedFile->size() < m_device->size())
+    m_mappedFile->map();
 }
 
 bool BTreeDatabase::tryFlatten() {
   if (m_headFreeIndexBlock == InvalidBlockIndex || m_rootIsLeaf || !m_device->isWritable())
     return false;
-  
+
+  finishBackgroundCommit();
   BlockIndex freeBlockCount = 0;
   BlockIndex indexBlockIndex = m_headFreeIndexBlock;
   while (indexBlockIndex != InvalidBlockIndex) {
@@ -1231,12 +1465,12 @@ bool BTreeDatabase::tryFlatten() {
   }
 
   m_availableBlocks.clear();
-  m_device->resize(m_deviceSize = HeaderSize + (StreamOffset)m_blockSize * count);
+  resizeDevice(m_deviceSize = HeaderSize + (StreamOffset)m_blockSize * count);
 
   m_indexCache.clear();
-  commitWrites();
-  writeRoot();
-  m_uncommitted.clear();
+  m_leafCache.clear();
+  writeCommit(takeCommit());
+  remapDevice();
 
   Logger::info("BTreeDatabase: Finished flattening BTreeDB5 file '{}' in {:.2f} ms", m_device->deviceName(), (Time::monotonicTime() - start) * 1000.0f);
   return true;
@@ -5,6 +5,7 @@
 #include "StarLruCache.hpp"
 #include "StarDataStreamDevices.hpp"
 #include "StarThread.hpp"
+#include "StarMemoryMappedFile.hpp"
 
 /* Added Kae's BTreeDB5 defragmenting code from OpenStarbound. */
 
@@ -16,6 +17,17 @@ class BTreeDatabase {
 public:
   uint32_t const ContentIdentifierStringSize = 16;
 
+  struct Statistics {
+    uint64_t indexCacheHits = 0;
+    uint64_t indexCacheMisses = 0;
+    uint64_t leafCacheHits = 0;
+    uint64_t leafCacheMisses = 0;
+    // Block bytes read through the IODevice and through the memory mapping,
+    // not counting uncommitted blocks which are already in memory.
+    uint64_t deviceBytesRead = 0;
+    uint64_t mappedBytesRead = 0;
+  };
+
   BTreeDatabase(float freeSpaceThreshold);
   BTreeDatabase();
   BTreeDatabase(String const& contentIdentifier, size_t keySize, float freeSpaceThreshold = 0.05f);
@@ -44,11 +56,29 @@ public:
   uint32_t indexCacheSize() const;
   void setIndexCacheSize(uint32_t indexCacheSize);
 
+  // Cache size for decoded leaf nodes, defaults to 0 (no leaf caching).
+  uint32_t leafCacheSize() const;
+  void setLeafCacheSize(uint32_t leafCacheSize);
+
+  // If true, and the IODevice is a File with a name, committed blocks are read
+  // through a read-only memory mapping of the file rather than copied through
+  // the device.  Falls back to device reads if the file cannot be mapped.
+  // Cannot be changed once the database is opened.  Defaults to false.
+  bool memoryMapped() const;
+  void setMemoryMapped(bool memoryMapped);
+
   // If true, every write operation will immediately result in a commit.
   // Defaults to true.
   bool autoCommit() const;
   void setAutoCommit(bool autoCommit);
 
+  // If true, commit() only snapshots the uncommitted blocks and new root, and
+  // a background thread writes and syncs them while further reads and writes
+  // proceed in memory.  The next commit, rollback, or close waits for it
+  // first, and re-throws any error it hit.  Defaults to false.
+  bool backgroundCommit() const;
+  void setBackgroundCommit(bool backgroundCommit);
+
   IODevicePtr ioDevice() const;
   void setIODevice(IODevicePtr device);
 
@@ -97,6 +127,9 @@ public:
 
   void close(bool closeDevice = false);
 
+  // Cumulative cache and read counters since the database was constructed.
+  Statistics statistics() const;
+
 private:
   typedef uint32_t BlockIndex;
   static BlockIndex const InvalidBlockIndex = (BlockIndex)(-1);
@@ -113,6 +146,9 @@ private:
   static size_t const BTreeRootSelectorBit = 32;
   static size_t const BTreeRootInfoStart = 33;
   static size_t const BTreeRootInfoSize = 17;
+  // Number of blocks the device is grown by whenever the database needs a
+  // block past its end.
+  static uint32_t const DeviceGrowthBlocks = 64;
 
   struct FreeIndexBlock {
     BlockIndex nextFreeBlock;
@@ -236,6 +272,14 @@ private:
   ByteArray readBlock(BlockIndex blockIndex) const;
   void updateBlock(BlockIndex blockIndex, ByteArray const& block);
 
+  // Returns a pointer to the whole block, either directly into memory that
+  // already holds it or into the given buffer after reading it.  Valid until
+  // the next write operation or until the buffer is changed.
+  char const* blockView(BlockIndex blockIndex, ByteArray& buffer) const;
+  // Returns the block if it is held in memory by an uncommitted write or a
+  // background commit.
+  ByteArray const* inMemoryBlock(BlockIndex blockIndex) const;
+
   void rawReadBlock(BlockIndex blockIndex, size_t blockOffset, char* block, size_t size) const;
   void rawWriteBlock(BlockIndex blockIndex, size_t blockOffset, char const* block, size_t size);
 
@@ -250,15 +294,41 @@ private:
   uint32_t dataSize(ByteArray const& d) const;
   List<BlockIndex> leafTailBlocks(BlockIndex leafPointer);
 
+  // Resizes the device, unmapping it first when shrinking, since some
+  // platforms do not allow truncating a mapped file.
+  void resizeDevice(StreamOffset size);
+  void mapDevice();
+
   void freeBlock(BlockIndex b);
   BlockIndex reserveBlock();
   BlockIndex makeEndBlock();
 
+  // Everything written to the device by a single commit.
+  struct PendingCommit {
+    Map<BlockIndex, ByteArray> writes;
+    BlockIndex headFreeIndexBlock;
+    StreamOffset deviceSize;
+    BlockIndex root;
+    bool rootIsLeaf;
+    // The root section that is selected once the commit is written.
+    bool usingAltRoot;
+  };
+
   void dirty();
-  void writeRoot();
   void readRoot();
   void doCommit();
-  void commitWrites();
+  // Moves the uncommitted writes and current root into a PendingCommit, after
+  // which the in-memory state is considered committed.
+  PendingCommit takeCommit();
+  // Writes and syncs the blocks of a commit, then switches to its root.  Only
+  // touches the device, so it may run outside of the main lock.
+  void writeCommit(PendingCommit const& commit);
+  // Waits for any background commit and releases its blocks.  If it failed,
+  // its blocks and root section are restored before rethrowing, so that the
+  // next commit retries it.
+  void finishBackgroundCommit();
+  void restoreFailedCommit();
+  void remapDevice();
   bool tryFlatten();
   bool flattenVisitor(BTreeImpl::Index& index, BlockIndex& count);
 
@@ -287,6 +357,30 @@ private:
   mutable SpinLock m_indexCacheSpinLock;
   LruCache<BlockIndex, shared_ptr<IndexNode>> m_indexCache;
 
+  // Same locking rules as the index cache.  Stored leaves replace their
+  // cached entry, and any freed block is dropped from the cache.
+  mutable SpinLock m_leafCacheSpinLock;
+  LruCache<BlockIndex, shared_ptr<LeafNode>> m_leafCache;
+  uint32_t m_leafCacheSize;
+
+  bool m_memoryMapped;
+  // Only set while open with a memory mapping.  Only remapped while holding
+  // the main writer lock, so readers may use it under the reader lock.
+  MemoryMappedFilePtr m_mappedFile;
+
+  bool m_backgroundCommit;
+  // Blocks of the commit being written in the background, which are read
+  // from here until it finishes.
+  shared_ptr<PendingCommit const> m_pendingCommit;
+  ThreadFunction<void> m_commitThread;
+
+  mutable atomic<uint64_t> m_indexCacheHits;
+  mutable atomic<uint64_t> m_indexCacheMisses;
+  mutable atomic<uint64_t> m_leafCacheHits;
+  mutable atomic<uint64_t> m_leafCacheMisses;
+  mutable atomic<uint64_t> m_deviceBytesRead;
+  mutable atomic<uint64_t> m_mappedBytesRead;
+
   BlockIndex m_headFreeIndexBlock;
   StreamOffset m_deviceSize;
   BlockIndex m_root;
@@ -335,8 +429,14 @@ public:
   using BTreeDatabase::setContentIdentifier;
   using BTreeDatabase::indexCacheSize;
   using BTreeDatabase::setIndexCacheSize;
+  using BTreeDatabase::leafCacheSize;
+  using BTreeDatabase::setLeafCacheSize;
+  using BTreeDatabase::memoryMapped;
+  using BTreeDatabase::setMemoryMapped;
   using BTreeDatabase::autoCommit;
   using BTreeDatabase::setAutoCommit;
+  using BTreeDatabase::backgroundCommit;
+  using BTreeDatabase::setBackgroundCommit;
   using BTreeDatabase::ioDevice;
   using BTreeDatabase::setIODevice;
   using BTreeDatabase::open;
@@ -350,6 +450,8 @@ public:
   using BTreeDatabase::commit;
   using BTreeDatabase::rollback;
   using BTreeDatabase::close;
+  using BTreeDatabase::Statistics;
+  using BTreeDatabase::statistics;
 };
 
 }
@@ -97,6 +97,115 @@ ByteArray uncompressData(ByteArray const& in) {
   return out;
 }
 
+// Every sync flush ends with an empty stored block, which is left out of the
+// compressed chunks and added back when uncompressing them.
+static unsigned char const CompressionStreamFlushMarker[] = {0x00, 0x00, 0xff, 0xff};
+static size_t const CompressionStreamFlushMarkerSize = sizeof(CompressionStreamFlushMarker);
+
+CompressionStream::CompressionStream(CompressionLevel compression) {
+  auto strm = new z_stream;
+  strm->zalloc = Z_NULL;
+  strm->zfree = Z_NULL;
+  strm->opaque = Z_NULL;
+  int deflate_res = deflateInit(strm, compression);
+  if (deflate_res != Z_OK) {
+    delete strm;
+    throw IOException(strf("Failed to initialise deflate ({})", deflate_res));
+  }
+  m_stream = strm;
+}
+
+CompressionStream::~CompressionStream() {
+  auto strm = (z_stream*)m_stream;
+  deflateEnd(strm);
+  delete strm;
+}
+
+ByteArray CompressionStream::compress(char const* data, size_t len) {
+  ByteArray out;
+  if (len == 0)
+    return out;
+
+  const size_t BUFSIZE = 32 * 1024;
+  unsigned char temp_buffer[BUFSIZE];
+
+  auto strm = (z_stream*)m_stream;
+  strm->next_in = (unsigned char*)data;
+  strm->avail_in = len;
+  do {
+    strm->next_out = temp_buffer;
+    strm->avail_out = BUFSIZE;
+    int deflate_res = deflate(strm, Z_SYNC_FLUSH);
+    if (deflate_res != Z_OK && deflate_res != Z_BUF_ERROR)
+      throw IOException(strf("Internal error in CompressionStream::compress, deflate_res is {}", deflate_res));
+    out.append((char const*)temp_buffer, BUFSIZE - strm->avail_out);
+  } while (strm->avail_out == 0);
+
+  if (out.size() < CompressionStreamFlushMarkerSize
+      || memcmp(out.ptr() + out.size() - CompressionStreamFlushMarkerSize, CompressionStreamFlushMarker, CompressionStreamFlushMarkerSize) != 0)
+    throw IOException("Internal error in CompressionStream::compress, missing flush marker");
+  out.resize(out.size() - CompressionStreamFlushMarkerSize);
+
+  return out;
+}
+
+ByteArray CompressionStream::compress(ByteArray const& in) {
+  return compress(in.ptr(), in.size());
+}
+
+DecompressionStream::DecompressionStream() {
+  auto strm = new z_stream;
+  strm->zalloc = Z_NULL;
+  strm->zfree = Z_NULL;
+  strm->opaque = Z_NULL;
+  strm->next_in = Z_NULL;
+  strm->avail_in = 0;
+  int inflate_res = inflateInit(strm);
+  if (inflate_res != Z_OK) {
+    delete strm;
+    throw IOException(strf("Failed to initialise inflate ({})", inflate_res));
+  }
+  m_stream = strm;
+}
+
+DecompressionStream::~DecompressionStream() {
+  auto strm = (z_stream*)m_stream;
+  inflateEnd(strm);
+  delete strm;
+}
+
+ByteArray DecompressionStream::uncompress(char const* data, size_t len) {
+  ByteArray out;
+  if (len == 0)
+    return out;
+
+  const size_t BUFSIZE = 32 * 1024;
+  unsigned char temp_buffer[BUFSIZE];
+
+  auto strm = (z_stream*)m_stream;
+  auto inflateInput = [&](unsigned char const* input, size_t inputSize) {
+    strm->next_in = (unsigned char*)input;
+    strm->avail_in = inputSize;
+    do {
+      strm->next_out = temp_buffer;
+      strm->avail_out = BUFSIZE;
+      int inflate_res = inflate(strm, Z_SYNC_FLUSH);
+      if (inflate_res != Z_OK && inflate_res != Z_BUF_ERROR)
+        throw IOException(strf("Error in DecompressionStream::uncompress, inflate_res is {}", inflate_res));
+      out.append((char const*)temp_buffer, BUFSIZE - strm->avail_out);
+    } while (strm->avail_out == 0 || strm->avail_in != 0);
+  };
+
+  inflateInput((unsigned char const*)data, len);
+  inflateInput(CompressionStreamFlushMarker, CompressionStreamFlushMarkerSize);
+
+  return out;
+}
+
+ByteArray DecompressionStream::uncompress(ByteArray const& in) {
+  return uncompress(in.ptr(), in.size());
+}
+
 CompressedFilePtr CompressedFile::open(String const& filename, IOMode mode, CompressionLevel comp) {
   CompressedFilePtr f = make_shared<CompressedFile>(filename);
   f->open(mode, comp);
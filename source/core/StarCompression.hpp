@@ -7,6 +7,8 @@
 namespace Star {
 
 STAR_CLASS(CompressedFile);
+STAR_CLASS(CompressionStream);
+STAR_CLASS(DecompressionStream);
 
 // Zlib compression level, ranges from 0 to 9
 typedef int CompressionLevel;
@@ -21,6 +23,40 @@ ByteArray compressData(ByteArray const& in, CompressionLevel compression = Mediu
 void uncompressData(ByteArray const& in, ByteArray& out);
 ByteArray uncompressData(ByteArray const& in);
 
+// Compresses data in chunks that can each be uncompressed as soon as they are
+// received, with a single zlib stream shared between all of them so that
+// every chunk can refer back to the data of the chunks before it.  Chunks
+// must be uncompressed in the same order by a DecompressionStream.
+class CompressionStream {
+public:
+  CompressionStream(CompressionLevel compression = MediumCompression);
+  ~CompressionStream();
+
+  CompressionStream(CompressionStream const&) = delete;
+  CompressionStream& operator=(CompressionStream const&) = delete;
+
+  ByteArray compress(char const* data, size_t len);
+  ByteArray compress(ByteArray const& in);
+
+private:
+  void* m_stream;
+};
+
+class DecompressionStream {
+public:
+  DecompressionStream();
+  ~DecompressionStream();
+
+  DecompressionStream(DecompressionStream const&) = delete;
+  DecompressionStream& operator=(DecompressionStream const&) = delete;
+
+  ByteArray uncompress(char const* data, size_t len);
+  ByteArray uncompress(ByteArray const& in);
+
+private:
+  void* m_stream;
+};
+
 // Random access to a (potentially) compressed file.
 class CompressedFile : public IODevice {
 public:
@@ -62,6 +62,8 @@ public:
   static bool isFile(String const& path);
   // Is the file a directory?
   static bool isDirectory(String const& path);
+  // Last modification time of the file, in milliseconds since the epoch.
+  static int64_t modificationTime(String const& path);
 
   static void remove(String const& filename);
   static void removeDirectoryRecursive(String const& filename);
@@ -13,7 +13,7 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 
-#ifdef STAR_SYSTEM_MACOSX
+#ifdef STAR_SYSTEM_MACOS
 #include <mach-o/dyld.h>
 #elif defined STAR_SYSTEM_FREEBSD
 #include <sys/types.h>
@@ -169,6 +169,18 @@ bool File::isDirectory(String const& path) {
   return S_ISDIR(st_buf.st_mode);
 }
 
+int64_t File::modificationTime(String const& path) {
+  struct stat st_buf;
+  if (stat(path.utf8Ptr(), &st_buf) != 0)
+    throw IOException::format("stat error on '{}': {}", path, strerror(errno));
+
+#ifdef STAR_SYSTEM_MACOS
+  return (int64_t)st_buf.st_mtimespec.tv_sec * 1000 + st_buf.st_mtimespec.tv_nsec / 1000000;
+#else
+  return (int64_t)st_buf.st_mtim.tv_sec * 1000 + st_buf.st_mtim.tv_nsec / 1000000;
+#endif
+}
+
 void File::remove(String const& filename) {
   if (::remove(filename.utf8Ptr()) < 0)
     throw IOException::format("remove error: {}", strerror(errno));
@@ -77,6 +77,16 @@ bool File::isDirectory(String const& path) {
   return attribs & FILE_ATTRIBUTE_DIRECTORY;
 }
 
+int64_t File::modificationTime(String const& path) {
+  WIN32_FILE_ATTRIBUTE_DATA attributes;
+  if (!GetFileAttributesExW(stringToUtf16(path).get(), GetFileExInfoStandard, &attributes))
+    throw IOException::format("GetFileAttributesEx error on '{}': {}", path, GetLastError());
+
+  // FILETIME counts 100 nanosecond intervals since 1601.
+  int64_t fileTime = ((int64_t)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+  return fileTime / 10000 - 11644473600000LL;
+}
+
 String File::fullPath(const String& path) {
   WCHAR buffer[MAX_PATH];
 
@@ -105,11 +105,11 @@ Json Json::ofType(Type t) {
 }
 
 Json Json::parse(String const& string) {
-  return inputUtf32Json<String::const_iterator>(string.begin(), string.end(), true);
+  return parseUtf8Json(string.utf8Ptr(), string.utf8Ptr() + string.utf8Size(), true);
 }
 
 Json Json::parseJson(String const& json) {
-  return inputUtf32Json<String::const_iterator>(json.begin(), json.end(), false);
+  return parseUtf8Json(json.utf8Ptr(), json.utf8Ptr() + json.utf8Size(), false);
 }
 
 Json::Json() {}
@@ -3,6 +3,7 @@
 
 #include "StarJsonParser.hpp"
 #include "StarJson.hpp"
+#include "StarJsonUtf8Parser.hpp"
 
 namespace Star {
 
@@ -52,21 +53,26 @@ public:
 
 template <typename InputIterator>
 Json inputUtf8Json(InputIterator begin, InputIterator end, bool fragment) {
-  typedef U8ToU32Iterator<InputIterator> Utf32Input;
-  typedef JsonParser<Utf32Input> Parser;
-
-  JsonBuilderStream stream;
-  Parser parser(stream);
-  Utf32Input wbegin(begin);
-  Utf32Input wend(end);
-  Utf32Input pend = parser.parse(wbegin, wend, fragment);
-
-  if (parser.error())
-    throw JsonParsingException(strf("Error parsing json: {} at {}:{}", parser.error(), parser.line(), parser.column()));
-  else if (pend != wend)
-    throw JsonParsingException(strf("Error extra data at end of input at {}:{}", parser.line(), parser.column()));
-
-  return stream.takeTop();
+  // Contiguous buffers are parsed byte by byte without decoding to UTF-32.
+  if constexpr (std::is_convertible_v<InputIterator, char const*>) {
+    return parseUtf8Json(begin, end, fragment);
+  } else {
+    typedef U8ToU32Iterator<InputIterator> Utf32Input;
+    typedef JsonParser<Utf32Input> Parser;
+
+    JsonBuilderStream stream;
+    Parser parser(stream);
+    Utf32Input wbegin(begin);
+    Utf32Input wend(end);
+    Utf32Input pend = parser.parse(wbegin, wend, fragment);
+
+    if (parser.error())
+      throw JsonParsingException(strf("Error parsing json: {} at {}:{}", parser.error(), parser.line(), parser.column()));
+    else if (pend != wend)
+      throw JsonParsingException(strf("Error extra data at end of input at {}:{}", parser.line(), parser.column()));
+
+    return stream.takeTop();
+  }
 }
 
 template <typename OutputIterator>
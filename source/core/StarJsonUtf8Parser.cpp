@@ -0,0 +1,574 @@
+#include "StarJsonUtf8Parser.hpp"
+#include "StarLexicalCast.hpp"
+
+#include <cstring>
+
+// SSE2 is part of the x86_64 baseline, so it needs no runtime dispatch.
+#ifdef STAR_ARCHITECTURE_X86_64
+#include <emmintrin.h>
+#define STAR_JSON_SSE2
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+namespace Star {
+
+namespace {
+#ifdef STAR_JSON_SSE2
+  inline unsigned firstSetBit(unsigned mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+  }
+#endif
+
+  // Returns the first byte in the range that cannot be copied verbatim into a
+  // string, which is a quote, backslash, NUL, or the start of a multi-byte
+  // UTF-8 sequence that must be validated.
+  inline char const* scanStringRun(char const* pos, char const* end) {
+#ifdef STAR_JSON_SSE2
+    __m128i const quote = _mm_set1_epi8('"');
+    __m128i const backslash = _mm_set1_epi8('\\');
+    __m128i const zero = _mm_setzero_si128();
+    while (end - pos >= 16) {
+      __m128i chars = _mm_loadu_si128((__m128i const*)pos);
+      __m128i special = _mm_or_si128(_mm_cmpeq_epi8(chars, quote), _mm_cmpeq_epi8(chars, backslash));
+      // Non-ASCII bytes already have their high bit set.
+      special = _mm_or_si128(special, _mm_or_si128(_mm_cmpeq_epi8(chars, zero), chars));
+      if (unsigned mask = _mm_movemask_epi8(special))
+        return pos + firstSetBit(mask);
+      pos += 16;
+    }
+#endif
+    for (; pos != end; ++pos) {
+      uint8_t c = *pos;
+      if (c == '"' || c == '\\' || c == 0 || c >= 0x80)
+        return pos;
+    }
+    return end;
+  }
+
+  inline bool isAsciiSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+  }
+
+  // Returns the first byte in the range that is not an ASCII JSON space.
+  inline char const* skipSpaceRun(char const* pos, char const* end) {
+#ifdef STAR_JSON_SSE2
+    __m128i const space = _mm_set1_epi8(' ');
+    __m128i const newline = _mm_set1_epi8('\n');
+    __m128i const carriageReturn = _mm_set1_epi8('\r');
+    __m128i const tab = _mm_set1_epi8('\t');
+    while (end - pos >= 16) {
+      __m128i chars = _mm_loadu_si128((__m128i const*)pos);
+      __m128i spaces = _mm_or_si128(
+          _mm_or_si128(_mm_cmpeq_epi8(chars, space), _mm_cmpeq_epi8(chars, newline)),
+          _mm_or_si128(_mm_cmpeq_epi8(chars, carriageReturn), _mm_cmpeq_epi8(chars, tab)));
+      if (unsigned mask = _mm_movemask_epi8(spaces) ^ 0xffff)
+        return pos + firstSetBit(mask);
+      pos += 16;
+    }
+#endif
+    while (pos != end && isAsciiSpace(*pos))
+      ++pos;
+    return pos;
+  }
+
+  // Powers of ten that are exactly representable as doubles.
+  double const ExactPowersOfTen[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+
+  class Utf8JsonParser {
+  public:
+    Utf8JsonParser(char const* begin, char const* end)
+      : m_begin(begin), m_pos(begin), m_end(end) {}
+
+    Json parse(bool fragment) {
+      Json result;
+      try {
+        white();
+        result = fragment ? value() : top();
+        white();
+      } catch (ParsingException const&) {
+        auto position = linePosition();
+        throw JsonParsingException(strf("Error parsing json: {} at {}:{}", m_error, position.first, position.second));
+      }
+
+      if (m_pos != m_end) {
+        auto position = linePosition();
+        throw JsonParsingException(strf("Error extra data at end of input at {}:{}", position.first, position.second));
+      }
+
+      return result;
+    }
+
+  private:
+    // Thrown internally to abort parsing.
+    class ParsingException {};
+
+    char peek() const {
+      return m_pos != m_end ? *m_pos : 0;
+    }
+
+    Json top() {
+      char c = peek();
+      if (c == '{')
+        return object();
+      else if (c == '[')
+        return array();
+      error("expected JSON object or array at top level");
+    }
+
+    Json value() {
+      char c = peek();
+      switch (c) {
+        case '{':
+          return object();
+        case '[':
+          return array();
+        case '"':
+          return Json(string());
+        case '-':
+          return number();
+        case 0:
+          error("unexpected end of stream parsing value");
+        default:
+          return c >= '0' && c <= '9' ? number() : word();
+      }
+    }
+
+    Json object() {
+      ++m_pos;
+      JsonObject object;
+
+      white();
+      if (peek() == '}') {
+        ++m_pos;
+        return Json(std::move(object));
+      }
+
+      while (true) {
+        String key = string();
+
+        white();
+        if (peek() != ':')
+          error("bad object, should be ':'");
+        ++m_pos;
+        white();
+
+        auto inserted = object.insert(std::move(key), value());
+        if (!inserted.second)
+          throw JsonParsingException(strf("Json object contains a duplicate entry for key '{}'", inserted.first->first));
+
+        white();
+        char c = peek();
+        if (c == '}') {
+          ++m_pos;
+          return Json(std::move(object));
+        } else if (c == ',') {
+          ++m_pos;
+          white();
+        } else if (c == 0) {
+          error("unexpected end of stream parsing object.");
+        } else {
+          error("bad object, should be '}' or ','");
+        }
+      }
+    }
+
+    Json array() {
+      ++m_pos;
+      JsonArray array;
+
+      white();
+      if (peek() == ']') {
+        ++m_pos;
+        return Json(std::move(array));
+      }
+
+      while (true) {
+        array.append(value());
+
+        white();
+        char c = peek();
+        if (c == ']') {
+          ++m_pos;
+          return Json(std::move(array));
+        } else if (c == ',') {
+          ++m_pos;
+          white();
+        } else if (c == 0) {
+          error("unexpected end of stream parsing array.");
+        } else {
+          error("bad array, should be ',' or ']'");
+        }
+      }
+    }
+
+    String string() {
+      if (peek() != '"')
+        error("bad string, should be '\"'");
+      ++m_pos;
+
+      // Strings without escapes are validated in place and copied once.
+      char const* start = m_pos;
+      while (true) {
+        m_pos = scanStringRun(m_pos, m_end);
+        if (m_pos == m_end)
+          error("unexpected end of stream reading string!");
+        uint8_t c = *m_pos;
+        if (c == '"') {
+          String result(start, m_pos - start);
+          ++m_pos;
+          return result;
+        } else if (c >= 0x80) {
+          utf8Sequence();
+        } else {
+          break;
+        }
+      }
+
+      m_buffer.assign(start, m_pos);
+      while (true) {
+        uint8_t c = *m_pos;
+        if (c == '"') {
+          ++m_pos;
+          return String(m_buffer);
+        } else if (c == '\\') {
+          ++m_pos;
+          escape();
+        } else if (c >= 0x80) {
+          char const* sequence = m_pos;
+          utf8Sequence();
+          m_buffer.append(sequence, m_pos);
+        } else {
+          error("unexpected end of stream reading string!");
+        }
+
+        char const* run = m_pos;
+        m_pos = scanStringRun(m_pos, m_end);
+        m_buffer.append(run, m_pos);
+        if (m_pos == m_end)
+          error("unexpected end of stream reading string!");
+      }
+    }
+
+    // Reads the escape sequence following a backslash into the string buffer.
+    void escape() {
+      char c = peek();
+      if (c == 'u') {
+        ++m_pos;
+        char32_t codepoint = hexCodepoint();
+        if (isUtf16LeadSurrogate(codepoint)) {
+          check('\\');
+          check('u');
+          char32_t trail = hexCodepoint();
+          if (!isUtf16TrailSurrogate(trail))
+            error("bad string unicode escape");
+          codepoint = utf32FromUtf16SurrogatePair(codepoint, trail);
+        }
+        char utf8[6];
+        m_buffer.append(utf8, utf8EncodeChar(utf8, codepoint));
+        return;
+      }
+
+      switch (c) {
+        case '"':
+          m_buffer += '"';
+          break;
+        case '\\':
+          m_buffer += '\\';
+          break;
+        case '/':
+          m_buffer += '/';
+          break;
+        case 'b':
+          m_buffer += '\b';
+          break;
+        case 'f':
+          m_buffer += '\f';
+          break;
+        case 'n':
+          m_buffer += '\n';
+          break;
+        case 'r':
+          m_buffer += '\r';
+          break;
+        case 't':
+          m_buffer += '\t';
+          break;
+        default:
+          error("bad string escape character");
+      }
+      ++m_pos;
+    }
+
+    char32_t hexCodepoint() {
+      char32_t codepoint = 0;
+      for (int i = 0; i < 4; ++i) {
+        char c = peek();
+        if (c >= '0' && c <= '9')
+          codepoint = codepoint * 16 + (c - '0');
+        else if (c >= 'a' && c <= 'f')
+          codepoint = codepoint * 16 + (c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F')
+          codepoint = codepoint * 16 + (c - 'A' + 10);
+        else
+          error("bad string unicode escape");
+        ++m_pos;
+      }
+      return codepoint;
+    }
+
+    // Validates and skips a multi-byte UTF-8 sequence.
+    void utf8Sequence() {
+      uint8_t lead = *m_pos;
+      size_t length;
+      char32_t codepoint;
+      if ((lead & 0xe0) == 0xc0) {
+        length = 2;
+        codepoint = lead & 0x1f;
+      } else if ((lead & 0xf0) == 0xe0) {
+        length = 3;
+        codepoint = lead & 0x0f;
+      } else if ((lead & 0xf8) == 0xf0) {
+        length = 4;
+        codepoint = lead & 0x07;
+      } else {
+        error("invalid UTF-8 sequence in string");
+      }
+
+      if ((size_t)(m_end - m_pos) < length)
+        error("unexpected end of stream reading string!");
+      for (size_t i = 1; i < length; ++i) {
+        uint8_t c = m_pos[i];
+        if ((c & 0xc0) != 0x80)
+          error("invalid UTF-8 sequence in string");
+        codepoint = (codepoint << 6) | (c & 0x3f);
+      }
+      if (codepoint > 0x10ffff)
+        error("invalid UTF-8 sequence in string");
+
+      m_pos += length;
+    }
+
+    Json number() {
+      char const* start = m_pos;
+      bool negative = false;
+      if (peek() == '-') {
+        negative = true;
+        ++m_pos;
+      }
+
+      // Up to 19 significant digits are accumulated exactly, anything longer
+      // or with an exponent out of the exact range is left to lexicalCast.
+      uint64_t mantissa = 0;
+      int significantDigits = 0;
+      int exponent = 0;
+      bool exact = true;
+      auto digit = [&](char c) {
+        if (mantissa != 0 || c != '0') {
+          if (significantDigits < 19)
+            mantissa = mantissa * 10 + (c - '0');
+          else
+            exact = false;
+          ++significantDigits;
+        }
+      };
+
+      char c = peek();
+      if (c == '0') {
+        ++m_pos;
+      } else if (c > '0' && c <= '9') {
+        for (; m_pos != m_end && *m_pos >= '0' && *m_pos <= '9'; ++m_pos)
+          digit(*m_pos);
+      } else {
+        error("bad number, must start with digit");
+      }
+
+      bool isDouble = false;
+      if (peek() == '.') {
+        isDouble = true;
+        ++m_pos;
+        for (; m_pos != m_end && *m_pos >= '0' && *m_pos <= '9'; ++m_pos) {
+          digit(*m_pos);
+          --exponent;
+        }
+      }
+
+      c = peek();
+      if (c == 'e' || c == 'E') {
+        isDouble = true;
+        ++m_pos;
+        bool negativeExponent = false;
+        c = peek();
+        if (c == '-' || c == '+') {
+          negativeExponent = c == '-';
+          ++m_pos;
+        }
+        int explicitExponent = 0;
+        char const* exponentStart = m_pos;
+        for (; m_pos != m_end && *m_pos >= '0' && *m_pos <= '9'; ++m_pos) {
+          if (explicitExponent < 10000)
+            explicitExponent = explicitExponent * 10 + (*m_pos - '0');
+        }
+        if (m_pos == exponentStart)
+          exact = false;
+        exponent += negativeExponent ? -explicitExponent : explicitExponent;
+      }
+
+      if (isDouble) {
+        // Both the mantissa and the power of ten are exact, so a single
+        // multiplication or division is correctly rounded.
+        if (exact && mantissa <= (uint64_t)1 << 53 && exponent >= -22 && exponent <= 22) {
+          double result = (double)mantissa;
+          if (exponent < 0)
+            result /= ExactPowersOfTen[-exponent];
+          else
+            result *= ExactPowersOfTen[exponent];
+          return Json(negative ? -result : result);
+        }
+
+        try {
+          return Json(lexicalCast<double>(StringView(start, m_pos - start)));
+        } catch (std::exception const& e) {
+          error(std::string("Bad double: ") + e.what());
+        }
+      } else {
+        if (exact && significantDigits <= 18)
+          return Json(negative ? -(int64_t)mantissa : (int64_t)mantissa);
+
+        try {
+          return Json(lexicalCast<long long>(StringView(start, m_pos - start)));
+        } catch (std::exception const& e) {
+          error(std::string("Bad integer: ") + e.what());
+        }
+      }
+    }
+
+    // true, false, or null
+    Json word() {
+      switch (peek()) {
+        case 't':
+          ++m_pos;
+          check('r');
+          check('u');
+          check('e');
+          return Json(true);
+        case 'f':
+          ++m_pos;
+          check('a');
+          check('l');
+          check('s');
+          check('e');
+          return Json(false);
+        case 'n':
+          ++m_pos;
+          check('u');
+          check('l');
+          check('l');
+          return Json();
+        default:
+          error("unexpected character parsing word");
+      }
+    }
+
+    // Checks current char then moves on to the next one
+    void check(char c) {
+      if (m_pos == m_end)
+        error("unexpected end of stream parsing word");
+      if (*m_pos != c)
+        error("unexpected character in word");
+      ++m_pos;
+    }
+
+    // Will skip whitespace and comments between tokens.
+    void white() {
+      while (m_pos != m_end) {
+        char c = *m_pos;
+        if (isAsciiSpace(c)) {
+          m_pos = skipSpaceRun(m_pos, m_end);
+        } else if (c == '/') {
+          comment();
+        } else if ((uint8_t)c == 0xef && m_end - m_pos >= 3 && (uint8_t)m_pos[1] == 0xbb && (uint8_t)m_pos[2] == 0xbf) {
+          // BOM or ZWNBSP
+          m_pos += 3;
+        } else {
+          return;
+        }
+      }
+    }
+
+    void comment() {
+      // Always consume '/' found in whitespace, because that is never valid
+      // JSON (other than comments)
+      ++m_pos;
+      char c = peek();
+      if (c == '/') {
+        // Read '//' style comments up until eol/eof.
+        auto newline = (char const*)memchr(m_pos, '\n', m_end - m_pos);
+        m_pos = newline ? newline : m_end;
+      } else if (c == '*') {
+        // Read '/*' style comments up until '*/'.
+        ++m_pos;
+        while (true) {
+          auto star = (char const*)memchr(m_pos, '*', m_end - m_pos);
+          if (!star) {
+            m_pos = m_end;
+            error("/* comment has no matching */");
+          }
+          m_pos = star + 1;
+          if (peek() == '/') {
+            ++m_pos;
+            return;
+          }
+        }
+      } else {
+        // The only allowed characters following / in whitespace are / and *
+        error("/ character in whitespace is not follwed by '/' or '*', invalid comment");
+      }
+    }
+
+    // One based line and column of the current position, where the column is
+    // counted in characters rather than bytes.
+    pair<size_t, size_t> linePosition() const {
+      size_t line = 1;
+      size_t column = 1;
+      for (char const* pos = m_begin; pos != m_pos; ++pos) {
+        if (*pos == '\n') {
+          ++line;
+          column = 1;
+        } else if (((uint8_t)*pos & 0xc0) != 0x80) {
+          ++column;
+        }
+      }
+      return {line, column};
+    }
+
+    [[noreturn]] void error(std::string message) {
+      m_error = std::move(message);
+      throw ParsingException();
+    }
+
+    char const* m_begin;
+    char const* m_pos;
+    char const* m_end;
+
+    std::string m_error;
+    // Reused for strings with escapes.
+    std::string m_buffer;
+  };
+}
+
+Json parseUtf8Json(char const* begin, char const* end, bool fragment) {
+  return Utf8JsonParser(begin, end).parse(fragment);
+}
+
+}
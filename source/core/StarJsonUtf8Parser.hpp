@@ -0,0 +1,18 @@
+#ifndef STAR_JSON_UTF8_PARSER_HPP
+#define STAR_JSON_UTF8_PARSER_HPP
+
+#include "StarJson.hpp"
+
+namespace Star {
+
+// Parses JSON directly from a buffer of UTF-8 bytes into Json values, rather
+// than decoding every character to UTF-32 and going through a JsonStream.
+// Accepts the same extended format as JsonParser, including comments, and
+// throws JsonParsingException with the same messages and line / column
+// information as inputUtf32Json.  Set fragment to true to parse any JSON type
+// rather than just object or array.
+Json parseUtf8Json(char const* begin, char const* end, bool fragment);
+
+}
+
+#endif
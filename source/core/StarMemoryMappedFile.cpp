@@ -0,0 +1,21 @@
+#include "StarMemoryMappedFile.hpp"
+
+namespace Star {
+
+String const& MemoryMappedFile::fileName() const {
+  return m_filename;
+}
+
+bool MemoryMappedFile::isMapped() const {
+  return m_data != nullptr;
+}
+
+char const* MemoryMappedFile::data() const {
+  return m_data;
+}
+
+size_t MemoryMappedFile::size() const {
+  return m_size;
+}
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "StarString.hpp"
+
+namespace Star {
+
+STAR_CLASS(MemoryMappedFile);
+
+// Read-only memory mapping of a file on disk.  The mapping is shared, so
+// writes made to the file through any other handle are visible through it,
+// but it only covers the size the file had when it was last mapped.  Not
+// thread safe; mapping and unmapping invalidate any pointer returned by
+// data().
+class MemoryMappedFile {
+public:
+  // Opens the given file for reading and maps it.  Throws IOException on
+  // error.
+  MemoryMappedFile(String filename);
+  ~MemoryMappedFile();
+
+  MemoryMappedFile(MemoryMappedFile const&) = delete;
+  MemoryMappedFile& operator=(MemoryMappedFile const&) = delete;
+
+  String const& fileName() const;
+
+  // Replaces the current mapping with one covering the current size of the
+  // file.
+  void map();
+  // Unmaps the file, which some platforms require before it can be truncated.
+  void unmap();
+
+  bool isMapped() const;
+
+  // Returns nullptr if nothing is mapped.
+  char const* data() const;
+  size_t size() const;
+
+private:
+  String m_filename;
+  shared_ptr<void> m_handle;
+  char const* m_data;
+  size_t m_size;
+};
+
+}
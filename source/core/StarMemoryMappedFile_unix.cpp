@@ -0,0 +1,57 @@
+#include "StarMemoryMappedFile.hpp"
+#include "StarFormat.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace Star {
+
+MemoryMappedFile::MemoryMappedFile(String filename)
+  : m_filename(std::move(filename)), m_data(nullptr), m_size(0) {
+  int fd = ::open(m_filename.utf8Ptr(), O_RDONLY);
+  if (fd < 0)
+    throw IOException::format("Could not open file '{}' for mapping, error: {}", m_filename, strerror(errno));
+  m_handle = shared_ptr<void>(new int(fd), [](void* p) {
+      ::close(*(int*)p);
+      delete (int*)p;
+    });
+
+  map();
+}
+
+MemoryMappedFile::~MemoryMappedFile() {
+  unmap();
+}
+
+void MemoryMappedFile::map() {
+  unmap();
+
+  struct stat st;
+  if (fstat(*(int*)m_handle.get(), &st) != 0)
+    throw IOException::format("Could not stat file '{}' for mapping, error: {}", m_filename, strerror(errno));
+
+  // Zero length mappings are not allowed, an empty file is simply unmapped.
+  if (st.st_size == 0)
+    return;
+
+  void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, *(int*)m_handle.get(), 0);
+  if (data == MAP_FAILED)
+    throw IOException::format("Could not map file '{}', error: {}", m_filename, strerror(errno));
+
+  m_data = (char const*)data;
+  m_size = st.st_size;
+}
+
+void MemoryMappedFile::unmap() {
+  if (m_data) {
+    munmap((void*)m_data, m_size);
+    m_data = nullptr;
+    m_size = 0;
+  }
+}
+
+}
@@ -0,0 +1,61 @@
+#include "StarMemoryMappedFile.hpp"
+#include "StarFormat.hpp"
+
+#include "StarString_windows.hpp"
+
+#include <windows.h>
+
+namespace Star {
+
+MemoryMappedFile::MemoryMappedFile(String filename)
+  : m_filename(std::move(filename)), m_data(nullptr), m_size(0) {
+  HANDLE file = CreateFileW(stringToUtf16(m_filename).get(),
+      GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    throw IOException::format("Could not open file '{}' for mapping, error code {}", m_filename, GetLastError());
+  m_handle = shared_ptr<void>(new HANDLE(file), [](void* p) {
+      CloseHandle(*(HANDLE*)p);
+      delete (HANDLE*)p;
+    });
+
+  map();
+}
+
+MemoryMappedFile::~MemoryMappedFile() {
+  unmap();
+}
+
+void MemoryMappedFile::map() {
+  unmap();
+
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(*(HANDLE*)m_handle.get(), &fileSize))
+    throw IOException::format("Could not get size of file '{}' for mapping, error code {}", m_filename, GetLastError());
+
+  // Zero length mappings are not allowed, an empty file is simply unmapped.
+  if (fileSize.QuadPart == 0)
+    return;
+
+  HANDLE mapping = CreateFileMappingW(*(HANDLE*)m_handle.get(), nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!mapping)
+    throw IOException::format("Could not create mapping of file '{}', error code {}", m_filename, GetLastError());
+
+  // The view keeps the mapping object alive on its own.
+  void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (!data)
+    throw IOException::format("Could not map file '{}', error code {}", m_filename, GetLastError());
+
+  m_data = (char const*)data;
+  m_size = (size_t)fileSize.QuadPart;
+}
+
+void MemoryMappedFile::unmap() {
+  if (m_data) {
+    UnmapViewOfFile(m_data);
+    m_data = nullptr;
+    m_size = 0;
+  }
+}
+
+}
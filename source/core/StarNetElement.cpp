@@ -11,6 +11,23 @@ void NetElementVersion::increment() {
   ++m_version;
 }
 
+NetElement::NetElement(NetElement const&) {}
+
+NetElement::NetElement(NetElement&&) {}
+
+NetElement::~NetElement() {
+  if (m_netParent)
+    m_netParent->netChildRemoved(this);
+}
+
+NetElement& NetElement::operator=(NetElement const&) {
+  return *this;
+}
+
+NetElement& NetElement::operator=(NetElement&&) {
+  return *this;
+}
+
 void NetElement::enableNetInterpolation(float) {}
 
 void NetElement::disableNetInterpolation() {}
@@ -19,4 +36,28 @@ void NetElement::tickNetInterpolation(float) {}
 
 void NetElement::blankNetDelta(float) {}
 
+Maybe<uint64_t> NetElement::netChangeVersion() const {
+  return {};
+}
+
+void NetElement::setNetParent(NetElement* parent) {
+  m_netParent = parent;
+}
+
+void NetElement::netChanged(uint64_t version) {
+  if (m_netParent)
+    m_netParent->netChildChanged(version);
+}
+
+void NetElement::netTrackingChanged() {
+  if (m_netParent)
+    m_netParent->netChildTrackingChanged();
+}
+
+void NetElement::netChildChanged(uint64_t) {}
+
+void NetElement::netChildTrackingChanged() {}
+
+void NetElement::netChildRemoved(NetElement*) {}
+
 }
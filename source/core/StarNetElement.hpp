@@ -2,6 +2,7 @@
 #define STAR_NET_ELEMENT_HPP
 
 #include "StarDataStream.hpp"
+#include "StarMaybe.hpp"
 
 namespace Star {
 
@@ -19,7 +20,16 @@ private:
 // Primary interface for the composable network synchronizable element system.
 class NetElement {
 public:
-  virtual ~NetElement() = default;
+  NetElement() = default;
+  // The parent belongs to the group an element was added to, so copies and
+  // moves never take it over, and assignment keeps the existing one.
+  NetElement(NetElement const&);
+  NetElement(NetElement&&);
+  // Removes the element from the group it was added to, if any.
+  virtual ~NetElement();
+
+  NetElement& operator=(NetElement const&);
+  NetElement& operator=(NetElement&&);
 
   // A network of NetElements will have a shared monotinically increasing
   // NetElementVersion.  When elements are updated, they will mark the version
@@ -55,6 +65,31 @@ public:
   // When extrapolating, it is important to notify when a delta WOULD have been
   // received even if no deltas are produced, so no extrapolation takes place.
   virtual void blankNetDelta(float interpolationTime);
+
+  // Elements may keep track of the highest version at which they changed, and
+  // report every change to the parent they were added to with netChanged, so
+  // that a parent can skip writing deltas for whole subtrees that have not
+  // changed since fromVersion.  Returns nothing for elements that do not,
+  // which are always asked to write their delta.
+  virtual Maybe<uint64_t> netChangeVersion() const;
+
+  void setNetParent(NetElement* parent);
+
+protected:
+  // Reports a change made at the given version to the parent, if any.
+  void netChanged(uint64_t version);
+  // Tells the parent, if any, that netChangeVersion may have gone from
+  // returning nothing to returning a version or the other way around.
+  void netTrackingChanged();
+
+  // Called on the parent of an element from netChanged and netTrackingChanged.
+  virtual void netChildChanged(uint64_t version);
+  virtual void netChildTrackingChanged();
+  // Called on the parent of an element when the element is destroyed.
+  virtual void netChildRemoved(NetElement* child);
+
+private:
+  NetElement* m_netParent = nullptr;
 };
 
 }
@@ -45,6 +45,8 @@ public:
   bool writeNetDelta(DataStream& ds, uint64_t fromVersion) const override;
   void readNetDelta(DataStream& ds, float interpolationTime = 0.0f) override;
 
+  Maybe<uint64_t> netChangeVersion() const override;
+
 protected:
   virtual void readData(DataStream& ds, T& t) const = 0;
   virtual void writeData(DataStream& ds, T const& t) const = 0;
@@ -158,6 +160,7 @@ void NetElementBasicField<T>::push(T value) {
   m_value = std::move(value);
   updated();
   m_latestUpdateVersion = m_netVersion ? m_netVersion->current() : 0;
+  netChanged(m_latestUpdateVersion);
   if (m_pendingInterpolatedValues)
     m_pendingInterpolatedValues->clear();
 }
@@ -173,6 +176,7 @@ void NetElementBasicField<T>::update(Mutator&& mutator) {
   if (mutator(m_value)) {
     updated();
     m_latestUpdateVersion = m_netVersion ? m_netVersion->current() : 0;
+    netChanged(m_latestUpdateVersion);
     if (m_pendingInterpolatedValues)
       m_pendingInterpolatedValues->clear();
   }
@@ -223,11 +227,17 @@ template <typename T>
 void NetElementBasicField<T>::netLoad(DataStream& ds) {
   readData(ds, m_value);
   m_latestUpdateVersion = m_netVersion ? m_netVersion->current() : 0;
+  netChanged(m_latestUpdateVersion);
   updated();
   if (m_pendingInterpolatedValues)
     m_pendingInterpolatedValues->clear();
 }
 
+template <typename T>
+Maybe<uint64_t> NetElementBasicField<T>::netChangeVersion() const {
+  return m_latestUpdateVersion;
+}
+
 template <typename T>
 bool NetElementBasicField<T>::writeNetDelta(DataStream& ds, uint64_t fromVersion) const {
   if (m_latestUpdateVersion < fromVersion)
@@ -245,6 +255,7 @@ void NetElementBasicField<T>::readNetDelta(DataStream& ds, float interpolationTi
   T t;
   readData(ds, t);
   m_latestUpdateVersion = m_netVersion ? m_netVersion->current() : 0;
+  netChanged(m_latestUpdateVersion);
   if (m_pendingInterpolatedValues) {
     // Only append an incoming delta to our pending value list if the incoming
     // step is forward in time of every other pending value.  In any other
@@ -42,6 +42,8 @@ public:
 
   bool writeNetDelta(DataStream& ds, uint64_t fromVersion) const override;
   void readNetDelta(DataStream& ds, float interpolationTime = 0.0f) override;
+
+  Maybe<uint64_t> netChangeVersion() const override;
   void blankNetDelta(float interpolationTime = 0.0f) override;
 
 private:
@@ -73,8 +75,10 @@ void NetElementFloating<T>::set(T value) {
   if (m_value != value) {
     // Only mark the step as updated here if it actually would change the
     // transmitted value.
-    if (!m_fixedPointBase || round(m_value / *m_fixedPointBase) != round(value / *m_fixedPointBase))
+    if (!m_fixedPointBase || round(m_value / *m_fixedPointBase) != round(value / *m_fixedPointBase)) {
       m_latestUpdateVersion = m_netVersion ? m_netVersion->current() : 0;
+      netChanged(m_latestUpdateVersion);
+    }
 
     m_value = value;
 
@@ -143,12 +147,18 @@ template <typename T>
 void NetElementFloating<T>::netLoad(DataStream& ds) {
   m_value = readValue(ds);
   m_latestUpdateVersion = m_netVersion ? m_netVersion->current() : 0;
+  netChanged(m_latestUpdateVersion);
   if (m_interpolationDataPoints) {
     m_interpolationDataPoints->clear();
     m_interpolationDataPoints->append({0.0f, m_value});
   }
 }
 
+template <typename T>
+Maybe<uint64_t> NetElementFloating<T>::netChangeVersion() const {
+  return m_latestUpdateVersion;
+}
+
 template <typename T>
 bool NetElementFloating<T>::writeNetDelta(DataStream& ds, uint64_t fromVersion) const {
   if (m_latestUpdateVersion < fromVersion)
@@ -167,6 +177,7 @@ void NetElementFloating<T>::readNetDelta(DataStream& ds, float interpolationTime
   T t = readValue(ds);
 
   m_latestUpdateVersion = m_netVersion ? m_netVersion->current() : 0;
+  netChanged(m_latestUpdateVersion);
   if (m_interpolationDataPoints) {
     if (interpolationTime < m_interpolationDataPoints->last().first)
       m_interpolationDataPoints->clear();
@@ -2,17 +2,32 @@
 
 namespace Star {
 
+NetElementGroup::~NetElementGroup() {
+  // Elements that were destroyed first have already removed themselves.
+  for (auto p : m_elements)
+    p.first->setNetParent(nullptr);
+}
+
 void NetElementGroup::addNetElement(NetElement* element, bool propagateInterpolation) {
   starAssert(!m_elements.any([element](auto p) { return p.first == element; }));
 
   element->initNetVersion(m_version);
   if (m_interpolationEnabled && propagateInterpolation)
     element->enableNetInterpolation(m_extrapolationHint);
+  element->setNetParent(this);
   m_elements.append(pair<NetElement*, bool>(element, propagateInterpolation));
+
+  if (auto version = element->netChangeVersion())
+    netChildChanged(*version);
+  else if (m_untrackedElements++ == 0)
+    netTrackingChanged();
 }
 
 void NetElementGroup::clearNetElements() {
+  for (auto p : m_elements)
+    p.first->setNetParent(nullptr);
   m_elements.clear();
+  updateTracking();
 }
 
 void NetElementGroup::initNetVersion(NetElementVersion const* version) {
@@ -57,7 +72,7 @@ void NetElementGroup::tickNetInterpolation(float dt) {
 }
 
 bool NetElementGroup::writeNetDelta(DataStream& ds, uint64_t fromStep) const {
-  if (m_elements.size() == 0) {
+  if (m_elements.size() == 0 || (m_untrackedElements == 0 && fromStep > m_changeVersion)) {
     return false;
   } else if (m_elements.size() == 1) {
     return m_elements[0].first->writeNetDelta(ds, fromStep);
@@ -105,4 +120,50 @@ void NetElementGroup::blankNetDelta(float interpolationTime) {
   }
 }
 
+Maybe<uint64_t> NetElementGroup::netChangeVersion() const {
+  if (m_untrackedElements != 0)
+    return {};
+  return m_changeVersion;
+}
+
+void NetElementGroup::netChildChanged(uint64_t version) {
+  if (version <= m_changeVersion)
+    return;
+  m_changeVersion = version;
+  netChanged(version);
+}
+
+void NetElementGroup::netChildTrackingChanged() {
+  updateTracking();
+}
+
+void NetElementGroup::netChildRemoved(NetElement* child) {
+  // Elements are usually destroyed in the reverse order they were added in.
+  // The count of untracked elements is left as is, which at worst visits the
+  // group more often than needed until tracking is next updated.
+  for (size_t i = m_elements.size(); i > 0; --i) {
+    if (m_elements[i - 1].first == child) {
+      m_elements.eraseAt(i - 1);
+      break;
+    }
+  }
+}
+
+void NetElementGroup::updateTracking() {
+  bool wasTracked = m_untrackedElements == 0;
+  uint64_t changeVersion = m_changeVersion;
+
+  m_untrackedElements = 0;
+  for (auto p : m_elements) {
+    if (auto version = p.first->netChangeVersion())
+      changeVersion = max(changeVersion, *version);
+    else
+      ++m_untrackedElements;
+  }
+
+  netChildChanged(changeVersion);
+  if (wasTracked != (m_untrackedElements == 0))
+    netTrackingChanged();
+}
+
 }
@@ -10,9 +10,14 @@ namespace Star {
 // A static group of NetElements that itself is a NetElement and serializes
 // changes based on the order in which elements are added.  All participants
 // must externally add elements of the correct type in the correct order.
+//
+// The group keeps the highest version any of its elements reported changing
+// at, so while every element tracks its changes, writing a delta from a later
+// version returns immediately without visiting any element.
 class NetElementGroup : public NetElement {
 public:
   NetElementGroup() = default;
+  ~NetElementGroup();
 
   NetElementGroup(NetElementGroup const&) = delete;
   NetElementGroup& operator=(NetElementGroup const&) = delete;
@@ -36,16 +41,30 @@ public:
   void readNetDelta(DataStream& ds, float interpolationTime = 0.0f) override;
   void blankNetDelta(float interpolationTime) override;
 
+  Maybe<uint64_t> netChangeVersion() const override;
+
   NetElementVersion const* netVersion() const;
   bool netInterpolationEnabled() const;
   float netExtrapolationHint() const;
 
+protected:
+  void netChildChanged(uint64_t version) override;
+  void netChildTrackingChanged() override;
+  void netChildRemoved(NetElement* child) override;
+
 private:
+  void updateTracking();
+
   List<pair<NetElement*, bool>> m_elements;
   NetElementVersion const* m_version = nullptr;
   bool m_interpolationEnabled = false;
   float m_extrapolationHint = 0.0f;
 
+  // Number of elements that do not track their changes, and the highest
+  // version at which any element that does reported a change.
+  size_t m_untrackedElements = 0;
+  uint64_t m_changeVersion = 0;
+
   mutable DataStreamBuffer m_buffer;
 };
 
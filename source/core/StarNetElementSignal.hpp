@@ -27,6 +27,8 @@ public:
   bool writeNetDelta(DataStream& ds, uint64_t fromVersion) const override;
   void readNetDelta(DataStream& ds, float interpolationTime = 0.0) override;
 
+  Maybe<uint64_t> netChangeVersion() const override;
+
   void send(Signal signal);
   List<Signal> receive();
 
@@ -121,11 +123,19 @@ void NetElementSignal<Signal>::readNetDelta(DataStream& ds, float interpolationT
   }
 }
 
+template <typename Signal>
+Maybe<uint64_t> NetElementSignal<Signal>::netChangeVersion() const {
+  if (m_signals.empty())
+    return 0;
+  return m_signals.last().version;
+}
+
 template <typename Signal>
 void NetElementSignal<Signal>::send(Signal signal) {
   m_signals.append({m_netVersion ? m_netVersion->current() : 0, signal, false});
   while (m_signals.size() > m_maxSignalQueue)
     m_signals.removeFirst();
+  netChanged(m_signals.last().version);
 }
 
 template <typename Signal>
@@ -63,6 +63,10 @@ void NetElementSyncGroup::blankNetDelta(float interpolationTime) {
     netElementsNeedLoad(false);
 }
 
+Maybe<uint64_t> NetElementSyncGroup::netChangeVersion() const {
+  return {};
+}
+
 void NetElementSyncGroup::netElementsNeedLoad(bool) {}
 
 void NetElementSyncGroup::netElementsNeedStore() {}
@@ -21,6 +21,10 @@ public:
   void readNetDelta(DataStream& ds, float interpolationTime = 0.0f) override;
   void blankNetDelta(float interpolationTime = 0.0f) override;
 
+  // Elements are only brought up to date when writing a delta, so a parent
+  // can never skip this group.
+  Maybe<uint64_t> netChangeVersion() const override;
+
 protected:
   // Notifies when data needs to be pulled from NetElements, load is true if
   // this is due to a netLoad call
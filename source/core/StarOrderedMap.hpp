@@ -401,8 +401,8 @@ auto OrderedMapWrapper<Map, Key, Value, Allocator, MapArgs...>::take(key_type co
     auto orderIt = i->second;
     m_map.erase(i);
 
-    mapped_type v = orderIt->second;
-    m_order.erase(i->second);
+    mapped_type v = std::move(orderIt->second);
+    m_order.erase(orderIt);
     return v;
   } else {
     throw MapException(strf("Key '{}' not found in OrderedMap::take()", outputAny(k)));
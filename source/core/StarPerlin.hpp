@@ -6,6 +6,10 @@
 #include "StarInterpolation.hpp"
 #include "StarRandom.hpp"
 
+#ifdef STAR_ARCHITECTURE_X86_64
+#include <emmintrin.h>
+#endif
+
 namespace Star {
 
 STAR_EXCEPTION(PerlinException, StarException);
@@ -19,6 +23,8 @@ enum class PerlinType {
 extern EnumMap<PerlinType> const PerlinTypeNames;
 
 int const PerlinSampleSize = 512;
+// Number of points batched 2D evaluation works on at a time.
+size_t const PerlinBatchSize = 64;
 
 template <typename Float>
 class Perlin {
@@ -41,6 +47,12 @@ public:
   Float get(Float x, Float y) const;
   Float get(Float x, Float y, Float z) const;
 
+  // Evaluates 2D noise for 'count' points at once, storing get(x[i], y[i]) in
+  // result[i].  The results are identical to evaluating each point on its
+  // own, but whole rows or columns of points are much faster to evaluate this
+  // way.
+  void get(size_t count, Float const* x, Float const* y, Float* result) const;
+
   PerlinType type() const;
 
   unsigned octaves() const;
@@ -61,6 +73,7 @@ private:
 
   Float noise1(Float arg) const;
   Float noise2(Float vec[2]) const;
+  void noise2(size_t count, Float const* x, Float const* y, Float* result) const;
   Float noise3(Float vec[3]) const;
 
   void normalize2(Float v[2]) const;
@@ -311,6 +324,70 @@ Float Perlin<Float>::get(Float x, Float y, Float z) const {
   }
 }
 
+template <typename Float>
+void Perlin<Float>::get(size_t count, Float const* x, Float const* y, Float* result) const {
+  if (m_type == PerlinType::Uninitialized)
+    throw PerlinException("::get called on uninitialized Perlin");
+
+  // Same as perlin(x, y), billow(x, y) and ridgedMulti(x, y), but going
+  // through the octaves for a batch of points at a time.
+  Float px[PerlinBatchSize];
+  Float py[PerlinBatchSize];
+  Float val[PerlinBatchSize];
+  Float sum[PerlinBatchSize];
+  Float weight[PerlinBatchSize];
+
+  for (size_t start = 0; start < count; start += PerlinBatchSize) {
+    size_t batch = min(count - start, PerlinBatchSize);
+    for (size_t i = 0; i < batch; ++i) {
+      px[i] = x[start + i] * m_frequency;
+      py[i] = y[start + i] * m_frequency;
+      sum[i] = 0;
+      weight[i] = 1.0;
+    }
+
+    Float scale = 1;
+    for (int o = 0; o < m_octaves; ++o) {
+      noise2(batch, px, py, val);
+
+      if (m_type == PerlinType::Perlin) {
+        for (size_t i = 0; i < batch; ++i)
+          sum[i] += val[i] / scale;
+      } else if (m_type == PerlinType::Billow) {
+        for (size_t i = 0; i < batch; ++i) {
+          Float v = 2.0 * fabs(val[i]) - 1.0;
+          sum[i] += v / scale;
+        }
+      } else {
+        for (size_t i = 0; i < batch; ++i) {
+          Float v = m_offset - fabs(val[i]);
+          v *= v;
+          v *= weight[i];
+          weight[i] = clamp<Float>(v * m_gain, 0.0, 1.0);
+          sum[i] += v / scale;
+        }
+      }
+
+      scale *= m_alpha;
+      for (size_t i = 0; i < batch; ++i) {
+        px[i] *= m_beta;
+        py[i] *= m_beta;
+      }
+    }
+
+    if (m_type == PerlinType::Perlin) {
+      for (size_t i = 0; i < batch; ++i)
+        result[start + i] = sum[i] * m_amplitude + m_bias;
+    } else if (m_type == PerlinType::Billow) {
+      for (size_t i = 0; i < batch; ++i)
+        result[start + i] = (sum[i] + 0.5) * m_amplitude + m_bias;
+    } else {
+      for (size_t i = 0; i < batch; ++i)
+        result[start + i] = ((sum[i] * 1.25) - 1.0) * m_amplitude + m_bias;
+    }
+  }
+}
+
 template <typename Float>
 PerlinType Perlin<Float>::type() const {
   return m_type;
@@ -407,6 +484,89 @@ inline Float Perlin<Float>::noise2(Float vec[2]) const {
   return lerp(sy, a, b);
 }
 
+template <typename Float>
+void Perlin<Float>::noise2(size_t count, Float const* x, Float const* y, Float* result) const {
+  size_t n = 0;
+
+#ifdef STAR_ARCHITECTURE_X86_64
+  if constexpr (std::is_same<Float, float>::value) {
+    // Performs exactly the same floating point operations as noise2 above on
+    // four points at a time, only the table lookups are done one by one.
+    __m128i const mask = _mm_set1_epi32(PerlinSampleSize - 1);
+
+    auto setup4 = [&](__m128 v, int* b0, int* b1, __m128& r0, __m128& r1) {
+      __m128i t = _mm_cvttps_epi32(v);
+      __m128i iv = _mm_add_epi32(t, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(t), v)));
+      _mm_storeu_si128((__m128i*)b0, _mm_and_si128(iv, mask));
+      _mm_storeu_si128((__m128i*)b1, _mm_and_si128(_mm_add_epi32(iv, _mm_set1_epi32(1)), mask));
+      r0 = _mm_sub_ps(v, _mm_cvtepi32_ps(iv));
+      r1 = _mm_sub_ps(r0, _mm_set1_ps(1.0f));
+    };
+
+    // s_curve rounds t * t to float and does the rest in double.
+    auto sCurve4 = [](__m128 t) {
+      __m128 tt = _mm_mul_ps(t, t);
+      auto half = [](__m128 tt, __m128 t) {
+        __m128d k = _mm_sub_pd(_mm_set1_pd(3.0), _mm_mul_pd(_mm_set1_pd(2.0), _mm_cvtps_pd(t)));
+        return _mm_cvtpd_ps(_mm_mul_pd(_mm_cvtps_pd(tt), k));
+      };
+      return _mm_movelh_ps(half(tt, t), half(_mm_movehl_ps(tt, tt), _mm_movehl_ps(t, t)));
+    };
+
+    auto at2x4 = [](__m128 qx, __m128 qy, __m128 rx, __m128 ry) {
+      return _mm_add_ps(_mm_mul_ps(rx, qx), _mm_mul_ps(ry, qy));
+    };
+
+    auto lerp4 = [](__m128 offset, __m128 f0, __m128 f1) {
+      return _mm_add_ps(_mm_mul_ps(f0, _mm_sub_ps(_mm_set1_ps(1.0f), offset)), _mm_mul_ps(f1, offset));
+    };
+
+    int bx0[4], bx1[4], by0[4], by1[4];
+    alignas(16) float q[8][4];
+    for (; n + 4 <= count; n += 4) {
+      __m128 rx0, rx1, ry0, ry1;
+      setup4(_mm_loadu_ps(x + n), bx0, bx1, rx0, rx1);
+      setup4(_mm_loadu_ps(y + n), by0, by1, ry0, ry1);
+
+      for (int k = 0; k < 4; ++k) {
+        int i = p[bx0[k]];
+        int j = p[bx1[k]];
+        float const* g00 = g2[p[i + by0[k]]];
+        float const* g10 = g2[p[j + by0[k]]];
+        float const* g01 = g2[p[i + by1[k]]];
+        float const* g11 = g2[p[j + by1[k]]];
+        q[0][k] = g00[0];
+        q[1][k] = g00[1];
+        q[2][k] = g10[0];
+        q[3][k] = g10[1];
+        q[4][k] = g01[0];
+        q[5][k] = g01[1];
+        q[6][k] = g11[0];
+        q[7][k] = g11[1];
+      }
+
+      __m128 sx = sCurve4(rx0);
+      __m128 sy = sCurve4(ry0);
+
+      __m128 u = at2x4(_mm_load_ps(q[0]), _mm_load_ps(q[1]), rx0, ry0);
+      __m128 v = at2x4(_mm_load_ps(q[2]), _mm_load_ps(q[3]), rx1, ry0);
+      __m128 a = lerp4(sx, u, v);
+
+      u = at2x4(_mm_load_ps(q[4]), _mm_load_ps(q[5]), rx0, ry1);
+      v = at2x4(_mm_load_ps(q[6]), _mm_load_ps(q[7]), rx1, ry1);
+      __m128 b = lerp4(sx, u, v);
+
+      _mm_storeu_ps(result + n, lerp4(sy, a, b));
+    }
+  }
+#endif
+
+  for (; n < count; ++n) {
+    Float vec[2] = {x[n], y[n]};
+    result[n] = noise2(vec);
+  }
+}
+
 template <typename Float>
 inline Float Perlin<Float>::noise3(Float vec[3]) const {
   int bx0, bx1, by0, by1, bz0, bz1, b00, b10, b01, b11;
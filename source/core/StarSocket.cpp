@@ -1,7 +1,13 @@
 #include "StarSocket.hpp"
 #include "StarLogging.hpp"
+#include "StarTime.hpp"
 #include "StarNetImpl.hpp"
 
+#ifdef STAR_SYSTEM_LINUX
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
 namespace Star {
 
 Maybe<SocketPollResult> Socket::poll(SocketPollQuery const& query, unsigned timeout) {
@@ -129,6 +135,14 @@ void Socket::bind(HostAddressWithPort const& addressWithPort) {
   if (::bind(m_impl->socketDesc, (struct sockaddr*)&sockAddr, sockAddrLen) < 0)
     throw NetworkException(strf("Cannot bind socket to {}: {}", m_localAddress, netErrorString()));
 
+  // Binding to port 0 picks a free port, look it up so that it can be
+  // connected to.
+  if (addressWithPort.port() == 0) {
+    sockAddrLen = sizeof(sockAddr);
+    if (::getsockname(m_impl->socketDesc, (struct sockaddr*)&sockAddr, &sockAddrLen) == 0)
+      setAddressFromNative(m_localAddress, m_networkMode, &sockAddr);
+  }
+
   m_socketMode = SocketMode::Bound;
 
   Logger::debug("bind {} ({})", addressWithPort, m_impl->socketDesc);
@@ -269,4 +283,164 @@ void Socket::doClose() {
   }
 }
 
+#ifdef STAR_SYSTEM_LINUX
+static int const SocketPollerMaxEvents = 256;
+#else
+// Socket::poll cannot be interrupted, so waits are split into slices of this
+// many milliseconds to check for wake().
+static unsigned const SocketPollerWakeCheckTime = 1;
+#endif
+
+SocketPoller::SocketPoller() {
+#ifdef STAR_SYSTEM_LINUX
+  m_epollDescriptor = ::epoll_create1(EPOLL_CLOEXEC);
+  if (m_epollDescriptor < 0)
+    throw NetworkException::format("Error during call to epoll_create1, '{}'", netErrorString());
+
+  m_wakeDescriptor = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (m_wakeDescriptor < 0) {
+    ::close(m_epollDescriptor);
+    throw NetworkException::format("Error during call to eventfd, '{}'", netErrorString());
+  }
+
+  // The wake descriptor is the only one registered without a socket.
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.ptr = nullptr;
+  if (::epoll_ctl(m_epollDescriptor, EPOLL_CTL_ADD, m_wakeDescriptor, &event) != 0) {
+    ::close(m_wakeDescriptor);
+    ::close(m_epollDescriptor);
+    throw NetworkException::format("Error during call to epoll_ctl, '{}'", netErrorString());
+  }
+#else
+  m_woken = false;
+#endif
+}
+
+SocketPoller::~SocketPoller() {
+#ifdef STAR_SYSTEM_LINUX
+  ::close(m_wakeDescriptor);
+  ::close(m_epollDescriptor);
+#endif
+}
+
+void SocketPoller::set(SocketPtr const& socket, SocketPollQueryEntry const& query) {
+#ifdef STAR_SYSTEM_LINUX
+  // Prevent the socket from being closed while its descriptor is in use.
+  ReadLocker locker(socket->m_mutex);
+  socket->checkOpen("SocketPoller::set");
+
+  epoll_event event = {};
+  if (query.readable)
+    event.events |= EPOLLIN;
+  if (query.writable)
+    event.events |= EPOLLOUT;
+  event.data.ptr = socket.get();
+  int operation = m_entries.contains(socket.get()) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+  if (::epoll_ctl(m_epollDescriptor, operation, socket->m_impl->socketDesc, &event) != 0)
+    throw NetworkException::format("Error during call to epoll_ctl, '{}'", netErrorString());
+#endif
+
+  m_entries[socket.get()] = Entry{socket, query};
+}
+
+void SocketPoller::remove(SocketPtr const& socket) {
+  auto i = m_entries.find(socket.get());
+  if (i == m_entries.end())
+    return;
+
+#ifdef STAR_SYSTEM_LINUX
+  // Closing a socket already removes it from the epoll set, and its
+  // descriptor may since have been reused.
+  ReadLocker locker(socket->m_mutex);
+  if (socket->isOpen())
+    ::epoll_ctl(m_epollDescriptor, EPOLL_CTL_DEL, socket->m_impl->socketDesc, nullptr);
+#endif
+
+  m_entries.erase(i);
+}
+
+bool SocketPoller::contains(SocketPtr const& socket) const {
+  return m_entries.contains(socket.get());
+}
+
+size_t SocketPoller::size() const {
+  return m_entries.size();
+}
+
+SocketPollResult SocketPoller::wait(unsigned timeout) {
+  SocketPollResult result;
+
+#ifdef STAR_SYSTEM_LINUX
+  epoll_event events[SocketPollerMaxEvents];
+  int count = ::epoll_wait(m_epollDescriptor, events, SocketPollerMaxEvents, (int)timeout);
+  if (count < 0) {
+    if (errno == EINTR)
+      return result;
+    throw NetworkException::format("Error during call to epoll_wait, '{}'", netErrorString());
+  }
+
+  for (int i = 0; i < count; ++i) {
+    if (!events[i].data.ptr) {
+      uint64_t wakeCount;
+      while (::read(m_wakeDescriptor, &wakeCount, sizeof(wakeCount)) > 0) {}
+      continue;
+    }
+
+    auto entry = m_entries.ptr((Socket*)events[i].data.ptr);
+    if (!entry)
+      continue;
+
+    SocketPollResultEntry pr;
+    pr.readable = events[i].events & EPOLLIN;
+    pr.writable = events[i].events & EPOLLOUT;
+    pr.exception = events[i].events & EPOLLHUP || events[i].events & EPOLLERR;
+    if (events[i].events & EPOLLHUP) {
+      ReadLocker locker(entry->socket->m_mutex);
+      entry->socket->doShutdown();
+    }
+    result.add(entry->socket, std::move(pr));
+  }
+
+#else
+  int64_t deadline = Time::monotonicMilliseconds() + timeout;
+  while (!m_woken.exchange(false)) {
+    int64_t remaining = deadline - Time::monotonicMilliseconds();
+    if (remaining <= 0)
+      break;
+    unsigned slice = (unsigned)min<int64_t>(remaining, SocketPollerWakeCheckTime);
+
+    SocketPollQuery query;
+    for (auto const& p : m_entries) {
+      if (p.second.socket->isOpen())
+        query.add(p.second.socket, p.second.query);
+    }
+
+    if (query.empty()) {
+      Thread::sleep(slice);
+    } else if (auto polled = Socket::poll(query, slice)) {
+      for (auto& p : *polled) {
+        if (p.second.readable || p.second.writable || p.second.exception)
+          result.add(p.first, p.second);
+      }
+      if (!result.empty())
+        break;
+    }
+  }
+#endif
+
+  return result;
+}
+
+void SocketPoller::wake() {
+#ifdef STAR_SYSTEM_LINUX
+  uint64_t wakeCount = 1;
+  // Can only fail if the counter would overflow, in which case the poller is
+  // already woken.
+  (void)!::write(m_wakeDescriptor, &wakeCount, sizeof(wakeCount));
+#else
+  m_woken = true;
+#endif
+}
+
 }
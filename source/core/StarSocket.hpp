@@ -12,6 +12,7 @@ STAR_EXCEPTION(SocketClosedException, NetworkException);
 
 STAR_STRUCT(SocketImpl);
 STAR_CLASS(Socket);
+STAR_CLASS(SocketPoller);
 
 enum class SocketMode {
   Closed,
@@ -74,6 +75,8 @@ public:
   void close();
 
 protected:
+  friend class SocketPoller;
+
   enum class SocketType {
     Tcp,
     Udp
@@ -93,6 +96,54 @@ protected:
   HostAddressWithPort m_localAddress;
 };
 
+// Waits for I/O readiness on a set of sockets that is kept between calls,
+// rather than given on every call like with Socket::poll, so that waiting
+// does not cost anything per idle socket.  Uses epoll on Linux, and
+// Socket::poll everywhere else.
+//
+// Only wake() may be called concurrently with other methods.
+class SocketPoller {
+public:
+  SocketPoller();
+  ~SocketPoller();
+
+  SocketPoller(SocketPoller const&) = delete;
+  SocketPoller& operator=(SocketPoller const&) = delete;
+
+  // Adds the socket to the set, or changes what it is queried for if it is
+  // already in the set.
+  void set(SocketPtr const& socket, SocketPollQueryEntry const& query);
+  // Closed sockets may be left in the set, but they will never be ready.
+  void remove(SocketPtr const& socket);
+  bool contains(SocketPtr const& socket) const;
+  size_t size() const;
+
+  // Waits until any sockets are ready for the queried I/O or have error
+  // conditions, until wake() is called, or until the timeout runs out.  Returns
+  // the sockets that are ready, which is empty if woken or timed out.  Like
+  // Socket::poll, sockets that have hung up are shut down.
+  SocketPollResult wait(unsigned timeout);
+
+  // Makes the current call to wait() return, or the next one if no thread is
+  // waiting.
+  void wake();
+
+private:
+  struct Entry {
+    SocketPtr socket;
+    SocketPollQueryEntry query;
+  };
+
+  HashMap<Socket*, Entry> m_entries;
+
+#ifdef STAR_SYSTEM_LINUX
+  int m_epollDescriptor;
+  int m_wakeDescriptor;
+#else
+  atomic<bool> m_woken;
+#endif
+};
+
 }
 
 #endif
@@ -182,6 +182,10 @@ bool TcpServer::isListening() const {
   return m_listenSocket->isActive();
 }
 
+HostAddressWithPort TcpServer::listenAddress() const {
+  return m_listenSocket->localAddress();
+}
+
 TcpSocketPtr TcpServer::accept(unsigned timeout) {
   MutexLocker locker(m_mutex);
   Socket::poll({{m_listenSocket, {true, false}}}, timeout);
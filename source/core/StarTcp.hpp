@@ -48,6 +48,10 @@ public:
   void stop();
   bool isListening() const;
 
+  // The address the server is listening on.  If it was given port 0, this has
+  // the port that was picked instead.
+  HostAddressWithPort listenAddress() const;
+
   // Blocks until next connection available for the given timeout.  Throws
   // ServerClosed if close() is called.  Cannot be called if AcceptCallback is
   // set.
@@ -0,0 +1,167 @@
+#include "StarTickProfiler.hpp"
+#include "StarTime.hpp"
+
+namespace Star {
+
+// Small, stable numbers for the threads recording sections, used as the trace
+// thread ids.
+static atomic<unsigned> s_nextThreadIndex(0);
+
+static unsigned currentThreadIndex() {
+  thread_local unsigned threadIndex = s_nextThreadIndex++;
+  return threadIndex;
+}
+
+TickProfiler::Scope::Scope(TickProfiler& profiler, SectionId section, Maybe<int64_t> id)
+  : m_profiler(profiler.enabled() ? &profiler : nullptr), m_section(section), m_id(id), m_start(0.0) {
+  if (m_profiler)
+    m_start = Time::monotonicTime();
+}
+
+TickProfiler::Scope::~Scope() {
+  if (m_profiler)
+    m_profiler->record(m_section, m_start, Time::monotonicTime(), m_id);
+}
+
+TickProfiler::TickProfiler(size_t windowTicks, size_t traceTicks, size_t maxTraceEvents)
+  : m_windowTicks(max<size_t>(windowTicks, 1)), m_traceTicks(traceTicks), m_maxTraceEvents(maxTraceEvents),
+    m_enabled(false), m_tickStart(0.0), m_windowPosition(0), m_windowFilled(0) {
+  section("tick");
+}
+
+bool TickProfiler::enabled() const {
+  return m_enabled;
+}
+
+void TickProfiler::setEnabled(bool enabled) {
+  if (enabled == m_enabled)
+    return;
+
+  if (enabled)
+    reset();
+  m_enabled = enabled;
+}
+
+auto TickProfiler::section(String const& name) -> SectionId {
+  MutexLocker locker(m_mutex);
+  if (auto id = m_sectionIds.ptr(name))
+    return *id;
+
+  SectionId id = m_sections.size();
+  m_sections.append(Section{name, 0.0, List<float>(m_windowTicks, 0.0f)});
+  m_sectionIds.add(name, id);
+  return id;
+}
+
+void TickProfiler::beginTick() {
+  if (m_enabled)
+    m_tickStart = Time::monotonicTime();
+}
+
+void TickProfiler::endTick() {
+  if (!m_enabled)
+    return;
+
+  record(0, m_tickStart, Time::monotonicTime());
+
+  MutexLocker locker(m_mutex);
+  for (auto& section : m_sections) {
+    section.window[m_windowPosition] = section.tickTotal * 1000.0;
+    section.tickTotal = 0.0;
+  }
+  m_windowPosition = (m_windowPosition + 1) % m_windowTicks;
+  m_windowFilled = min(m_windowFilled + 1, m_windowTicks);
+
+  if (m_traceTicks != 0) {
+    m_trace.append(take(m_tickTrace));
+    while (m_trace.size() > m_traceTicks)
+      m_trace.removeFirst();
+  }
+}
+
+void TickProfiler::record(SectionId section, double start, double end, Maybe<int64_t> id) {
+  unsigned thread = currentThreadIndex();
+
+  MutexLocker locker(m_mutex);
+  m_sections.at(section).tickTotal += end - start;
+  if (m_traceTicks != 0 && m_tickTrace.size() < m_maxTraceEvents)
+    m_tickTrace.append(TraceEvent{section, start, end, thread, id});
+}
+
+Json TickProfiler::summary() const {
+  MutexLocker locker(m_mutex);
+
+  List<pair<float, JsonObject>> sections;
+  List<float> times;
+  for (auto const& section : m_sections) {
+    if (m_windowFilled == 0)
+      break;
+
+    times.clear();
+    double total = 0.0;
+    for (size_t i = 0; i < m_windowFilled; ++i) {
+      times.append(section.window[i]);
+      total += section.window[i];
+    }
+    sort(times);
+
+    float mean = total / m_windowFilled;
+    sections.append({mean, JsonObject{
+        {"name", section.name},
+        {"meanMs", mean},
+        {"p50Ms", times[times.size() / 2]},
+        {"p99Ms", times[min<size_t>(times.size() * 99 / 100, times.size() - 1)]},
+        {"maxMs", times.last()}
+      }});
+  }
+  sortByComputedValue(sections, [](pair<float, JsonObject> const& section) { return -section.first; });
+
+  return JsonObject{
+    {"ticks", m_windowFilled},
+    {"sections", sections.transformed([](pair<float, JsonObject> const& section) -> Json { return section.second; })}
+  };
+}
+
+JsonArray TickProfiler::traceEvents(int64_t processId, String const& processName) const {
+  MutexLocker locker(m_mutex);
+
+  JsonArray events;
+  events.append(JsonObject{
+      {"name", "process_name"},
+      {"ph", "M"},
+      {"pid", processId},
+      {"args", JsonObject{{"name", processName}}}
+    });
+
+  for (auto const& tick : m_trace) {
+    for (auto const& event : tick) {
+      JsonObject traceEvent{
+        {"name", m_sections.at(event.section).name},
+        {"ph", "X"},
+        {"ts", event.start * 1000000.0},
+        {"dur", (event.end - event.start) * 1000000.0},
+        {"pid", processId},
+        {"tid", event.thread}
+      };
+      if (event.id)
+        traceEvent["args"] = JsonObject{{"id", *event.id}};
+      events.append(std::move(traceEvent));
+    }
+  }
+
+  return events;
+}
+
+void TickProfiler::reset() {
+  MutexLocker locker(m_mutex);
+  for (auto& section : m_sections) {
+    section.tickTotal = 0.0;
+    section.window = List<float>(m_windowTicks, 0.0f);
+  }
+  m_windowPosition = 0;
+  m_windowFilled = 0;
+  m_tickTrace.clear();
+  m_trace.clear();
+}
+
+}
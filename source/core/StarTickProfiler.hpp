@@ -0,0 +1,104 @@
+#ifndef STAR_TICK_PROFILER_HPP
+#define STAR_TICK_PROFILER_HPP
+
+#include "StarJson.hpp"
+#include "StarThread.hpp"
+
+namespace Star {
+
+STAR_CLASS(TickProfiler);
+
+// Collects the time taken by named sections of something that runs in ticks,
+// such as the phases of a world update.  The total time of every section in
+// each tick is kept over a rolling window of ticks, along with every recorded
+// section of the last few ticks for exporting as a Chrome trace.  While
+// disabled nothing is recorded and scopes do not read the clock, so they can
+// be left in place.
+//
+// beginTick, endTick and setEnabled must be called from one thread, sections
+// may be recorded from any thread in between.
+class TickProfiler {
+public:
+  typedef size_t SectionId;
+
+  // Records the section from construction to destruction, if the profiler is
+  // enabled at construction.
+  class Scope {
+  public:
+    Scope(TickProfiler& profiler, SectionId section, Maybe<int64_t> id = {});
+    ~Scope();
+
+    Scope(Scope const&) = delete;
+    Scope& operator=(Scope const&) = delete;
+
+  private:
+    TickProfiler* m_profiler;
+    SectionId m_section;
+    Maybe<int64_t> m_id;
+    double m_start;
+  };
+
+  // Tick totals are kept for the last windowTicks ticks, and trace events for
+  // the last traceTicks ticks, up to maxTraceEvents events per tick.
+  TickProfiler(size_t windowTicks = 600, size_t traceTicks = 10, size_t maxTraceEvents = 10000);
+
+  bool enabled() const;
+  // Enabling the profiler discards everything previously recorded.
+  void setEnabled(bool enabled);
+
+  // Returns the id of the section with the given name, adding it if it does
+  // not exist yet.
+  SectionId section(String const& name);
+
+  void beginTick();
+  void endTick();
+
+  // Records a section that ran from start to end, in Time::monotonicTime
+  // seconds.  The optional id, such as an entity id, is shown in the trace.
+  void record(SectionId section, double start, double end, Maybe<int64_t> id = {});
+
+  // The mean, median, 99th percentile and maximum time per tick, in
+  // milliseconds, of every section over the window, slowest first.  The
+  // whole tick is the section "tick".
+  Json summary() const;
+
+  // Chrome trace events for the recorded ticks, as the process with the given
+  // id and name, to be placed in the "traceEvents" list of a trace file.
+  JsonArray traceEvents(int64_t processId, String const& processName) const;
+
+private:
+  struct Section {
+    String name;
+    double tickTotal;
+    List<float> window;
+  };
+
+  struct TraceEvent {
+    SectionId section;
+    double start;
+    double end;
+    unsigned thread;
+    Maybe<int64_t> id;
+  };
+
+  void reset();
+
+  size_t m_windowTicks;
+  size_t m_traceTicks;
+  size_t m_maxTraceEvents;
+
+  atomic<bool> m_enabled;
+  double m_tickStart;
+
+  mutable Mutex m_mutex;
+  List<Section> m_sections;
+  StringMap<SectionId> m_sectionIds;
+  size_t m_windowPosition;
+  size_t m_windowFilled;
+  List<TraceEvent> m_tickTrace;
+  Deque<List<TraceEvent>> m_trace;
+};
+
+}
+
+#endif
@@ -1,9 +1,58 @@
 #include "StarWorkerPool.hpp"
 #include "StarIterator.hpp"
 #include "StarMathCommon.hpp"
+#include "StarArray.hpp"
 
 namespace Star {
 
+size_t const WorkerPoolPriorityCount = 3;
+
+WorkerPoolJob::WorkerPoolJob() : m_operations(nullptr) {}
+
+WorkerPoolJob::~WorkerPoolJob() {
+  reset();
+}
+
+WorkerPoolJob::WorkerPoolJob(WorkerPoolJob&& job) : m_operations(job.m_operations) {
+  if (m_operations) {
+    m_operations->move(m_storage, job.m_storage);
+    job.m_operations = nullptr;
+  }
+}
+
+WorkerPoolJob& WorkerPoolJob::operator=(WorkerPoolJob&& job) {
+  if (&job != this) {
+    reset();
+    m_operations = job.m_operations;
+    if (m_operations) {
+      m_operations->move(m_storage, job.m_storage);
+      job.m_operations = nullptr;
+    }
+  }
+  return *this;
+}
+
+WorkerPoolJob::operator bool() const {
+  return m_operations != nullptr;
+}
+
+bool WorkerPoolJob::heapAllocated() const {
+  return m_operations && m_operations->heapAllocated;
+}
+
+void WorkerPoolJob::operator()() {
+  if (!m_operations)
+    throw WorkerPoolException("Called empty WorkerPoolJob");
+  m_operations->invoke(m_storage);
+}
+
+void WorkerPoolJob::reset() {
+  if (m_operations) {
+    m_operations->destroy(m_storage);
+    m_operations = nullptr;
+  }
+}
+
 bool WorkerPoolHandle::done() const {
   MutexLocker locker(m_impl->mutex);
   return m_impl->done;
@@ -28,7 +77,7 @@ bool WorkerPoolHandle::poll() const {
 void WorkerPoolHandle::finish() const {
   MutexLocker locker(m_impl->mutex);
 
-  if (!m_impl->done)
+  while (!m_impl->done)
     m_impl->condition.wait(m_impl->mutex);
 
   if (m_impl->exception)
@@ -37,130 +86,317 @@ void WorkerPoolHandle::finish() const {
   return;
 }
 
-WorkerPoolHandle::Impl::Impl() : done(false) {}
+WorkerPoolHandle::Impl::Impl(weak_ptr<WorkerPoolScheduler> scheduler, WorkerPoolPriority priority)
+  : scheduler(std::move(scheduler)), priority(priority), done(false) {}
 
 WorkerPoolHandle::WorkerPoolHandle(shared_ptr<Impl> impl) : m_impl(std::move(impl)) {}
 
-WorkerPool::WorkerPool(String name) : m_name(std::move(name)) {}
+// Pending work of every priority, guarded by a spin lock since it is only
+// ever held long enough to push or pop a single job.
+struct WorkerPool::WorkQueue {
+  WorkQueue();
+
+  void push(WorkerPoolJob job, WorkerPoolPriority priority);
+  // Takes the oldest job of the given priority, or the newest if newest is
+  // true.
+  bool take(WorkerPoolJob& job, WorkerPoolPriority priority, bool newest);
+  // Moves all pending jobs to the given queue.
+  void drainInto(WorkQueue& queue);
+
+  SpinLock spinLock;
+  Array<Deque<WorkerPoolJob>, WorkerPoolPriorityCount> jobs;
+  // Number of jobs of each priority, so that empty queues can be skipped
+  // without taking the lock.
+  Array<atomic<size_t>, WorkerPoolPriorityCount> counts;
+};
+
+class WorkerPool::WorkerThread : public Thread {
+public:
+  // Does not start automatically, so that all threads of a pool exist before
+  // any of them try to steal work from the others.
+  WorkerThread(WorkerPoolScheduler* scheduler, size_t index);
+  ~WorkerThread();
+
+  void run() override;
+
+  static thread_local WorkerThread* current;
+
+  WorkerPoolScheduler* scheduler;
+  size_t index;
+  atomic<bool> shouldStop;
+  WorkQueue queue;
+};
+
+struct WorkerPoolScheduler {
+  typedef WorkerPool::WorkQueue WorkQueue;
+  typedef WorkerPool::WorkerThread WorkerThread;
+
+  WorkerPoolScheduler(String name);
+
+  // Takes the highest priority job available, looking first in the queue of
+  // the given thread (if any), then in the shared queue, then in the queues of
+  // the other threads.
+  bool takeWork(WorkerThread* thread, WorkerPoolJob& job);
+
+  // Wakes up a waiting thread if there are any.  Must be called after the
+  // pending count is increased.
+  void wake(size_t count);
+
+  void stopThreads();
+
+  String name;
+
+  // Held while threads are started or stopped, the list of threads does not
+  // change while any of them are running.
+  Mutex threadMutex;
+  List<unique_ptr<WorkerThread>> workerThreads;
+
+  WorkQueue sharedQueue;
+
+  // Number of jobs that are queued but not yet taken.  Increased before a job
+  // is pushed, so it may briefly count a job that is not yet visible.
+  atomic<size_t> pendingCount;
+
+  Mutex sleepMutex;
+  ConditionVariable sleepCondition;
+  atomic<size_t> sleepingCount;
+};
+
+thread_local WorkerPool::WorkerThread* WorkerPool::WorkerThread::current = nullptr;
+
+WorkerPool::WorkQueue::WorkQueue() {
+  for (auto& count : counts)
+    count = 0;
+}
+
+void WorkerPool::WorkQueue::push(WorkerPoolJob job, WorkerPoolPriority priority) {
+  SpinLocker locker(spinLock);
+  jobs[(size_t)priority].append(std::move(job));
+  ++counts[(size_t)priority];
+}
+
+bool WorkerPool::WorkQueue::take(WorkerPoolJob& job, WorkerPoolPriority priority, bool newest) {
+  if (counts[(size_t)priority].load(std::memory_order_relaxed) == 0)
+    return false;
+
+  SpinLocker locker(spinLock);
+  auto& queue = jobs[(size_t)priority];
+  if (queue.empty())
+    return false;
+
+  job = newest ? queue.takeLast() : queue.takeFirst();
+  --counts[(size_t)priority];
+  return true;
+}
+
+void WorkerPool::WorkQueue::drainInto(WorkQueue& queue) {
+  SpinLocker locker(spinLock);
+  for (size_t i = 0; i < WorkerPoolPriorityCount; ++i) {
+    while (!jobs[i].empty())
+      queue.push(jobs[i].takeFirst(), (WorkerPoolPriority)i);
+    counts[i] = 0;
+  }
+}
+
+WorkerPool::WorkerThread::WorkerThread(WorkerPoolScheduler* scheduler, size_t index)
+  : Thread(strf("WorkerThread for WorkerPool '{}'", scheduler->name)),
+    scheduler(scheduler),
+    index(index),
+    shouldStop(false) {}
+
+WorkerPool::WorkerThread::~WorkerThread() {
+  join();
+}
+
+void WorkerPool::WorkerThread::run() {
+  current = this;
+
+  WorkerPoolJob job;
+  while (!shouldStop) {
+    if (scheduler->takeWork(this, job)) {
+      job();
+      job.reset();
+      continue;
+    }
+
+    MutexLocker sleepLocker(scheduler->sleepMutex);
+    ++scheduler->sleepingCount;
+    if (!shouldStop && scheduler->pendingCount == 0)
+      scheduler->sleepCondition.wait(scheduler->sleepMutex);
+    --scheduler->sleepingCount;
+  }
+
+  current = nullptr;
+}
+
+WorkerPoolScheduler::WorkerPoolScheduler(String name)
+  : name(std::move(name)), pendingCount(0), sleepingCount(0) {}
+
+bool WorkerPoolScheduler::takeWork(WorkerThread* thread, WorkerPoolJob& job) {
+  if (pendingCount == 0)
+    return false;
+
+  for (size_t p = WorkerPoolPriorityCount; p-- > 0;) {
+    auto priority = (WorkerPoolPriority)p;
+
+    // A thread takes its own newest work first, since that is most likely to
+    // still be in cache, and steals the oldest work of other threads.
+    bool found = (thread && thread->queue.take(job, priority, true)) || sharedQueue.take(job, priority, false);
+    if (!found) {
+      size_t start = thread ? thread->index + 1 : 0;
+      for (size_t i = 0; i < workerThreads.size() && !found; ++i) {
+        auto& victim = workerThreads[(start + i) % workerThreads.size()];
+        if (victim.get() != thread)
+          found = victim->queue.take(job, priority, false);
+      }
+    }
+
+    if (found) {
+      --pendingCount;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void WorkerPoolScheduler::wake(size_t count) {
+  if (sleepingCount == 0)
+    return;
+
+  // Must hold the sleep lock while signaling to ensure that any worker
+  // threads that are about to wait actually get the signal.
+  MutexLocker sleepLocker(sleepMutex);
+  if (count == 1)
+    sleepCondition.signal();
+  else
+    sleepCondition.broadcast();
+}
+
+void WorkerPoolScheduler::stopThreads() {
+  for (auto const& workerThread : workerThreads)
+    workerThread->shouldStop = true;
+
+  {
+    MutexLocker sleepLocker(sleepMutex);
+    sleepCondition.broadcast();
+  }
+
+  // Any work left in the queues of the stopped threads is moved to the shared
+  // queue, so that it is picked up when the pool is started again.
+  for (auto const& workerThread : workerThreads) {
+    workerThread->join();
+    workerThread->queue.drainInto(sharedQueue);
+  }
+
+  workerThreads.clear();
+}
+
+WorkerPool::WorkerPool(String name) : m_scheduler(make_shared<WorkerPoolScheduler>(std::move(name))) {}
 
 WorkerPool::WorkerPool(String name, unsigned threadCount) : WorkerPool(std::move(name)) {
   start(threadCount);
 }
 
 WorkerPool::~WorkerPool() {
-  stop();
+  if (m_scheduler)
+    stop();
 }
 
 WorkerPool::WorkerPool(WorkerPool&&) = default;
 WorkerPool& WorkerPool::operator=(WorkerPool&&) = default;
 
 void WorkerPool::start(unsigned threadCount) {
-  MutexLocker threadLock(m_threadMutex);
-
-  for (auto const& workerThread : m_workerThreads)
-    workerThread->shouldStop = true;
+  MutexLocker threadLock(m_scheduler->threadMutex);
 
-  m_workCondition.broadcast();
-  m_workerThreads.clear();
+  m_scheduler->stopThreads();
 
-  for (size_t i = m_workerThreads.size(); i < threadCount; ++i)
-    m_workerThreads.append(make_unique<WorkerThread>(this));
+  for (size_t i = 0; i < threadCount; ++i)
+    m_scheduler->workerThreads.append(make_unique<WorkerThread>(m_scheduler.get(), i));
+  for (auto const& workerThread : m_scheduler->workerThreads)
+    workerThread->start();
 }
 
 void WorkerPool::stop() {
-  MutexLocker threadLock(m_threadMutex);
-  for (auto const& workerThread : m_workerThreads)
-    workerThread->shouldStop = true;
+  MutexLocker threadLock(m_scheduler->threadMutex);
+  m_scheduler->stopThreads();
+}
 
+void WorkerPool::finish() {
+  // The calling thread joins in on the action and tries to finish work while
+  // yielding to the other threads after each completed job, then stops the
+  // pool once nothing is pending.  Jobs still running on worker threads are
+  // finished by stopping them.
   {
-    // Must hold the work lock while broadcasting to ensure that any worker
-    // threads that might wait without stopping actually get the signal.
-    MutexLocker workLock(m_workMutex);
-    m_workCondition.broadcast();
+    MutexLocker threadLock(m_scheduler->threadMutex);
+    WorkerPoolJob job;
+    while (m_scheduler->pendingCount != 0) {
+      if (m_scheduler->takeWork(nullptr, job)) {
+        job();
+        job.reset();
+      }
+      Thread::yield();
+    }
   }
 
-  m_workerThreads.clear();
+  stop();
 }
 
-void WorkerPool::finish() {
-  // This is kind of a weird way to "wait" until all the pending work is
-  // finished.  In order for the currently active worker threads to
-  // cooperatively complete the remaining work, the work lock must not be held
-  // the entire time (then just this thread would be the one finishing the
-  // work).  Instead, the calling thread joins in on the action and tries to
-  // finish work while yielding to the other threads after each completed job.
-  MutexLocker workMutex(m_workMutex);
-  while (!m_pendingWork.empty()) {
-    auto firstWork = m_pendingWork.takeFirst();
-    workMutex.unlock();
-    firstWork();
-    Thread::yield();
-    workMutex.lock();
+void WorkerPool::queueWork(weak_ptr<WorkerPoolScheduler> const& scheduler, WorkerPoolJob work, WorkerPoolPriority priority) {
+  if (auto lockedScheduler = scheduler.lock()) {
+    queueWork(*lockedScheduler, std::move(work), priority);
+  } else {
+    List<WorkerPoolJob> abandoned;
+    abandoned.append(std::move(work));
+    abandonWork(std::move(abandoned));
   }
-  workMutex.unlock();
+}
 
-  stop();
+void WorkerPool::queueWork(weak_ptr<WorkerPoolScheduler> const& scheduler, List<WorkerPoolJob> work, WorkerPoolPriority priority) {
+  if (auto lockedScheduler = scheduler.lock())
+    queueWork(*lockedScheduler, std::move(work), priority);
+  else
+    abandonWork(std::move(work));
 }
 
-WorkerPoolHandle WorkerPool::addWork(function<void()> work) {
-  // Construct a worker pool handle and wrap the work to signal the handle when
-  // finished.  Set the result to empty string if successful and to the content
-  // of the exception if an exception is thrown.
-  auto workerPoolHandleImpl = make_shared<WorkerPoolHandle::Impl>();
-  queueWork([workerPoolHandleImpl, work]() {
-    try {
-      work();
-      MutexLocker handleLocker(workerPoolHandleImpl->mutex);
-      workerPoolHandleImpl->done = true;
-      workerPoolHandleImpl->condition.broadcast();
-    } catch (...) {
-      MutexLocker handleLocker(workerPoolHandleImpl->mutex);
-      workerPoolHandleImpl->done = true;
-      workerPoolHandleImpl->exception = std::current_exception();
-      workerPoolHandleImpl->condition.broadcast();
-    }
-  });
+static thread_local bool s_abandoningWork = false;
 
-  return workerPoolHandleImpl;
+void WorkerPool::abandonWork(List<WorkerPoolJob> work) {
+  // Abandoned continuations finish their own continuations, which are
+  // abandoned in turn.
+  bool wasAbandoning = s_abandoningWork;
+  s_abandoningWork = true;
+  auto guard = finally([wasAbandoning]() { s_abandoningWork = wasAbandoning; });
+  for (auto& job : work)
+    job();
 }
 
-WorkerPool::WorkerThread::WorkerThread(WorkerPool* parent)
-  : Thread(strf("WorkerThread for WorkerPool '{}'", parent->m_name)),
-    parent(parent),
-    shouldStop(false),
-    waiting(false) {
-  start();
+bool WorkerPool::abandoningWork() {
+  return s_abandoningWork;
 }
 
-WorkerPool::WorkerThread::~WorkerThread() {
-  join();
-}
+void WorkerPool::queueWork(WorkerPoolScheduler& scheduler, WorkerPoolJob work, WorkerPoolPriority priority) {
+  ++scheduler.pendingCount;
 
-void WorkerPool::WorkerThread::run() {
-  MutexLocker workLock(parent->m_workMutex);
-  while (true) {
-    if (shouldStop)
-      break;
-
-    if (parent->m_pendingWork.empty()) {
-      waiting = true;
-      parent->m_workCondition.wait(parent->m_workMutex);
-      waiting = false;
-    }
+  auto currentThread = WorkerThread::current;
+  if (currentThread && currentThread->scheduler == &scheduler)
+    currentThread->queue.push(std::move(work), priority);
+  else
+    scheduler.sharedQueue.push(std::move(work), priority);
 
-    if (!parent->m_pendingWork.empty()) {
-      auto work = parent->m_pendingWork.takeFirst();
-      workLock.unlock();
-      work();
-      workLock.lock();
-    }
-  }
+  scheduler.wake(1);
 }
 
-void WorkerPool::queueWork(function<void()> work) {
-  MutexLocker workLock(m_workMutex);
-  m_pendingWork.append(std::move(work));
-  m_workCondition.signal();
+void WorkerPool::queueWork(WorkerPoolScheduler& scheduler, List<WorkerPoolJob> work, WorkerPoolPriority priority) {
+  size_t count = work.size();
+  scheduler.pendingCount += count;
+
+  auto currentThread = WorkerThread::current;
+  auto& queue = currentThread && currentThread->scheduler == &scheduler ? currentThread->queue : scheduler.sharedQueue;
+  for (auto& job : work)
+    queue.push(std::move(job), priority);
+
+  scheduler.wake(count);
 }
 
 }
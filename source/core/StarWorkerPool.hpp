@@ -9,6 +9,79 @@ STAR_EXCEPTION(WorkerPoolException, StarException);
 
 STAR_CLASS(WorkerPool);
 
+// Shared state of a WorkerPool, which handles refer to so that they stay
+// valid while the pool is moved.
+struct WorkerPoolScheduler;
+
+// Pending work of a higher priority is always started before pending work of
+// a lower priority.  Work of the same priority is not strictly ordered.
+enum class WorkerPoolPriority : uint8_t {
+  Low = 0,
+  Normal = 1,
+  High = 2
+};
+
+// Move-only type erased callable used to store queued work.  Callables that
+// fit within InlineSize bytes and can be moved without throwing are stored
+// inline, so queueing them does not allocate.
+class WorkerPoolJob {
+public:
+  static size_t const InlineSize = 64;
+
+  WorkerPoolJob();
+  template <typename Function, typename = std::enable_if_t<!std::is_same<std::decay_t<Function>, WorkerPoolJob>::value>>
+  WorkerPoolJob(Function&& function);
+  ~WorkerPoolJob();
+
+  WorkerPoolJob(WorkerPoolJob&& job);
+  WorkerPoolJob& operator=(WorkerPoolJob&& job);
+
+  explicit operator bool() const;
+
+  // True if the callable did not fit inline and was allocated on the heap.
+  bool heapAllocated() const;
+
+  void operator()();
+
+  void reset();
+
+private:
+  struct Operations {
+    void (*invoke)(void* storage);
+    void (*move)(void* destination, void* source);
+    void (*destroy)(void* storage);
+    bool heapAllocated;
+  };
+
+  template <typename Function>
+  struct InlineOperations {
+    static void invoke(void* storage);
+    static void move(void* destination, void* source);
+    static void destroy(void* storage);
+    static Operations const operations;
+  };
+
+  template <typename Function>
+  struct HeapOperations {
+    static void invoke(void* storage);
+    static void move(void* destination, void* source);
+    static void destroy(void* storage);
+    static Operations const operations;
+  };
+
+  Operations const* m_operations;
+  alignas(std::max_align_t) unsigned char m_storage[InlineSize];
+};
+
+class WorkerPoolHandle;
+template <typename ResultType>
+class WorkerPoolPromise;
+
+// The type of a continuation of a WorkerPool computation that produces the
+// given type, WorkerPoolHandle if it produces nothing.
+template <typename ResultType>
+using WorkerPoolContinuation = std::conditional_t<std::is_void<ResultType>::value, WorkerPoolHandle, WorkerPoolPromise<ResultType>>;
+
 // Shareable handle for a WorkerPool computation that does not produce any
 // value.
 class WorkerPoolHandle {
@@ -30,16 +103,29 @@ public:
   // an exception it will be re-thrown by this method.
   void finish() const;
 
+  // Queues the given function on the same pool and with the same priority
+  // once this computation finishes.  If this computation throws, the
+  // continuation is not called and the exception is forwarded to the returned
+  // handle or promise instead.  If the pool has been destroyed by the time
+  // this computation finishes, the continuation is not called and the
+  // returned handle or promise throws a WorkerPoolException instead.
+  template <typename Function>
+  auto then(Function continuation) const -> WorkerPoolContinuation<decltype(continuation())>;
+
 private:
   friend WorkerPool;
 
   struct Impl {
-    Impl();
+    Impl(weak_ptr<WorkerPoolScheduler> scheduler, WorkerPoolPriority priority);
+
+    weak_ptr<WorkerPoolScheduler> scheduler;
+    WorkerPoolPriority priority;
 
     Mutex mutex;
     ConditionVariable condition;
     atomic<bool> done;
     std::exception_ptr exception;
+    List<WorkerPoolJob> continuations;
   };
 
   WorkerPoolHandle(shared_ptr<Impl> impl);
@@ -70,14 +156,30 @@ public:
   ResultType& get();
   ResultType const& get() const;
 
+  // Queues the given function on the same pool and with the same priority
+  // once the result is produced, passing it a reference to the result.  If
+  // the producer throws, the continuation is not called and the exception is
+  // forwarded to the returned handle or promise instead.  If the pool has been
+  // destroyed by the time the result is produced, the continuation is not
+  // called and the returned handle or promise throws a WorkerPoolException
+  // instead.
+  template <typename Function>
+  auto then(Function continuation) const -> WorkerPoolContinuation<decltype(continuation(std::declval<ResultType&>()))>;
+
 private:
   friend WorkerPool;
 
   struct Impl {
+    Impl(weak_ptr<WorkerPoolScheduler> scheduler, WorkerPoolPriority priority);
+
+    weak_ptr<WorkerPoolScheduler> scheduler;
+    WorkerPoolPriority priority;
+
     Mutex mutex;
     ConditionVariable condition;
     Maybe<ResultType> result;
     std::exception_ptr exception;
+    List<WorkerPoolJob> continuations;
   };
 
   WorkerPoolPromise(shared_ptr<Impl> impl);
@@ -85,6 +187,9 @@ private:
   shared_ptr<Impl> m_impl;
 };
 
+// Thread pool with a work queue per thread.  Work added from within a worker
+// thread goes to the queue of that thread, other work goes to a shared queue,
+// and idle threads steal work from the queues of other threads.
 class WorkerPool {
 public:
   // Creates a stopped pool
@@ -114,38 +219,134 @@ public:
   // required that the caller of this method hold on to the worker handle, the
   // work will be managed and completed regardless of the WorkerPoolHandle
   // lifetime.
-  WorkerPoolHandle addWork(function<void()> work);
+  template <typename Function>
+  WorkerPoolHandle addWork(Function&& work, WorkerPoolPriority priority = WorkerPoolPriority::Normal);
 
   // Like addWork, but the worker is expected to produce some result.  The
   // returned promise can be used to get this return value once the producer is
   // complete.
-  template <typename ResultType>
-  WorkerPoolPromise<ResultType> addProducer(function<ResultType()> producer);
+  template <typename ResultType, typename Function>
+  WorkerPoolPromise<ResultType> addProducer(Function&& producer, WorkerPoolPriority priority = WorkerPoolPriority::Normal);
 
 private:
-  class WorkerThread : public Thread {
-  public:
-    // Starts automatically
-    WorkerThread(WorkerPool* parent);
-    ~WorkerThread();
+  friend WorkerPoolHandle;
+  template <typename ResultType>
+  friend class WorkerPoolPromise;
+  friend WorkerPoolScheduler;
+
+  struct WorkQueue;
+  class WorkerThread;
+
+  // Wraps the given work so that it signals the returned handle, without
+  // queueing it.
+  template <typename Function>
+  static pair<WorkerPoolHandle, WorkerPoolJob> makeWork(weak_ptr<WorkerPoolScheduler> scheduler, WorkerPoolPriority priority, Function work);
+  template <typename ResultType, typename Function>
+  static pair<WorkerPoolPromise<ResultType>, WorkerPoolJob> makeProducer(weak_ptr<WorkerPoolScheduler> scheduler, WorkerPoolPriority priority, Function producer);
+
+  // Queues work on the pool with the given scheduler, or abandons it if that
+  // pool no longer exists.
+  static void queueWork(weak_ptr<WorkerPoolScheduler> const& scheduler, WorkerPoolJob work, WorkerPoolPriority priority);
+  static void queueWork(weak_ptr<WorkerPoolScheduler> const& scheduler, List<WorkerPoolJob> work, WorkerPoolPriority priority);
+
+  // Runs continuations on the calling thread with abandoningWork() set, which
+  // makes them throw instead of calling the continuation, so that their
+  // handles and promises still finish.
+  static void abandonWork(List<WorkerPoolJob> work);
+  static bool abandoningWork();
+
+  static void queueWork(WorkerPoolScheduler& scheduler, WorkerPoolJob work, WorkerPoolPriority priority);
+  static void queueWork(WorkerPoolScheduler& scheduler, List<WorkerPoolJob> work, WorkerPoolPriority priority);
+
+  shared_ptr<WorkerPoolScheduler> m_scheduler;
+};
+
+template <typename Function, typename>
+WorkerPoolJob::WorkerPoolJob(Function&& function) {
+  typedef std::decay_t<Function> FunctionType;
+  if constexpr (sizeof(FunctionType) <= InlineSize && alignof(FunctionType) <= alignof(std::max_align_t)
+      && std::is_nothrow_move_constructible<FunctionType>::value) {
+    new (m_storage) FunctionType(std::forward<Function>(function));
+    m_operations = &InlineOperations<FunctionType>::operations;
+  } else {
+    *reinterpret_cast<FunctionType**>(m_storage) = new FunctionType(std::forward<Function>(function));
+    m_operations = &HeapOperations<FunctionType>::operations;
+  }
+}
+
+template <typename Function>
+void WorkerPoolJob::InlineOperations<Function>::invoke(void* storage) {
+  (*static_cast<Function*>(storage))();
+}
+
+template <typename Function>
+void WorkerPoolJob::InlineOperations<Function>::move(void* destination, void* source) {
+  new (destination) Function(std::move(*static_cast<Function*>(source)));
+  static_cast<Function*>(source)->~Function();
+}
+
+template <typename Function>
+void WorkerPoolJob::InlineOperations<Function>::destroy(void* storage) {
+  static_cast<Function*>(storage)->~Function();
+}
 
-    void run() override;
+template <typename Function>
+WorkerPoolJob::Operations const WorkerPoolJob::InlineOperations<Function>::operations = {
+  &InlineOperations::invoke, &InlineOperations::move, &InlineOperations::destroy, false};
+
+template <typename Function>
+void WorkerPoolJob::HeapOperations<Function>::invoke(void* storage) {
+  (**static_cast<Function**>(storage))();
+}
+
+template <typename Function>
+void WorkerPoolJob::HeapOperations<Function>::move(void* destination, void* source) {
+  *static_cast<Function**>(destination) = *static_cast<Function**>(source);
+}
+
+template <typename Function>
+void WorkerPoolJob::HeapOperations<Function>::destroy(void* storage) {
+  delete *static_cast<Function**>(storage);
+}
 
-    WorkerPool* parent;
-    atomic<bool> shouldStop;
-    atomic<bool> waiting;
+template <typename Function>
+WorkerPoolJob::Operations const WorkerPoolJob::HeapOperations<Function>::operations = {
+  &HeapOperations::invoke, &HeapOperations::move, &HeapOperations::destroy, true};
+
+template <typename Function>
+auto WorkerPoolHandle::then(Function continuation) const -> WorkerPoolContinuation<decltype(continuation())> {
+  typedef decltype(continuation()) ContinuationResult;
+
+  auto antecedent = m_impl;
+  auto wrapped = [antecedent, continuation = std::move(continuation)]() mutable -> ContinuationResult {
+    if (antecedent->exception)
+      std::rethrow_exception(antecedent->exception);
+    if (WorkerPool::abandoningWork())
+      throw WorkerPoolException("WorkerPool was destroyed before the continuation could be queued");
+    return continuation();
   };
 
-  void queueWork(function<void()> work);
+  auto pending = [&]() {
+    if constexpr (std::is_void<ContinuationResult>::value)
+      return WorkerPool::makeWork(m_impl->scheduler, m_impl->priority, std::move(wrapped));
+    else
+      return WorkerPool::makeProducer<ContinuationResult>(m_impl->scheduler, m_impl->priority, std::move(wrapped));
+  }();
 
-  String m_name;
-  Mutex m_threadMutex;
-  List<unique_ptr<WorkerThread>> m_workerThreads;
+  MutexLocker locker(m_impl->mutex);
+  if (m_impl->done) {
+    locker.unlock();
+    WorkerPool::queueWork(m_impl->scheduler, std::move(pending.second), m_impl->priority);
+  } else {
+    m_impl->continuations.append(std::move(pending.second));
+  }
+
+  return std::move(pending.first);
+}
 
-  Mutex m_workMutex;
-  ConditionVariable m_workCondition;
-  Deque<function<void()>> m_pendingWork;
-};
+template <typename ResultType>
+WorkerPoolPromise<ResultType>::Impl::Impl(weak_ptr<WorkerPoolScheduler> scheduler, WorkerPoolPriority priority)
+  : scheduler(std::move(scheduler)), priority(priority) {}
 
 template <typename ResultType>
 bool WorkerPoolPromise<ResultType>::done() const {
@@ -178,7 +379,7 @@ template <typename ResultType>
 ResultType& WorkerPoolPromise<ResultType>::get() {
   MutexLocker locker(m_impl->mutex);
 
-  if (!m_impl->result && !m_impl->exception)
+  while (!m_impl->result && !m_impl->exception)
     m_impl->condition.wait(m_impl->mutex);
 
   if (m_impl->exception)
@@ -192,29 +393,109 @@ ResultType const& WorkerPoolPromise<ResultType>::get() const {
   return const_cast<WorkerPoolPromise*>(this)->get();
 }
 
+template <typename ResultType>
+template <typename Function>
+auto WorkerPoolPromise<ResultType>::then(Function continuation) const
+    -> WorkerPoolContinuation<decltype(continuation(std::declval<ResultType&>()))> {
+  typedef decltype(continuation(std::declval<ResultType&>())) ContinuationResult;
+
+  auto antecedent = m_impl;
+  auto wrapped = [antecedent, continuation = std::move(continuation)]() mutable -> ContinuationResult {
+    if (antecedent->exception)
+      std::rethrow_exception(antecedent->exception);
+    if (WorkerPool::abandoningWork())
+      throw WorkerPoolException("WorkerPool was destroyed before the continuation could be queued");
+    return continuation(*antecedent->result);
+  };
+
+  auto pending = [&]() {
+    if constexpr (std::is_void<ContinuationResult>::value)
+      return WorkerPool::makeWork(m_impl->scheduler, m_impl->priority, std::move(wrapped));
+    else
+      return WorkerPool::template makeProducer<ContinuationResult>(m_impl->scheduler, m_impl->priority, std::move(wrapped));
+  }();
+
+  MutexLocker locker(m_impl->mutex);
+  if (m_impl->result || m_impl->exception) {
+    locker.unlock();
+    WorkerPool::queueWork(m_impl->scheduler, std::move(pending.second), m_impl->priority);
+  } else {
+    m_impl->continuations.append(std::move(pending.second));
+  }
+
+  return std::move(pending.first);
+}
+
 template <typename ResultType>
 WorkerPoolPromise<ResultType>::WorkerPoolPromise(shared_ptr<Impl> impl)
   : m_impl(std::move(impl)) {}
 
-template <typename ResultType>
-WorkerPoolPromise<ResultType> WorkerPool::addProducer(function<ResultType()> producer) {
+template <typename Function>
+WorkerPoolHandle WorkerPool::addWork(Function&& work, WorkerPoolPriority priority) {
+  auto pending = makeWork(m_scheduler, priority, std::forward<Function>(work));
+  queueWork(*m_scheduler, std::move(pending.second), priority);
+  return std::move(pending.first);
+}
+
+template <typename ResultType, typename Function>
+WorkerPoolPromise<ResultType> WorkerPool::addProducer(Function&& producer, WorkerPoolPriority priority) {
+  auto pending = makeProducer<ResultType>(m_scheduler, priority, std::forward<Function>(producer));
+  queueWork(*m_scheduler, std::move(pending.second), priority);
+  return std::move(pending.first);
+}
+
+template <typename Function>
+pair<WorkerPoolHandle, WorkerPoolJob> WorkerPool::makeWork(weak_ptr<WorkerPoolScheduler> scheduler, WorkerPoolPriority priority, Function work) {
+  // Construct a worker pool handle and wrap the work to signal the handle when
+  // finished, then queue any continuations that were added in the meantime.
+  auto workerPoolHandleImpl = make_shared<WorkerPoolHandle::Impl>(std::move(scheduler), priority);
+  WorkerPoolJob job([workerPoolHandleImpl, work = std::move(work)]() mutable {
+    std::exception_ptr exception;
+    try {
+      work();
+    } catch (...) {
+      exception = std::current_exception();
+    }
+
+    MutexLocker handleLocker(workerPoolHandleImpl->mutex);
+    workerPoolHandleImpl->done = true;
+    workerPoolHandleImpl->exception = std::move(exception);
+    workerPoolHandleImpl->condition.broadcast();
+    auto continuations = std::move(workerPoolHandleImpl->continuations);
+    handleLocker.unlock();
+
+    if (!continuations.empty())
+      queueWork(workerPoolHandleImpl->scheduler, std::move(continuations), workerPoolHandleImpl->priority);
+  });
+
+  return {WorkerPoolHandle(std::move(workerPoolHandleImpl)), std::move(job)};
+}
+
+template <typename ResultType, typename Function>
+pair<WorkerPoolPromise<ResultType>, WorkerPoolJob> WorkerPool::makeProducer(weak_ptr<WorkerPoolScheduler> scheduler, WorkerPoolPriority priority, Function producer) {
   // Construct a worker pool promise and wrap the producer to signal the
-  // promise when finished.
-  auto workerPoolPromiseImpl = make_shared<typename WorkerPoolPromise<ResultType>::Impl>();
-  queueWork([workerPoolPromiseImpl, producer]() {
+  // promise when finished, then queue any continuations that were added in
+  // the meantime.
+  auto workerPoolPromiseImpl = make_shared<typename WorkerPoolPromise<ResultType>::Impl>(std::move(scheduler), priority);
+  WorkerPoolJob job([workerPoolPromiseImpl, producer = std::move(producer)]() mutable {
+    MutexLocker promiseLocker(workerPoolPromiseImpl->mutex, false);
     try {
       auto result = producer();
-      MutexLocker promiseLocker(workerPoolPromiseImpl->mutex);
+      promiseLocker.lock();
       workerPoolPromiseImpl->result = std::move(result);
-      workerPoolPromiseImpl->condition.broadcast();
     } catch (...) {
-      MutexLocker promiseLocker(workerPoolPromiseImpl->mutex);
+      promiseLocker.lock();
       workerPoolPromiseImpl->exception = std::current_exception();
-      workerPoolPromiseImpl->condition.broadcast();
     }
+    workerPoolPromiseImpl->condition.broadcast();
+    auto continuations = std::move(workerPoolPromiseImpl->continuations);
+    promiseLocker.unlock();
+
+    if (!continuations.empty())
+      queueWork(workerPoolPromiseImpl->scheduler, std::move(continuations), workerPoolPromiseImpl->priority);
   });
 
-  return workerPoolPromiseImpl;
+  return {WorkerPoolPromise<ResultType>(std::move(workerPoolPromiseImpl)), std::move(job)};
 }
 
 }
@@ -1457,7 +1457,7 @@ bool PathController::validateEdge(ActorMovementController& movementController, P
 
 bool PathController::movingCollision(ActorMovementController& movementController, PolyF const& collisionPoly) {
   bool collided = false;
-  movementController.forEachMovingCollision(collisionPoly.boundBox(), [&](MovingCollisionId id, PhysicsMovingCollision mc, PolyF poly, RectF bounds) {
+  movementController.forEachMovingCollision(collisionPoly.boundBox(), [&](MovingCollisionId, PhysicsMovingCollision const&, PolyF const& poly, RectF const&) {
       if (poly.intersects(collisionPoly)) {
         // set collided and stop iterating
         collided = true;
@@ -56,28 +56,36 @@ DataStream& operator>>(DataStream& ds, RemoteDamageNotification& damageNotificat
   return ds;
 }
 
-DamageManager::DamageManager(World* world, ConnectionId connectionId) : m_world(world), m_connectionId(connectionId) {}
+DamageManager::DamageManager(World* world, ConnectionId connectionId)
+  : m_world(world), m_connectionId(connectionId), m_hittableEntities(16.0f) {}
 
 void DamageManager::update(float dt) {
   float const DefaultDamageTimeout = 1.0f;
 
   auto damageIt = makeSMutableMapIterator(m_recentEntityDamages);
   while (damageIt.hasNext()) {
-    auto& events = damageIt.next().second;
-    auto eventIt = makeSMutableIterator(events);
-    while (eventIt.hasNext()) {
-      auto& event = eventIt.next();
-      event.timeout -= dt;
-      auto entityIdTimeoutGroup = event.timeoutGroup.maybe<EntityId>();
-      if (event.timeout <= 0.0f || (entityIdTimeoutGroup && !m_world->entity(*entityIdTimeoutGroup)))
-        eventIt.remove();
+    auto& damages = damageIt.next().second;
+    auto entityIt = makeSMutableMapIterator(damages.entityTimeouts);
+    while (entityIt.hasNext()) {
+      auto& pair = entityIt.next();
+      pair.second -= dt;
+      if (pair.second <= 0.0f || !m_world->entity(pair.first))
+        entityIt.remove();
     }
-    if (events.empty())
+    auto groupIt = makeSMutableMapIterator(damages.groupTimeouts);
+    while (groupIt.hasNext()) {
+      auto& pair = groupIt.next();
+      pair.second -= dt;
+      if (pair.second <= 0.0f)
+        groupIt.remove();
+    }
+    if (damages.entityTimeouts.empty() && damages.groupTimeouts.empty())
       damageIt.remove();
   }
 
-  m_world->forAllEntities([&](EntityPtr const& causingEntity) {
-    for (auto& damageSource : causingEntity->damageSources()) {
+  for (auto& pair : updateEntities()) {
+    auto const& causingEntity = pair.first;
+    for (auto& damageSource : pair.second) {
       if (damageSource.trackSourceEntity)
         damageSource.translate(causingEntity->position());
 
@@ -91,26 +99,17 @@ void DamageManager::update(float dt) {
         if (!isAuthoritative(causingEntity, targetEntity))
           continue;
 
-        auto& eventList = m_recentEntityDamages[hitResultPair.first];
         // Guard against rapidly repeating damages by either the causing
         // entity id, or optionally the repeat group if specified.
-        bool allowDamage = true;
-        for (auto const& event : eventList) {
-          if (damageSource.damageRepeatGroup) {
-            if (event.timeoutGroup == *damageSource.damageRepeatGroup)
-              allowDamage = false;
-          } else {
-            if (event.timeoutGroup == causingEntity->entityId())
-              allowDamage = false;
-          }
-        }
-        if (allowDamage) {
-          float timeout = damageSource.damageRepeatTimeout.value(DefaultDamageTimeout);
-          if (damageSource.damageRepeatGroup)
-            eventList.append({*damageSource.damageRepeatGroup, timeout});
-          else
-            eventList.append({causingEntity->entityId(), timeout});
+        auto& damages = m_recentEntityDamages[hitResultPair.first];
+        float timeout = damageSource.damageRepeatTimeout.value(DefaultDamageTimeout);
+        bool allowDamage;
+        if (damageSource.damageRepeatGroup)
+          allowDamage = damages.groupTimeouts.insert(*damageSource.damageRepeatGroup, timeout).second;
+        else
+          allowDamage = damages.entityTimeouts.insert(causingEntity->entityId(), timeout).second;
 
+        if (allowDamage) {
           auto damageRequest = DamageRequest(hitResultPair.second, damageSource.damageType, damageSource.damage,
               damageSource.knockbackMomentum(m_world->geometry(), targetEntity->position()),
               damageSource.sourceEntityId, damageSource.damageSourceKind, damageSource.statusEffects);
@@ -121,10 +120,7 @@ void DamageManager::update(float dt) {
         }
       }
     }
-
-    for (auto const& damageNotification : causingEntity->selfDamageNotifications())
-      addDamageNotification({causingEntity->entityId(), damageNotification});
-  });
+  }
 }
 
 void DamageManager::pushRemoteHitRequest(RemoteHitRequest const& remoteHitRequest) {
@@ -206,14 +202,57 @@ SmallList<pair<EntityId, HitType>, 4> DamageManager::queryHit(DamageSource const
     return;
   };
 
-  if (auto poly = source.damageArea.ptr<PolyF>())
-    m_world->forEachEntity(poly->boundBox(), doQueryHit);
-  else if (auto line = source.damageArea.ptr<Line2F>())
-    m_world->forEachEntityLine(line->min(), line->max(), doQueryHit);
+  auto const& geometry = m_world->geometry();
+  if (auto poly = source.damageArea.ptr<PolyF>()) {
+    m_hittableEntities.forEach(geometry.splitRect(poly->boundBox()), doQueryHit);
+  } else if (auto line = source.damageArea.ptr<Line2F>()) {
+    m_hittableEntities.forEach(geometry.splitRect(RectF::boundBoxOf(line->min(), line->max())), [&](EntityPtr const& targetEntity) {
+        if (geometry.lineIntersectsRect(*line, targetEntity->metaBoundBox().translated(targetEntity->position())))
+          doQueryHit(targetEntity);
+      });
+  }
 
   return resultList;
 }
 
+List<pair<EntityPtr, List<DamageSource>>> DamageManager::updateEntities() {
+  List<pair<EntityPtr, List<DamageSource>>> damagingEntities;
+  size_t hittableCount = 0;
+
+  auto const& geometry = m_world->geometry();
+  auto const& hittableEntries = m_hittableEntities.entries();
+  m_world->forAllEntities([&](EntityPtr const& entity) {
+      if (entity->canBeHit()) {
+        ++hittableCount;
+        auto rects = geometry.splitRect(entity->metaBoundBox(), entity->position());
+        auto entry = hittableEntries.find(entity->entityId());
+        if (entry == hittableEntries.end() || entry->second.value != entity)
+          m_hittableEntities.set(entity->entityId(), rects, entity);
+        else if (!containersEqual(rects, entry->second.rects))
+          m_hittableEntities.set(entity->entityId(), rects);
+      }
+
+      auto damageSources = entity->damageSources();
+      if (!damageSources.empty())
+        damagingEntities.append({entity, std::move(damageSources)});
+
+      for (auto const& damageNotification : entity->selfDamageNotifications())
+        addDamageNotification({entity->entityId(), damageNotification});
+    });
+
+  // Every entity still in the world was just set, so any other entries belong
+  // to entities that have since been removed.
+  if (m_hittableEntities.size() != hittableCount) {
+    for (auto entityId : m_hittableEntities.keys()) {
+      auto entity = m_world->entity(entityId);
+      if (!entity || entity != m_hittableEntities.get(entityId))
+        m_hittableEntities.remove(entityId);
+    }
+  }
+
+  return damagingEntities;
+}
+
 bool DamageManager::isAuthoritative(EntityPtr const& causingEntity, EntityPtr const& targetEntity) {
   // Damage manager is authoritative if either one of the entities is
   // masterOnly, OR the manager is server-side and both entities are
@@ -3,6 +3,7 @@
 
 #include "StarDamage.hpp"
 #include "StarDamageTypes.hpp"
+#include "StarSpatialHash2D.hpp"
 
 namespace Star {
 
@@ -42,6 +43,10 @@ DataStream& operator>>(DataStream& ds, RemoteDamageNotification& damageNotificat
 
 // Right now, handles entity -> entity damage and ensures that no repeat damage
 // is applied within the damage cutoff time from the same causing entity.
+//
+// Every update, the entities that can be hit are indexed by their bound boxes,
+// and only entities currently giving off damage sources query that index, so
+// the many projectiles of a busy fight never have to test each other.
 class DamageManager {
 public:
   DamageManager(World* world, ConnectionId connectionId);
@@ -66,11 +71,19 @@ public:
   List<DamageNotification> pullPendingNotifications();
 
 private:
-  struct EntityDamageEvent {
-    Variant<EntityId, String> timeoutGroup;
-    float timeout;
+  // Remaining damage timeouts of a target entity, by the causing entity for
+  // sources without a repeat group, or otherwise by the repeat group.
+  struct RecentDamages {
+    HashMap<EntityId, float> entityTimeouts;
+    StringMap<float> groupTimeouts;
   };
 
+  typedef SpatialHash2D<EntityId, float, EntityPtr> HittableEntityMap;
+
+  // Refreshes the index of hittable entities, and returns every entity with
+  // damage sources along with those sources.
+  List<pair<EntityPtr, List<DamageSource>>> updateEntities();
+
   // Searches for and queries for hit to any entity within range of the
   // damage source.  Skips over source.sourceEntityId, if set.
   SmallList<pair<EntityId, HitType>, 4> queryHit(DamageSource const& source, EntityId causingId) const;
@@ -86,7 +99,10 @@ private:
 
   // Maps target entity to all of the recent damage events that entity has
   // received, to prevent rapidly repeating damage.
-  HashMap<EntityId, List<EntityDamageEvent>> m_recentEntityDamages;
+  HashMap<EntityId, RecentDamages> m_recentEntityDamages;
+
+  // Every hittable entity as of the last update, by its world space bound box.
+  HittableEntityMap m_hittableEntities;
 
   List<RemoteHitRequest> m_pendingRemoteHitRequests;
   List<RemoteDamageRequest> m_pendingRemoteDamageRequests;
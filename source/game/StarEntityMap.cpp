@@ -8,6 +8,18 @@ namespace Star {
 float const EntityMapSpatialHashSectorSize = 16.0f;
 int const EntityMap::MaximumEntityBoundBox = 10000;
 
+// Island membership bookkeeping for a checked parallel update job, set on the
+// thread that is running the job.
+struct IslandCheck {
+  HashMap<EntityId, size_t> const* islandIndexes = nullptr;
+  size_t island = 0;
+  EntityId currentEntity = NullEntityId;
+  List<EntityMap::CrossIslandAccess> accesses;
+};
+
+static thread_local IslandCheck* s_islandCheck = nullptr;
+static thread_local bool s_inParallelUpdate = false;
+
 EntityMap::EntityMap(Vec2U const& worldSize, EntityId beginIdSpace, EntityId endIdSpace)
   : m_geometry(worldSize),
     m_spatialMap(EntityMapSpatialHashSectorSize),
@@ -90,39 +102,6 @@ List<EntityId> EntityMap::entityIds() const {
 }
 
 void EntityMap::updateAllEntities(EntityCallback const& callback, function<bool(EntityPtr const&, EntityPtr const&)> sortOrder) {
-  auto updateEntityInfo = [&](SpatialMap::Entry const& entry) {
-    auto const& entity = entry.value;
-
-    auto position = entity->position();
-    auto boundBox = entity->metaBoundBox();
-
-    if (boundBox.isNegative() || boundBox.width() > MaximumEntityBoundBox || boundBox.height() > MaximumEntityBoundBox) {
-      throw EntityMapException::format("Entity id: {} type: {} bound box is negative or beyond the maximum entity bound box size in EntityMap::addEntity",
-          entity->entityId(), (int)entity->entityType());
-    }
-
-    auto entityId = entity->entityId();
-    if (entityId == NullEntityId)
-      throw EntityMapException::format("Null entity id in EntityMap::setEntityInfo");
-
-    auto rects = m_geometry.splitRect(boundBox, position);
-    if (!containersEqual(rects, entry.rects))
-      m_spatialMap.set(entityId, rects);
-
-    auto uniqueId = entity->uniqueId();
-    if (uniqueId) {
-      if (auto existingEntityId = m_uniqueMap.maybeRight(*uniqueId)) {
-        if (entityId != *existingEntityId)
-          throw EntityMapException::format("Duplicate entity unique id on entity ids ({}) and ({})", *existingEntityId, entityId);
-      } else {
-        m_uniqueMap.removeRight(entityId);
-        m_uniqueMap.add(*uniqueId, entityId);
-      }
-    } else {
-      m_uniqueMap.removeRight(entityId);
-    }
-  };
-
   // Even if there is no sort order, we still copy pointers to a temporary
   // list, so that it is safe to call addEntity from the callback.
   m_entrySortBuffer.clear();
@@ -142,6 +121,104 @@ void EntityMap::updateAllEntities(EntityCallback const& callback, function<bool(
   }
 }
 
+List<EntityMap::CrossIslandAccess> EntityMap::updateAllEntities(EntityCallback const& callback,
+    function<bool(EntityPtr const&, EntityPtr const&)> sortOrder, ParallelUpdate const& parallelUpdate) {
+  m_entrySortBuffer.clear();
+  for (auto const& entry : m_spatialMap.entries())
+    m_entrySortBuffer.append(&entry.second);
+
+  if (sortOrder) {
+    m_entrySortBuffer.sort([&sortOrder](auto a, auto b) {
+        return sortOrder(a->value, b->value);
+      });
+  }
+
+  List<CrossIslandAccess> crossIslandAccesses;
+  List<SpatialMap::Entry const*> parallelRun;
+
+  auto updateParallelRun = [&]() {
+    if (parallelRun.empty())
+      return;
+
+    auto islands = entityIslands(parallelRun, parallelUpdate.islandPadding);
+
+    HashMap<EntityId, size_t> islandIndexes;
+    if (parallelUpdate.checkIslands) {
+      for (size_t i = 0; i < islands.size(); ++i) {
+        for (auto const& entity : islands[i])
+          islandIndexes[entity->entityId()] = i;
+      }
+    }
+
+    List<IslandCheck> islandChecks;
+    islandChecks.resize(parallelUpdate.checkIslands ? islands.size() : 0);
+
+    List<function<void()>> jobs;
+    jobs.reserve(islands.size());
+    for (size_t i = 0; i < islands.size(); ++i) {
+      IslandCheck* islandCheck = nullptr;
+      if (parallelUpdate.checkIslands) {
+        islandCheck = &islandChecks[i];
+        islandCheck->islandIndexes = &islandIndexes;
+        islandCheck->island = i;
+      }
+
+      jobs.append([&callback, island = &islands[i], islandCheck]() {
+          s_islandCheck = islandCheck;
+          s_inParallelUpdate = true;
+          try {
+            for (auto const& entity : *island) {
+              if (islandCheck)
+                islandCheck->currentEntity = entity->entityId();
+              if (callback)
+                callback(entity);
+            }
+          } catch (...) {
+            s_islandCheck = nullptr;
+            s_inParallelUpdate = false;
+            throw;
+          }
+          s_islandCheck = nullptr;
+          s_inParallelUpdate = false;
+        });
+    }
+
+    if (parallelUpdate.prepareRegions) {
+      List<RectF> regions;
+      for (auto entry : parallelRun)
+        regions.appendAll(m_geometry.splitRect(entry->value->metaBoundBox().padded(parallelUpdate.islandPadding), entry->value->position()));
+      parallelUpdate.prepareRegions(regions);
+    }
+
+    parallelUpdate.runJobs(jobs);
+
+    for (auto entry : parallelRun)
+      updateEntityInfo(*entry);
+    parallelRun.clear();
+
+    for (auto& islandCheck : islandChecks)
+      crossIslandAccesses.appendAll(std::move(islandCheck.accesses));
+  };
+
+  for (auto entry : m_entrySortBuffer) {
+    if (parallelUpdate.filter(entry->value)) {
+      parallelRun.append(entry);
+    } else {
+      updateParallelRun();
+      if (callback)
+        callback(entry->value);
+      updateEntityInfo(*entry);
+    }
+  }
+  updateParallelRun();
+
+  return crossIslandAccesses;
+}
+
+bool EntityMap::inParallelUpdate() {
+  return s_inParallelUpdate;
+}
+
 EntityId EntityMap::uniqueEntityId(String const& uniqueId) const {
   return m_uniqueMap.maybeRight(uniqueId).value(NullEntityId);
 }
@@ -149,6 +226,7 @@ EntityId EntityMap::uniqueEntityId(String const& uniqueId) const {
 EntityPtr EntityMap::entity(EntityId entityId) const {
   auto entity = m_spatialMap.value(entityId);
   starAssert(!entity || entity->entityId() == entityId);
+  checkIslandAccess(entity);
   return entity;
 }
 
@@ -184,11 +262,19 @@ List<TileEntityPtr> EntityMap::entitiesAtTile(Vec2I const& pos, EntityFilterOf<T
 }
 
 void EntityMap::forEachEntity(RectF const& boundBox, EntityCallback const& callback) const {
-  m_spatialMap.forEach(m_geometry.splitRect(boundBox), callback);
+  if (s_islandCheck) {
+    m_spatialMap.forEach(m_geometry.splitRect(boundBox), [&](EntityPtr const& entity) {
+        checkIslandAccess(entity);
+        callback(entity);
+      });
+  } else {
+    m_spatialMap.forEach(m_geometry.splitRect(boundBox), callback);
+  }
 }
 
 void EntityMap::forEachEntityLine(Vec2F const& begin, Vec2F const& end, EntityCallback const& callback) const {
   return m_spatialMap.forEach(m_geometry.splitRect(RectF::boundBoxOf(begin, end)), [&](EntityPtr const& entity) {
+      checkIslandAccess(entity);
       if (m_geometry.lineIntersectsRect({begin, end}, entity->metaBoundBox().translated(entity->position())))
         callback(entity);
     });
@@ -220,8 +306,10 @@ void EntityMap::forAllEntities(EntityCallback const& callback, function<bool(Ent
       });
   }
 
-  for (auto ptr : allEntities)
+  for (auto ptr : allEntities) {
+    checkIslandAccess(*ptr);
     callback(*ptr);
+  }
 }
 
 EntityPtr EntityMap::findEntity(RectF const& boundBox, EntityFilter const& filter) const {
@@ -275,6 +363,7 @@ EntityPtr EntityMap::closestEntity(Vec2F const& center, float radius, EntityFilt
   RectF boundBox(center[0] - radius, center[1] - radius, center[0] + radius, center[1] + radius);
 
   m_spatialMap.forEach(m_geometry.splitRect(boundBox), [&](EntityPtr const& entity) {
+      checkIslandAccess(entity);
       Vec2F pos = entity->position();
       float thisDistSquared = m_geometry.diff(center, pos).magnitudeSquared();
       if (distSquared > thisDistSquared) {
@@ -294,6 +383,7 @@ InteractiveEntityPtr EntityMap::interactiveEntityNear(Vec2F const& pos, float ma
   double bestDistance = maxRadius + 100;
   double bestCenterDistance = maxRadius + 100;
   m_spatialMap.forEach(m_geometry.splitRect(rect), [&](EntityPtr const& entity) {
+      checkIslandAccess(entity);
       if (auto ie = as<InteractiveEntity>(entity)) {
         if (alwaysInteractive || ie->isInteractive()) { // FezzedOne: Allow the interactivity check to be overridden.
           if (auto tileEntity = as<TileEntity>(entity)) {
@@ -353,4 +443,99 @@ bool EntityMap::spaceIsOccupied(RectF const& rect, bool includesEphemeral) const
   return false;
 }
 
+void EntityMap::updateEntityInfo(SpatialMap::Entry const& entry) {
+  auto const& entity = entry.value;
+
+  auto position = entity->position();
+  auto boundBox = entity->metaBoundBox();
+
+  if (boundBox.isNegative() || boundBox.width() > MaximumEntityBoundBox || boundBox.height() > MaximumEntityBoundBox) {
+    throw EntityMapException::format("Entity id: {} type: {} bound box is negative or beyond the maximum entity bound box size in EntityMap::addEntity",
+        entity->entityId(), (int)entity->entityType());
+  }
+
+  auto entityId = entity->entityId();
+  if (entityId == NullEntityId)
+    throw EntityMapException::format("Null entity id in EntityMap::setEntityInfo");
+
+  auto rects = m_geometry.splitRect(boundBox, position);
+  if (!containersEqual(rects, entry.rects))
+    m_spatialMap.set(entityId, rects);
+
+  auto uniqueId = entity->uniqueId();
+  if (uniqueId) {
+    if (auto existingEntityId = m_uniqueMap.maybeRight(*uniqueId)) {
+      if (entityId != *existingEntityId)
+        throw EntityMapException::format("Duplicate entity unique id on entity ids ({}) and ({})", *existingEntityId, entityId);
+    } else {
+      m_uniqueMap.removeRight(entityId);
+      m_uniqueMap.add(*uniqueId, entityId);
+    }
+  } else {
+    m_uniqueMap.removeRight(entityId);
+  }
+}
+
+List<List<EntityPtr>> EntityMap::entityIslands(List<SpatialMap::Entry const*> const& entries, float padding) const {
+  // Union-find over entry indexes, any two entries whose padded bound boxes
+  // touch the same spatial hash sector end up in the same set.  The root of
+  // each set is always its lowest index, so island order follows entry order.
+  List<size_t> parents;
+  parents.resize(entries.size());
+  for (size_t i = 0; i < entries.size(); ++i)
+    parents[i] = i;
+
+  auto findRoot = [&parents](size_t i) {
+    while (parents[i] != i) {
+      parents[i] = parents[parents[i]];
+      i = parents[i];
+    }
+    return i;
+  };
+
+  HashMap<Vec2I, size_t> sectorOwners;
+  for (size_t i = 0; i < entries.size(); ++i) {
+    auto const& entity = entries[i]->value;
+    for (auto const& rect : m_geometry.splitRect(entity->metaBoundBox().padded(padding), entity->position())) {
+      Vec2I minSector = Vec2I::floor(rect.min() / EntityMapSpatialHashSectorSize);
+      Vec2I maxSector = Vec2I::floor(rect.max() / EntityMapSpatialHashSectorSize);
+      for (int x = minSector[0]; x <= maxSector[0]; ++x) {
+        for (int y = minSector[1]; y <= maxSector[1]; ++y) {
+          auto res = sectorOwners.insert({Vec2I(x, y), i});
+          if (!res.second) {
+            size_t a = findRoot(res.first->second);
+            size_t b = findRoot(i);
+            if (a < b)
+              parents[b] = a;
+            else if (b < a)
+              parents[a] = b;
+          }
+        }
+      }
+    }
+  }
+
+  List<List<EntityPtr>> islands;
+  HashMap<size_t, size_t> rootIslands;
+  for (size_t i = 0; i < entries.size(); ++i) {
+    auto res = rootIslands.insert({findRoot(i), islands.size()});
+    if (res.second)
+      islands.append({});
+    islands[res.first->second].append(entries[i]->value);
+  }
+
+  return islands;
+}
+
+void EntityMap::checkIslandAccess(EntityPtr const& entity) const {
+  auto islandCheck = s_islandCheck;
+  if (!islandCheck || !entity)
+    return;
+
+  if (auto island = islandCheck->islandIndexes->maybe(entity->entityId())) {
+    if (*island != islandCheck->island)
+      islandCheck->accesses.append({islandCheck->currentEntity, entity->entityId()});
+  }
+}
+
 }
@@ -25,6 +25,34 @@ public:
   static float const SpatialHashSectorSize;
   static int const MaximumEntityBoundBox;
 
+  // Configures the parallel variant of updateAllEntities.
+  struct ParallelUpdate {
+    // Entities accepted by this filter may be updated concurrently with
+    // entities in other islands.
+    EntityFilter filter;
+    // Each entity's meta bound box is padded by this amount before grouping
+    // entities into islands, it should cover the range at which a parallel
+    // entity can observe or affect other parallel entities during update.
+    float islandPadding = 0.0f;
+    // Called before runJobs with the padded bound boxes of every entity in
+    // the run, so that anything the jobs read in those regions can be made
+    // ready to be read concurrently.
+    function<void(List<RectF> const&)> prepareRegions;
+    // Must run every given job, possibly concurrently, and return only once
+    // all of them have completed.
+    function<void(List<function<void()>> const&)> runJobs;
+    // If true, every entity lookup made from inside a job is checked against
+    // the island the job is updating.
+    bool checkIslands = false;
+  };
+
+  // An entity lookup made while updating one island that touched a parallel
+  // entity belonging to a different island.
+  struct CrossIslandAccess {
+    EntityId accessingEntity;
+    EntityId accessedEntity;
+  };
+
   // beginIdSpace and endIdSpace is the *inclusive* range for new entityIds.
   EntityMap(Vec2U const& worldSize, EntityId beginIdSpace, EntityId endIdSpace);
 
@@ -47,6 +75,20 @@ public:
   // the spatial information for each entity along the way.
   void updateAllEntities(EntityCallback const& callback = {}, function<bool(EntityPtr const&, EntityPtr const&)> sortOrder = {});
 
+  // Parallel variant of updateAllEntities.  Every run of consecutive (in sort
+  // order) entities accepted by the parallel filter is split into islands,
+  // groups of entities whose padded bound boxes transitively overlap, and each
+  // island becomes a job that calls the callback for its entities in sort
+  // order.  Spatial information for the run is updated once all its jobs are
+  // done.  Entities outside of these runs are updated serially as in
+  // updateAllEntities.  If checkIslands is set, returns every detected access
+  // from one island into another, which would make the result differ from a
+  // serial update.
+  List<CrossIslandAccess> updateAllEntities(EntityCallback const& callback, function<bool(EntityPtr const&, EntityPtr const&)> sortOrder, ParallelUpdate const& parallelUpdate);
+
+  // True on a thread while it is running a job of a parallel update.
+  static bool inParallelUpdate();
+
   // If the given unique entity is in this map, then return its entity id
   EntityId uniqueEntityId(String const& uniqueId) const;
 
@@ -119,6 +161,15 @@ public:
 private:
   typedef SpatialHash2D<EntityId, float, EntityPtr> SpatialMap;
 
+  void updateEntityInfo(SpatialMap::Entry const& entry);
+
+  // Groups the given entities into islands, preserving the given order inside
+  // each island.  Islands are ordered by their first entity.
+  List<List<EntityPtr>> entityIslands(List<SpatialMap::Entry const*> const& entries, float padding) const;
+
+  // Records the access if the calling thread is running a checked island job.
+  void checkIslandAccess(EntityPtr const& entity) const;
+
   WorldGeometry m_geometry;
 
   SpatialMap m_spatialMap;
@@ -131,11 +131,21 @@ bool ItemDatabase::canMakeRecipe(ItemRecipe const& recipe, HashMap<ItemDescripto
   return true;
 }
 
+thread_local ItemDatabase::LuaSlot* ItemDatabase::s_heldLuaSlot = nullptr;
+
 ItemDatabase::ItemDatabase()
-  : m_luaRoot(make_shared<LuaRoot>()) {
+  : m_builtConfigHits(0), m_builtConfigMisses(0) {
+  // Item scripts run on whichever thread needs the item, so there is a Lua
+  // slot for each of up to assetLuaRoots threads to build items concurrently.
   auto config = Root::singleton().configuration();
-  m_luaRoot->tuneAutoGarbageCollection(config->get("assetLuaGcPause").optFloat().value(1.2f),
-    config->get("assetLuaGcStepMultiplier").optFloat().value(1.2f));
+  size_t luaSlots = config->get("assetLuaRoots").optUInt().value(min(Thread::numberOfProcessors(), 8u));
+  for (size_t i = 0; i < max<size_t>(luaSlots, 1); ++i)
+    m_luaSlots.append(make_shared<LuaSlot>());
+
+  size_t configCacheSize = config->get("itemConfigCacheSize").optUInt().value(4096);
+  m_baseConfigCache.setMaxSize(configCacheSize);
+  m_builtConfigCache.setMaxSize(configCacheSize);
+
   scanItems();
   addObjectItems();
   addCodexes();
@@ -150,6 +160,9 @@ void ItemDatabase::cleanup() {
       return !item.unique();
     });
   }
+
+  auto statistics = itemConfigCacheStatistics();
+  LogMap::set("item_config_cache", strf("{} hits, {} misses, {} cached", statistics.hits, statistics.misses, statistics.size));
 }
 
 ItemPtr ItemDatabase::diskLoad(Json const& diskStore) const {
@@ -199,26 +212,69 @@ ItemDatabase::ItemConfig ItemDatabase::itemConfig(String const& itemName, Json p
   auto const& data = itemData(itemName);
 
   ItemConfig itemConfig;
-  if (data.assetsConfig)
-    itemConfig.config = Root::singleton().assets()->json(*data.assetsConfig);
   itemConfig.directory = data.directory;
-  itemConfig.config = jsonMerge(itemConfig.config, data.customConfig);
   itemConfig.parameters = parameters;
 
-  if (auto builder = itemConfig.config.optString("builder")) {
-    RecursiveMutexLocker locker(m_luaMutex);
-    auto context = m_luaRoot->createContext(*builder);
-    context.setCallbacks("root", LuaBindings::makeRootCallbacks());
-    context.setCallbacks("xsb", LuaBindings::makeXsbCallbacks());
-    context.setCallbacks("sb", LuaBindings::makeUtilityCallbacks());
-    luaTie(itemConfig.config, itemConfig.parameters) = context.invokePath<LuaTupleReturn<Json, Json>>(
-        "build", itemConfig.directory, itemConfig.config, itemConfig.parameters, level, seed);
-    // m_luaRoot->collectGarbage();
+  {
+    MutexLocker locker(m_configCacheMutex);
+    if (auto baseConfig = m_baseConfigCache.ptr(itemName))
+      itemConfig.config = *baseConfig;
   }
+  if (!itemConfig.config) {
+    if (data.assetsConfig)
+      itemConfig.config = Root::singleton().assets()->json(*data.assetsConfig);
+    itemConfig.config = jsonMerge(itemConfig.config, data.customConfig);
+    MutexLocker locker(m_configCacheMutex);
+    m_baseConfigCache.set(itemName, itemConfig.config);
+  }
+
+  auto builder = itemConfig.config.optString("builder");
+  if (!builder)
+    return itemConfig;
+
+  ItemConfigCacheEntry cacheEntry{itemName, std::move(parameters), level, seed};
+  {
+    MutexLocker locker(m_configCacheMutex);
+    if (m_deterministicBuilders.value(*builder, false)) {
+      if (auto cached = m_builtConfigCache.ptr(cacheEntry)) {
+        ++m_builtConfigHits;
+        return *cached;
+      }
+      ++m_builtConfigMisses;
+    }
+  }
+
+  withLuaSlot([&](LuaSlot& slot) {
+      if (!slot.builders.contains(*builder)) {
+        auto context = slot.luaRoot->createContext(*builder);
+        context.setCallbacks("root", LuaBindings::makeRootCallbacks());
+        context.setCallbacks("xsb", LuaBindings::makeXsbCallbacks());
+        context.setCallbacks("sb", LuaBindings::makeUtilityCallbacks());
+        bool deterministic = context.get<Maybe<bool>>("deterministicBuild").value(false);
+        slot.builders.add(*builder, std::move(context));
+
+        MutexLocker locker(m_configCacheMutex);
+        m_deterministicBuilders[*builder] = deterministic;
+      }
+
+      // Copied out of the map, as building may add builders to the slot.
+      LuaContext context = slot.builders.get(*builder);
+      luaTie(itemConfig.config, itemConfig.parameters) = context.invokePath<LuaTupleReturn<Json, Json>>(
+          "build", itemConfig.directory, itemConfig.config, itemConfig.parameters, level, seed);
+    });
+
+  MutexLocker locker(m_configCacheMutex);
+  if (m_deterministicBuilders.value(*builder, false))
+    m_builtConfigCache.set(cacheEntry, itemConfig);
 
   return itemConfig;
 }
 
+auto ItemDatabase::itemConfigCacheStatistics() const -> ItemConfigCacheStatistics {
+  MutexLocker locker(m_configCacheMutex);
+  return {m_builtConfigHits, m_builtConfigMisses, m_builtConfigCache.currentSize()};
+}
+
 ItemPtr ItemDatabase::itemShared(ItemDescriptor descriptor, Maybe<float> level, Maybe<uint64_t> seed) const {
   if (!descriptor)
     return {};
@@ -396,18 +452,18 @@ HashSet<ItemRecipe> ItemDatabase::allRecipes(StringSet const& types) const {
 
 ItemPtr ItemDatabase::applyAugment(ItemPtr const item, AugmentItem* augment) const {
   if (item) {
-    RecursiveMutexLocker locker(m_luaMutex);
-    LuaBaseComponent script;
-    script.setLuaRoot(m_luaRoot);
-    script.setScripts(augment->augmentScripts());
-    // FezzedOne: Added apparently missing `root`, `xsb` and `sb` callbacks.
-    script.addCallbacks("item", LuaBindings::makeItemCallbacks(augment));
-    script.addCallbacks("config", LuaBindings::makeConfigCallbacks(bind(&Item::instanceValue, augment, _1, _2)));
-    script.init();
-    auto luaResult = script.invoke<LuaTupleReturn<Json, Maybe<uint64_t>>>("apply", item->descriptor().toJson());
-    script.uninit();
-    // m_luaRoot->collectGarbage();
-    locker.unlock();
+    Maybe<LuaTupleReturn<Json, Maybe<uint64_t>>> luaResult;
+    withLuaSlot([&](LuaSlot& slot) {
+        LuaBaseComponent script;
+        script.setLuaRoot(slot.luaRoot);
+        script.setScripts(augment->augmentScripts());
+        // FezzedOne: Added apparently missing `root`, `xsb` and `sb` callbacks.
+        script.addCallbacks("item", LuaBindings::makeItemCallbacks(augment));
+        script.addCallbacks("config", LuaBindings::makeConfigCallbacks(bind(&Item::instanceValue, augment, _1, _2)));
+        script.init();
+        luaResult = script.invoke<LuaTupleReturn<Json, Maybe<uint64_t>>>("apply", item->descriptor().toJson());
+        script.uninit();
+      });
 
     if (luaResult) {
       if (!get<0>(*luaResult).isNull()) {
@@ -430,15 +486,15 @@ bool ItemDatabase::ageItem(ItemPtr& item, double aging) const {
 
   ItemDescriptor original = item->descriptor();
 
-  RecursiveMutexLocker locker(m_luaMutex);
-  LuaBaseComponent script;
-  script.setLuaRoot(m_luaRoot);
-  script.setScripts(itemData.agingScripts);
-  script.init();
-  auto aged = script.invoke<Json>("ageItem", original.toJson(), aging).apply(construct<ItemDescriptor>());
-  script.uninit();
-  // m_luaRoot->collectGarbage();
-  locker.unlock();
+  Maybe<ItemDescriptor> aged;
+  withLuaSlot([&](LuaSlot& slot) {
+      LuaBaseComponent script;
+      script.setLuaRoot(slot.luaRoot);
+      script.setScripts(itemData.agingScripts);
+      script.init();
+      aged = script.invoke<Json>("ageItem", original.toJson(), aging).apply(construct<ItemDescriptor>());
+      script.uninit();
+    });
 
   if (aged && *aged != original) {
     item = ItemDatabase::item(*aged);
@@ -629,6 +685,50 @@ void ItemDatabase::addObjectDropItem(String const& objectPath, Json const& objec
   m_items[data.name] = std::move(data);
 }
 
+void ItemDatabase::withLuaSlot(function<void(LuaSlot&)> const& function) const {
+  if (s_heldLuaSlot) {
+    for (auto const& slot : m_luaSlots) {
+      if (slot.get() == s_heldLuaSlot)
+        return function(*slot);
+    }
+  }
+
+  static atomic<size_t> nextThreadIndex(0);
+  thread_local size_t threadIndex = nextThreadIndex++;
+
+  // Prefer the thread's own slot, then any free slot, and only wait for the
+  // thread's own slot if every slot is in use.
+  size_t preferred = threadIndex % m_luaSlots.size();
+  LuaSlot* slot = nullptr;
+  for (size_t i = 0; i < m_luaSlots.size(); ++i) {
+    auto const& candidate = m_luaSlots[(preferred + i) % m_luaSlots.size()];
+    if (candidate->mutex.tryLock()) {
+      slot = candidate.get();
+      break;
+    }
+  }
+  if (!slot) {
+    slot = m_luaSlots[preferred].get();
+    slot->mutex.lock();
+  }
+
+  LuaSlot* previousSlot = s_heldLuaSlot;
+  s_heldLuaSlot = slot;
+  auto release = finally([slot, previousSlot]() {
+      s_heldLuaSlot = previousSlot;
+      slot->mutex.unlock();
+    });
+
+  if (!slot->luaRoot) {
+    auto config = Root::singleton().configuration();
+    slot->luaRoot = make_shared<LuaRoot>();
+    slot->luaRoot->tuneAutoGarbageCollection(config->get("assetLuaGcPause").optFloat().value(1.2f),
+      config->get("assetLuaGcStepMultiplier").optFloat().value(1.2f));
+  }
+
+  function(*slot);
+}
+
 void ItemDatabase::scanItems() {
   auto assets = Root::singleton().assets();
 
@@ -7,6 +7,7 @@
 #include "StarCasting.hpp"
 #include "StarLuaRoot.hpp"
 #include "StarTtlCache.hpp"
+#include "StarLruCache.hpp"
 
 namespace Star {
 
@@ -66,6 +67,12 @@ public:
     Json parameters;
   };
 
+  struct ItemConfigCacheStatistics {
+    uint64_t hits;
+    uint64_t misses;
+    size_t size;
+  };
+
   static uint64_t getCountOfItem(List<ItemPtr> const& bag, ItemDescriptor const& item, bool exactMatch = false);
   static uint64_t getCountOfItem(HashMap<ItemDescriptor, uint64_t> const& bag, ItemDescriptor const& item, bool exactMatch = false);
   static HashMap<ItemDescriptor, uint64_t> normalizeBag(List<ItemPtr> const& bag);
@@ -109,7 +116,14 @@ public:
   // Generate an item config for the given itemName, parameters, level and seed.
   // Level and seed are used by generation in some item types, and may be stored as part
   // of the unique item data or may be ignored.
+  //
+  // Builder scripts that set the global deterministicBuild to true declare
+  // that build always returns the same result for the same arguments, even
+  // without a seed, and the configs they build are memoized by item name,
+  // parameters, level and seed.
   ItemConfig itemConfig(String const& itemName, Json parameters, Maybe<float> level = {}, Maybe<uint64_t> seed = {}) const;
+  // Hits and misses of the memoized builds of deterministic builders.
+  ItemConfigCacheStatistics itemConfigCacheStatistics() const;
 
   // Generates the config for the given item descriptor and then loads the item
   // from the appropriate factory.  If there is a problem instantiating the
@@ -148,6 +162,15 @@ public:
   List<String> allItems() const;
 
 private:
+  // A LuaRoot for item scripts, along with the builder contexts created on it
+  // so far, which are reused for every item with that builder.  The LuaRoot is
+  // created on first use.
+  struct LuaSlot {
+    RecursiveMutex mutex;
+    LuaRootPtr luaRoot;
+    StringMap<LuaContext> builders;
+  };
+
   struct ItemData {
     ItemType type;
     String name;
@@ -168,6 +191,11 @@ private:
   void addItemSet(ItemType type, String const& extension);
   void addObjectDropItem(String const& objectPath, Json const& objectConfig);
 
+  // Runs the function with one of the Lua slots locked, preferably the one
+  // for the calling thread.  Item scripts that call back into the
+  // ItemDatabase keep using the slot their thread already holds.
+  void withLuaSlot(function<void(LuaSlot&)> const& function) const;
+
   void scanItems();
   void addObjectItems();
   void scanRecipes();
@@ -177,10 +205,21 @@ private:
   StringMap<ItemData> m_items;
   HashSet<ItemRecipe> m_recipes;
 
-  mutable RecursiveMutex m_luaMutex;
-  LuaRootPtr m_luaRoot;
+  static thread_local LuaSlot* s_heldLuaSlot;
+
+  List<shared_ptr<LuaSlot>> m_luaSlots;
 
   typedef tuple<ItemDescriptor, Maybe<float>, Maybe<uint64_t>> ItemCacheEntry;
+  typedef tuple<String, Json, Maybe<float>, Maybe<uint64_t>> ItemConfigCacheEntry;
+
+  // The base configs merged with each item's custom config, and the configs
+  // built by deterministic builders.
+  mutable Mutex m_configCacheMutex;
+  mutable HashLruCache<String, Json> m_baseConfigCache;
+  mutable StringMap<bool> m_deterministicBuilders;
+  mutable HashLruCache<ItemConfigCacheEntry, ItemConfig> m_builtConfigCache;
+  mutable atomic<uint64_t> m_builtConfigHits;
+  mutable atomic<uint64_t> m_builtConfigMisses;
 
   mutable Mutex m_cacheMutex;
   mutable HashTtlCache<ItemCacheEntry, ItemPtr> m_itemCache;
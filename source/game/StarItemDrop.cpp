@@ -6,6 +6,7 @@
 #include "StarJsonExtra.hpp"
 #include "StarEntityRendering.hpp"
 #include "StarWorld.hpp"
+#include "StarEntityMap.hpp"
 #include "StarDataStreamExtra.hpp"
 #include "StarPlayer.hpp"
 #include "StarMaterialItem.hpp"
@@ -231,7 +232,9 @@ void ItemDrop::update(float dt, uint64_t) {
     if (m_mode.get() == Mode::Taken && m_dropAge.elapsedTime() > m_afterTakenLife)
       m_mode.set(Mode::Dead);
 
-    if (m_mode.get() <= Mode::Available && m_ageItemsTimer.elapsedTime() > m_ageItemsEvery) {
+    // Aging runs item scripts, which parallel updates must not do, so it
+    // waits for the next serial update.
+    if (m_mode.get() <= Mode::Available && m_ageItemsTimer.elapsedTime() > m_ageItemsEvery && !EntityMap::inParallelUpdate()) {
       if (Root::singleton().itemDatabase()->ageItem(m_item, m_ageItemsTimer.elapsedTime())) {
         m_itemDescriptor.set(m_item->descriptor());
         updateCollisionPoly();
@@ -262,6 +265,10 @@ void ItemDrop::update(float dt, uint64_t) {
   }
 }
 
+bool ItemDrop::parallelUpdateSafe() const {
+  return m_mode.get() > Mode::Available || m_ageItemsTimer.elapsedTime() <= m_ageItemsEvery;
+}
+
 bool ItemDrop::shouldDestroy() const {
   return m_mode.get() == Mode::Dead || (m_item->empty() && m_owningEntity.get() == NullEntityId);
 }
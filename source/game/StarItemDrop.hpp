@@ -54,6 +54,7 @@ public:
   RectF collisionArea() const override;
 
   void update(float dt, uint64_t currentStep) override;
+  bool parallelUpdateSafe() const override;
 
   bool shouldDestroy() const override;
 
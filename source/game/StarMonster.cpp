@@ -230,6 +230,10 @@ String Monster::description() const {
   return m_monsterVariant.description.value("Some indescribable horror");
 }
 
+bool Monster::canBeHit() const {
+  return true;
+}
+
 Maybe<HitType> Monster::queryHit(DamageSource const& source) const {
   if (!inWorld() || m_knockedOut || m_statusController->statPositive("invulnerable"))
     return {};
@@ -72,6 +72,7 @@ public:
   List<LightSource> lightSources() const override;
 
   Maybe<HitType> queryHit(DamageSource const& source) const override;
+  bool canBeHit() const override;
   Maybe<PolyF> hitPoly() const override;
 
   void hitOther(EntityId targetEntityId, DamageRequest const& damageRequest) override;
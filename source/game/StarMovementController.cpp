@@ -557,8 +557,8 @@ void MovementController::tickMaster(float dt) {
 
       RectF queryBounds = body.boundBox().padded(maximumCorrection);
       queryBounds.combine(queryBounds.translated(movement));
-      queryCollisions(queryBounds);
-      auto result = collisionMove(m_workingCollisions, body, movement, ignorePlatforms, *m_parameters.enableSurfaceSlopeCorrection && !zeroG(),
+      auto& collisions = queryCollisions(queryBounds);
+      auto result = collisionMove(collisions, body, movement, ignorePlatforms, *m_parameters.enableSurfaceSlopeCorrection && !zeroG(),
           maximumCorrection, maximumPlatformCorrection, bodyCenter, dtSteps);
 
       setPosition(position() + result.movement);
@@ -719,7 +719,7 @@ void MovementController::setIgnorePhysicsEntities(Set<EntityId> ignorePhysicsEnt
   m_ignorePhysicsEntities = ignorePhysicsEntities;
 }
 
-void MovementController::forEachMovingCollision(RectF const& region, function<bool(MovingCollisionId id, PhysicsMovingCollision, PolyF, RectF)> callback) {
+void MovementController::forEachMovingCollision(RectF const& region, function<bool(MovingCollisionId id, PhysicsMovingCollision const&, PolyF const&, RectF const&)> callback) {
   auto geometry = world()->geometry();
   if (!m_ignoreAllPhysicsEntities) {
     for (auto& physicsEntity : world()->query<PhysicsEntity>(region)) {
@@ -1079,18 +1079,28 @@ void MovementController::updatePositionInterpolators() {
   m_yPosition.setInterpolator(bind(lerpWithLimit<float, float>, m_parameters.discontinuityThreshold, _1, _2, _3));
 }
 
-void MovementController::queryCollisions(RectF const& region) {
-  while (!m_workingCollisions.empty()) {
-    m_collisionBuffers.append(m_workingCollisions.takeLast().poly);
-  }
+auto MovementController::collisionQueryBuffers() -> CollisionQueryBuffers& {
+  // Rather than every controller keeping the polys of its own last query,
+  // every controller updated on a thread shares one set, so the vertex
+  // storage of spare polys is reused across controllers and almost never
+  // needs to be allocated.
+  static thread_local CollisionQueryBuffers buffers;
+  return buffers;
+}
 
-  auto newCollisionPoly = [this]() -> CollisionPoly& {
-    if (!m_collisionBuffers.empty())
-      return m_workingCollisions.emplaceAppend(CollisionPoly{
-          m_collisionBuffers.takeLast(), {}, {}, {}, {}, {}
+auto MovementController::queryCollisions(RectF const& region) -> List<CollisionPoly>& {
+  auto& buffers = collisionQueryBuffers();
+  auto& collisions = buffers.collisions;
+  while (!collisions.empty())
+    buffers.spares.append(std::move(collisions.takeLast().poly));
+
+  auto newCollisionPoly = [&]() -> CollisionPoly& {
+    if (!buffers.spares.empty())
+      return collisions.emplaceAppend(CollisionPoly{
+          buffers.spares.takeLast(), {}, {}, {}, {}, {}
         });
     else
-      return m_workingCollisions.emplaceAppend(CollisionPoly{});
+      return collisions.emplaceAppend(CollisionPoly{});
   };
 
   auto geometry = world()->geometry();
@@ -1114,15 +1124,17 @@ void MovementController::queryCollisions(RectF const& region) {
       }
     });
 
-  forEachMovingCollision(region, [&](MovingCollisionId id, PhysicsMovingCollision mc, PolyF poly, RectF bounds) {
+  forEachMovingCollision(region, [&](MovingCollisionId id, PhysicsMovingCollision const& mc, PolyF const& poly, RectF const& bounds) {
     CollisionPoly& collisionPoly = newCollisionPoly();
-    collisionPoly.poly = std::move(poly);
+    collisionPoly.poly = poly;
     collisionPoly.polyBounds = bounds;
     collisionPoly.sortPosition = collisionPoly.poly.center();
     collisionPoly.movingCollisionId = id;
     collisionPoly.collisionKind = mc.collisionKind;
     return true;
   });
+
+  return collisions;
 }
 
 float MovementController::gravity() {
@@ -195,7 +195,7 @@ public:
 
   void setIgnorePhysicsEntities(Set<EntityId> ignorePhysicsEntities);
   // iterate over all physics entity collision polys in the region, iteration stops if the callback returns false
-  void forEachMovingCollision(RectF const& region, function<bool(MovingCollisionId, PhysicsMovingCollision, PolyF, RectF)> callback);
+  void forEachMovingCollision(RectF const& region, function<bool(MovingCollisionId, PhysicsMovingCollision const&, PolyF const&, RectF const&)> callback);
 
 protected:
   // forces the movement controller onGround status, used when manually controlling movement outside the movement controller
@@ -242,6 +242,15 @@ private:
     float sortDistance;
   };
 
+  // The polys of the last collision query on a thread, and spare polys to
+  // reuse for the next one.
+  struct CollisionQueryBuffers {
+    List<CollisionPoly> collisions;
+    List<PolyF> spares;
+  };
+
+  static CollisionQueryBuffers& collisionQueryBuffers();
+
   static CollisionKind maxOrNullCollision(CollisionKind a, CollisionKind b);
   static CollisionResult collisionMove(List<CollisionPoly>& collisionPolys, PolyF const& body, Vec2F const& movement,
       bool ignorePlatforms, bool enableSurfaceSlopeCorrection, float maximumCorrection, float maximumPlatformCorrection, Vec2F sortCenter, float dt);
@@ -251,7 +260,9 @@ private:
   void updateParameters(MovementParameters parameters);
   void updatePositionInterpolators();
 
-  void queryCollisions(RectF const& region);
+  // Returns every collision poly in the region.  The list is shared by every
+  // controller on the same thread, so it is only valid until the next query.
+  List<CollisionPoly>& queryCollisions(RectF const& region);
 
   float gravity();
 
@@ -294,9 +305,6 @@ private:
   bool m_resting;
   int m_restTicks;
   float m_timeStep;
-
-  List<CollisionPoly> m_workingCollisions;
-  List<PolyF> m_collisionBuffers;
 };
 
 }
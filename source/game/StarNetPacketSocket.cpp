@@ -5,6 +5,10 @@
 
 namespace Star {
 
+// Set on the packet type of stream compressed packet groups, which are never
+// sent to peers that have not signaled support for them.
+static uint8_t const StreamCompressedPacketTypeFlag = 0x80;
+
 PacketStatCollector::PacketStatCollector(float calculationWindow)
   : m_calculationWindow(calculationWindow), m_stats(), m_lastMixTime(0) {}
 
@@ -55,9 +59,16 @@ Maybe<PacketStats> PacketSocket::outgoingStats() const {
   return {};
 }
 
+SocketPtr PacketSocket::pollSocket() const {
+  return {};
+}
+
 void PacketSocket::setLegacy(bool legacy) { m_legacy = legacy; }
 bool PacketSocket::legacy() const { return m_legacy; }
 
+void PacketSocket::setStreamCompression(bool streamCompression) { m_streamCompression = streamCompression; }
+bool PacketSocket::streamCompression() const { return m_streamCompression; }
+
 pair<LocalPacketSocketUPtr, LocalPacketSocketUPtr> LocalPacketSocket::openPair() {
   auto lhsIncomingPipe = make_shared<Pipe>();
   auto rhsIncomingPipe = make_shared<Pipe>();
@@ -157,13 +168,29 @@ void TcpPacketSocket::sendPackets(List<PacketPtr> packets) {
     // determine packet count
     starAssert(!packetBuffer.empty());
 
+    DataStreamBuffer outBuffer;
+
+    // The compression stream keeps its history between packet groups, so
+    // even small ones are worth compressing.
+    if (streamCompression() && !legacy() && currentCompressionMode != PacketCompressionMode::Disabled) {
+      if (!m_compressionStream)
+        m_compressionStream = make_unique<CompressionStream>();
+      ByteArray compressedPackets = m_compressionStream->compress(packetBuffer.data());
+
+      outBuffer.write<uint8_t>((uint8_t)currentType | StreamCompressedPacketTypeFlag);
+      outBuffer.writeVlqU(compressedPackets.size());
+      outBuffer.writeData(compressedPackets.ptr(), compressedPackets.size());
+      m_outgoingStats.mix(currentType, compressedPackets.size());
+      m_outputBuffer.append(outBuffer.takeData());
+      continue;
+    }
+
     ByteArray compressedPackets;
     bool mustCompress = currentCompressionMode == PacketCompressionMode::Enabled;
     bool perhapsCompress = currentCompressionMode == PacketCompressionMode::Automatic && packetBuffer.size() > 64;
     if (mustCompress || perhapsCompress)
       compressedPackets = compressData(packetBuffer.data());
 
-    DataStreamBuffer outBuffer;
     outBuffer.write(currentType);
 
     if (!compressedPackets.empty() && (mustCompress || compressedPackets.size() < packetBuffer.size())) {
@@ -187,17 +214,26 @@ List<PacketPtr> TcpPacketSocket::receivePackets() {
       PacketType packetType;
       uint64_t packetSize = 0;
       bool packetCompressed = false;
+      bool packetStreamCompressed = false;
 
       DataStreamBuffer ds(m_inputBuffer);
       try {
-        packetType = ds.read<PacketType>();
-        int64_t len = ds.readVlqI();
-        if (len < 0) {
-          packetSize = -len;
+        uint8_t packetTypeByte = ds.read<uint8_t>();
+        packetStreamCompressed = !legacy() && (packetTypeByte & StreamCompressedPacketTypeFlag);
+        if (packetStreamCompressed) {
+          packetType = (PacketType)(packetTypeByte & ~StreamCompressedPacketTypeFlag);
+          packetSize = ds.readVlqU();
           packetCompressed = true;
         } else {
-          packetSize = len;
-          packetCompressed = false;
+          packetType = (PacketType)packetTypeByte;
+          int64_t len = ds.readVlqI();
+          if (len < 0) {
+            packetSize = -len;
+            packetCompressed = true;
+          } else {
+            packetSize = len;
+            packetCompressed = false;
+          }
         }
       } catch (EofException const&) {
         // Guard against not having the entire packet header available when
@@ -212,8 +248,15 @@ List<PacketPtr> TcpPacketSocket::receivePackets() {
         break;
 
       ByteArray packetBytes = ds.readBytes(packetSize);
-      if (packetCompressed)
+      if (packetStreamCompressed) {
+        if (!m_decompressionStream)
+          m_decompressionStream = make_unique<DecompressionStream>();
+        packetBytes = m_decompressionStream->uncompress(packetBytes);
+        // The peer only sends these if it can receive them too.
+        setStreamCompression(true);
+      } else if (packetCompressed) {
         packetBytes = uncompressData(packetBytes);
+      }
 
       m_incomingStats.mix(packetType, packetSize);
 
@@ -295,9 +338,15 @@ Maybe<PacketStats> TcpPacketSocket::outgoingStats() const {
   return m_outgoingStats.stats();
 }
 
+SocketPtr TcpPacketSocket::pollSocket() const {
+  return m_socket;
+}
+
 TcpPacketSocket::TcpPacketSocket(TcpSocketPtr socket)
   : m_socket(std::move(socket)) {}
 
+TcpPacketSocket::~TcpPacketSocket() = default;
+
 P2PPacketSocketUPtr P2PPacketSocket::open(P2PSocketUPtr socket) {
   return P2PPacketSocketUPtr(new P2PPacketSocket(std::move(socket)));
 }
@@ -12,6 +12,8 @@ STAR_CLASS(PacketSocket);
 STAR_CLASS(LocalPacketSocket);
 STAR_CLASS(TcpPacketSocket);
 STAR_CLASS(P2PPacketSocket);
+STAR_CLASS(CompressionStream);
+STAR_CLASS(DecompressionStream);
 
 struct PacketStats {
   HashMap<PacketType, float> packetBytesPerSecond;
@@ -73,10 +75,22 @@ public:
   virtual Maybe<PacketStats> incomingStats() const;
   virtual Maybe<PacketStats> outgoingStats() const;
 
+  // Should return the socket that readData() and writeData() do I/O on, if
+  // there is one, so that callers can wait for it to become ready instead of
+  // calling them repeatedly.  Default implementation returns null.
+  virtual SocketPtr pollSocket() const;
+
   void setLegacy(bool legacy);
   bool legacy() const;
+
+  // Whether packets are compressed with a single compression stream for the
+  // whole connection rather than separately, which needs support on both
+  // ends.  Packet sockets that do not implement it ignore this setting.
+  void setStreamCompression(bool streamCompression);
+  bool streamCompression() const;
 private:
   bool m_legacy = false;
+  bool m_streamCompression = false;
 };
 
 // PacketSocket for local communication.
@@ -109,11 +123,14 @@ private:
   weak_ptr<Pipe> m_outgoingPipe;
 };
 
-// Wraps a TCP socket into a PacketSocket.
+// Wraps a TCP socket into a PacketSocket.  Always accepts stream compressed
+// packets, and once any are received, stream compresses what it sends as well.
 class TcpPacketSocket : public PacketSocket {
 public:
   static TcpPacketSocketUPtr open(TcpSocketPtr socket);
 
+  ~TcpPacketSocket();
+
   bool isOpen() const override;
   void close() override;
 
@@ -128,6 +145,8 @@ public:
   Maybe<PacketStats> incomingStats() const override;
   Maybe<PacketStats> outgoingStats() const override;
 
+  SocketPtr pollSocket() const override;
+
 private:
   TcpPacketSocket(TcpSocketPtr socket);
 
@@ -137,6 +156,10 @@ private:
   PacketStatCollector m_outgoingStats;
   ByteArray m_outputBuffer;
   ByteArray m_inputBuffer;
+
+  // Created on first use.
+  CompressionStreamUPtr m_compressionStream;
+  DecompressionStreamUPtr m_decompressionStream;
 };
 
 // Wraps a P2PSocket into a PacketSocket
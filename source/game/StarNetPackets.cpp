@@ -182,14 +182,18 @@ void ProtocolRequestPacket::write(DataStream& ds) const {
 }
 
 ProtocolResponsePacket::ProtocolResponsePacket(bool allowed)
-  : allowed(allowed) {}
+  : allowed(allowed), streamCompression(false) {}
 
+// Support for stream compression is signaled by sending 2 rather than 1 for
+// allowed, which other clients still read as true.
 void ProtocolResponsePacket::read(DataStream& ds) {
-  ds.read(allowed);
+  uint8_t response = ds.read<uint8_t>();
+  allowed = response != 0;
+  streamCompression = response == 2;
 }
 
 void ProtocolResponsePacket::write(DataStream& ds) const {
-  ds.write(allowed);
+  ds.write<uint8_t>(allowed ? (streamCompression ? 2 : 1) : 0);
 }
 
 ConnectSuccessPacket::ConnectSuccessPacket() {}
@@ -166,6 +166,8 @@ struct ProtocolResponsePacket : PacketBase<PacketType::ProtocolResponse> {
   void write(DataStream& ds) const override;
 
   bool allowed;
+  // Whether the server supports stream compression.
+  bool streamCompression;
 };
 
 struct ServerDisconnectPacket : PacketBase<PacketType::ServerDisconnect> {
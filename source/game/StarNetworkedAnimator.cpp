@@ -239,6 +239,10 @@ NetworkedAnimator::NetworkedAnimator(NetworkedAnimator const& animator) {
 }
 
 NetworkedAnimator& NetworkedAnimator::operator=(NetworkedAnimator&& animator) {
+  // The elements of this animator are destroyed by the assignments below, so
+  // they must leave the group first.
+  clearNetElements();
+
   m_relativePath = std::move(animator.m_relativePath);
   m_animatedParts = std::move(animator.m_animatedParts);
   m_stateInfo = std::move(animator.m_stateInfo);
@@ -263,6 +267,10 @@ NetworkedAnimator& NetworkedAnimator::operator=(NetworkedAnimator&& animator) {
 }
 
 NetworkedAnimator& NetworkedAnimator::operator=(NetworkedAnimator const& animator) {
+  // The elements of this animator are destroyed by the assignments below, so
+  // they must leave the group first.
+  clearNetElements();
+
   m_relativePath = animator.m_relativePath;
   m_animatedParts = animator.m_animatedParts;
   m_stateInfo = animator.m_stateInfo;
@@ -296,6 +296,10 @@ Json Npc::scriptConfigParameter(String const& parameterName, Json const& default
   return m_npcVariant.scriptConfig.query(parameterName, defaultValue);
 }
 
+bool Npc::canBeHit() const {
+  return true;
+}
+
 Maybe<HitType> Npc::queryHit(DamageSource const& source) const {
   if (!inWorld() || !m_statusController->resourcePositive("health") || m_statusController->statPositive("invulnerable"))
     return {};
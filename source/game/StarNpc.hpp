@@ -81,6 +81,7 @@ public:
   Json scriptConfigParameter(String const& parameterName, Json const& defaultValue = Json()) const;
 
   Maybe<HitType> queryHit(DamageSource const& source) const override;
+  bool canBeHit() const override;
   Maybe<PolyF> hitPoly() const override;
 
   void damagedOther(DamageNotification const& damage) override;
@@ -1120,6 +1120,10 @@ PolyF Object::statusEffectArea() const {
   return volume();
 }
 
+bool Object::canBeHit() const {
+  return true;
+}
+
 Maybe<HitType> Object::queryHit(DamageSource const& source) const {
   if (!m_config->smashable || !inWorld() || m_health.get() <= 0.0f || m_unbreakable)
     return {};
@@ -100,6 +100,7 @@ public:
   virtual List<DamageSource> damageSources() const override;
 
   virtual Maybe<HitType> queryHit(DamageSource const& source) const override;
+  virtual bool canBeHit() const override;
   Maybe<PolyF> hitPoly() const override;
 
   virtual List<DamageNotification> applyDamage(DamageRequest const& damage) override;
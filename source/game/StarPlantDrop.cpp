@@ -4,6 +4,7 @@
 #include "StarRoot.hpp"
 #include "StarImageMetadataDatabase.hpp"
 #include "StarItemDrop.hpp"
+#include "StarEntityMap.hpp"
 #include "StarAssets.hpp"
 #include "StarEntityRendering.hpp"
 #include "StarWorld.hpp"
@@ -245,7 +246,9 @@ void PlantDrop::update(float dt, uint64_t) {
 
     auto imgMetadata = Root::singleton().imageMetadataDatabase();
 
-    if ((m_time <= 0 || world()->gravity(position()) == 0) && !m_spawnedDrops.get()) {
+    // Spawning drops builds items, which runs item scripts that parallel
+    // updates must not run, so it waits for the next serial update.
+    if ((m_time <= 0 || world()->gravity(position()) == 0) && !m_spawnedDrops.get() && !EntityMap::inParallelUpdate()) {
       m_spawnedDrops.set(true);
       for (auto& plantPiece : m_pieces) {
         JsonArray dropOptions;
@@ -282,6 +285,10 @@ void PlantDrop::update(float dt, uint64_t) {
   }
 }
 
+bool PlantDrop::parallelUpdateSafe() const {
+  return !isMaster() || m_spawnedDrops.get() || (m_time > 0 && world()->gravity(position()) != 0);
+}
+
 void PlantDrop::destroy(RenderCallback* renderCallback) {
   if (renderCallback)
     render(renderCallback);
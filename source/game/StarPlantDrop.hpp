@@ -46,6 +46,7 @@ public:
   RectF collisionRect() const;
 
   void update(float dt, uint64_t currentStep) override;
+  bool parallelUpdateSafe() const override;
 
   void render(RenderCallback* renderCallback) override;
 
@@ -609,6 +609,10 @@ RectF Player::metaBoundBox() const {
   return m_config->metaBoundBox;
 }
 
+bool Player::canBeHit() const {
+  return true;
+}
+
 Maybe<HitType> Player::queryHit(DamageSource const& source) const {
   if (!inWorld() || isDead() || m_isAdmin || isTeleporting() || m_statusController->statPositive("invulnerable"))
     return {};
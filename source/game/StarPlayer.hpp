@@ -122,6 +122,7 @@ public:
   bool menuIndicatorOverridden() const;
 
   virtual Maybe<HitType> queryHit(DamageSource const& source) const override;
+  virtual bool canBeHit() const override;
   Maybe<PolyF> hitPoly() const override;
 
   List<DamageNotification> applyDamage(DamageRequest const& damage) override;
@@ -413,7 +413,13 @@ AssetsConstPtr Root::assets() {
       StringList assetDirectories = m_settings.assetDirectories;
       assetDirectories.appendAll(m_modDirectories);
 
-      auto assets = make_shared<Assets>(m_settings.assetsSettings, scanForAssetSources(assetDirectories));
+      auto assetsSettings = m_settings.assetsSettings;
+      if (assetsSettings.imageCacheDirectory)
+        assetsSettings.imageCacheDirectory = toStoragePath(*assetsSettings.imageCacheDirectory);
+      if (assetsSettings.snapshotFile)
+        assetsSettings.snapshotFile = toStoragePath(*assetsSettings.snapshotFile);
+
+      auto assets = make_shared<Assets>(assetsSettings, scanForAssetSources(assetDirectories));
       Logger::info("Assets digest is {}", hexEncode(assets->digest()));
       return assets;
     });
@@ -33,7 +33,10 @@ Json const BaseAssetsSettings = Json::parseJson(R"JSON(
       ],
 
       "luaGcPause" : 1.2,
-      "luaGcStepMultiplier" : 2.0
+      "luaGcStepMultiplier" : 2.0,
+
+      "imageCacheSizeLimit" : 268435456,
+      "snapshotFile" : "assets.snapshot"
     }
   )JSON");
 
@@ -64,6 +67,8 @@ Json const BaseDefaultConfiguration = Json::parseJson(R"JSON(
       "scriptInstructionLimit" : 10000000,
       "scriptProfilingEnabled" : false,
       "scriptInstructionMeasureInterval" : 10000,
+      "scriptBytecodeCache" : true,
+      "sharedScriptModules" : [],
 
       "allowAdminCommands" : true,
       "allowAdminCommandsFromAnyone" : false,
@@ -81,6 +86,7 @@ Json const BaseDefaultConfiguration = Json::parseJson(R"JSON(
       "interactiveHighlight" : true,
 
       "monochromeLighting" : false,
+      "lightingTiles" : 1,
 
       "crafting" : {
         "filterHaveMaterials" : false
@@ -157,6 +163,9 @@ Root::Settings RootLoader::rootSettingsForOptions(Options const& options) const
     rootSettings.assetsSettings.digestIgnore = jsonToStringList(assetsSettings.get("digestIgnore"));
     rootSettings.assetsSettings.luaGcPause = assetsSettings.getFloat("luaGcPause");
     rootSettings.assetsSettings.luaGcStepMultiplier = assetsSettings.getFloat("luaGcStepMultiplier");
+    rootSettings.assetsSettings.imageCacheDirectory = assetsSettings.optString("imageCacheDirectory");
+    rootSettings.assetsSettings.imageCacheSizeLimit = assetsSettings.getUInt("imageCacheSizeLimit");
+    rootSettings.assetsSettings.snapshotFile = assetsSettings.optString("snapshotFile");
 
     rootSettings.assetDirectories = jsonToStringList(bootConfig.get("assetDirectories"));
 
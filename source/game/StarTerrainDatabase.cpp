@@ -54,6 +54,19 @@ TerrainSelector::TerrainSelector(String type, Json config, TerrainSelectorParame
 
 TerrainSelector::~TerrainSelector() {}
 
+void TerrainSelector::getPoints(size_t count, int const* x, int const* y, float* values) const {
+  for (size_t i = 0; i < count; ++i)
+    values[i] = get(x[i], y[i]);
+}
+
+void TerrainSelector::getColumn(int x, int y, size_t height, float* values) const {
+  List<int> xs(height, x);
+  List<int> ys(height, 0);
+  for (size_t i = 0; i < height; ++i)
+    ys[i] = y + (int)i;
+  getPoints(height, xs.ptr(), ys.ptr(), values);
+}
+
 TerrainDatabase::TerrainDatabase() {
   auto assets = Root::singleton().assets();
 
@@ -31,9 +31,18 @@ struct TerrainSelector {
   virtual ~TerrainSelector();
 
   // Returns a float signifying the "solid-ness" of a block, >= 0.0 should be
-  // considered solid, < 0.0 should be considered open space.
+  // considered solid, < 0.0 should be considered open space.  Selectors may be
+  // evaluated from several threads at once, so any caching must be locked.
   virtual float get(int x, int y) const = 0;
 
+  // Evaluates get() for 'count' points at once, storing the results in
+  // 'values'.  Selectors that can share work between points override this,
+  // the default evaluates each point on its own.
+  virtual void getPoints(size_t count, int const* x, int const* y, float* values) const;
+
+  // Evaluates the column of 'height' points from (x, y) upwards.
+  void getColumn(int x, int y, size_t height, float* values) const;
+
   String type;
   Json config;
   TerrainSelectorParameters parameters;
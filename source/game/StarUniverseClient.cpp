@@ -139,6 +139,8 @@ Maybe<String> UniverseClient::connect(UniverseConnection connection, bool allowA
 
   m_legacyServer = protocolResponsePacket->compressionMode() != PacketCompressionMode::Enabled; // True if server is vanilla
   connection.setLegacy(m_legacyServer);
+  // Once the server receives stream compressed packets, it sends them too.
+  connection.setStreamCompression(!m_legacyServer && protocolResponsePacket->streamCompression);
   connection.pushSingle(make_shared<ClientConnectPacket>(Root::singleton().assets()->digest(), allowAssetsMismatch, m_mainPlayer->uuid(), m_mainPlayer->name(),
       m_mainPlayer->species(), m_playerStorage->loadShipData(m_mainPlayer->uuid()), m_mainPlayer->shipUpgrades(),
       m_mainPlayer->log()->introComplete(), account));
@@ -4,6 +4,9 @@
 namespace Star {
 
 static const int PacketSocketPollSleep = 1;
+// Nothing depends on the processing loop waking up when there is nothing to
+// do, it only bounds how long it waits.
+static const int PacketSocketIdleWait = 1000;
 
 UniverseConnection::UniverseConnection(PacketSocketUPtr packetSocket)
   : m_packetSocket(std::move(packetSocket)) {}
@@ -111,6 +114,11 @@ void UniverseConnection::setLegacy(bool legacy) {
   m_packetSocket->setLegacy(legacy);
 }
 
+void UniverseConnection::setStreamCompression(bool streamCompression) {
+  MutexLocker locker(m_mutex);
+  m_packetSocket->setStreamCompression(streamCompression);
+}
+
 Maybe<PacketStats> UniverseConnection::incomingStats() const {
   MutexLocker locker(m_mutex);
   return m_packetSocket->incomingStats();
@@ -122,60 +130,15 @@ Maybe<PacketStats> UniverseConnection::outgoingStats() const {
 }
 
 UniverseConnectionServer::UniverseConnectionServer(PacketReceiveCallback packetReceiver)
-  : m_packetReceiver(std::move(packetReceiver)), m_shutdown(false) {
+  : m_packetReceiver(std::move(packetReceiver)), m_connectionsChanged(false), m_shutdown(false) {
   m_processingLoop = Thread::invoke("UniverseConnectionServer::processingLoop", [this]() {
-      RecursiveMutexLocker connectionsLocker(m_connectionsMutex);
-      try {
-        while (!m_shutdown) {
-          connectionsLocker.lock();
-          auto connections = m_connections.pairs();
-          connectionsLocker.unlock();
-
-          bool dataTransmitted = false;
-          for (auto& p : connections) {
-            MutexLocker connectionLocker(p.second->mutex);
-            if (!p.second->packetSocket || !p.second->packetSocket->isOpen())
-              continue;
-
-            p.second->packetSocket->sendPackets(take(p.second->sendQueue));
-            dataTransmitted |= p.second->packetSocket->writeData();
-
-            dataTransmitted |= p.second->packetSocket->readData();
-            List<PacketPtr> receivePackets = p.second->packetSocket->receivePackets();
-            if (!receivePackets.empty()) {
-              p.second->lastActivityTime = Time::monotonicMilliseconds();
-              p.second->receiveQueue.appendAll(take(receivePackets));
-            }
-
-            if (!p.second->receiveQueue.empty()) {
-              List<PacketPtr> toReceive = List<PacketPtr>::from(take(p.second->receiveQueue));
-              connectionLocker.unlock();
-
-              try {
-                m_packetReceiver(this, p.first, std::move(toReceive));
-              } catch (std::exception const& e) {
-                Logger::error("Exception caught handling incoming server packets, disconnecting client '{}' {}", p.first, outputException(e, true));
-
-                connectionLocker.lock();
-                p.second->packetSocket->close();
-              }
-            }
-          }
-
-          if (!dataTransmitted)
-            Thread::sleep(PacketSocketPollSleep);
-        }
-      } catch (std::exception const& e) {
-        Logger::error("Exception caught in UniverseConnectionServer::remoteProcessLoop, closing all remote connections: {}", e.what());
-        connectionsLocker.lock();
-        for (auto& p : m_connections)
-          p.second->packetSocket->close();
-      }
+      processingLoop();
     });
 }
 
 UniverseConnectionServer::~UniverseConnectionServer() {
   m_shutdown = true;
+  m_socketPoller.wake();
   m_processingLoop.finish();
   removeAllConnections();
 }
@@ -218,8 +181,15 @@ void UniverseConnectionServer::addConnection(ConnectionId clientId, UniverseConn
   connection->packetSocket = std::move(uc.m_packetSocket);
   connection->sendQueue = std::move(uc.m_sendQueue);
   connection->receiveQueue = std::move(uc.m_receiveQueue);
+  connection->pollSocket = connection->packetSocket->pollSocket();
+  connection->pollWritable = false;
   connection->lastActivityTime = Time::monotonicMilliseconds();
   m_connections.add(clientId, std::move(connection));
+
+  // Sends anything that was already queued on the connection.
+  m_pendingConnections.add(clientId);
+  m_connectionsChanged = true;
+  m_socketPoller.wake();
 }
 
 UniverseConnection UniverseConnectionServer::removeConnection(ConnectionId clientId) {
@@ -228,6 +198,10 @@ UniverseConnection UniverseConnectionServer::removeConnection(ConnectionId clien
     throw UniverseConnectionException::format("Client '{}' does not exist in UniverseConnectionServer::removeConnection", clientId);
 
   auto conn = m_connections.take(clientId);
+  m_pendingConnections.remove(clientId);
+  m_connectionsChanged = true;
+  m_socketPoller.wake();
+
   MutexLocker connectionLocker(conn->mutex);
 
   UniverseConnection uc;
@@ -254,10 +228,130 @@ void UniverseConnectionServer::sendPackets(ConnectionId clientId, List<PacketPtr
     if (conn->packetSocket->isOpen()) {
       conn->packetSocket->sendPackets(take(conn->sendQueue));
       conn->packetSocket->writeData();
+
+      // Anything left is written by the processing loop as soon as the socket
+      // is writable again.
+      if (conn->packetSocket->sentPacketsPending() && m_pendingConnections.add(clientId))
+        m_socketPoller.wake();
     }
   } else {
     throw UniverseConnectionException::format("No such client '{}' in UniverseConnectionServer::sendPackets", clientId);
   }
 }
 
+void UniverseConnectionServer::processingLoop() {
+  // The processing loop's own copy of the connections, updated whenever they
+  // change.
+  HashMap<ConnectionId, shared_ptr<Connection>> connections;
+  HashMap<Socket*, ConnectionId> socketConnections;
+  List<ConnectionId> unpolledConnections;
+
+  try {
+    bool dataTransmitted = false;
+    while (!m_shutdown) {
+      HashSet<ConnectionId> toProcess;
+      {
+        RecursiveMutexLocker connectionsLocker(m_connectionsMutex);
+        if (m_connectionsChanged) {
+          m_connectionsChanged = false;
+
+          for (auto const& p : connections) {
+            if (p.second->pollSocket && m_connections.value(p.first) != p.second)
+              m_socketPoller.remove(p.second->pollSocket);
+          }
+
+          connections = m_connections;
+          socketConnections.clear();
+          unpolledConnections.clear();
+          for (auto const& p : connections) {
+            if (auto const& socket = p.second->pollSocket) {
+              // Connections start out only waiting for reads, they are
+              // processed once on being added which waits for writes if
+              // needed.
+              if (!m_socketPoller.contains(socket) && socket->isActive())
+                m_socketPoller.set(socket, {true, false});
+              socketConnections.set(socket.get(), p.first);
+            } else {
+              unpolledConnections.append(p.first);
+            }
+          }
+        }
+
+        toProcess = take(m_pendingConnections);
+      }
+
+      // Connections without a poll socket are processed continuously while
+      // they transmit data, and otherwise every PacketSocketPollSleep.
+      unsigned timeout = PacketSocketIdleWait;
+      if (!toProcess.empty() || (dataTransmitted && !unpolledConnections.empty()))
+        timeout = 0;
+      else if (!unpolledConnections.empty())
+        timeout = PacketSocketPollSleep;
+
+      for (auto const& p : m_socketPoller.wait(timeout)) {
+        if (auto clientId = socketConnections.maybe(p.first.get()))
+          toProcess.add(*clientId);
+      }
+      toProcess.addAll(unpolledConnections);
+
+      dataTransmitted = false;
+      for (auto clientId : toProcess) {
+        if (auto connection = connections.value(clientId))
+          dataTransmitted |= processConnection(clientId, *connection);
+      }
+    }
+  } catch (std::exception const& e) {
+    Logger::error("Exception caught in UniverseConnectionServer::remoteProcessLoop, closing all remote connections: {}", e.what());
+    RecursiveMutexLocker connectionsLocker(m_connectionsMutex);
+    for (auto& p : m_connections)
+      p.second->packetSocket->close();
+  }
+}
+
+bool UniverseConnectionServer::processConnection(ConnectionId clientId, Connection& connection) {
+  MutexLocker connectionLocker(connection.mutex);
+  if (!connection.packetSocket || !connection.packetSocket->isOpen()) {
+    // A socket that is shut down but not yet closed would otherwise be ready
+    // on every wait.
+    if (connection.pollSocket)
+      m_socketPoller.remove(connection.pollSocket);
+    return false;
+  }
+
+  connection.packetSocket->sendPackets(take(connection.sendQueue));
+  bool dataTransmitted = connection.packetSocket->writeData();
+
+  dataTransmitted |= connection.packetSocket->readData();
+  List<PacketPtr> receivePackets = connection.packetSocket->receivePackets();
+  if (!receivePackets.empty()) {
+    connection.lastActivityTime = Time::monotonicMilliseconds();
+    connection.receiveQueue.appendAll(take(receivePackets));
+  }
+
+  if (connection.pollSocket) {
+    bool pollWritable = connection.packetSocket->sentPacketsPending();
+    if (pollWritable != connection.pollWritable && m_socketPoller.contains(connection.pollSocket)) {
+      m_socketPoller.set(connection.pollSocket, {true, pollWritable});
+      connection.pollWritable = pollWritable;
+    }
+  }
+
+  if (!connection.receiveQueue.empty()) {
+    List<PacketPtr> toReceive = List<PacketPtr>::from(take(connection.receiveQueue));
+    connectionLocker.unlock();
+
+    try {
+      m_packetReceiver(this, clientId, std::move(toReceive));
+    } catch (std::exception const& e) {
+      Logger::error("Exception caught handling incoming server packets, disconnecting client '{}' {}", clientId, outputException(e, true));
+
+      connectionLocker.lock();
+      if (connection.packetSocket)
+        connection.packetSocket->close();
+    }
+  }
+
+  return dataTransmitted;
+}
+
 }
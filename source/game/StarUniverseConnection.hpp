@@ -50,6 +50,7 @@ public:
   bool receiveAny(unsigned timeout);
 
   void setLegacy(bool legacy);
+  void setStreamCompression(bool streamCompression);
 
   // Packet stats for the most recent one second window of activity incoming
   // and outgoing.  Will only return valid stats if the underlying PacketSocket
@@ -69,7 +70,9 @@ private:
 };
 
 // Manage a set of UniverseConnections cheaply and in an asynchronous way.
-// Uses a single background thread to handle remote sending and receiving.
+// Uses a single background thread to handle remote sending and receiving,
+// which waits for connections with a socket to become ready rather than
+// checking every connection continuously.
 class UniverseConnectionServer {
 public:
   // The packet receive callback is called asynchronously on every packet group
@@ -97,16 +100,36 @@ private:
   struct Connection {
     Mutex mutex;
     PacketSocketUPtr packetSocket;
+    // Connections without a socket to wait on are processed on every
+    // iteration of the processing loop.
+    SocketPtr pollSocket;
+    // Whether the poll socket is waited on for writing, only used by the
+    // processing loop.
+    bool pollWritable;
     List<PacketPtr> sendQueue;
     Deque<PacketPtr> receiveQueue;
     int64_t lastActivityTime;
   };
 
+  void processingLoop();
+  // Sends and receives everything possible without blocking and hands the
+  // received packets to the receive callback.  Returns true if any data was
+  // sent or received.
+  bool processConnection(ConnectionId clientId, Connection& connection);
+
   PacketReceiveCallback const m_packetReceiver;
 
   mutable RecursiveMutex m_connectionsMutex;
   HashMap<ConnectionId, shared_ptr<Connection>> m_connections;
-
+  // Set when connections are added or removed, so that the processing loop
+  // updates the sockets it waits on.
+  bool m_connectionsChanged;
+  // Connections that the processing loop should process next whether or not
+  // their sockets are ready, such as ones with data that sendPackets could not
+  // write.
+  HashSet<ConnectionId> m_pendingConnections;
+
+  SocketPoller m_socketPoller;
   ThreadFunction<void> m_processingLoop;
   atomic<bool> m_shutdown;
 };
@@ -89,6 +89,7 @@ UniverseServer::UniverseServer(String const& storageDir)
   m_connectionServer = make_shared<UniverseConnectionServer>(bind(&UniverseServer::packetsReceived, this, _1, _2, _3));
 
   m_pause = make_shared<atomic<bool>>(false);
+  m_tickProfiling = make_shared<atomic<bool>>(false);
 }
 
 UniverseServer::~UniverseServer() {
@@ -152,6 +153,42 @@ void UniverseServer::setPause(bool pause) {
     m_connectionServer->sendPackets(p.first, {make_shared<PausePacket>(*m_pause)});
 }
 
+void UniverseServer::setTickProfiling(bool tickProfiling) {
+  *m_tickProfiling = tickProfiling;
+}
+
+bool UniverseServer::tickProfiling() const {
+  return *m_tickProfiling;
+}
+
+JsonObject UniverseServer::tickProfile() {
+  RecursiveMutexLocker locker(m_mainLock);
+  JsonObject profile;
+  for (auto const& worldId : m_worlds.keys()) {
+    if (auto world = getWorld(worldId)) {
+      world->executeAction([&](WorldServerThread*, WorldServer* worldServer) {
+          profile[printWorldId(worldId)] = worldServer->tickProfiler().summary();
+        });
+    }
+  }
+  return profile;
+}
+
+Json UniverseServer::tickProfileTrace() {
+  RecursiveMutexLocker locker(m_mainLock);
+  JsonArray traceEvents;
+  int64_t processId = 0;
+  for (auto const& worldId : m_worlds.keys()) {
+    if (auto world = getWorld(worldId)) {
+      ++processId;
+      world->executeAction([&](WorldServerThread*, WorldServer* worldServer) {
+          traceEvents.appendAll(worldServer->tickProfiler().traceEvents(processId, printWorldId(worldId)));
+        });
+    }
+  }
+  return JsonObject{{"traceEvents", std::move(traceEvents)}};
+}
+
 List<WorldId> UniverseServer::activeWorlds() const {
   RecursiveMutexLocker locker(m_mainLock);
   return m_worlds.keys();
@@ -1539,6 +1576,7 @@ void UniverseServer::acceptConnection(UniverseConnection connection, Maybe<HostA
 
   auto protocolResponse = make_shared<ProtocolResponsePacket>();
   protocolResponse->setCompressionMode(PacketCompressionMode::Enabled); // Signal that we're xStarbound or OpenStarbound.
+  protocolResponse->streamCompression = !legacyClient;
   if (protocolRequest->requestProtocolVersion != StarProtocolVersion) {
     Logger::warn("UniverseServer: client connection aborted, unsupported protocol version {}, supported version {}",
         protocolRequest->requestProtocolVersion, StarProtocolVersion);
@@ -2012,6 +2050,7 @@ Maybe<WorkerPoolPromise<WorldServerThreadPtr>> UniverseServer::shipWorldPromise(
 
       auto shipWorldThread = make_shared<WorldServerThread>(shipWorld, ClientShipWorldId(clientShipWorldId));
       shipWorldThread->setPause(m_pause);
+      shipWorldThread->setTickProfiling(m_tickProfiling);
       clientContext->updateShipChunks(shipWorldThread->readChunks());
       shipWorldThread->start();
       shipWorldThread->setUpdateAction(bind(&UniverseServer::worldUpdated, this, _1));
@@ -2056,6 +2095,7 @@ Maybe<WorkerPoolPromise<WorldServerThreadPtr>> UniverseServer::celestialWorldPro
 
       auto worldThread = make_shared<WorldServerThread>(worldServer, celestialWorldId);
       worldThread->setPause(m_pause);
+      worldThread->setTickProfiling(m_tickProfiling);
       worldThread->start();
       worldThread->setUpdateAction(bind(&UniverseServer::worldUpdated, this, _1));
 
@@ -2177,6 +2217,7 @@ Maybe<WorkerPoolPromise<WorldServerThreadPtr>> UniverseServer::instanceWorldProm
 
       auto worldThread = make_shared<WorldServerThread>(worldServer, instanceWorldId);
       worldThread->setPause(m_pause);
+      worldThread->setTickProfiling(m_tickProfiling);
       worldThread->start();
       worldThread->setUpdateAction(bind(&UniverseServer::worldUpdated, this, _1));
 
@@ -50,6 +50,15 @@ public:
 
   void setPause(bool pause);
 
+  // Enables or disables the tick profilers of all worlds.
+  void setTickProfiling(bool tickProfiling);
+  bool tickProfiling() const;
+  // The tick profiler summary of every active world, by world id.
+  JsonObject tickProfile();
+  // A Chrome trace of the last profiled ticks of every active world, each
+  // world as a separate process.
+  Json tickProfileTrace();
+
   List<WorldId> activeWorlds() const;
   bool isWorldActive(WorldId const& worldId) const;
 
@@ -227,6 +236,7 @@ private:
   IdMap<ConnectionId, ServerClientContextPtr> m_clients;
 
   shared_ptr<atomic<bool>> m_pause;
+  shared_ptr<atomic<bool>> m_tickProfiling;
   Map<WorldId, Maybe<WorkerPoolPromise<WorldServerThreadPtr>>> m_worlds;
   Map<InstanceWorldId, pair<int64_t, int64_t>> m_tempWorldIndex;
   Map<Vec3I, SystemWorldServerThreadPtr> m_systemWorlds;
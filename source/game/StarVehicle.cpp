@@ -156,6 +156,10 @@ ClientEntityMode Vehicle::clientEntityMode() const {
   return m_clientEntityMode;
 }
 
+bool Vehicle::canBeHit() const {
+  return true;
+}
+
 Maybe<HitType> Vehicle::queryHit(DamageSource const& source) const {
   if (source.intersectsWithPoly(world()->geometry(), m_movementController.collisionBody()))
     return HitType::Hit;
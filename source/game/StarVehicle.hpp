@@ -32,6 +32,7 @@ public:
 
   List<DamageSource> damageSources() const override;
   Maybe<HitType> queryHit(DamageSource const& source) const override;
+  bool canBeHit() const override;
   Maybe<PolyF> hitPoly() const override;
 
   List<DamageNotification> applyDamage(DamageRequest const& damage) override;
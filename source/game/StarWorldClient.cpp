@@ -314,7 +314,7 @@ void WorldClient::forEachCollisionBlock(RectI const& region, function<void(Colli
     return;
 
   const_cast<WorldClient*>(this)->freshenCollision(region);
-  m_tileArray->tileEach(region, [iterator](Vec2I const& pos, ClientTile const& tile) {
+  m_tileArray->tileEach(region, [&iterator](Vec2I const& pos, ClientTile const& tile) {
       if (tile.collision == CollisionKind::Null) {
         iterator(CollisionBlock::nullBlock(pos));
       } else {
@@ -1907,6 +1907,16 @@ void WorldClient::initWorld(WorldStartPacket const& startPacket) {
 
   m_lightingCalculator.setMonochrome(Root::singleton().configuration()->get("monochromeLighting").toBool());
   m_lightingCalculator.setParameters(assets->json("/lighting.config:lighting"));
+  // Tiled colored lighting can differ slightly from untiled lighting at tile
+  // edges, so it is opt in.  A tile count of 0 picks one based on the number
+  // of processors.
+  unsigned lightingTiles = Root::singleton().configuration()->get("lightingTiles").optUInt().value(1);
+  if (lightingTiles == 0)
+    lightingTiles = clamp(Thread::numberOfProcessors() / 2, 1u, 4u);
+  {
+    MutexLocker lightingLocker(m_lightingMutex);
+    m_lightingCalculator.setTiles(lightingTiles);
+  }
   m_lightIntensityCalculator.setParameters(assets->json("/lighting.config:intensity"));
 
   m_inWorld = true;
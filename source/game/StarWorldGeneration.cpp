@@ -647,9 +647,25 @@ WorldGenerator::WorldGenerator(WorldServer* server) : m_worldServer(server) {
   m_microDungeonFactory = make_shared<MicroDungeonFactory>();
 }
 
-void WorldGenerator::generateSectorLevel(WorldStorage* worldStorage, Sector const& sector, SectorGenerationLevel generationLevel) {
+function<SectorPregenerationPtr()> WorldGenerator::pregenerateSector(WorldStorage* worldStorage, Sector const& sector) {
+  // Only the world template is used, which can be read from any thread.
+  WorldTemplateConstPtr planet = m_worldServer->worldTemplate();
+  RectI sectorRegion = worldStorage->tileArray()->sectorRegion(sector);
+  return [planet, sectorRegion]() -> SectorPregenerationPtr {
+    auto pregeneration = make_shared<TilePregeneration>();
+    pregeneration->blockInfoRevision = planet->blockInfoRevision();
+    pregeneration->blockInfo.reserve(sectorRegion.width() * sectorRegion.height());
+    for (int x = sectorRegion.xMin(); x < sectorRegion.xMax(); ++x) {
+      for (int y = sectorRegion.yMin(); y < sectorRegion.yMax(); ++y)
+        pregeneration->blockInfo.append(planet->blockInfo(x, y));
+    }
+    return pregeneration;
+  };
+}
+
+void WorldGenerator::generateSectorLevel(WorldStorage* worldStorage, Sector const& sector, SectorGenerationLevel generationLevel, SectorPregenerationPtr const& pregeneration) {
   if (generationLevel == SectorGenerationLevel::BaseTiles) {
-    prepareTiles(worldStorage, sector);
+    prepareTiles(worldStorage, sector, pregeneration);
   } else if (generationLevel == SectorGenerationLevel::MicroDungeons) {
     if (!worldStorage->floatingDungeonWorld())
       generateMicroDungeons(worldStorage, sector);
@@ -756,21 +772,29 @@ void WorldGenerator::replaceBiomeBlocks(ServerTile* tile) {
   }
 }
 
-void WorldGenerator::prepareTiles(WorldStorage* worldStorage, ServerTileSectorArray::Sector const& sector) {
+void WorldGenerator::prepareTiles(WorldStorage* worldStorage, ServerTileSectorArray::Sector const& sector, SectorPregenerationPtr const& pregeneration) {
   auto materialDatabase = Root::singleton().materialDatabase();
   auto planet = m_worldServer->worldTemplate();
+
+  // Block info calculated ahead of time is stale if the template has changed
+  // since, for instance by a dungeon marking its terrain.
+  auto tilePregeneration = as<TilePregeneration>(pregeneration);
+  if (tilePregeneration && tilePregeneration->blockInfoRevision != planet->blockInfoRevision())
+    tilePregeneration.reset();
+
   // Generate sector.
   auto tileArray = worldStorage->tileArray();
   RectI sectorRegion = tileArray->sectorRegion(sector);
+  size_t blockIndex = 0;
   for (int x = sectorRegion.xMin(); x < sectorRegion.xMax(); ++x) {
-    for (int y = sectorRegion.yMin(); y < sectorRegion.yMax(); ++y) {
+    for (int y = sectorRegion.yMin(); y < sectorRegion.yMax(); ++y, ++blockIndex) {
       Vec2I pos(x, y);
       ServerTile* tile = tileArray->modifyTile(pos);
       starAssert(tile);
       if (!tile)
         continue;
 
-      auto blockInfo = planet->blockInfo(pos[0], pos[1]);
+      auto blockInfo = tilePregeneration ? tilePregeneration->blockInfo[blockIndex] : planet->blockInfo(pos[0], pos[1]);
 
       tile->blockBiomeIndex = blockInfo.blockBiomeIndex;
       tile->environmentBiomeIndex = blockInfo.environmentBiomeIndex;
@@ -8,6 +8,7 @@
 #include "StarMicroDungeon.hpp"
 #include "StarCellularLiquid.hpp"
 #include "StarBiomePlacement.hpp"
+#include "StarWorldTemplate.hpp"
 
 namespace Star {
 
@@ -117,7 +118,8 @@ class WorldGenerator : public WorldGeneratorFacade {
 public:
   WorldGenerator(WorldServer* server);
 
-  void generateSectorLevel(WorldStorage* worldStorage, Sector const& sector, SectorGenerationLevel generationLevel) override;
+  function<SectorPregenerationPtr()> pregenerateSector(WorldStorage* worldStorage, Sector const& sector) override;
+  void generateSectorLevel(WorldStorage* worldStorage, Sector const& sector, SectorGenerationLevel generationLevel, SectorPregenerationPtr const& pregeneration) override;
   void sectorLoadLevelChanged(WorldStorage* worldStorage, Sector const& sector, SectorLoadLevel loadLevel) override;
   void terraformSector(WorldStorage* worldStorage, Sector const& sector) override;
   void initEntity(WorldStorage* worldStorage, EntityId entityId, EntityPtr const& entity) override;
@@ -136,7 +138,14 @@ private:
     bool fulfilled;
   };
 
-  void prepareTiles(WorldStorage* worldStorage, Sector const& sector);
+  // Block info for every tile of a sector, calculated ahead of time from the
+  // world template.
+  struct TilePregeneration : SectorPregeneration {
+    uint64_t blockInfoRevision;
+    List<WorldTemplate::BlockInfo> blockInfo;
+  };
+
+  void prepareTiles(WorldStorage* worldStorage, Sector const& sector, SectorPregenerationPtr const& pregeneration);
   void generateMicroDungeons(WorldStorage* worldStorage, Sector const& sector);
   void generateCaveLiquid(WorldStorage* worldStorage, Sector const& sector);
   void prepareSector(WorldStorage* worldStorage, Sector const& sector);
@@ -93,6 +93,8 @@ public:
 
   BiomeConstPtr const& getBiome(BiomeIndex index) const;
   TerrainSelectorConstPtr const& getTerrainSelector(TerrainSelectorIndex index) const;
+  // Selector with TerrainSelectorIndex i is at position i - 1.
+  List<TerrainSelectorConstPtr> const& terrainSelectors() const;
 
   // Will return region weighting in order of greatest to least weighting.
   List<RegionWeighting> getWeighting(int x, int y) const;
@@ -176,6 +178,10 @@ inline TerrainSelectorConstPtr const& WorldLayout::getTerrainSelector(TerrainSel
   return m_terrainSelectors[index - 1];
 }
 
+inline List<TerrainSelectorConstPtr> const& WorldLayout::terrainSelectors() const {
+  return m_terrainSelectors;
+}
+
 }
 
 #endif
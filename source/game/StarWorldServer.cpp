@@ -24,9 +24,16 @@
 #include "StarWarpTargetEntity.hpp"
 #include "StarUniverseSettings.hpp"
 #include "StarUniverseServerLuaBindings.hpp"
+#include "StarWorkerPool.hpp"
 
 namespace Star {
 
+// Set on a thread while it runs parallel entity update jobs for a WorldServer.
+// World mutations made by entities on that thread are queued here instead of
+// being applied, and are applied on the world thread in island order once all
+// jobs are complete.
+static thread_local List<WorldAction>* s_deferredWorldActions = nullptr;
+
 EnumMap<WorldServerFidelity> const WorldServerFidelityNames{
   {WorldServerFidelity::Minimum, "minimum"},
   {WorldServerFidelity::Low, "low"},
@@ -34,6 +41,25 @@ EnumMap<WorldServerFidelity> const WorldServerFidelityNames{
   {WorldServerFidelity::High, "high"}
 };
 
+EnumMap<WorldServerTickPhase> const WorldServerTickPhaseNames{
+  {WorldServerTickPhase::Packets, "packets"},
+  {WorldServerTickPhase::Entities, "entities"},
+  {WorldServerTickPhase::Lua, "lua"},
+  {WorldServerTickPhase::Damage, "damage"},
+  {WorldServerTickPhase::Liquid, "liquid"},
+  {WorldServerTickPhase::Storage, "storage"},
+  {WorldServerTickPhase::Other, "other"}
+};
+
+WorldServerTickTimes::WorldServerTickTimes() : updates(0), phases(Array<double, WorldServerTickPhaseCount>::filled(0.0)) {}
+
+double WorldServerTickTimes::total() const {
+  double total = 0.0;
+  for (auto time : phases)
+    total += time;
+  return total;
+}
+
 WorldServer::WorldServer(WorldTemplatePtr const& worldTemplate, IODevicePtr storage) {
   m_worldTemplate = worldTemplate;
   m_worldStorage = make_shared<WorldStorage>(m_worldTemplate->size(), storage, make_shared<WorldGenerator>(this));
@@ -120,6 +146,7 @@ void WorldServer::initLua(UniverseServer* universe) {
     scriptComponent->addCallbacks("universe", LuaBindings::makeUniverseServerCallbacks(universe));
 
     m_scriptContexts.set(p.first, scriptComponent);
+    m_scriptContextProfileSections.set(p.first, m_tickProfiler.section(strf("lua:{}", p.first)));
     scriptComponent->init(this);
   }
 }
@@ -344,6 +371,14 @@ List<EntityId> WorldServer::players() const {
 }
 
 void WorldServer::handleIncomingPackets(ConnectionId clientId, List<PacketPtr> const& packets) {
+  double start = Time::monotonicTime();
+  auto addTime = finally([this, start]() {
+      double end = Time::monotonicTime();
+      m_tickTimes.phases[(size_t)WorldServerTickPhase::Packets] += end - start;
+      if (m_tickProfiler.enabled())
+        m_tickProfiler.record(m_phaseProfileSections[(size_t)WorldServerTickPhase::Packets], start, end);
+    });
+
   auto const& clientInfo = m_clientInfo.get(clientId);
   auto& root = Root::singleton();
   auto entityFactory = root.entityFactory();
@@ -593,6 +628,14 @@ List<PacketPtr> WorldServer::getOutgoingPackets(ConnectionId clientId) {
   return std::move(clientInfo->outgoingPackets);
 }
 
+WorldServerTickTimes const& WorldServer::tickTimes() const {
+  return m_tickTimes;
+}
+
+TickProfiler& WorldServer::tickProfiler() {
+  return m_tickProfiler;
+}
+
 Maybe<Json> WorldServer::receiveMessage(ConnectionId fromConnection, String const& message, JsonArray const& args) {
   Maybe<Json> result;
   for (auto& p : m_scriptContexts) {
@@ -626,6 +669,18 @@ void WorldServer::setExpiryTime(float expiryTime) {
 
 void WorldServer::update(float dt) {
   ++m_currentStep;
+  ++m_tickTimes.updates;
+  m_tickProfiler.beginTick();
+
+  // Accounts the time since the previous phase ended to the given phase.
+  double phaseStart = Time::monotonicTime();
+  auto endPhase = [this, &phaseStart](WorldServerTickPhase phase) {
+      double now = Time::monotonicTime();
+      m_tickTimes.phases[(size_t)phase] += now - phaseStart;
+      if (m_tickProfiler.enabled())
+        m_tickProfiler.record(m_phaseProfileSections[(size_t)phase], phaseStart, now);
+      phaseStart = now;
+    };
 
   constexpr double conversionFactor = 60.0;
   for (auto const& pair : m_clientInfo)
@@ -650,8 +705,11 @@ void WorldServer::update(float dt) {
     m_needsGlobalBreakCheck = false;
 
   List<EntityId> toRemove;
-  m_entityMap->updateAllEntities([&](EntityPtr const& entity) {
-      entity->update(dt, m_currentStep);
+  auto updateEntity = [&](EntityPtr const& entity) {
+      {
+        TickProfiler::Scope profile(m_tickProfiler, m_entityProfileSections[(size_t)entity->entityType()], entity->entityId());
+        entity->update(dt, m_currentStep);
+      }
 
       if (auto tileEntity = as<TileEntity>(entity)) {
         // Only do break checks on objects if all sectors the object touches
@@ -662,16 +720,51 @@ void WorldServer::update(float dt) {
         updateTileEntityTiles(tileEntity);
       }
 
-      if (entity->shouldDestroy() && entity->entityMode() == EntityMode::Master)
-        toRemove.append(entity->entityId());
-    }, [](EntityPtr const& a, EntityPtr const& b) {
+      if (entity->shouldDestroy() && entity->entityMode() == EntityMode::Master) {
+        if (s_deferredWorldActions)
+          s_deferredWorldActions->append([&toRemove, entityId = entity->entityId()](World*) { toRemove.append(entityId); });
+        else
+          toRemove.append(entity->entityId());
+      }
+    };
+  auto entityUpdateOrder = [](EntityPtr const& a, EntityPtr const& b) {
       return a->entityType() < b->entityType();
-    });
+    };
+
+  endPhase(WorldServerTickPhase::Other);
+
+  if (m_entityUpdatePool) {
+    EntityMap::ParallelUpdate parallelUpdate;
+    parallelUpdate.filter = [](EntityPtr const& entity) { return entity->parallelUpdateSafe(); };
+    parallelUpdate.islandPadding = m_entityUpdateIslandPadding;
+    parallelUpdate.prepareRegions = [this](List<RectF> const& regions) {
+        for (auto const& region : regions)
+          freshenCollision(RectI::integral(region));
+      };
+    parallelUpdate.runJobs = [this](List<function<void()>> const& jobs) { runParallelEntityJobs(jobs); };
+    parallelUpdate.checkIslands = m_checkEntityUpdateIslands;
+
+    auto crossIslandAccesses = m_entityMap->updateAllEntities(updateEntity, entityUpdateOrder, parallelUpdate);
+    for (auto const& access : crossIslandAccesses) {
+      Logger::warn("WorldServer: Parallel update of entity {} on world {} accessed entity {} in a different island, result may differ from a serial update",
+          access.accessingEntity, m_worldId, access.accessedEntity);
+    }
+    if (m_checkEntityUpdateIslands)
+      LogMap::set(strf("server_{}_cross_island_accesses", m_worldId), crossIslandAccesses.size());
+  } else {
+    m_entityMap->updateAllEntities(updateEntity, entityUpdateOrder);
+  }
+  endPhase(WorldServerTickPhase::Entities);
 
-  for (auto& pair : m_scriptContexts)
+  for (auto& pair : m_scriptContexts) {
+    TickProfiler::Scope profile(m_tickProfiler, m_scriptContextProfileSections.get(pair.first));
     pair.second->update(pair.second->updateDt(dt));
+  }
+  endPhase(WorldServerTickPhase::Lua);
 
   updateDamage(dt);
+  endPhase(WorldServerTickPhase::Damage);
+
   if (shouldRunThisStep("wiringUpdate"))
     m_wireProcessor->process();
 
@@ -690,11 +783,16 @@ void WorldServer::update(float dt) {
   for (auto projectile : m_weather.pullNewProjectiles())
     addEntity(std::move(projectile));
 
+  endPhase(WorldServerTickPhase::Other);
+
   if (shouldRunThisStep("liquidUpdate")) {
-    m_liquidEngine->setProcessingLimit(m_fidelityConfig.optUInt("liquidEngineBackgroundProcessingLimit"));
+    m_liquidEngine->setProcessingLimit(m_fidelityConfig.optUInt("liquidEngineBackgroundProcessingLimit").apply([this](uint64_t limit) {
+        return (unsigned)(limit * m_liquidProcessingLimitMultiplier);
+      }));
     m_liquidEngine->setNoProcessingLimitRegions(clientMonitoringRegions);
     m_liquidEngine->update();
   }
+  endPhase(WorldServerTickPhase::Liquid);
 
   if (shouldRunThisStep("fallingBlocksUpdate"))
     m_fallingBlocksAgent->update();
@@ -702,6 +800,8 @@ void WorldServer::update(float dt) {
   if (auto delta = shouldRunThisStep("blockDamageUpdate"))
     updateDamagedBlocks(*delta * GlobalTimestep);
 
+  endPhase(WorldServerTickPhase::Other);
+
   if (auto delta = shouldRunThisStep("worldStorageTick"))
     m_worldStorage->tick(*delta * GlobalTimestep);
 
@@ -724,15 +824,36 @@ void WorldServer::update(float dt) {
   for (EntityId entityId : toRemove)
     removeEntity(entityId, true);
 
+  // All regions are signalled before any packets are queued, so that no
+  // sector is loaded or generated while sector packing jobs may be reading
+  // the tile array.
   for (auto const& pair : m_clientInfo) {
     for (auto const& monitoredRegion : pair.second->monitoringRegions(m_entityMap))
       signalRegion(monitoredRegion.padded(jsonToVec2I(m_serverConfig.get("playerActiveRegionPad"))));
-    queueUpdatePackets(pair.first);
   }
+  endPhase(WorldServerTickPhase::Storage);
+
+  List<WorkerPoolHandle> sectorPackingJobs;
+  try {
+    for (auto const& pair : m_clientInfo)
+      queueUpdatePackets(pair.first, sectorPackingJobs);
+  } catch (...) {
+    // The jobs write into packets that may still be referenced, so they must
+    // not outlive a failed update.
+    for (auto const& job : sectorPackingJobs) {
+      try {
+        job.finish();
+      } catch (...) {}
+    }
+    throw;
+  }
+  for (auto const& job : sectorPackingJobs)
+    job.finish();
   m_netStateCache.clear();
 
   for (auto& pair : m_clientInfo)
     pair.second->pendingForward = false;
+  endPhase(WorldServerTickPhase::Packets);
 
   m_expiryTimer.tick(dt);
 
@@ -740,6 +861,23 @@ void WorldServer::update(float dt) {
   LogMap::set(strf("server_{}_time", m_worldId), strf("age = {:4.2f}, day = {:4.2f}/{:4.2f}s", epochTime(), timeOfDay(), dayLength()));
   LogMap::set(strf("server_{}_active_liquid", m_worldId), m_liquidEngine->activeCells());
   LogMap::set(strf("server_{}_lua_mem", m_worldId), m_luaRoot->luaMemoryUsage());
+
+  auto storageStatistics = m_worldStorage->databaseStatistics();
+  auto hitRate = [](uint64_t hits, uint64_t misses) {
+    return hits + misses == 0 ? 0.0 : 100.0 * hits / (hits + misses);
+  };
+  LogMap::set(strf("server_{}_storage_cache", m_worldId), strf("index {:.1f}%, leaf {:.1f}% hits",
+      hitRate(storageStatistics.indexCacheHits, storageStatistics.indexCacheMisses),
+      hitRate(storageStatistics.leafCacheHits, storageStatistics.leafCacheMisses)));
+  LogMap::set(strf("server_{}_storage_read", m_worldId), strf("{} KiB from device, {} KiB mapped",
+      storageStatistics.deviceBytesRead / 1024, storageStatistics.mappedBytesRead / 1024));
+  for (auto loadLevel : {SectorLoadLevel::Tiles, SectorLoadLevel::Entities}) {
+    auto const& latency = m_worldStorage->sectorLoadLatency(loadLevel);
+    LogMap::set(strf("server_{}_sector_load_{}", m_worldId, loadLevel == SectorLoadLevel::Tiles ? "tiles" : "entities"),
+        strf("p50 {}ms, p99 {}ms over {}", latency.percentile(50), latency.percentile(99), latency.count()));
+  }
+  endPhase(WorldServerTickPhase::Other);
+  m_tickProfiler.endTick();
 }
 
 WorldGeometry WorldServer::geometry() const {
@@ -781,6 +919,11 @@ void WorldServer::addEntity(EntityPtr const& entity, EntityId entityId) {
   if (!entity)
     return;
 
+  if (s_deferredWorldActions) {
+    s_deferredWorldActions->append([entity, entityId](World* world) { world->addEntity(entity, entityId); });
+    return;
+  }
+
   entity->init(this, m_entityMap->reserveEntityId(entityId), EntityMode::Master);
   m_entityMap->addEntity(entity);
 
@@ -830,13 +973,24 @@ CollisionKind WorldServer::tileCollisionKind(Vec2I const& pos) const {
 
 
 void WorldServer::forEachCollisionBlock(RectI const& region, function<void(CollisionBlock const&)> const& iterator) const {
-  const_cast<WorldServer*>(this)->freshenCollision(region);
-  m_tileArray->tileEach(region, [iterator](Vec2I const& pos, ServerTile const& tile) {
+  // Collision is read only while parallel entity updates run, the regions
+  // they update in are freshened before they start.
+  if (!m_parallelEntityUpdateActive)
+    const_cast<WorldServer*>(this)->freshenCollision(region);
+  m_tileArray->tileEach(region, [this, &iterator](Vec2I const& pos, ServerTile const& tile) {
       // FezzedOne: Make sure to use the runtime-calculated collision.
       if (tile.getCollision() == CollisionKind::Null) {
         iterator(CollisionBlock::nullBlock(pos));
+      } else if (tile.collisionCacheDirty) {
+        // A parallel entity reached outside its freshened region, so generate
+        // the blocks for this tile without caching them.
+        starAssert(m_parallelEntityUpdateActive);
+        MutexLocker locker(m_collisionGeneratorMutex);
+        auto blocks = m_collisionGenerator.getBlocks(RectI(pos, pos + Vec2I(1, 1)));
+        locker.unlock();
+        for (auto const& block : blocks)
+          iterator(block);
       } else {
-        starAssert(!tile.collisionCacheDirty);
         for (auto const& block : tile.collisionCache)
           iterator(block);
       }
@@ -1302,6 +1456,12 @@ void WorldServer::init(bool firstTime) {
 
   m_currentStep = 0;
   m_generatingDungeon = false;
+
+  for (size_t i = 0; i < WorldServerTickPhaseCount; ++i)
+    m_phaseProfileSections[i] = m_tickProfiler.section(WorldServerTickPhaseNames.getRight((WorldServerTickPhase)i));
+  m_entityProfileSections.clear();
+  for (size_t i = 0; i <= (size_t)EntityType::Player; ++i)
+    m_entityProfileSections.append(m_tickProfiler.section(strf("entities:{}", EntityTypeNames.getRight((EntityType)i))));
   m_geometry = WorldGeometry(m_worldTemplate->size());
   m_entityMap = m_worldStorage->entityMap();
   m_tileArray = m_worldStorage->tileArray();
@@ -1324,10 +1484,37 @@ void WorldServer::init(bool firstTime) {
 
   m_tileEntityBreakCheckTimer = GameTimer(m_serverConfig.getFloat("tileEntityBreakCheckInterval"));
 
+  auto parallelEntityUpdateConfig = m_serverConfig.get("parallelEntityUpdate", JsonObject());
+  m_parallelEntityUpdateActive = false;
+  m_entityUpdateIslandPadding = parallelEntityUpdateConfig.getFloat("islandPadding", 4.0f);
+  m_checkEntityUpdateIslands = parallelEntityUpdateConfig.getBool("checkIslands", false);
+  m_entityUpdateThreads = max<unsigned>(parallelEntityUpdateConfig.getUInt("threads", 4), 1);
+  if (parallelEntityUpdateConfig.getBool("enabled", false))
+    m_entityUpdatePool = make_shared<WorkerPool>("WorldServerEntityUpdatePool", m_entityUpdateThreads);
+  else
+    m_entityUpdatePool.reset();
+
+  auto packetAssemblyConfig = m_serverConfig.get("pipelinedPacketAssembly", JsonObject());
+  if (packetAssemblyConfig.getBool("enabled", false))
+    m_packetAssemblyPool = make_shared<WorkerPool>("WorldServerPacketAssemblyPool", max<unsigned>(packetAssemblyConfig.getUInt("threads", 2), 1));
+  else
+    m_packetAssemblyPool.reset();
+
   m_liquidEngine = make_shared<LiquidCellEngine<LiquidId>>(liquidsDatabase->liquidEngineParameters(), make_shared<LiquidWorld>(this));
   for (auto liquidSettings : liquidsDatabase->allLiquidSettings())
     m_liquidEngine->setLiquidTickDelta(liquidSettings->id, liquidSettings->tickDelta);
 
+  auto parallelLiquidUpdateConfig = m_serverConfig.get("parallelLiquidUpdate", JsonObject());
+  m_liquidProcessingLimitMultiplier = 1.0f;
+  if (parallelLiquidUpdateConfig.getBool("enabled", false)) {
+    unsigned liquidUpdateThreads = max<unsigned>(parallelLiquidUpdateConfig.getUInt("threads", 4), 1);
+    m_liquidUpdatePool = make_shared<WorkerPool>("WorldServerLiquidUpdatePool", liquidUpdateThreads);
+    m_liquidEngine->setWorkerPool(m_liquidUpdatePool, liquidUpdateThreads);
+    m_liquidProcessingLimitMultiplier = parallelLiquidUpdateConfig.getFloat("processingLimitMultiplier", 4.0f);
+  } else {
+    m_liquidUpdatePool.reset();
+  }
+
   m_fallingBlocksAgent = make_shared<FallingBlocksAgent>(make_shared<FallingBlocksWorld>(this));
 
   setupForceRegions();
@@ -1836,7 +2023,7 @@ List<ItemDescriptor> WorldServer::destroyBlock(TileLayer layer, Vec2I const& pos
   return drops;
 }
 
-void WorldServer::queueUpdatePackets(ConnectionId clientId) {
+void WorldServer::queueUpdatePackets(ConnectionId clientId, List<WorkerPoolHandle>& sectorPackingJobs) {
   auto const& clientInfo = m_clientInfo.get(clientId);
   clientInfo->outgoingPackets.append(make_shared<StepUpdatePacket>(m_currentStep));
 
@@ -1859,10 +2046,19 @@ void WorldServer::queueUpdatePackets(ConnectionId clientId) {
     auto sectorTiles = m_tileArray->sectorRegion(sector);
     tileArrayUpdate->min = sectorTiles.min();
     tileArrayUpdate->array.resize(Vec2S(sectorTiles.width(), sectorTiles.height()));
-    for (int x = sectorTiles.xMin(); x < sectorTiles.xMax(); ++x) {
-      for (int y = sectorTiles.yMin(); y < sectorTiles.yMax(); ++y)
-        writeNetTile({x, y}, tileArrayUpdate->array(x - sectorTiles.xMin(), y - sectorTiles.yMin()));
-    }
+    auto packSector = [this, tileArrayUpdate, sectorTiles]() {
+      for (int x = sectorTiles.xMin(); x < sectorTiles.xMax(); ++x) {
+        for (int y = sectorTiles.yMin(); y < sectorTiles.yMax(); ++y)
+          writeNetTile({x, y}, tileArrayUpdate->array(x - sectorTiles.xMin(), y - sectorTiles.yMin()));
+      }
+    };
+
+    // The packet is queued now to keep packet order, and is filled in by the
+    // pool while the entity updates below are serialized.
+    if (m_packetAssemblyPool)
+      sectorPackingJobs.append(m_packetAssemblyPool->addWork(packSector));
+    else
+      packSector();
 
     clientInfo->outgoingPackets.append(tileArrayUpdate);
     clientInfo->pendingSectors.remove(sector);
@@ -2219,6 +2415,11 @@ Json WorldServer::getProperty(String const& propertyName, Json const& def) const
 }
 
 void WorldServer::setProperty(String const& propertyName, Json const& property) {
+  if (s_deferredWorldActions) {
+    s_deferredWorldActions->append([propertyName, property](World* world) { world->setProperty(propertyName, property); });
+    return;
+  }
+
   // Kae: Properties set to null (nil from Lua) should be erased instead of lingering around
   auto entry = m_worldProperties.find(propertyName);
   bool missing = entry == m_worldProperties.end();
@@ -2235,6 +2436,11 @@ void WorldServer::setProperty(String const& propertyName, Json const& property)
 }
 
 void WorldServer::timer(int stepsDelay, WorldAction worldAction) {
+  if (s_deferredWorldActions) {
+    s_deferredWorldActions->append([stepsDelay, worldAction](World* world) { world->timer(stepsDelay, worldAction); });
+    return;
+  }
+
   m_timers.append({stepsDelay, worldAction});
 }
 
@@ -2280,6 +2486,18 @@ RpcPromise<Vec2F> WorldServer::findUniqueEntity(String const& uniqueId) {
 }
 
 RpcPromise<Json> WorldServer::sendEntityMessage(Variant<EntityId, String> const& entityId, String const& message, JsonArray const& args) {
+  auto pair = RpcPromise<Json>::createPair();
+  if (s_deferredWorldActions) {
+    s_deferredWorldActions->append([this, entityId, message, args, keeper = pair.second](World*) {
+        deliverEntityMessage(entityId, message, args, keeper);
+      });
+  } else {
+    deliverEntityMessage(entityId, message, args, pair.second);
+  }
+  return pair.first;
+}
+
+void WorldServer::deliverEntityMessage(Variant<EntityId, String> const& entityId, String const& message, JsonArray const& args, RpcPromiseKeeper<Json> keeper) {
   EntityPtr entity;
   if (entityId.is<EntityId>())
     entity = m_entityMap->entity(entityId.get<EntityId>());
@@ -2287,19 +2505,75 @@ RpcPromise<Json> WorldServer::sendEntityMessage(Variant<EntityId, String> const&
     entity = m_entityMap->entity(loadUniqueEntity(entityId.get<String>()));
 
   if (!entity) {
-    return RpcPromise<Json>::createFailed("Unknown entity");
+    keeper.fail("Unknown entity");
   } else if (entity->isMaster()) {
     if (auto resp = entity->receiveMessage(ServerConnectionId, message, args))
-      return RpcPromise<Json>::createFulfilled(resp.take());
+      keeper.fulfill(resp.take());
     else
-      return RpcPromise<Json>::createFailed("Message not handled by entity");
+      keeper.fail("Message not handled by entity");
   } else {
-    auto pair = RpcPromise<Json>::createPair();
     auto clientInfo = m_clientInfo.get(connectionForEntity(entity->entityId()));
     Uuid uuid;
-    m_entityMessageResponses[uuid] = {clientInfo->clientId, pair.second};
+    m_entityMessageResponses[uuid] = {clientInfo->clientId, keeper};
     clientInfo->outgoingPackets.append(make_shared<EntityMessagePacket>(entity->entityId(), message, args, uuid));
-    return pair.first;
+  }
+}
+
+void WorldServer::runParallelEntityJobs(List<function<void()>> const& jobs) {
+  if (jobs.empty())
+    return;
+
+  // Hand jobs to the pool in contiguous batches, so that worlds with many
+  // tiny islands do not pay for a pool round trip per island.  Each batch
+  // collects its own deferred actions so they can be applied in job order.
+  size_t batchCount = min<size_t>(jobs.size(), m_entityUpdateThreads * 4);
+  List<List<WorldAction>> deferredActions;
+  deferredActions.resize(batchCount);
+
+  auto runBatch = [&jobs, &deferredActions, batchCount](size_t batch) {
+    s_deferredWorldActions = &deferredActions[batch];
+    try {
+      for (size_t i = batch * jobs.size() / batchCount; i < (batch + 1) * jobs.size() / batchCount; ++i)
+        jobs[i]();
+    } catch (...) {
+      s_deferredWorldActions = nullptr;
+      throw;
+    }
+    s_deferredWorldActions = nullptr;
+  };
+
+  m_parallelEntityUpdateActive = true;
+  std::exception_ptr exception;
+  if (batchCount == 1) {
+    try {
+      runBatch(0);
+    } catch (...) {
+      exception = std::current_exception();
+    }
+  } else {
+    List<WorkerPoolHandle> handles;
+    for (size_t batch = 0; batch < batchCount; ++batch)
+      handles.append(m_entityUpdatePool->addWork([&runBatch, batch]() { runBatch(batch); }));
+
+    // Every job references this stack frame, so all of them must be finished
+    // before an exception can be propagated.
+    for (auto const& handle : handles) {
+      try {
+        handle.finish();
+      } catch (...) {
+        if (!exception)
+          exception = std::current_exception();
+      }
+    }
+  }
+  m_parallelEntityUpdateActive = false;
+
+  if (exception)
+    std::rethrow_exception(exception);
+
+  for (auto& actions : deferredActions) {
+    for (auto& action : actions)
+      action(this);
   }
 }
 
@@ -16,6 +16,7 @@
 #include "StarWorldRenderData.hpp"
 #include "StarWarping.hpp"
 #include "StarRpcThreadPromise.hpp"
+#include "StarTickProfiler.hpp"
 
 namespace Star {
 
@@ -33,6 +34,8 @@ STAR_CLASS(WorldServer);
 STAR_CLASS(TileEntity);
 STAR_CLASS(UniverseSettings);
 STAR_CLASS(UniverseServer);
+STAR_CLASS(WorkerPool);
+class WorkerPoolHandle;
 
 STAR_EXCEPTION(WorldServerException, StarException);
 
@@ -47,6 +50,34 @@ enum class WorldServerFidelity {
 };
 extern EnumMap<WorldServerFidelity> const WorldServerFidelityNames;
 
+// The parts of a WorldServer tick that time is accounted to.  Packets is
+// handling incoming packets and queueing outgoing ones, Lua is the world
+// scripts (entity scripts are part of Entities), Storage is sector loading,
+// generation and unloading, and Other is everything else.
+enum class WorldServerTickPhase : uint8_t {
+  Packets,
+  Entities,
+  Lua,
+  Damage,
+  Liquid,
+  Storage,
+  Other
+};
+extern EnumMap<WorldServerTickPhase> const WorldServerTickPhaseNames;
+
+size_t const WorldServerTickPhaseCount = 7;
+
+// Time spent in each WorldServerTickPhase, in seconds, since the world was
+// created.
+struct WorldServerTickTimes {
+  WorldServerTickTimes();
+
+  double total() const;
+
+  uint64_t updates;
+  Array<double, WorldServerTickPhaseCount> phases;
+};
+
 class WorldServer : public World {
 public:
   typedef LuaMessageHandlingComponent<LuaUpdatableComponent<LuaWorldComponent<LuaBaseComponent>>> ScriptComponent;
@@ -265,6 +296,12 @@ public:
   void setGlobal(Maybe<String> const& jsonPath, Json const& newValue);
   Json getGlobal(Maybe<String> const& jsonPath) const;
 
+  WorldServerTickTimes const& tickTimes() const;
+
+  // Profiles each update by phase, by type of entity updated and by world
+  // script context.  Disabled until enabled through the profiler.
+  TickProfiler& tickProfiler();
+
 private:
   struct ClientInfo {
     ClientInfo(ConnectionId clientId, InterpolationTracker const trackerInit);
@@ -311,8 +348,11 @@ private:
 
   TileModificationList doApplyTileModifications(TileModificationList const& modificationList, bool allowEntityOverlap, bool ignoreTileProtection = false);
 
-  // Queues pending (step based) updates to the given player
-  void queueUpdatePackets(ConnectionId clientId);
+  // Queues pending (step based) updates to the given player.  If packet
+  // assembly is pipelined, tile sector packets are queued empty and filled by
+  // the jobs appended to sectorPackingJobs, which must be finished before the
+  // packets are sent or the tile array is next modified.
+  void queueUpdatePackets(ConnectionId clientId, List<WorkerPoolHandle>& sectorPackingJobs);
   void updateDamage(float dt);
 
   void updateDamagedBlocks(float dt);
@@ -324,6 +364,14 @@ private:
   void queueTileDamageUpdates(Vec2I const& pos, TileLayer layer);
   void writeNetTile(Vec2I const& pos, NetTile& netTile) const;
 
+  // Delivers an entity message immediately, completing the given promise
+  // keeper either now or once a remote client responds.
+  void deliverEntityMessage(Variant<EntityId, String> const& entityId, String const& message, JsonArray const& args, RpcPromiseKeeper<Json> keeper);
+
+  // Runs the island jobs of a parallel entity update on m_entityUpdatePool,
+  // then applies the world actions deferred by them in job order.
+  void runParallelEntityJobs(List<function<void()>> const& jobs);
+
   void dirtyCollision(RectI const& region);
   void freshenCollision(RectI const& region);
 
@@ -367,6 +415,11 @@ private:
 
   WorldGeometry m_geometry;
   uint64_t m_currentStep;
+  WorldServerTickTimes m_tickTimes;
+  TickProfiler m_tickProfiler;
+  Array<TickProfiler::SectionId, WorldServerTickPhaseCount> m_phaseProfileSections;
+  List<TickProfiler::SectionId> m_entityProfileSections;
+  StringMap<TickProfiler::SectionId> m_scriptContextProfileSections;
   mutable CellularLightIntensityCalculator m_lightIntensityCalculator;
   SkyPtr m_sky;
 
@@ -374,6 +427,19 @@ private:
 
   CollisionGenerator m_collisionGenerator;
   List<CollisionBlock> m_workingCollisionBlocks;
+  // Guards the working buffers of m_collisionGenerator while parallel entity
+  // updates generate collision for tiles that were not freshened beforehand.
+  mutable Mutex m_collisionGeneratorMutex;
+
+  // Only set if parallel entity updates are enabled in the configuration.
+  WorkerPoolPtr m_entityUpdatePool;
+  unsigned m_entityUpdateThreads;
+  float m_entityUpdateIslandPadding;
+  bool m_checkEntityUpdateIslands;
+  bool m_parallelEntityUpdateActive;
+
+  // Only set if pipelined packet assembly is enabled in the configuration.
+  WorkerPoolPtr m_packetAssemblyPool;
 
   HashMap<pair<EntityId, uint64_t>, pair<ByteArray, uint64_t>> m_netStateCache;
   OrderedHashMap<ConnectionId, shared_ptr<ClientInfo>> m_clientInfo;
@@ -381,6 +447,9 @@ private:
   GameTimer m_tileEntityBreakCheckTimer;
 
   shared_ptr<LiquidCellEngine<LiquidId>> m_liquidEngine;
+  // Only set if parallel liquid updates are enabled in the configuration.
+  WorkerPoolPtr m_liquidUpdatePool;
+  float m_liquidProcessingLimitMultiplier;
   FallingBlocksAgentPtr m_fallingBlocksAgent;
   Spawner m_spawner;
 
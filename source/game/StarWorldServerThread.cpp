@@ -47,6 +47,10 @@ void WorldServerThread::setPause(shared_ptr<const atomic<bool>> pause) {
   m_pause = pause;
 }
 
+void WorldServerThread::setTickProfiling(shared_ptr<const atomic<bool>> tickProfiling) {
+  m_tickProfiling = tickProfiling;
+}
+
 bool WorldServerThread::serverErrorOccurred() {
   return m_errorOccurred;
 }
@@ -251,6 +255,8 @@ void WorldServerThread::run() {
 
 void WorldServerThread::update(WorldServerFidelity fidelity) {
   RecursiveMutexLocker locker(m_mutex);
+  if (m_tickProfiling)
+    m_worldServer->tickProfiler().setEnabled(*m_tickProfiling);
   auto unerroredClientIds = m_worldServer->clientIds();
   for (auto clientId : unerroredClientIds) {
     RecursiveMutexLocker queueLocker(m_queueMutex);
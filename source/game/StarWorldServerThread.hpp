@@ -31,6 +31,8 @@ public:
   // Signals the WorldServerThread to stop and then joins it
   void stop();
   void setPause(shared_ptr<const atomic<bool>> pause);
+  // Enables the world's tick profiler while the flag is set.
+  void setTickProfiling(shared_ptr<const atomic<bool>> tickProfiling);
 
   // An exception occurred from the actual WorldServer itself and the
   // WorldServerThread has stopped running.
@@ -101,6 +103,7 @@ private:
 
   atomic<bool> m_stop;
   shared_ptr<const atomic<bool>> m_pause;
+  shared_ptr<const atomic<bool>> m_tickProfiling;
   mutable atomic<bool> m_errorOccurred;
   mutable atomic<bool> m_shouldExpire;
 };
@@ -14,6 +14,45 @@
 
 namespace Star {
 
+double SectorLoadLatency::bucketLimit(size_t bucket) {
+  return std::ldexp(1.0, (int)bucket - 4);
+}
+
+SectorLoadLatency::SectorLoadLatency() : buckets(Array<uint64_t, BucketCount>::filled(0)) {}
+
+void SectorLoadLatency::record(double milliseconds) {
+  size_t bucket = 0;
+  while (bucket < BucketCount - 1 && milliseconds > bucketLimit(bucket))
+    ++bucket;
+  ++buckets[bucket];
+}
+
+uint64_t SectorLoadLatency::count() const {
+  uint64_t total = 0;
+  for (auto c : buckets)
+    total += c;
+  return total;
+}
+
+double SectorLoadLatency::percentile(double percentile) const {
+  uint64_t total = count();
+  if (total == 0)
+    return 0.0;
+
+  double threshold = clamp(percentile, 0.0, 100.0) / 100.0 * total;
+  uint64_t seen = 0;
+  for (size_t i = 0; i < BucketCount; ++i) {
+    seen += buckets[i];
+    if (seen > 0 && seen >= threshold)
+      return bucketLimit(i);
+  }
+  return bucketLimit(BucketCount - 1);
+}
+
+function<SectorPregenerationPtr()> WorldGeneratorFacade::pregenerateSector(WorldStorage*, Sector const&) {
+  return {};
+}
+
 /* xStarbound: Automatic world file repacking. Now much less often needed because xStarbound now has OpenStarbound's BTreeDB5 defragmentation. */
 void WorldStorage::repackWorldFile(String const& fileName, String const& fileType) {
   const String repackExtension = ".repack";
@@ -177,6 +216,11 @@ WorldStorage::WorldStorage(WorldChunks const& chunks, WorldGeneratorFacadePtr co
 }
 
 WorldStorage::~WorldStorage() {
+  m_pendingPrefetches.clear();
+  m_prefetchPool.reset();
+  m_pendingPregenerations.clear();
+  m_generationPool.reset();
+
   if (m_db.isOpen()) {
     unloadAll(true);
     m_db.close();
@@ -247,6 +291,7 @@ void WorldStorage::loadSector(Sector sector) {
 
 void WorldStorage::activateSector(Sector sector) {
   try {
+    pregenerateAround(sector);
     generateSectorToLevel(sector, SectorGenerationLevel::Complete);
     setSectorTimeToLive(sector, randomizedSectorTTL());
   } catch (std::exception const& e) {
@@ -266,6 +311,15 @@ void WorldStorage::queueSectorActivation(Sector sector) {
 
   auto p = m_generationQueue.insert(sector, m_generationQueueTimeToLive);
   m_generationQueue.toFront(p.first);
+  if (p.second)
+    pregenerateAround(sector);
+
+  if (m_prefetchPool) {
+    // Generating a sector loads the sectors around it as well.
+    prefetchSector(sector);
+    for (auto const& adjacentSector : adjacentSectors(sector))
+      prefetchSector(adjacentSector);
+  }
 }
 
 void WorldStorage::triggerTerraformSector(Sector sector) {
@@ -367,6 +421,17 @@ void WorldStorage::tick(float dt) {
         return p.second <= 0.0f;
       });
 
+    // Likewise discard background reads of sectors that were never loaded,
+    // and pregenerated sectors that were never generated.
+    eraseWhere(m_pendingPrefetches, [dt](auto& p) {
+        p.second.timeToLive -= dt;
+        return p.second.timeToLive <= 0.0f;
+      });
+    eraseWhere(m_pendingPregenerations, [dt](auto& p) {
+        p.second.timeToLive -= dt;
+        return p.second.timeToLive <= 0.0f;
+      });
+
     // Tick down sector TTL values
     for (auto& p : m_sectorMetadata)
       p.second.timeToLive -= dt;
@@ -422,6 +487,7 @@ void WorldStorage::tick(float dt) {
           if (auto res = m_db.find(entitySectorKey(sector)))
             sectorStore = readEntitySector(*res);
 
+          dropPrefetch(sector);
           UniqueIndexStore storedUniques;
           for (auto const& entity : zombiesToStore) {
             m_entityMap->removeEntity(entity->entityId());
@@ -492,6 +558,16 @@ void WorldStorage::sync() {
   }
 }
 
+BTreeDatabase::Statistics WorldStorage::databaseStatistics() const {
+  return m_db.statistics();
+}
+
+SectorLoadLatency const& WorldStorage::sectorLoadLatency(SectorLoadLevel loadLevel) const {
+  if (loadLevel == SectorLoadLevel::None)
+    throw WorldStorageException("No load latency is recorded for SectorLoadLevel::None");
+  return m_loadLatency[(uint8_t)loadLevel - 1];
+}
+
 WorldChunks WorldStorage::readChunks() {
   try {
     for (auto const& pair : m_sectorMetadata)
@@ -685,6 +761,20 @@ WorldStorage::WorldStorage() {
   auto storageConfig = Root::singleton().assets()->json("/worldstorage.config");
   m_sectorTimeToLive = jsonToVec2F(storageConfig.get("sectorTimeToLive"));
   m_generationQueueTimeToLive = storageConfig.getFloat("generationQueueTimeToLive");
+
+  m_db.setMemoryMapped(storageConfig.getBool("memoryMappedWorldFiles", false));
+  m_db.setLeafCacheSize(storageConfig.getUInt("worldFileLeafCacheSize", 0));
+  m_db.setBackgroundCommit(storageConfig.getBool("backgroundWorldFileCommit", false));
+
+  auto asyncConfig = storageConfig.get("asyncSectorLoading", JsonObject());
+  m_maxPendingPrefetches = asyncConfig.getUInt("maxPending", 64);
+  if (asyncConfig.getBool("enabled", false))
+    m_prefetchPool = make_shared<WorkerPool>("WorldStorage::prefetch", asyncConfig.getUInt("threads", 2));
+
+  auto generationConfig = storageConfig.get("parallelSectorGeneration", JsonObject());
+  m_maxPendingPregenerations = generationConfig.getUInt("maxPending", 256);
+  if (generationConfig.getBool("enabled", false))
+    m_generationPool = make_shared<WorkerPool>("WorldStorage::generation", generationConfig.getUInt("threads", 2));
 }
 
 bool WorldStorage::belongsInSector(Sector const& sector, Vec2F const& position) const {
@@ -730,7 +820,10 @@ pair<bool, size_t> WorldStorage::generateSectorToLevel(Sector const& sector, Sec
       }
     }
 
-    m_generatorFacade->generateSectorLevel(this, sector, currentGeneration);
+    SectorPregenerationPtr pregeneration;
+    if (currentGeneration == SectorGenerationLevel::BaseTiles)
+      pregeneration = takePregeneration(sector);
+    m_generatorFacade->generateSectorLevel(this, sector, currentGeneration, pregeneration);
     metadata.generationLevel = currentGeneration;
 
     ++totalGeneratedLevels;
@@ -762,26 +855,38 @@ void WorldStorage::loadSectorToLevel(Sector const& sector, SectorLoadLevel targe
         loadSectorToLevel(adjacentSector, stepDownLoad);
     }
 
+    double loadStart = Time::monotonicTime();
     if (currentLoad == SectorLoadLevel::Tiles) {
-      if (auto res = m_db.find(tileSectorKey(sector))) {
-        TileSectorStore sectorStore = readTileSector(*res);
+      Maybe<TileSectorStore> sectorStore;
+      if (auto prefetch = waitPrefetch(sector))
+        sectorStore = std::move(prefetch->tileStore);
+      else if (auto res = m_db.find(tileSectorKey(sector)))
+        sectorStore = readTileSector(*res);
 
-        m_tileArray->loadSector(sector, std::move(sectorStore.tiles));
+      if (sectorStore) {
+        m_tileArray->loadSector(sector, std::move(sectorStore->tiles));
 
-        metadata.generationLevel = sectorStore.generationLevel;
+        metadata.generationLevel = sectorStore->generationLevel;
       } else {
         if (!m_tileArray->sectorLoaded(sector))
           m_tileArray->loadDefaultSector(sector);
       }
 
       metadata.loadLevel = currentLoad;
+      m_loadLatency[i - 1].record((Time::monotonicTime() - loadStart) * 1000.0);
       m_generatorFacade->sectorLoadLevelChanged(this, sector, currentLoad);
 
     } else if (currentLoad == SectorLoadLevel::Entities) {
+      Maybe<EntitySectorStore> sectorStore;
+      if (auto prefetch = waitPrefetch(sector)) {
+        sectorStore = std::move(prefetch->entityStore);
+        dropPrefetch(sector);
+      } else if (auto res = m_db.find(entitySectorKey(sector)))
+        sectorStore = readEntitySector(*res);
+
       List<EntityPtr> addedEntities;
-      if (auto res = m_db.find(entitySectorKey(sector))) {
-        EntitySectorStore sectorStore = readEntitySector(*res);
-        for (auto const& entityStore : sectorStore) {
+      if (sectorStore) {
+        for (auto const& entityStore : *sectorStore) {
           try {
             addedEntities.append(entityFactory->loadVersionedEntity(entityStore));
           } catch (std::exception const& e) {
@@ -803,6 +908,7 @@ void WorldStorage::loadSectorToLevel(Sector const& sector, SectorLoadLevel targe
       updateSectorUniques(sector, readUniques);
 
       metadata.loadLevel = currentLoad;
+      m_loadLatency[i - 1].record((Time::monotonicTime() - loadStart) * 1000.0);
       m_generatorFacade->sectorLoadLevelChanged(this, sector, currentLoad);
     }
   }
@@ -872,6 +978,7 @@ void WorldStorage::unloadSectorToLevel(Sector const& sector, SectorLoadLevel tar
         sectorStore.append(entityFactory->storeVersionedEntity(entity));
       }
     }
+    dropPrefetch(sector);
     m_db.insert(entitySectorKey(sector), writeEntitySector(sectorStore));
     if (metadata.loadLevel < SectorLoadLevel::Entities)
       mergeSectorUniques(sector, storedUniques);
@@ -888,6 +995,7 @@ void WorldStorage::unloadSectorToLevel(Sector const& sector, SectorLoadLevel tar
     TileSectorStore sectorStore;
     sectorStore.tiles = m_tileArray->unloadSector(sector);
     sectorStore.generationLevel = metadata.generationLevel;
+    dropPrefetch(sector);
     m_db.insert(tileSectorKey(sector), writeTileSector(sectorStore));
     m_sectorMetadata.remove(sector);
     m_generatorFacade->sectorLoadLevelChanged(this, sector, SectorLoadLevel::None);
@@ -919,6 +1027,7 @@ void WorldStorage::syncSector(Sector const& sector) {
         sectorStore.append(entityFactory->storeVersionedEntity(entity));
       }
     }
+    dropPrefetch(sector);
     m_db.insert(entitySectorKey(sector), writeEntitySector(sectorStore));
     updateSectorUniques(sector, storedUniques);
   }
@@ -927,10 +1036,83 @@ void WorldStorage::syncSector(Sector const& sector) {
     TileSectorStore sectorStore;
     sectorStore.tiles = m_tileArray->copySector(sector);
     sectorStore.generationLevel = metadata.generationLevel;
+    dropPrefetch(sector);
     m_db.insert(tileSectorKey(sector), writeTileSector(sectorStore));
   }
 }
 
+void WorldStorage::prefetchSector(Sector const& sector) {
+  if (!m_prefetchPool || m_pendingPrefetches.size() >= m_maxPendingPrefetches)
+    return;
+
+  if (m_sectorMetadata.value(sector).loadLevel >= SectorLoadLevel::Loaded)
+    return;
+
+  if (auto pending = m_pendingPrefetches.ptr(sector)) {
+    pending->timeToLive = m_generationQueueTimeToLive;
+    return;
+  }
+
+  // Only the database and the read functions are used here, both of which are
+  // safe to use from any thread.  Entities themselves are still constructed on
+  // the world thread.
+  auto prefetch = m_prefetchPool->addProducer<SectorPrefetch>([this, sector]() {
+      SectorPrefetch prefetch;
+      if (auto res = m_db.find(tileSectorKey(sector)))
+        prefetch.tileStore = readTileSector(*res);
+      if (auto res = m_db.find(entitySectorKey(sector)))
+        prefetch.entityStore = readEntitySector(*res);
+      return prefetch;
+    });
+  m_pendingPrefetches.add(sector, PendingPrefetch{std::move(prefetch), m_generationQueueTimeToLive});
+}
+
+auto WorldStorage::waitPrefetch(Sector const& sector) -> SectorPrefetch* {
+  if (auto pending = m_pendingPrefetches.ptr(sector))
+    return &pending->prefetch.get();
+  return nullptr;
+}
+
+void WorldStorage::dropPrefetch(Sector const& sector) {
+  m_pendingPrefetches.remove(sector);
+}
+
+void WorldStorage::pregenerateAround(Sector const& sector) {
+  if (!m_generationPool || !m_tileArray->sectorValid(sector))
+    return;
+
+  // Each generation level above BaseTiles needs the level below it in the
+  // adjacent sectors, so every sector within that many sectors of the given
+  // one may need its base tiles.
+  int radius = (uint8_t)SectorGenerationLevel::Complete - (uint8_t)SectorGenerationLevel::BaseTiles;
+  RectI region = m_tileArray->sectorRegion(sector).padded(radius * WorldSectorSize);
+  for (auto const& s : m_tileArray->validSectorsFor(region)) {
+    if (m_pendingPregenerations.size() >= m_maxPendingPregenerations)
+      return;
+
+    if (auto pending = m_pendingPregenerations.ptr(s)) {
+      pending->timeToLive = m_generationQueueTimeToLive;
+      continue;
+    }
+
+    if (auto metadata = m_sectorMetadata.ptr(s)) {
+      if (metadata->generationLevel != SectorGenerationLevel::None)
+        continue;
+    } else if (m_db.contains(tileSectorKey(s))) {
+      continue;
+    }
+
+    if (auto job = m_generatorFacade->pregenerateSector(this, s))
+      m_pendingPregenerations.add(s, PendingPregeneration{m_generationPool->addProducer<SectorPregenerationPtr>(std::move(job)), m_generationQueueTimeToLive});
+  }
+}
+
+SectorPregenerationPtr WorldStorage::takePregeneration(Sector const& sector) {
+  if (auto pending = m_pendingPregenerations.maybeTake(sector))
+    return pending->pregeneration.get();
+  return {};
+}
+
 List<WorldStorage::Sector> WorldStorage::adjacentSectors(Sector const& sector) const {
   auto tiles = m_tileArray->sectorRegion(sector);
   return m_tileArray->validSectorsFor(tiles.padded(WorldSectorSize));
@@ -8,6 +8,7 @@
 #include "StarWorldTiles.hpp"
 #include "StarRpcPromise.hpp"
 #include "StarBiomePlacement.hpp"
+#include "StarWorkerPool.hpp"
 
 namespace Star {
 
@@ -15,6 +16,7 @@ STAR_EXCEPTION(WorldStorageException, StarException);
 
 STAR_CLASS(EntityMap);
 STAR_STRUCT(WorldGeneratorFacade);
+STAR_STRUCT(SectorPregeneration);
 STAR_CLASS(WorldStorage);
 
 typedef HashMap<ByteArray, Maybe<ByteArray>> WorldChunks;
@@ -39,14 +41,29 @@ enum class SectorGenerationLevel : uint8_t {
   Terraform = 5
 };
 
+// The part of a sector's generation that only depends on the sector itself,
+// calculated ahead of time by the job from
+// WorldGeneratorFacade::pregenerateSector.
+struct SectorPregeneration {
+  virtual ~SectorPregeneration() {}
+};
+
 struct WorldGeneratorFacade {
   typedef ServerTileSectorArray::Sector Sector;
 
   WorldGeneratorFacade() {}
   virtual ~WorldGeneratorFacade() {}
 
+  // May return a job to be run on a worker thread before the given sector is
+  // brought to SectorGenerationLevel::BaseTiles.  The job must not touch the
+  // WorldStorage or any world state, and may still be running after the
+  // facade is destroyed.  The default does no work ahead of time.
+  virtual function<SectorPregenerationPtr()> pregenerateSector(WorldStorage* storage, Sector const& sector);
+
   // Should bring a given sector from generationLevel - 1 to generationLevel.
-  virtual void generateSectorLevel(WorldStorage* storage, Sector const& sector, SectorGenerationLevel generationLevel) = 0;
+  // If the sector was pregenerated, the result of the job is given along with
+  // SectorGenerationLevel::BaseTiles, otherwise pregeneration is null.
+  virtual void generateSectorLevel(WorldStorage* storage, Sector const& sector, SectorGenerationLevel generationLevel, SectorPregenerationPtr const& pregeneration) = 0;
 
   virtual void sectorLoadLevelChanged(WorldStorage* storage, Sector const& sector, SectorLoadLevel loadLevel) = 0;
 
@@ -74,6 +91,26 @@ struct WorldGeneratorFacade {
   virtual RpcPromise<Vec2I> enqueuePlacement(List<BiomeItemDistribution> placements, Maybe<DungeonId> id) = 0;
 };
 
+// Histogram of the time taken by sector load level transitions, in buckets
+// whose upper bounds double starting from 1/16th of a millisecond.  The last
+// bucket holds everything slower than the bucket before it.
+struct SectorLoadLatency {
+  static size_t const BucketCount = 16;
+
+  static double bucketLimit(size_t bucket);
+
+  SectorLoadLatency();
+
+  void record(double milliseconds);
+
+  uint64_t count() const;
+  // Returns the upper bound of the bucket containing the given percentile (in
+  // the range [0, 100]) of all recorded latencies, or 0 if none are recorded.
+  double percentile(double percentile) const;
+
+  Array<uint64_t, BucketCount> buckets;
+};
+
 // Handles paging entity and tile data in / out of disk backed storage for
 // WorldServer and triggers initial generation.  Ties tile sectors to entity
 // sectors, and allows for multiple stage generation of those sectors.  Sector
@@ -85,6 +122,16 @@ struct WorldGeneratorFacade {
 // indeterminate world state cause the underlying database to be rolled back
 // and then immediately closed.  The underlying database committed only when
 // destructed without error, or a manual call to sync().
+//
+// If asynchronous sector loading is enabled in worldstorage.config, sectors
+// queued for activation are read, decompressed and deserialized on worker
+// threads ahead of time, so that loading them only has to apply the result.
+//
+// Likewise if parallel sector generation is enabled, the part of generating a
+// sector that does not depend on its neighbors is run on worker threads for
+// every sector that generating a queued or activated sector will need, and
+// only the generation levels that depend on neighboring sectors run on the
+// world thread.
 class WorldStorage {
 public:
   typedef ServerTileSectorArray::Sector Sector;
@@ -178,6 +225,13 @@ public:
   // into memory.
   WorldChunks readChunks();
 
+  // Cache and read counters of the underlying world database.
+  BTreeDatabase::Statistics databaseStatistics() const;
+
+  // Latency of bringing sectors up to the given load level from the level
+  // below it, including any wait for a background read of the sector.
+  SectorLoadLatency const& sectorLoadLatency(SectorLoadLevel loadLevel) const;
+
   // if this is set, all terrain generation is assumed to be handled by dungeon placement
   // and steps such as microdungeons, biome objects and grass mods will be skipped
   bool floatingDungeonWorld() const;
@@ -216,6 +270,23 @@ private:
     TileArrayPtr tiles;
   };
 
+  // Sector data read ahead of time on a worker thread.  Either store is
+  // nothing if the sector had no stored tiles or entities.
+  struct SectorPrefetch {
+    Maybe<TileSectorStore> tileStore;
+    Maybe<EntitySectorStore> entityStore;
+  };
+
+  struct PendingPrefetch {
+    WorkerPoolPromise<SectorPrefetch> prefetch;
+    float timeToLive;
+  };
+
+  struct PendingPregeneration {
+    WorkerPoolPromise<SectorPregenerationPtr> pregeneration;
+    float timeToLive;
+  };
+
   struct SectorMetadata {
     SectorMetadata();
 
@@ -273,6 +344,26 @@ private:
   // Sync this sector to disk without unloading it.
   void syncSector(Sector const& sector);
 
+  // Start reading the given sector in the background, if asynchronous loading
+  // is enabled and the sector is not already loaded or being read.
+  void prefetchSector(Sector const& sector);
+  // Waits for the background read of the given sector, if there is one.  The
+  // tile store is consumed when the sector is loaded to SectorLoadLevel::Tiles,
+  // and the read is dropped once the entity store is consumed.  The returned
+  // pointer is only valid until the next prefetch is started or dropped.
+  SectorPrefetch* waitPrefetch(Sector const& sector);
+  // Discards any background read of the given sector.  Must be called before
+  // the tile or entity store of a sector is written.
+  void dropPrefetch(Sector const& sector);
+
+  // Start pregenerating, in the background, every sector that bringing the
+  // given sector to SectorGenerationLevel::Complete will generate, if parallel
+  // sector generation is enabled.
+  void pregenerateAround(Sector const& sector);
+  // Waits for and takes the result of pregenerating the given sector, if it
+  // was pregenerated.
+  SectorPregenerationPtr takePregeneration(Sector const& sector);
+
   // Returns the sectors within WorldSectorSize of the given sector.  This is
   // *not exactly the same* as the surrounding 9 sectors in a square pattern,
   // because first this does not return invalid sectors, and second, If a world
@@ -302,7 +393,19 @@ private:
 
   StableHashMap<Sector, SectorMetadata> m_sectorMetadata;
   OrderedHashMap<Sector, float> m_generationQueue;
+
+  Array<SectorLoadLatency, 2> m_loadLatency;
+  size_t m_maxPendingPrefetches;
+  HashMap<Sector, PendingPrefetch> m_pendingPrefetches;
+
+  size_t m_maxPendingPregenerations;
+  HashMap<Sector, PendingPregeneration> m_pendingPregenerations;
+  WorkerPoolPtr m_generationPool;
+
   BTreeDatabase m_db;
+  // Declared after the database so that it is destroyed, and its threads
+  // stopped, before the database is.
+  WorkerPoolPtr m_prefetchPool;
 };
 
 }
@@ -115,8 +115,11 @@ void WorldTemplate::setWorldParameters(VisitableWorldParametersPtr newParameters
 }
 
 void WorldTemplate::setWorldLayout(WorldLayoutPtr newLayout) {
+  WriteLocker locker(m_blockInfoLock);
   m_layout = take(newLayout);
+  ++m_blockInfoRevision;
   m_blockCache.clear();
+  m_terrainSelectorColumns.clear();
 }
 
 void WorldTemplate::setSkyParameters(SkyParameters newParameters) {
@@ -186,17 +189,23 @@ Maybe<Vec2I> WorldTemplate::findSensiblePlayerStart() const {
 }
 
 void WorldTemplate::addCustomTerrainRegion(PolyF poly) {
+  WriteLocker locker(m_blockInfoLock);
   m_customTerrainRegions.append({poly, poly.boundBox(), true});
+  ++m_blockInfoRevision;
   m_blockCache.clear();
 }
 
 void WorldTemplate::addCustomSpaceRegion(PolyF poly) {
+  WriteLocker locker(m_blockInfoLock);
   m_customTerrainRegions.append({poly, poly.boundBox(), false});
+  ++m_blockInfoRevision;
   m_blockCache.clear();
 }
 
 void WorldTemplate::clearCustomTerrains() {
+  WriteLocker locker(m_blockInfoLock);
   m_customTerrainRegions.clear();
+  ++m_blockInfoRevision;
   m_blockCache.clear();
 }
 
@@ -230,8 +239,11 @@ List<RectI> WorldTemplate::previewExpandBiomeRegion(Vec2I const& position, int n
 
 void WorldTemplate::addBiomeRegion(Vec2I const& position, String const& biomeName, String const& subBlockSelector, int width) {
   if (auto terrestrialParameters = as<TerrestrialWorldParameters>(m_worldParameters)) {
+    WriteLocker locker(m_blockInfoLock);
     m_layout->addBiomeRegion(*terrestrialParameters, m_seed, position, biomeName, subBlockSelector, width);
+    ++m_blockInfoRevision;
     m_blockCache.clear();
+    m_terrainSelectorColumns.clear();
   } else {
     Logger::error("Cannot add biome region to non-terrestrial world!");
     // throw StarException("Cannot add biome region to non-terrestrial world!");
@@ -240,8 +252,11 @@ void WorldTemplate::addBiomeRegion(Vec2I const& position, String const& biomeNam
 
 void WorldTemplate::expandBiomeRegion(Vec2I const& position, int newWidth) {
   if (auto terrestrialParameters = as<TerrestrialWorldParameters>(m_worldParameters)) {
+    WriteLocker locker(m_blockInfoLock);
     m_layout->expandBiomeRegion(position, newWidth);
+    ++m_blockInfoRevision;
     m_blockCache.clear();
+    m_terrainSelectorColumns.clear();
   } else {
     Logger::error("Cannot expand biome region on non-terrestrial world!");
     // throw StarException("Cannot expand biome region on non-terrestrial world!");
@@ -277,6 +292,10 @@ List<WorldTemplate::Dungeon> WorldTemplate::dungeons() const {
   return dungeonList;
 }
 
+uint64_t WorldTemplate::blockInfoRevision() const {
+  return m_blockInfoRevision;
+}
+
 WorldTemplate::BlockInfo WorldTemplate::blockInfo(int x, int y) const {
   return getBlockInfo(m_geometry.xwrap(x), y);
 }
@@ -578,8 +597,10 @@ WorldTemplate::WorldTemplate() {
   m_customTerrainBlendWeight = m_templateConfig.getFloat("customTerrainBlendWeight");
 
   m_blockCache.setMaxSize(m_templateConfig.getInt("blockCacheSize"));
+  m_terrainSelectorColumns.setMaxSize(m_templateConfig.getInt("terrainSelectorColumnCacheSize", 4096));
   m_geometry = Vec2U(2048, 2048);
   m_seed = Random::randu64();
+  m_blockInfoRevision = 0;
 }
 
 void WorldTemplate::determineWorldName() {
@@ -623,8 +644,34 @@ pair<float, float> WorldTemplate::customTerrainWeighting(int x, int y) const {
   return {finalSolidWeight * m_customTerrainBlendWeight, 1.0f - minimumDistance / m_customTerrainBlendSize};
 }
 
+float WorldTemplate::terrainSelectorValue(TerrainSelectorIndex index, int x, int y) const {
+  int columnY = y - pmod<int>(y, WorldSectorSize);
+  Vec3I key(index, x, columnY);
+  {
+    MutexLocker cacheLocker(m_blockCacheMutex);
+    if (auto column = m_terrainSelectorColumns.ptr(key))
+      return (*column)[y - columnY];
+  }
+
+  Array<float, WorldSectorSize> column;
+  m_layout->getTerrainSelector(index)->getColumn(x, columnY, WorldSectorSize, column.ptr());
+  MutexLocker cacheLocker(m_blockCacheMutex);
+  m_terrainSelectorColumns.set(key, column);
+  return column[y - columnY];
+}
+
 WorldTemplate::BlockInfo WorldTemplate::getBlockInfo(uint32_t x, uint32_t y) const {
-  return m_blockCache.get(Vector<uint32_t, 2>(x, y), [this, x, y](Vector<uint32_t, 2>) {
+  ReadLocker locker(m_blockInfoLock);
+  Vector<uint32_t, 2> key(x, y);
+  {
+    MutexLocker cacheLocker(m_blockCacheMutex);
+    if (auto blockInfo = m_blockCache.ptr(key))
+      return *blockInfo;
+  }
+
+  // Calculated without holding the cache mutex, so that other threads can
+  // calculate block info at the same time.
+  BlockInfo computed = [this, x, y]() {
       BlockInfo blockInfo;
 
       if (!m_layout)
@@ -673,8 +720,7 @@ WorldTemplate::BlockInfo WorldTemplate::getBlockInfo(uint32_t x, uint32_t y) con
       // to blend among them.
       for (auto const& weighting : flatWeighting) {
         if (weighting.region->terrainSelectorIndex != NullTerrainSelectorIndex) {
-          auto const& terrainSelector = m_layout->getTerrainSelector(weighting.region->terrainSelectorIndex);
-          float select = terrainSelector->get(weighting.xValue, y) * weighting.weight;
+          float select = terrainSelectorValue(weighting.region->terrainSelectorIndex, weighting.xValue, y) * weighting.weight;
           terrainSelect += select;
         }
       }
@@ -691,15 +737,11 @@ WorldTemplate::BlockInfo WorldTemplate::getBlockInfo(uint32_t x, uint32_t y) con
         blockInfo.terrain = true;
 
         for (auto const& weighting : flatWeighting) {
-          if (weighting.region->foregroundCaveSelectorIndex != NullTerrainSelectorIndex) {
-            auto const& foregroundCaveSelector = m_layout->getTerrainSelector(weighting.region->foregroundCaveSelectorIndex);
-            foregroundCaveSelect += foregroundCaveSelector->get(weighting.xValue, y) * weighting.weight;
-          }
+          if (weighting.region->foregroundCaveSelectorIndex != NullTerrainSelectorIndex)
+            foregroundCaveSelect += terrainSelectorValue(weighting.region->foregroundCaveSelectorIndex, weighting.xValue, y) * weighting.weight;
 
-          if (weighting.region->backgroundCaveSelectorIndex != NullTerrainSelectorIndex) {
-            auto const& backgroundCaveSelector = m_layout->getTerrainSelector(weighting.region->backgroundCaveSelectorIndex);
-            backgroundCaveSelect += backgroundCaveSelector->get(weighting.xValue, y) * weighting.weight;
-          }
+          if (weighting.region->backgroundCaveSelectorIndex != NullTerrainSelectorIndex)
+            backgroundCaveSelect += terrainSelectorValue(weighting.region->backgroundCaveSelectorIndex, weighting.xValue, y) * weighting.weight;
         }
 
         auto surfaceCaveAttenuationDist = m_templateConfig.getFloat("surfaceCaveAttenuationDist", 0);
@@ -778,7 +820,11 @@ WorldTemplate::BlockInfo WorldTemplate::getBlockInfo(uint32_t x, uint32_t y) con
       }
 
       return blockInfo;
-    });
+    }();
+
+  MutexLocker cacheLocker(m_blockCacheMutex);
+  m_blockCache.set(key, computed);
+  return computed;
 }
 
 }
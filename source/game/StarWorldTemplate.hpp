@@ -3,6 +3,7 @@
 
 #include "StarOrderedMap.hpp"
 #include "StarLruCache.hpp"
+#include "StarThread.hpp"
 #include "StarWorldLayout.hpp"
 #include "StarBiomePlacement.hpp"
 #include "StarCelestialDatabase.hpp"
@@ -129,8 +130,14 @@ public:
   // Is this integral region of blocks outside the terrain?
   bool isOutside(RectI const& region) const;
 
+  // May be called from any thread, as long as the template is only modified
+  // from one.
   BlockInfo blockInfo(int x, int y) const;
 
+  // Incremented whenever a change to the template may change block info, so
+  // that block info calculated ahead of time can be checked for staleness.
+  uint64_t blockInfoRevision() const;
+
   // partial blockinfo that doesn't use terrain selectors
   BlockInfo blockBiomeInfo(int x, int y) const;
 
@@ -185,6 +192,10 @@ private:
   // Calculates block info and adds to cache
   BlockInfo getBlockInfo(uint32_t x, uint32_t y) const;
 
+  // Terrain selector values are evaluated a whole sector high column at a
+  // time, since the blocks of a sector are generated together.
+  float terrainSelectorValue(TerrainSelectorIndex index, int x, int y) const;
+
   Json m_templateConfig;
   float m_customTerrainBlendSize;
   float m_customTerrainBlendWeight;
@@ -199,7 +210,14 @@ private:
 
   List<CustomTerrainRegion> m_customTerrainRegions;
 
+  // Held for reading while calculating block info and for writing while
+  // changing anything it depends on.
+  mutable ReadersWriterMutex m_blockInfoLock;
+  atomic<uint64_t> m_blockInfoRevision;
+
+  mutable Mutex m_blockCacheMutex;
   mutable HashLruCache<Vector<uint32_t, 2>, BlockInfo> m_blockCache;
+  mutable HashLruCache<Vec3I, Array<float, WorldSectorSize>> m_terrainSelectorColumns;
 };
 
 }
@@ -89,6 +89,10 @@ Maybe<HitType> Entity::queryHit(DamageSource const&) const {
   return {};
 }
 
+bool Entity::canBeHit() const {
+  return false;
+}
+
 Maybe<PolyF> Entity::hitPoly() const {
   return {};
 }
@@ -113,6 +117,10 @@ Maybe<Json> Entity::receiveMessage(ConnectionId, String const&, JsonArray const&
 
 void Entity::update(float dt, uint64_t) {}
 
+bool Entity::parallelUpdateSafe() const {
+  return false;
+}
+
 void Entity::render(RenderCallback*) {}
 
 void Entity::renderLightSources(RenderCallback*) {}
@@ -110,6 +110,10 @@ public:
   // source.  Will be called on master and slave entities.  Culling based on
   // team damage and self damage will be done outside of this query.
   virtual Maybe<HitType> queryHit(DamageSource const& source) const;
+  // Whether queryHit can ever return a hit.  Entities that override queryHit
+  // must also override this to return true, otherwise they are left out of
+  // the hit queries of DamageManager.
+  virtual bool canBeHit() const;
 
   // Return the polygonal area in which the entity can be hit. Not used for
   // actual hit computation, only for determining more precisely where a
@@ -151,6 +155,13 @@ public:
 
   virtual void update(float dt, uint64_t currentStep);
 
+  // If true, update() may be called from a worker thread concurrently with
+  // the updates of other such entities that are not near this one.  An entity
+  // returning true must not run Lua or touch entities outside of its own
+  // vicinity during update, and any world mutations it makes are deferred
+  // until the end of the parallel update.  Defaults to false.
+  virtual bool parallelUpdateSafe() const;
+
   virtual void render(RenderCallback* renderer);
 
   virtual void renderLightSources(RenderCallback* renderer);
@@ -1,11 +1,55 @@
 #include "StarLuaRoot.hpp"
 #include "StarAssets.hpp"
+#include "StarDataStreamDevices.hpp"
+#include "StarEncode.hpp"
+#include "StarJsonExtra.hpp"
+#include "StarXXHash.hpp"
 
 namespace Star {
 
+// Used by SharedModules to find the globals a module defined and to freeze and
+// copy them.
+static char const* const SharedModuleHelpers = R"LUA(
+  function snapshot(env)
+    local copy = {}
+    for k, v in pairs(env) do copy[k] = v end
+    return copy
+  end
+
+  function exportsOf(env, before)
+    local exports = {}
+    for k, v in pairs(env) do
+      if k ~= "_SBLOADED" and not rawequal(before[k], v) then exports[k] = v end
+    end
+    return exports
+  end
+
+  function freeze(env)
+    local frozen = snapshot(env)
+    for k in pairs(frozen) do env[k] = nil end
+    setmetatable(env, {
+        __index = frozen,
+        __newindex = function(_, k)
+          error(string.format("cannot set global '%s' in a shared module", tostring(k)), 2)
+        end
+      })
+  end
+
+  function import(env, exports)
+    for k, v in pairs(exports) do
+      if type(v) == "table" then
+        local copy = setmetatable({}, getmetatable(v))
+        for tk, tv in pairs(v) do copy[tk] = tv end
+        v = copy
+      end
+      env[k] = v
+    end
+  end
+)LUA";
+
 LuaRoot::LuaRoot() {
   auto& root = Root::singleton();
-  m_scriptCache = make_shared<ScriptCache>();
+  m_scriptCache = sharedScriptCache();
 
   restart();
 
@@ -44,14 +88,18 @@ void LuaRoot::restart() {
   m_luaEngine->setInstructionLimit(root.configuration()->get("scriptInstructionLimit").toUInt());
   m_luaEngine->setProfilingEnabled(root.configuration()->get("scriptProfilingEnabled").toBool());
   m_luaEngine->setInstructionMeasureInterval(root.configuration()->get("scriptInstructionMeasureInterval").toUInt());
+
+  auto sharedModules = jsonToStringList(root.configuration()->get("sharedScriptModules").optArray().value());
+  if (!sharedModules.empty())
+    m_sharedModules = make_shared<SharedModules>(*m_luaEngine, sharedModules);
 }
 
 void LuaRoot::shutdown() {
-  clearScriptCache();
-
   if (!m_luaEngine)
     return;
 
+  m_scriptCache->save(*m_luaEngine);
+
   auto profile = m_luaEngine->getProfile();
   if (!profile.empty()) {
     profile.sort([](auto const& a, auto const& b) {
@@ -85,6 +133,7 @@ void LuaRoot::shutdown() {
     File::writeFile(profileSummary, path);
   }
 
+  m_sharedModules.reset();
   collectGarbage();
   // FezzedOne: Hacky, but fixes a major memory leak.
   // Had to remove the `zero` hack. Argh.
@@ -104,16 +153,7 @@ LuaContext LuaRoot::createContext(StringList const& scriptPaths) {
 
   auto newContext = m_luaEngine->createContext();
 
-  auto cache = m_scriptCache;
-  newContext.setRequireFunction([cache](LuaContext& context, LuaString const& module) {
-    if (!context.get("_SBLOADED").is<LuaTable>())
-      context.set("_SBLOADED", context.createTable());
-    auto t = context.get<LuaTable>("_SBLOADED");
-    if (!t.contains(module)) {
-      t.set(module, true);
-      cache->loadContextScript(context, module.toString());
-    }
-  });
+  newContext.setRequireFunction(makeRequireFunction(m_scriptCache, m_sharedModules));
 
   /* FezzedOne: Removed this safeScripts version of `loadstring`, since fixing the memory leak it caused makes
      all `loadstring` calls cause segfaults (if that wasn't the behaviour before). `/run` will now require `safeScripts` to be off in order to do anything. */
@@ -126,7 +166,7 @@ LuaContext LuaRoot::createContext(StringList const& scriptPaths) {
 
   for (auto const& scriptPath : scriptPaths) {
     if (assets->assetExists(scriptPath))
-      cache->loadContextScript(newContext, scriptPath);
+      m_scriptCache->loadContextScript(newContext, scriptPath);
     else
       Logger::error("Script '{}' does not exist", scriptPath);
   }
@@ -172,15 +212,49 @@ LuaEngine& LuaRoot::luaEngine() const {
   return *m_luaEngine;
 }
 
+shared_ptr<LuaRoot::ScriptCache> LuaRoot::sharedScriptCache() {
+  static shared_ptr<ScriptCache> scriptCache = make_shared<ScriptCache>();
+  return scriptCache;
+}
+
+LuaContext::RequireFunction LuaRoot::makeRequireFunction(shared_ptr<ScriptCache> cache, weak_ptr<SharedModules> sharedModules) {
+  return [cache, sharedModules](LuaContext& context, LuaString const& module) {
+    if (!context.get("_SBLOADED").is<LuaTable>())
+      context.set("_SBLOADED", context.createTable());
+    auto t = context.get<LuaTable>("_SBLOADED");
+    if (!t.contains(module)) {
+      t.set(module, true);
+      String modulePath = module.toString();
+      auto modules = sharedModules.lock();
+      if (modules && modules->isShared(modulePath))
+        modules->require(context, modulePath, *cache, makeRequireFunction(cache, sharedModules));
+      else
+        cache->loadContextScript(context, modulePath);
+    }
+  };
+}
+
 void LuaRoot::ScriptCache::loadScript(LuaEngine& engine, String const& assetPath) {
-  auto assets = Root::singleton().assets();
+  auto source = Root::singleton().assets()->bytes(assetPath);
+  uint64_t sourceHash = xxHash64(*source);
+
   RecursiveMutexLocker locker(mutex);
-  scripts[assetPath] = engine.compile(*assets->bytes(assetPath), assetPath);
+  readCacheFile(engine);
+  if (auto script = scripts.ptr(assetPath)) {
+    if (script->sourceHash == sourceHash) {
+      script->checked = true;
+      return;
+    }
+  }
+
+  scripts[assetPath] = Script{sourceHash, engine.compile(*source, assetPath), true};
+  cacheFileDirty = true;
 }
 
 bool LuaRoot::ScriptCache::scriptLoaded(String const& assetPath) const {
   RecursiveMutexLocker locker(mutex);
-  return scripts.contains(assetPath);
+  auto script = scripts.ptr(assetPath);
+  return script && script->checked;
 }
 
 void LuaRoot::ScriptCache::unloadScript(String const& assetPath) {
@@ -191,21 +265,122 @@ void LuaRoot::ScriptCache::unloadScript(String const& assetPath) {
 void LuaRoot::ScriptCache::clear() {
   RecursiveMutexLocker locker(mutex);
   scripts.clear();
+  cacheFileRead = false;
+  cacheFileDirty = false;
+  cacheFile.reset();
 }
 
 void LuaRoot::ScriptCache::loadContextScript(LuaContext& context, String const& assetPath) {
   RecursiveMutexLocker locker(mutex);
   if (!scriptLoaded(assetPath))
     loadScript(context.engine(), assetPath);
-  context.load(scripts.get(assetPath));
+  ByteArray bytecode = scripts.get(assetPath).bytecode;
+  // Running the script may take a while and require other scripts, so it is
+  // done without holding up the other LuaRoots.
+  locker.unlock();
+  context.load(bytecode);
 }
 
 size_t LuaRoot::ScriptCache::memoryUsage() const {
   RecursiveMutexLocker locker(mutex);
   size_t total = 0;
   for (auto const& p : scripts)
-    total += p.second.size();
+    total += p.second.bytecode.size();
   return total;
 }
 
+void LuaRoot::ScriptCache::save(LuaEngine& engine) {
+  RecursiveMutexLocker locker(mutex);
+  if (!cacheFile || !cacheFileDirty)
+    return;
+
+  try {
+    // The compiled empty chunk identifies the bytecode format, so that a
+    // cache written by a different Lua build is not used.
+    DataStreamBuffer ds;
+    ds.write(engine.compile(String()));
+    ds.writeMapContainer(scripts, [](DataStream& ds, String const& assetPath, Script const& script) {
+        ds.write(assetPath);
+        ds.write(script.sourceHash);
+        ds.write(script.bytecode);
+      });
+
+    String directory = File::dirName(*cacheFile);
+    if (!File::isDirectory(directory))
+      File::makeDirectory(directory);
+    File::overwriteFileWithRename(ds.data(), *cacheFile);
+    cacheFileDirty = false;
+
+    // Caches for other assets would only be used again if those exact assets
+    // come back, so they are removed rather than left to accumulate.
+    String cacheFileName = File::baseName(*cacheFile);
+    for (auto const& entry : File::dirList(directory)) {
+      if (!entry.second && entry.first.beginsWith("bytecode-") && entry.first.endsWith(".cache") && entry.first != cacheFileName)
+        File::remove(File::relativeTo(directory, entry.first));
+    }
+  } catch (std::exception const& e) {
+    Logger::warn("LuaRoot: Could not write script bytecode cache {}: {}", *cacheFile, outputException(e, false));
+  }
+}
+
+void LuaRoot::ScriptCache::readCacheFile(LuaEngine& engine) {
+  if (cacheFileRead)
+    return;
+  cacheFileRead = true;
+
+  auto& root = Root::singleton();
+  if (!root.configuration()->get("scriptBytecodeCache").optBool().value(true))
+    return;
+
+  cacheFile = File::relativeTo(root.toStoragePath("lua"), strf("bytecode-{}.cache", hexEncode(root.assets()->digest())));
+  if (!File::isFile(*cacheFile))
+    return;
+
+  try {
+    DataStreamBuffer ds(File::readFile(*cacheFile));
+    if (ds.read<ByteArray>() != engine.compile(String()))
+      return;
+
+    ds.readMapContainer(scripts, [](DataStream& ds, String& assetPath, Script& script) {
+        ds.read(assetPath);
+        ds.read(script.sourceHash);
+        ds.read(script.bytecode);
+        script.checked = false;
+      });
+  } catch (std::exception const& e) {
+    Logger::warn("LuaRoot: Could not read script bytecode cache {}: {}", *cacheFile, outputException(e, false));
+    scripts.clear();
+  }
+}
+
+LuaRoot::SharedModules::SharedModules(LuaEngine& engine, StringList const& modules)
+  : m_modules(StringSet::from(modules)), m_helpers(engine.createContext()) {
+  m_helpers.load(SharedModuleHelpers, "shared module helpers");
+}
+
+bool LuaRoot::SharedModules::isShared(String const& module) const {
+  return m_modules.contains(module);
+}
+
+void LuaRoot::SharedModules::require(LuaContext& context, String const& module, ScriptCache& cache, LuaContext::RequireFunction const& requireFunction) {
+  if (!m_exports.contains(module)) {
+    auto& engine = context.engine();
+    auto moduleContext = engine.createContext();
+    moduleContext.setRequireFunction(requireFunction);
+    auto moduleEnvironment = moduleContext.eval<LuaTable>("_ENV");
+    auto before = m_helpers.invokePath<LuaTable>("snapshot", moduleEnvironment);
+
+    auto loaded = engine.createTable();
+    loaded.set(module, true);
+    moduleContext.set("_SBLOADED", loaded);
+    cache.loadContextScript(moduleContext, module);
+
+    auto exports = m_helpers.invokePath<LuaTable>("exportsOf", moduleEnvironment, before);
+    m_helpers.invokePath("freeze", moduleEnvironment);
+    m_exports.add(module, std::move(exports));
+  }
+
+  m_helpers.invokePath("import", context.eval<LuaTable>("_ENV"), m_exports.get(module));
+}
+
 }
@@ -12,6 +12,19 @@ STAR_CLASS(LuaRoot);
 // Loads and caches lua scripts from assets.  Automatically clears cache on
 // root reload.  Uses an internal LuaEngine, so this and all contexts are meant
 // for single threaded access and have no locking.
+//
+// Compiled scripts are shared by all LuaRoots, and unless the
+// "scriptBytecodeCache" configuration is false they are also kept in a
+// bytecode cache file for the current assets in the lua storage directory,
+// so that they are not compiled again on the next start.
+//
+// Modules listed in the "sharedScriptModules" configuration are run only once
+// per LuaRoot, in their own environment which is frozen afterwards.  A
+// context that requires one gets each global the module defined, with tables
+// copied one level deep so that the context may replace their functions, but
+// the functions and any nested tables are shared with every other context.
+// Only modules that keep no per-context state and do not use the callbacks of
+// the requiring context can be shared.
 class LuaRoot {
 public:
   LuaRoot();
@@ -54,15 +67,50 @@ private:
     void clear();
     void loadContextScript(LuaContext& context, String const& assetPath);
     size_t memoryUsage() const;
+    // Writes the bytecode cache file if any script was compiled since it was
+    // read.
+    void save(LuaEngine& engine);
 
   private:
+    struct Script {
+      uint64_t sourceHash;
+      ByteArray bytecode;
+      // Scripts read from the bytecode cache file are only used once their
+      // source is checked to be unchanged.
+      bool checked;
+    };
+
+    void readCacheFile(LuaEngine& engine);
+
     mutable RecursiveMutex mutex;
-    StringMap<ByteArray> scripts;
+    StringMap<Script> scripts;
+    bool cacheFileRead = false;
+    bool cacheFileDirty = false;
+    Maybe<String> cacheFile;
   };
 
+  class SharedModules {
+  public:
+    SharedModules(LuaEngine& engine, StringList const& modules);
+
+    bool isShared(String const& module) const;
+    void require(LuaContext& context, String const& module, ScriptCache& cache, LuaContext::RequireFunction const& requireFunction);
+
+  private:
+    StringSet m_modules;
+    StringMap<LuaTable> m_exports;
+    LuaContext m_helpers;
+  };
+
+  static shared_ptr<ScriptCache> sharedScriptCache();
+  // The require function is kept by the engine for each context, so it must
+  // not hold any of the engine's values.
+  static LuaContext::RequireFunction makeRequireFunction(shared_ptr<ScriptCache> cache, weak_ptr<SharedModules> sharedModules);
+
   LuaEnginePtr m_luaEngine;
   StringMap<LuaCallbacks> m_luaCallbacks;
   shared_ptr<ScriptCache> m_scriptCache;
+  shared_ptr<SharedModules> m_sharedModules;
 
   ListenerPtr m_rootReloadListener;
 
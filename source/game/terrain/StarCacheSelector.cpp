@@ -18,9 +18,45 @@ CacheSelector::CacheSelector(
 }
 
 float CacheSelector::get(int x, int y) const {
-  return m_cache.get(Vec2I(x, y), [this](Vec2I const& key) {
-      return m_source->get(key[0], key[1]);
-    });
+  {
+    MutexLocker locker(m_cacheMutex);
+    if (auto value = m_cache.ptr(Vec2I(x, y)))
+      return *value;
+  }
+
+  float value = m_source->get(x, y);
+  MutexLocker locker(m_cacheMutex);
+  m_cache.set(Vec2I(x, y), value);
+  return value;
+}
+
+void CacheSelector::getPoints(size_t count, int const* x, int const* y, float* values) const {
+  // Only the points missing from the cache are evaluated, together.
+  List<size_t> missing;
+  List<int> missingX;
+  List<int> missingY;
+  MutexLocker locker(m_cacheMutex);
+  for (size_t i = 0; i < count; ++i) {
+    if (auto value = m_cache.ptr(Vec2I(x[i], y[i]))) {
+      values[i] = *value;
+    } else {
+      missing.append(i);
+      missingX.append(x[i]);
+      missingY.append(y[i]);
+    }
+  }
+
+  locker.unlock();
+  if (missing.empty())
+    return;
+
+  List<float> missingValues(missing.size(), 0.0f);
+  m_source->getPoints(missing.size(), missingX.ptr(), missingY.ptr(), missingValues.ptr());
+  locker.lock();
+  for (size_t i = 0; i < missing.size(); ++i) {
+    values[missing[i]] = missingValues[i];
+    m_cache.set(Vec2I(missingX[i], missingY[i]), missingValues[i]);
+  }
 }
 
 }
@@ -4,6 +4,7 @@
 #include "StarTerrainDatabase.hpp"
 #include "StarLruCache.hpp"
 #include "StarVector.hpp"
+#include "StarThread.hpp"
 
 namespace Star {
 
@@ -13,8 +14,10 @@ struct CacheSelector : TerrainSelector {
   CacheSelector(Json const& config, TerrainSelectorParameters const& parameters, TerrainDatabase const* database);
 
   float get(int x, int y) const override;
+  void getPoints(size_t count, int const* x, int const* y, float* values) const override;
 
   TerrainSelectorConstPtr m_source;
+  mutable Mutex m_cacheMutex;
   mutable HashLruCache<Vec2I, float> m_cache;
 };
 
@@ -53,6 +53,33 @@ float DisplacementSelector::get(int x, int y) const {
   return m_source->get(x_, y_);
 }
 
+void DisplacementSelector::getPoints(size_t count, int const* x, int const* y, float* values) const {
+  List<float> xs(count, 0.0f);
+  List<float> ys(count, 0.0f);
+  List<float> xDisplacement(count, 0.0f);
+  List<float> yDisplacement(count, 0.0f);
+
+  for (size_t i = 0; i < count; ++i) {
+    xs[i] = x[i] * xXInfluence;
+    ys[i] = y[i] * xYInfluence;
+  }
+  xDisplacementFunction.get(count, xs.ptr(), ys.ptr(), xDisplacement.ptr());
+
+  for (size_t i = 0; i < count; ++i) {
+    xs[i] = x[i] * yXInfluence;
+    ys[i] = y[i] * yYInfluence;
+  }
+  yDisplacementFunction.get(count, xs.ptr(), ys.ptr(), yDisplacement.ptr());
+
+  List<int> sourceX(count, 0);
+  List<int> sourceY(count, 0);
+  for (size_t i = 0; i < count; ++i) {
+    sourceX[i] = x[i] + xDisplacement[i];
+    sourceY[i] = y[i] + clampY(yDisplacement[i]);
+  }
+  m_source->getPoints(count, sourceX.ptr(), sourceY.ptr(), values);
+}
+
 float DisplacementSelector::clampY(float v) const {
   if (!yClamp)
     return v;
@@ -14,6 +14,7 @@ struct DisplacementSelector : TerrainSelector {
       Json const& config, TerrainSelectorParameters const& parameters, TerrainDatabase const* database);
 
   float get(int x, int y) const override;
+  void getPoints(size_t count, int const* x, int const* y, float* values) const override;
 
   PerlinF xDisplacementFunction;
   PerlinF yDisplacementFunction;
@@ -40,9 +40,20 @@ IslandColumn IslandSurfaceSelector::generateColumn(int x) const {
 }
 
 float IslandSurfaceSelector::get(int x, int y) const {
-  auto col = columnCache.get(x, [=](int x) {
-      return IslandSurfaceSelector::generateColumn(x);
-    });
+  Maybe<IslandColumn> cached;
+  {
+    MutexLocker locker(columnCacheMutex);
+    if (auto ptr = columnCache.ptr(x))
+      cached = *ptr;
+  }
+
+  if (!cached) {
+    cached = generateColumn(x);
+    MutexLocker locker(columnCacheMutex);
+    columnCache.set(x, *cached);
+  }
+
+  auto const& col = *cached;
 
   return (col.topLevel - col.bottomLevel) / 2 - abs((col.topLevel + col.bottomLevel) / 2 - y);
 }
@@ -2,6 +2,7 @@
 #define STAR_ISLAND_SURFACE_SELECTOR_HPP
 
 #include "StarLruCache.hpp"
+#include "StarThread.hpp"
 #include "StarPerlin.hpp"
 #include "StarTerrainDatabase.hpp"
 
@@ -21,6 +22,7 @@ struct IslandSurfaceSelector : TerrainSelector {
 
   IslandColumn generateColumn(int x) const;
 
+  mutable Mutex columnCacheMutex;
   mutable HashLruCache<int, IslandColumn> columnCache;
 
   PerlinF islandHeight;
@@ -31,9 +31,19 @@ KarstCaveSelector::KarstCaveSelector(Json const& config, TerrainSelectorParamete
 
 float KarstCaveSelector::get(int x, int y) const {
   Vec2I key = Vec2I(x - pmod(x, m_sectorSize), y - pmod(y, m_sectorSize));
-  return m_sectorCache.get(key, [=](Vec2I const& key) {
-      return Sector(this, key);
-    }).get(x, y);
+  shared_ptr<Sector const> sector;
+  {
+    MutexLocker locker(m_cacheMutex);
+    if (auto ptr = m_sectorCache.ptr(key))
+      sector = *ptr;
+  }
+
+  if (!sector) {
+    sector = make_shared<Sector const>(this, key);
+    MutexLocker locker(m_cacheMutex);
+    m_sectorCache.set(key, sector);
+  }
+  return sector->get(x, y);
 }
 
 KarstCaveSelector::Sector::Sector(KarstCaveSelector const* parent, Vec2I sector)
@@ -41,44 +51,78 @@ KarstCaveSelector::Sector::Sector(KarstCaveSelector const* parent, Vec2I sector)
 
   m_maxValue = 0;
 
+  // The wrapping noise coordinates only depend on x, so every cave layer
+  // samples the same row of them, all at once.
+  int sectorSize = parent->m_sectorSize;
+  List<float> noiseX(sectorSize, 0.0f);
+  List<float> noiseY(sectorSize, 0.0f);
+  for (int i = 0; i < sectorSize; ++i) {
+    float noiseAngle = 2 * Constants::pi * (sector[0] + i) / parent->m_worldWidth;
+    noiseX[i] = (std::cos(noiseAngle) * parent->m_worldWidth) / (2 * Constants::pi);
+    noiseY[i] = (std::sin(noiseAngle) * parent->m_worldWidth) / (2 * Constants::pi);
+  }
+
+  List<float> caveDecision(sectorSize, 0.0f);
+  List<int> caves;
+  List<float> caveNoiseX;
+  List<float> caveNoiseY;
+  List<float> layerHeightVariation;
+  List<float> caveHeightVariation;
+  List<float> caveFloorVariation;
+
   for (int y = sector[1] - parent->m_bufferHeight; y < sector[1] + parent->m_sectorSize + parent->m_bufferHeight; y++) {
     float layerChance = parent->m_layerDensity * parent->m_layerResolution;
     // determine whether this layer has caves
     if (y % parent->m_layerResolution == 0 && staticRandomFloat(parent->m_seed, y) <= layerChance) {
-      LayerPerlins const& layerPerlins = parent->layerPerlins(y);
+      auto layerPerlins = parent->layerPerlins(y);
+
+      // determine where caves be at
+      layerPerlins->caveDecision.get(sectorSize, noiseX.ptr(), noiseY.ptr(), caveDecision.ptr());
+
+      // only the points with caves need the variation noise
+      caves.clear();
+      caveNoiseX.clear();
+      caveNoiseY.clear();
+      for (int i = 0; i < sectorSize; ++i) {
+        if (caveDecision[i] > 0) {
+          caves.append(i);
+          caveNoiseX.append(noiseX[i]);
+          caveNoiseY.append(noiseY[i]);
+        }
+      }
+
+      layerHeightVariation.resize(caves.size());
+      caveHeightVariation.resize(caves.size());
+      caveFloorVariation.resize(caves.size());
+      layerPerlins->layerHeightVariation.get(caves.size(), caveNoiseX.ptr(), caveNoiseY.ptr(), layerHeightVariation.ptr());
+      layerPerlins->caveHeightVariation.get(caves.size(), caveNoiseX.ptr(), caveNoiseY.ptr(), caveHeightVariation.ptr());
+      layerPerlins->caveFloorVariation.get(caves.size(), caveNoiseX.ptr(), caveNoiseY.ptr(), caveFloorVariation.ptr());
 
       // carve out cave layer
-      for (int x = sector[0]; x < sector[0] + parent->m_sectorSize; x++) {
-        // use wrapping noise
-        float noiseAngle = 2 * Constants::pi * x / parent->m_worldWidth;
-        float noiseX = (std::cos(noiseAngle) * parent->m_worldWidth) / (2 * Constants::pi);
-        float noiseY = (std::sin(noiseAngle) * parent->m_worldWidth) / (2 * Constants::pi);
-
-        // determine where caves be at
-        float isThereACaveHere = layerPerlins.caveDecision.get(noiseX, noiseY);
-        if (isThereACaveHere > 0) {
-          float taperFactor = isThereACaveHere < parent->m_caveTaperPoint
-              ? std::sin((0.5 * Constants::pi * isThereACaveHere) / parent->m_caveTaperPoint)
-              : 1.0f;
-
-          int baseY = y + layerPerlins.layerHeightVariation.get(noiseX, noiseY);
-          int ceilingY = baseY + layerPerlins.caveHeightVariation.get(noiseX, noiseY) * taperFactor;
-          int floorY = baseY + layerPerlins.caveFloorVariation.get(noiseX, noiseY) * taperFactor;
-          float halfHeight = abs(ceilingY - floorY + 1) / 2.0f;
-          float midpointY = (floorY + ceilingY) / 2.0f;
-
-          m_maxValue = max(m_maxValue, halfHeight);
-
-          for (int pointY = floorY; pointY < ceilingY; pointY++)
-            if (inside(x, pointY))
-              set(x, pointY, max(get(x, pointY), halfHeight - abs(midpointY - pointY)));
-        }
+      for (size_t c = 0; c < caves.size(); ++c) {
+        int x = sector[0] + caves[c];
+        float isThereACaveHere = caveDecision[caves[c]];
+        float taperFactor = isThereACaveHere < parent->m_caveTaperPoint
+            ? std::sin((0.5 * Constants::pi * isThereACaveHere) / parent->m_caveTaperPoint)
+            : 1.0f;
+
+        int baseY = y + layerHeightVariation[c];
+        int ceilingY = baseY + caveHeightVariation[c] * taperFactor;
+        int floorY = baseY + caveFloorVariation[c] * taperFactor;
+        float halfHeight = abs(ceilingY - floorY + 1) / 2.0f;
+        float midpointY = (floorY + ceilingY) / 2.0f;
+
+        m_maxValue = max(m_maxValue, halfHeight);
+
+        for (int pointY = floorY; pointY < ceilingY; pointY++)
+          if (inside(x, pointY))
+            set(x, pointY, max(get(x, pointY), halfHeight - abs(midpointY - pointY)));
       }
     }
   }
 }
 
-float KarstCaveSelector::Sector::get(int x, int y) {
+float KarstCaveSelector::Sector::get(int x, int y) const {
   auto val = values[(x - sector[0]) + parent->m_sectorSize * (y - sector[1])];
   if (val > 0)
     return val;
@@ -86,7 +130,7 @@ float KarstCaveSelector::Sector::get(int x, int y) {
     return -m_maxValue;
 }
 
-bool KarstCaveSelector::Sector::inside(int x, int y) {
+bool KarstCaveSelector::Sector::inside(int x, int y) const {
   int x_ = x - sector[0];
   if (x_ < 0 || x_ >= parent->m_sectorSize)
     return false;
@@ -100,15 +144,22 @@ void KarstCaveSelector::Sector::set(int x, int y, float value) {
   values[(x - sector[0]) + parent->m_sectorSize * (y - sector[1])] = value;
 }
 
-KarstCaveSelector::LayerPerlins const& KarstCaveSelector::layerPerlins(int y) const {
-  return m_layerPerlinsCache.get(y, [this](int y) {
-      return LayerPerlins{
-        PerlinF(m_caveDecisionPerlinConfig, staticRandomU64(y, m_seed, "CaveDecision")),
-        PerlinF(m_layerHeightVariationPerlinConfig, staticRandomU64(y, m_seed, "LayerHeightVariation")),
-        PerlinF(m_caveHeightVariationPerlinConfig, staticRandomU64(y, m_seed, "CaveHeightVariation")),
-        PerlinF(m_caveFloorVariationPerlinConfig, staticRandomU64(y, m_seed, "CaveFloorVariation"))
-      };
+auto KarstCaveSelector::layerPerlins(int y) const -> shared_ptr<LayerPerlins const> {
+  {
+    MutexLocker locker(m_cacheMutex);
+    if (auto ptr = m_layerPerlinsCache.ptr(y))
+      return *ptr;
+  }
+
+  auto perlins = make_shared<LayerPerlins const>(LayerPerlins{
+      PerlinF(m_caveDecisionPerlinConfig, staticRandomU64(y, m_seed, "CaveDecision")),
+      PerlinF(m_layerHeightVariationPerlinConfig, staticRandomU64(y, m_seed, "LayerHeightVariation")),
+      PerlinF(m_caveHeightVariationPerlinConfig, staticRandomU64(y, m_seed, "CaveHeightVariation")),
+      PerlinF(m_caveFloorVariationPerlinConfig, staticRandomU64(y, m_seed, "CaveFloorVariation"))
     });
+  MutexLocker locker(m_cacheMutex);
+  m_layerPerlinsCache.set(y, perlins);
+  return perlins;
 }
 
 }
@@ -5,6 +5,7 @@
 #include "StarLruCache.hpp"
 #include "StarVector.hpp"
 #include "StarPerlin.hpp"
+#include "StarThread.hpp"
 
 namespace Star {
 
@@ -27,9 +28,9 @@ private:
   struct Sector {
     Sector(KarstCaveSelector const* parent, Vec2I sector);
 
-    float get(int x, int y);
+    float get(int x, int y) const;
 
-    bool inside(int x, int y);
+    bool inside(int x, int y) const;
     void set(int x, int y, float value);
 
     KarstCaveSelector const* parent;
@@ -39,7 +40,7 @@ private:
     float m_maxValue;
   };
 
-  LayerPerlins const& layerPerlins(int y) const;
+  shared_ptr<LayerPerlins const> layerPerlins(int y) const;
 
   int m_sectorSize;
   int m_layerResolution;
@@ -55,8 +56,11 @@ private:
   int m_worldWidth;
   uint64_t m_seed;
 
-  mutable HashLruCache<int, LayerPerlins> m_layerPerlinsCache;
-  mutable HashLruCache<Vec2I, Sector> m_sectorCache;
+  // Cached values are shared, so that they can be used without holding the
+  // mutex while other threads evaluate the selector.
+  mutable Mutex m_cacheMutex;
+  mutable HashLruCache<int, shared_ptr<LayerPerlins const>> m_layerPerlinsCache;
+  mutable HashLruCache<Vec2I, shared_ptr<Sector const>> m_sectorCache;
 };
 
 }
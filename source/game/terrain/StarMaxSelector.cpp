@@ -24,4 +24,16 @@ float MaxSelector::get(int x, int y) const {
   return value;
 }
 
+void MaxSelector::getPoints(size_t count, int const* x, int const* y, float* values) const {
+  for (size_t i = 0; i < count; ++i)
+    values[i] = lowest<float>();
+
+  List<float> sourceValues(count, 0.0f);
+  for (auto const& source : m_sources) {
+    source->getPoints(count, x, y, sourceValues.ptr());
+    for (size_t i = 0; i < count; ++i)
+      values[i] = max(values[i], sourceValues[i]);
+  }
+}
+
 }
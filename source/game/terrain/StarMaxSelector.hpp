@@ -11,6 +11,7 @@ struct MaxSelector : TerrainSelector {
   MaxSelector(Json const& config, TerrainSelectorParameters const& parameters, TerrainDatabase const* database);
 
   float get(int x, int y) const override;
+  void getPoints(size_t count, int const* x, int const* y, float* values) const override;
 
   List<TerrainSelectorConstPtr> m_sources;
 };
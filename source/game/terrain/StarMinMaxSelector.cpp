@@ -29,4 +29,20 @@ float MinMaxSelector::get(int x, int y) const {
   return value;
 }
 
+void MinMaxSelector::getPoints(size_t count, int const* x, int const* y, float* values) const {
+  for (size_t i = 0; i < count; ++i)
+    values[i] = 0.0f;
+
+  List<float> sourceValues(count, 0.0f);
+  for (auto const& source : m_sources) {
+    source->getPoints(count, x, y, sourceValues.ptr());
+    for (size_t i = 0; i < count; ++i) {
+      if (values[i] > 0 || sourceValues[i] > 0)
+        values[i] = max(values[i], sourceValues[i]);
+      else
+        values[i] = min(values[i], sourceValues[i]);
+    }
+  }
+}
+
 }
@@ -27,4 +27,14 @@ float PerlinSelector::get(int x, int y) const {
   return function.get(x * xInfluence, y * yInfluence);
 }
 
+void PerlinSelector::getPoints(size_t count, int const* x, int const* y, float* values) const {
+  List<float> xs(count, 0.0f);
+  List<float> ys(count, 0.0f);
+  for (size_t i = 0; i < count; ++i) {
+    xs[i] = x[i] * xInfluence;
+    ys[i] = y[i] * yInfluence;
+  }
+  function.get(count, xs.ptr(), ys.ptr(), values);
+}
+
 }
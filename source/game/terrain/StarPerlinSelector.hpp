@@ -12,6 +12,7 @@ struct PerlinSelector : TerrainSelector {
   PerlinSelector(Json const& config, TerrainSelectorParameters const& parameters);
 
   float get(int x, int y) const override;
+  void getPoints(size_t count, int const* x, int const* y, float* values) const override;
 
   PerlinF function;
 
@@ -32,4 +32,41 @@ float RidgeBlocksSelector::get(int x, int y) const {
   }
 }
 
+void RidgeBlocksSelector::getPoints(size_t count, int const* x, int const* y, float* values) const {
+  if (commonality <= 0.0f) {
+    for (size_t i = 0; i < count; ++i)
+      values[i] = 0.0f;
+    return;
+  }
+
+  List<float> xs(count, 0.0f);
+  List<float> ys(count, 0.0f);
+  List<float> noise(count, 0.0f);
+  List<int> noisedX(count, 0);
+
+  // The y noise is sampled at the already noised x, as in get().
+  for (size_t i = 0; i < count; ++i) {
+    xs[i] = x[i];
+    ys[i] = y[i];
+  }
+  noisePerlin.get(count, xs.ptr(), ys.ptr(), noise.ptr());
+  for (size_t i = 0; i < count; ++i) {
+    noisedX[i] = x[i] + noise[i];
+    xs[i] = y[i];
+    ys[i] = noisedX[i];
+  }
+  noisePerlin.get(count, xs.ptr(), ys.ptr(), noise.ptr());
+  for (size_t i = 0; i < count; ++i) {
+    int noisedY = y[i] + noise[i];
+    xs[i] = noisedX[i];
+    ys[i] = noisedY;
+  }
+
+  List<float> ridge2(count, 0.0f);
+  ridgePerlin1.get(count, xs.ptr(), ys.ptr(), values);
+  ridgePerlin2.get(count, xs.ptr(), ys.ptr(), ridge2.ptr());
+  for (size_t i = 0; i < count; ++i)
+    values[i] = (values[i] - ridge2[i]) * commonality + bias;
+}
+
 }
@@ -24,4 +24,15 @@ float RotateSelector::get(int x, int y) const {
   return m_source->get(pos[0], pos[1]);
 }
 
+void RotateSelector::getPoints(size_t count, int const* x, int const* y, float* values) const {
+  List<int> sourceX(count, 0);
+  List<int> sourceY(count, 0);
+  for (size_t i = 0; i < count; ++i) {
+    auto pos = (Vec2F(x[i], y[i]) - rotationCenter).rotate(rotation) + rotationCenter;
+    sourceX[i] = pos[0];
+    sourceY[i] = pos[1];
+  }
+  m_source->getPoints(count, sourceX.ptr(), sourceY.ptr(), values);
+}
+
 }
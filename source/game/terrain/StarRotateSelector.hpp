@@ -12,6 +12,7 @@ struct RotateSelector : TerrainSelector {
   RotateSelector(Json const& config, TerrainSelectorParameters const& parameters, TerrainDatabase const* database);
 
   float get(int x, int y) const override;
+  void getPoints(size_t count, int const* x, int const* y, float* values) const override;
 
   float rotation;
   Vec2F rotationCenter;
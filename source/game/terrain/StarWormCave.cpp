@@ -119,7 +119,7 @@ WormCaveSector::WormCaveSector(int sectorSize, Vec2I sector, Json const& config,
   }
 }
 
-float WormCaveSector::get(int x, int y) {
+float WormCaveSector::get(int x, int y) const {
   auto val = m_values[(x - m_sector[0]) + m_sectorSize * (y - m_sector[1])];
   if (val > 0)
     return val;
@@ -149,9 +149,19 @@ WormCaveSelector::WormCaveSelector(Json const& config, TerrainSelectorParameters
 
 float WormCaveSelector::get(int x, int y) const {
   Vec2I sector = Vec2I(x - pmod(x, m_sectorSize), y - pmod(y, m_sectorSize));
-  return m_cache.get(sector, [=](Vec2I const& sector) {
-      return WormCaveSector(m_sectorSize, sector, config, parameters.seed, parameters.commonality);
-    }).get(x, y);
+  shared_ptr<WormCaveSector const> cached;
+  {
+    MutexLocker locker(m_cacheMutex);
+    if (auto ptr = m_cache.ptr(sector))
+      cached = *ptr;
+  }
+
+  if (!cached) {
+    cached = make_shared<WormCaveSector const>(m_sectorSize, sector, config, parameters.seed, parameters.commonality);
+    MutexLocker locker(m_cacheMutex);
+    m_cache.set(sector, cached);
+  }
+  return cached->get(x, y);
 }
 
 }
@@ -4,6 +4,7 @@
 #include "StarTerrainDatabase.hpp"
 #include "StarLruCache.hpp"
 #include "StarVector.hpp"
+#include "StarThread.hpp"
 
 namespace Star {
 
@@ -11,7 +12,7 @@ class WormCaveSector {
 public:
   WormCaveSector(int sectorSize, Vec2I sector, Json const& config, size_t seed, float commonality);
 
-  float get(int x, int y);
+  float get(int x, int y) const;
 
 private:
   bool inside(int x, int y);
@@ -34,7 +35,8 @@ public:
 
 private:
   int m_sectorSize;
-  mutable HashLruCache<Vec2I, WormCaveSector> m_cache;
+  mutable Mutex m_cacheMutex;
+  mutable HashLruCache<Vec2I, shared_ptr<WormCaveSector const>> m_cache;
 };
 
 }
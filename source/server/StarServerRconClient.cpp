@@ -5,6 +5,8 @@
 #include "StarConfiguration.hpp"
 #include "StarUniverseServer.hpp"
 #include "StarLexicalCast.hpp"
+#include "StarFile.hpp"
+#include "StarTime.hpp"
 
 namespace Star {
 
@@ -40,11 +42,51 @@ String ServerRconClient::handleCommand(String commandLine) {
   } else if (command == "stop") {
     m_universe->stop();
     return "OK: shutting down";
+  } else if (command == "tickprofile") {
+    return handleTickProfileCommand(commandLine.trim());
   } else {
     return m_universe->adminCommand(strf("{} {}", command, commandLine));
   }
 }
 
+// "tickprofile on" and "tickprofile off" enable and disable the world tick
+// profilers, "tickprofile" lists the slowest parts of the profiled ticks of
+// each world, and "tickprofile trace" writes a Chrome trace of the last
+// profiled ticks to the storage directory.
+String ServerRconClient::handleTickProfileCommand(String const& argument) {
+  if (argument == "on") {
+    m_universe->setTickProfiling(true);
+    return "OK: tick profiling enabled";
+  } else if (argument == "off") {
+    m_universe->setTickProfiling(false);
+    return "OK: tick profiling disabled";
+  } else if (argument == "trace") {
+    String path = Root::singleton().toStoragePath(strf("tickprofile-{}.json", Time::millisecondsSinceEpoch()));
+    File::writeFile(m_universe->tickProfileTrace().printJson(), path);
+    return strf("OK: wrote tick profile trace to {}", path);
+  } else if (!argument.empty()) {
+    return strf("Unknown tickprofile argument '{}', expected on, off or trace", argument);
+  }
+
+  if (!m_universe->tickProfiling())
+    return "Tick profiling is disabled, enable it with 'tickprofile on'";
+
+  size_t const maxSections = 10;
+  String output;
+  for (auto const& world : m_universe->tickProfile()) {
+    output += strf("{} ({} ticks):\n", world.first, world.second.getUInt("ticks"));
+    auto sections = world.second.getArray("sections");
+    for (size_t i = 0; i < min(sections.size(), maxSections); ++i) {
+      auto const& section = sections[i];
+      output += strf("  {}: mean {:.2f}ms, p50 {:.2f}ms, p99 {:.2f}ms, max {:.2f}ms\n", section.getString("name"),
+          section.getFloat("meanMs"), section.getFloat("p50Ms"), section.getFloat("p99Ms"), section.getFloat("maxMs"));
+    }
+  }
+  if (output.empty())
+    return "No active worlds";
+  return output;
+}
+
 void ServerRconClient::receive(size_t size) {
   m_packetBuffer.reset(size);
   auto ptr = m_packetBuffer.ptr();
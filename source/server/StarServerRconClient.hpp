@@ -37,6 +37,7 @@ private:
   void closeSocket();
   void processRequest();
   String handleCommand(String commandLine);
+  String handleTickProfileCommand(String const& argument);
 
   UniverseServer* m_universe;
   TcpSocketPtr m_socket;
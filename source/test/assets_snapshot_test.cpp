@@ -0,0 +1,104 @@
+#include "StarAssetsSnapshot.hpp"
+#include "StarAssets.hpp"
+#include "StarFile.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+TEST(AssetsSnapshotTest, WriteRead) {
+  auto dir = File::temporaryDirectory();
+  String path = File::relativeTo(dir, "assets.snapshot");
+  ByteArray key("key", 3);
+  Json first = Json::parseJson(R"JSON({"a" : [1, 2.5, "three", null, true], "b" : {"c" : -4}})JSON");
+  Json second = JsonArray{1, 2, 3};
+
+  {
+    AssetsSnapshot snapshot(path, key);
+    EXPECT_FALSE(snapshot.digest());
+    EXPECT_FALSE(snapshot.json("/first.config"));
+
+    snapshot.setDigest(ByteArray("digest", 6));
+    snapshot.setJson("/first.config", first);
+    EXPECT_EQ(snapshot.json("/first.config"), first);
+    snapshot.write();
+    EXPECT_EQ(snapshot.json("/first.config"), first);
+  }
+
+  {
+    AssetsSnapshot snapshot(path, key);
+    EXPECT_EQ(snapshot.digest(), ByteArray("digest", 6));
+    EXPECT_EQ(snapshot.json("/first.config"), first);
+    EXPECT_EQ(snapshot.jsonCount(), 1u);
+
+    // Entries from the previous snapshot are kept when adding more.
+    snapshot.setJson("/second.config", second);
+    snapshot.write();
+  }
+
+  {
+    AssetsSnapshot snapshot(path, key);
+    EXPECT_EQ(snapshot.json("/first.config"), first);
+    EXPECT_EQ(snapshot.json("/second.config"), second);
+    EXPECT_EQ(snapshot.jsonCount(), 2u);
+  }
+
+  {
+    // A different key discards the old snapshot.
+    AssetsSnapshot snapshot(path, ByteArray("other", 5));
+    EXPECT_FALSE(snapshot.digest());
+    EXPECT_FALSE(snapshot.json("/first.config"));
+    EXPECT_EQ(snapshot.jsonCount(), 0u);
+  }
+
+  File::writeFile(ByteArray("garbage", 7), path);
+  {
+    AssetsSnapshot snapshot(path, key);
+    EXPECT_FALSE(snapshot.digest());
+    EXPECT_EQ(snapshot.jsonCount(), 0u);
+  }
+
+  File::removeDirectoryRecursive(dir);
+}
+
+TEST(AssetsSnapshotTest, Assets) {
+  auto dir = File::temporaryDirectory();
+  String assetsDir = File::relativeTo(dir, "assets");
+  File::makeDirectory(assetsDir);
+  File::writeFile(String(R"JSON({"value" : 1, "list" : [1, 2]})JSON"), File::relativeTo(assetsDir, "test.config"));
+  File::writeFile(String(R"JSON([{"op" : "replace", "path" : "/value", "value" : 2}])JSON"), File::relativeTo(assetsDir, "test.config.patch"));
+
+  Assets::Settings settings;
+  settings.assetTimeToLive = 30.0f;
+  settings.audioDecompressLimit = 0.0f;
+  settings.workerPoolSize = 1;
+  settings.luaGcPause = 1.2f;
+  settings.luaGcStepMultiplier = 2.0f;
+  settings.imageCacheSizeLimit = 0;
+  settings.snapshotFile = File::relativeTo(dir, "assets.snapshot");
+
+  ByteArray digest;
+  {
+    Assets assets(settings, {assetsDir});
+    EXPECT_EQ(assets.json("/test.config:value"), 2);
+    digest = assets.digest();
+  }
+  EXPECT_TRUE(File::isFile(*settings.snapshotFile));
+
+  {
+    Assets assets(settings, {assetsDir});
+    EXPECT_EQ(assets.digest(), digest);
+    EXPECT_EQ(assets.json("/test.config:value"), 2);
+    EXPECT_EQ(assets.json("/test.config:list"), JsonArray({1, 2}));
+  }
+
+  // Changing any file invalidates the snapshot.
+  Thread::sleep(20);
+  File::writeFile(String(R"JSON([{"op" : "replace", "path" : "/value", "value" : 3}])JSON"), File::relativeTo(assetsDir, "test.config.patch"));
+  {
+    Assets assets(settings, {assetsDir});
+    EXPECT_EQ(assets.json("/test.config:value"), 3);
+  }
+
+  File::removeDirectoryRecursive(dir);
+}
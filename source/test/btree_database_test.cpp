@@ -1,5 +1,6 @@
 #include "StarBTreeDatabase.hpp"
 #include "StarFile.hpp"
+#include "StarBuffer.hpp"
 #include "StarRandom.hpp"
 
 #include "gtest/gtest.h"
@@ -78,7 +79,8 @@ namespace {
     return totalRemoved;
   }
 
-  void testBTreeDatabase(size_t testCount, size_t writeRepeat, size_t randCount, size_t rollbackCount, size_t blockSize) {
+  void testBTreeDatabase(size_t testCount, size_t writeRepeat, size_t randCount, size_t rollbackCount, size_t blockSize,
+      bool memoryMapped = false, uint32_t leafCacheSize = 0, bool backgroundCommit = false) {
     auto tmpFile = File::temporaryFile();
     auto finallyGuard = finally([&tmpFile]() { tmpFile->remove(); });
 
@@ -96,6 +98,9 @@ namespace {
     }
 
     db.setIndexCacheSize(0);
+    db.setLeafCacheSize(leafCacheSize);
+    db.setMemoryMapped(memoryMapped);
+    db.setBackgroundCommit(backgroundCommit);
     db.setBlockSize(blockSize);
     db.setIODevice(tmpFile);
     db.open();
@@ -174,6 +179,112 @@ TEST(BTreeDatabaseTest, Consistency) {
     testBTreeDatabase(30, 2, 2, 2, 200 + i);
 }
 
+TEST(BTreeDatabaseTest, MemoryMappedConsistency) {
+  testBTreeDatabase(500, 3, 5, 5, 512, true, 16);
+
+  for (size_t i = 0; i < 4; ++i)
+    testBTreeDatabase(30, 2, 2, 2, 200 + i, true, 1 + i);
+}
+
+TEST(BTreeDatabaseTest, BackgroundCommitConsistency) {
+  testBTreeDatabase(500, 3, 5, 5, 512, false, 0, true);
+  testBTreeDatabase(500, 3, 5, 5, 512, true, 16, true);
+
+  for (size_t i = 0; i < 4; ++i)
+    testBTreeDatabase(30, 2, 2, 2, 200 + i, false, 0, true);
+}
+
+namespace {
+  class FailingSyncBuffer : public Buffer {
+  public:
+    void sync() override {
+      if (failSync)
+        throw IOException("Simulated sync failure");
+    }
+
+    atomic<bool> failSync{false};
+  };
+}
+
+TEST(BTreeDatabaseTest, FailedBackgroundCommit) {
+  auto device = make_shared<FailingSyncBuffer>();
+
+  List<uint32_t> keys;
+  for (uint32_t k = 0; k < 200; ++k)
+    keys.append(k);
+
+  {
+    BTreeDatabase db("TestDB", 4);
+    db.setAutoCommit(false);
+    db.setBlockSize(256);
+    db.setIODevice(device);
+    db.open();
+
+    for (uint32_t k : keys.slice(0, 100))
+      db.insert(toByteArray(k), genBlock(k));
+    db.commit();
+
+    db.setBackgroundCommit(true);
+    for (uint32_t k : keys.slice(100))
+      db.insert(toByteArray(k), genBlock(k));
+    device->failSync = true;
+    db.commit();
+    EXPECT_THROW(db.setBackgroundCommit(false), IOException);
+
+    // The failed commit is kept in memory and retried by the next one.
+    device->failSync = false;
+    checkAll(db, keys);
+    db.commit();
+    db.close();
+  }
+
+  BTreeDatabase db("TestDB", 4);
+  db.setIODevice(device);
+  db.open();
+  checkAll(db, keys);
+  EXPECT_EQ(db.totalBlockCount(), db.freeBlockCount() + db.indexBlockCount() + db.leafBlockCount());
+  db.close();
+}
+
+TEST(BTreeDatabaseTest, Statistics) {
+  auto tmpFile = File::temporaryFile();
+  auto finallyGuard = finally([&tmpFile]() { tmpFile->remove(); });
+
+  List<uint32_t> keys;
+  for (uint32_t k = 0; k < 200; ++k)
+    keys.append(k);
+
+  {
+    BTreeDatabase db("TestDB", 4);
+    db.setBlockSize(256);
+    db.setIODevice(tmpFile);
+    db.open();
+    putAll(db, keys);
+    db.close();
+  }
+
+  BTreeDatabase db("TestDB", 4);
+  db.setMemoryMapped(true);
+  db.setLeafCacheSize(1024);
+  db.setIODevice(tmpFile);
+  db.open();
+
+  checkAll(db, keys);
+  auto first = db.statistics();
+  EXPECT_GT(first.mappedBytesRead, 0u);
+  EXPECT_EQ(first.deviceBytesRead, 0u);
+  EXPECT_GT(first.leafCacheMisses, 0u);
+
+  // Every leaf is now cached, so reading everything again reads no blocks.
+  checkAll(db, keys);
+  auto second = db.statistics();
+  EXPECT_EQ(second.mappedBytesRead, first.mappedBytesRead);
+  EXPECT_EQ(second.leafCacheMisses, first.leafCacheMisses);
+  EXPECT_GT(second.leafCacheHits, first.leafCacheHits);
+
+  db.close();
+}
+
 TEST(BTreeDatabaseTest, Threading) {
   auto tmpFile = File::temporaryFile();
   auto finallyGuard = finally([&tmpFile]() { tmpFile->remove(); });
@@ -0,0 +1,149 @@
+#include "StarCellularLighting.hpp"
+#include "StarRandom.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+namespace {
+  template <typename LightArray, typename RandomLight>
+  List<typename LightArray::LightValue> calculateRandomLighting(CellularLightSimd simd, RandomLight randomLight) {
+    // Odd sizes, so that the vector loops always leave cells for the scalar
+    // tails.
+    size_t const width = 53;
+    size_t const height = 37;
+
+    setCellularLightSimd(simd);
+    RandomSource rand(12345);
+
+    LightArray lightArray;
+    lightArray.setParameters(3, 6.0f, 3.0f, 40.0f, 5.0f, 0.2f);
+    lightArray.begin(width, height);
+    for (size_t x = 0; x < width; ++x) {
+      for (size_t y = 0; y < height; ++y) {
+        lightArray.setObstacle(x, y, rand.randf() < 0.3f);
+        if (rand.randf() < 0.05f)
+          lightArray.setLight(x, y, randomLight(rand));
+      }
+    }
+    for (size_t i = 0; i < 8; ++i)
+      lightArray.addSpreadLight({Vec2F(rand.randf(0, width), rand.randf(0, height)), randomLight(rand)});
+
+    size_t border = lightArray.borderCells();
+    lightArray.calculate(border, border, width - border, height - border);
+
+    List<typename LightArray::LightValue> result;
+    for (size_t x = 0; x < width; ++x) {
+      for (size_t y = 0; y < height; ++y)
+        result.append(lightArray.getLight(x, y));
+    }
+    return result;
+  }
+
+  Image calculateRandomTiledLighting(bool monochrome, unsigned tiles) {
+    RandomSource rand(54321);
+
+    CellularLightingCalculator calculator(monochrome);
+    calculator.setParameters(JsonObject{
+        {"spreadPasses", 3},
+        {"spreadMaxAir", 6.0f},
+        {"spreadMaxObstacle", 3.0f},
+        {"pointMaxAir", 10.0f},
+        {"pointMaxObstacle", 5.0f},
+        {"pointObstacleBoost", 0.2f}
+      });
+    calculator.setTiles(tiles);
+    calculator.begin(RectI(-20, 5, 47, 38));
+
+    RectI region = calculator.calculationRegion();
+    for (int x = region.xMin(); x < region.xMax(); ++x) {
+      size_t baseIndex = calculator.baseIndexFor(Vec2I(x, region.yMin()));
+      for (int y = 0; y < region.height(); ++y) {
+        Vec3F light;
+        if (rand.randf() < 0.05f)
+          light = Vec3F(rand.randf(), rand.randf(), rand.randf());
+        calculator.setCellIndex(baseIndex + y, light, rand.randf() < 0.3f);
+      }
+    }
+    for (size_t i = 0; i < 8; ++i) {
+      Vec2F position(rand.randf(region.xMin(), region.xMax()), rand.randf(region.yMin(), region.yMax()));
+      calculator.addSpreadLight(position, Vec3F(rand.randf(), rand.randf(), rand.randf()));
+    }
+    for (size_t i = 0; i < 4; ++i) {
+      Vec2F position(rand.randf(region.xMin(), region.xMax()), rand.randf(region.yMin(), region.yMax()));
+      calculator.addPointLight(position, Vec3F(rand.randf(), rand.randf(), rand.randf()), rand.randf(), rand.randf(0, 6), rand.randf());
+    }
+
+    Image output;
+    calculator.calculate(output);
+    return output;
+  }
+}
+
+TEST(CellularLightArrayTest, ScalarSimd) {
+  auto randomLight = [](RandomSource& rand) { return rand.randf(); };
+  auto reference = calculateRandomLighting<ScalarCellularLightArray>(CellularLightSimd::None, randomLight);
+
+  for (auto simd : {CellularLightSimd::SSE2, CellularLightSimd::AVX2}) {
+    if (simd > cellularLightSimdSupported())
+      continue;
+
+    auto result = calculateRandomLighting<ScalarCellularLightArray>(simd, randomLight);
+    ASSERT_EQ(result.size(), reference.size());
+    for (size_t i = 0; i < result.size(); ++i)
+      EXPECT_NEAR(result[i], reference[i], 1e-6f);
+  }
+
+  setCellularLightSimd(cellularLightSimdSupported());
+}
+
+TEST(CellularLightArrayTest, ColoredSimd) {
+  auto randomLight = [](RandomSource& rand) {
+    // Include unlit cells, which must not spread at all.
+    if (rand.randf() < 0.2f)
+      return Vec3F();
+    return Vec3F(rand.randf(), rand.randf(), rand.randf());
+  };
+  auto reference = calculateRandomLighting<ColoredCellularLightArray>(CellularLightSimd::None, randomLight);
+
+  for (auto simd : {CellularLightSimd::SSE2, CellularLightSimd::AVX2}) {
+    if (simd > cellularLightSimdSupported())
+      continue;
+
+    auto result = calculateRandomLighting<ColoredCellularLightArray>(simd, randomLight);
+    ASSERT_EQ(result.size(), reference.size());
+    for (size_t i = 0; i < result.size(); ++i) {
+      for (size_t c = 0; c < 3; ++c)
+        EXPECT_NEAR(result[i][c], reference[i][c], 1e-6f);
+    }
+  }
+
+  setCellularLightSimd(cellularLightSimdSupported());
+}
+
+TEST(CellularLightArrayTest, Tiles) {
+  for (bool monochrome : {false, true}) {
+    Image reference = calculateRandomTiledLighting(monochrome, 1);
+    for (unsigned tiles : {2, 3, 7}) {
+      Image result = calculateRandomTiledLighting(monochrome, tiles);
+      ASSERT_EQ(result.size(), reference.size());
+      for (unsigned x = 0; x < result.width(); ++x) {
+        for (unsigned y = 0; y < result.height(); ++y) {
+          Vec3B resultPixel = result.get24(x, y);
+          Vec3B referencePixel = reference.get24(x, y);
+          if (monochrome) {
+            EXPECT_EQ(resultPixel, referencePixel);
+          } else {
+            // The brightest channel never spreads further than the tile
+            // padding, but a dimmer channel carried along by the brightest
+            // channel of another light can, and is cut off at the tile edges.
+            // This is why tiles are off by default.
+            EXPECT_EQ(resultPixel.max(), referencePixel.max());
+            for (size_t c = 0; c < 3; ++c)
+              EXPECT_NEAR(resultPixel[c], referencePixel[c], 16);
+          }
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,41 @@
+#include "StarCompression.hpp"
+#include "StarRandom.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+TEST(CompressionTest, Stream) {
+  CompressionStream compressor;
+  DecompressionStream decompressor;
+
+  RandomSource random(1234);
+  ByteArray update = random.randBytes(200);
+
+  // Chunks that repeat earlier data are much smaller than the first.
+  ByteArray first = compressor.compress(update);
+  EXPECT_EQ(decompressor.uncompress(first), update);
+  ByteArray second = compressor.compress(update);
+  EXPECT_LT(second.size(), first.size() / 4);
+  EXPECT_EQ(decompressor.uncompress(second), update);
+
+  EXPECT_TRUE(compressor.compress(ByteArray()).empty());
+
+  ByteArray large = ByteArray(100000, 'a');
+  large.append(random.randBytes(100000));
+  EXPECT_EQ(decompressor.uncompress(compressor.compress(large)), large);
+
+  for (size_t i = 1; i < 100; ++i) {
+    ByteArray chunk = random.randBytes(i);
+    EXPECT_EQ(decompressor.uncompress(compressor.compress(chunk)), chunk);
+  }
+}
+
+TEST(CompressionTest, StreamCorruption) {
+  CompressionStream compressor;
+  DecompressionStream decompressor;
+
+  ByteArray chunk = compressor.compress(ByteArray(1000, 'a'));
+  chunk[0] = (char)0xff;
+  EXPECT_THROW(decompressor.uncompress(chunk), IOException);
+}
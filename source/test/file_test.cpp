@@ -49,3 +49,12 @@ TEST(FileTest, All) {
   EXPECT_EQ(File::relativeTo("/foo", "/bar/"), "/bar/");
 #endif
 }
+
+TEST(FileTest, ModificationTime) {
+  auto dir = File::temporaryDirectory();
+  String path = File::relativeTo(dir, "file");
+  File::writeFile(ByteArray("data", 4), path);
+  EXPECT_GT(File::modificationTime(path), 0);
+  EXPECT_THROW(File::modificationTime(File::relativeTo(dir, "missing")), IOException);
+  File::removeDirectoryRecursive(dir);
+}
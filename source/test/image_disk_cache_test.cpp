@@ -0,0 +1,86 @@
+#include "StarImageDiskCache.hpp"
+#include "StarFile.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+namespace {
+  Image testImage(uint8_t value) {
+    Image image(8, 8, PixelFormat::RGBA32);
+    image.fill(Vec4B(value, 255 - value, value / 2, 255));
+    return image;
+  }
+
+  void expectImage(Maybe<Image> const& image, uint8_t value) {
+    ASSERT_TRUE(image.isValid());
+    EXPECT_EQ(image->size(), Vec2U(8, 8));
+    EXPECT_EQ(image->pixelFormat(), PixelFormat::RGBA32);
+    EXPECT_EQ(image->get(3, 5), Vec4B(value, 255 - value, value / 2, 255));
+  }
+}
+
+TEST(ImageDiskCacheTest, StoreLoad) {
+  auto dir = File::temporaryDirectory();
+  {
+    ImageDiskCache cache(dir, 1 << 20);
+    EXPECT_FALSE(cache.load("a").isValid());
+
+    cache.store("a", testImage(10));
+    cache.store("b", testImage(20));
+    expectImage(cache.load("a"), 10);
+    expectImage(cache.load("b"), 20);
+
+    cache.store("a", testImage(30));
+    expectImage(cache.load("a"), 30);
+    EXPECT_EQ(cache.count(), 2u);
+  }
+
+  {
+    ImageDiskCache cache(dir, 1 << 20);
+    EXPECT_EQ(cache.count(), 2u);
+    expectImage(cache.load("a"), 30);
+    expectImage(cache.load("b"), 20);
+  }
+  File::removeDirectoryRecursive(dir);
+}
+
+TEST(ImageDiskCacheTest, Eviction) {
+  auto dir = File::temporaryDirectory();
+  uint64_t entrySize;
+  {
+    ImageDiskCache cache(dir, 1 << 20);
+    cache.store("size", testImage(0));
+    entrySize = cache.totalSize();
+  }
+  File::removeDirectoryRecursive(dir);
+
+  dir = File::temporaryDirectory();
+  {
+    ImageDiskCache cache(dir, entrySize * 3);
+    cache.store("a", testImage(1));
+    cache.store("b", testImage(2));
+    cache.store("c", testImage(3));
+    // Using "a" makes "b" the least recently used.
+    EXPECT_TRUE(cache.load("a").isValid());
+    cache.store("d", testImage(4));
+
+    EXPECT_EQ(cache.count(), 3u);
+    EXPECT_EQ(cache.totalSize(), entrySize * 3);
+    EXPECT_FALSE(cache.load("b").isValid());
+    expectImage(cache.load("a"), 1);
+    expectImage(cache.load("c"), 3);
+    expectImage(cache.load("d"), 4);
+  }
+
+  // The usage order is kept between instances, so with a smaller limit the
+  // least recently used "a" is removed.
+  {
+    ImageDiskCache cache(dir, entrySize * 2);
+    EXPECT_EQ(cache.count(), 2u);
+    EXPECT_FALSE(cache.load("a").isValid());
+    expectImage(cache.load("c"), 3);
+    expectImage(cache.load("d"), 4);
+  }
+  File::removeDirectoryRecursive(dir);
+}
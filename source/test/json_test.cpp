@@ -1,4 +1,5 @@
 #include "StarJson.hpp"
+#include "StarJsonBuilder.hpp"
 #include "StarFile.hpp"
 #include "StarJsonPatch.hpp"
 #include "StarJsonPath.hpp"
@@ -119,6 +120,74 @@ TEST(JsonTest, JsonParsingEdge) {
   EXPECT_TRUE(isValidJson(" {} "));
 }
 
+TEST(JsonTest, Utf8Parser) {
+  // The byte oriented parser must agree with JsonParser, both on results and
+  // on error messages.
+  auto referenceParse = [](String const& json, bool fragment) -> String {
+    try {
+      return inputUtf32Json<String::const_iterator>(json.begin(), json.end(), fragment).repr(0, true);
+    } catch (JsonParsingException const& e) {
+      return e.what();
+    }
+  };
+
+  auto utf8Parse = [](String const& json, bool fragment) -> String {
+    try {
+      return parseUtf8Json(json.utf8Ptr(), json.utf8Ptr() + json.utf8Size(), fragment).repr(0, true);
+    } catch (JsonParsingException const& e) {
+      return e.what();
+    }
+  };
+
+  StringList documents = {
+    "{}",
+    " [ ] ",
+    "\xef\xbb\xbf{\"bom\" : true}",
+    "{\"a\" : 1, \"b\" : -2, \"c\" : [1.5, -0.0, 1e3, 2.5E-3, 1., 12345678901234567890, 0.1234567890123456789]}",
+    "[9223372036854775807, -9223372036854775808, 1e400, 1e-400, 123456789e-30, 5e22, 5e23]",
+    "[true, false, null, \"\", \"plain string that is long enough to scan in blocks\"]",
+    "[\"esc\\\"aped\\\\ \\/ \\b\\f\\n\\r\\t\", \"\\u0041\\u00e9\\u65e5\\ud83d\\ude00 and more\"]",
+    "[\"日本語 and ascii after the multi-byte characters\", \"😀\"]",
+    "{ // line comment\n \"a\" /* block * comment */ : [1, /**/ 2] // trailing\n}",
+    "\t{\r\n\"deep\" : [[[[{\"x\" : [{}]}]]]]\r\n}\n",
+    "",
+    "{",
+    "[1, 2",
+    "[1 2]",
+    "{\"a\" 1}",
+    "{\"a\" : 1,}",
+    "{\"a\" : 1, \"a\" : 2}",
+    "[\"unterminated]",
+    "[\"bad \\q escape\"]",
+    "[tru]",
+    "[trUe]",
+    "[nul",
+    "[-]",
+    "[-.5]",
+    "[1]\n  x",
+    "[1] / 2",
+    "[1]\n\n日本 x",
+    "{\"a\" : 99999999999999999999}",
+    "true",
+    "\"fragment\"",
+    "  -12.5e+2 ",
+  };
+
+  for (auto const& document : documents) {
+    EXPECT_EQ(utf8Parse(document, false), referenceParse(document, false)) << document;
+    EXPECT_EQ(utf8Parse(document, true), referenceParse(document, true)) << document;
+  }
+
+  auto expectError = [](std::string const& json) {
+    EXPECT_THROW(parseUtf8Json(json.data(), json.data() + json.size(), false), JsonParsingException) << json;
+  };
+  expectError("[\"bad \\u12 escape\"]");
+  expectError("[\"lone \\ud83d surrogate\"]");
+  expectError("[\"\xc3\x28\"]");
+  expectError("[\"\xe6\x97");
+  expectError("[\"\xff\"]");
+}
+
 TEST(JsonTest, Types) {
   Json v;
   EXPECT_EQ(v.type(), Json::Type::Null);
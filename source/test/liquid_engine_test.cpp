@@ -0,0 +1,102 @@
+#include "StarCellularLiquid.hpp"
+#include "StarMultiArray.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+namespace {
+  int const TestWorldWidth = 96;
+  int const TestWorldHeight = 64;
+
+  // Wraps horizontally, with a solid floor and ceiling.
+  struct TestLiquidWorld : CellularLiquidWorld<uint8_t> {
+    TestLiquidWorld() : flows(TestWorldWidth, TestWorldHeight) {
+      flows.forEach([](Array2S const&, CellularLiquidFlowCell<uint8_t>& flow) {
+          flow = {{}, 0.0f, 0.0f};
+        });
+    }
+
+    Vec2I uniqueLocation(Vec2I const& location) const override {
+      return Vec2I(pmod(location[0], TestWorldWidth), location[1]);
+    }
+
+    CellularLiquidCell<uint8_t> cell(Vec2I const& location) const override {
+      if (location[1] <= 0 || location[1] >= TestWorldHeight - 1)
+        return CellularLiquidCollisionCell();
+      return flows(location[0], location[1]);
+    }
+
+    void setFlow(Vec2I const& location, CellularLiquidFlowCell<uint8_t> const& flow) override {
+      flows(location[0], location[1]) = flow;
+    }
+
+    float totalLevel() const {
+      float total = 0.0f;
+      flows.forEach([&](Array2S const&, CellularLiquidFlowCell<uint8_t> const& flow) {
+          total += flow.level;
+        });
+      return total;
+    }
+
+    int highestLiquid() const {
+      int highest = 0;
+      flows.forEach([&](Array2S const& index, CellularLiquidFlowCell<uint8_t> const& flow) {
+          if (flow.liquid)
+            highest = max(highest, (int)index[1]);
+        });
+      return highest;
+    }
+
+    MultiArray<CellularLiquidFlowCell<uint8_t>, 2> flows;
+  };
+
+  LiquidCellEngineParameters testEngineParameters() {
+    LiquidCellEngineParameters parameters;
+    parameters.lateralMoveFactor = 0.4f;
+    parameters.spreadOverfillUpFactor = 0.2f;
+    parameters.spreadOverfillLateralFactor = 0.4f;
+    parameters.spreadOverfillDownFactor = 0.6f;
+    parameters.pressureEqualizeFactor = 0.3f;
+    parameters.pressureMoveFactor = 0.03f;
+    parameters.maximumPressureLevelImbalance = 0.1f;
+    parameters.minimumLivenPressureChange = 0.002f;
+    parameters.minimumLivenLevelChange = 0.002f;
+    // Never delete liquid, so that the total level is conserved.
+    parameters.minimumLiquidLevel = 0.0f;
+    parameters.interactTransformationLevel = 0.3f;
+    return parameters;
+  }
+
+  // Drops a block of liquid starting at xMin, which may cross the wrapping
+  // edge of the world, and lets it settle.
+  void testLiquidSettles(WorkerPoolPtr workerPool, int xMin) {
+    auto world = make_shared<TestLiquidWorld>();
+    for (int x = xMin; x < xMin + 16; ++x) {
+      for (int y = 30; y < 50; ++y)
+        world->setFlow(world->uniqueLocation({x, y}), {uint8_t(1), 1.0f, 0.0f});
+    }
+    float initialLevel = world->totalLevel();
+
+    LiquidCellEngine<uint8_t> engine(testEngineParameters(), world);
+    engine.setWorkerPool(workerPool, 4);
+    engine.visitRegion(RectI(0, 0, TestWorldWidth, TestWorldHeight));
+    for (size_t i = 0; i < 600; ++i)
+      engine.update();
+
+    EXPECT_NEAR(world->totalLevel(), initialLevel, initialLevel * 1e-4f);
+    // 320 cells of liquid spread over a 96 cell wide floor.
+    EXPECT_LT(world->highestLiquid(), 10);
+  }
+}
+
+TEST(LiquidCellEngineTest, Serial) {
+  testLiquidSettles({}, 40);
+  testLiquidSettles({}, 88);
+}
+
+TEST(LiquidCellEngineTest, Parallel) {
+  auto workerPool = make_shared<WorkerPool>("LiquidCellEngineTest", 3);
+  testLiquidSettles(workerPool, 40);
+  testLiquidSettles(workerPool, 88);
+}
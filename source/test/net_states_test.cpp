@@ -1,4 +1,5 @@
 #include "StarNetElementSystem.hpp"
+#include "StarTime.hpp"
 
 #include "gtest/gtest.h"
 
@@ -1056,3 +1057,157 @@ TEST(NetElements, NetElementSignal) {
   EXPECT_EQ(slaveSignal1.receive(), List<int>({}));
   EXPECT_EQ(slaveSignal2.receive(), List<int>({}));
 }
+
+TEST(NetElements, GroupChangeTracking) {
+  NetElementInt masterField1;
+  NetElementInt masterField2;
+  NetElementInt masterSyncField;
+  NetElementGroup masterSubGroup;
+  NetElementCallbackGroup masterSyncGroup;
+  NetElementTop<NetElementGroup> master;
+
+  int syncValue = 0;
+  masterSyncGroup.setNeedsStoreCallback([&]() { masterSyncField.set(syncValue); });
+  masterSyncGroup.addNetElement(&masterSyncField);
+  masterSubGroup.addNetElement(&masterField2);
+  master.addNetElement(&masterField1);
+  master.addNetElement(&masterSubGroup);
+
+  NetElementInt slaveField1;
+  NetElementInt slaveField2;
+  NetElementInt slaveSyncField;
+  NetElementGroup slaveSubGroup;
+  NetElementSyncGroup slaveSyncGroup;
+  NetElementTop<NetElementGroup> slave;
+
+  slaveSyncGroup.addNetElement(&slaveSyncField);
+  slaveSubGroup.addNetElement(&slaveField2);
+  slave.addNetElement(&slaveField1);
+  slave.addNetElement(&slaveSubGroup);
+
+  auto update = master.writeNetState();
+  slave.readNetState(update.first);
+
+  // Nothing changed, so the whole tree is skipped.
+  EXPECT_TRUE(master.netChangeVersion().isValid());
+  update = master.writeNetState(update.second);
+  EXPECT_TRUE(update.first.empty());
+
+  masterField2.set(10);
+  update = master.writeNetState(update.second);
+  slave.readNetState(update.first);
+  EXPECT_EQ(slaveField2.get(), 10);
+
+  update = master.writeNetState(update.second);
+  EXPECT_TRUE(update.first.empty());
+
+  // Sync groups only change while writing, so adding one to a nested group
+  // means the tree is always visited again.
+  masterSubGroup.addNetElement(&masterSyncGroup);
+  slaveSubGroup.addNetElement(&slaveSyncGroup);
+  EXPECT_FALSE(master.netChangeVersion().isValid());
+
+  syncValue = 20;
+  update = master.writeNetState(update.second);
+  slave.readNetState(update.first);
+  EXPECT_EQ(slaveSyncField.get(), 20);
+
+  update = master.writeNetState(update.second);
+  EXPECT_TRUE(update.first.empty());
+
+  // Once the sync group is gone the tree can be skipped again.
+  masterSubGroup.clearNetElements();
+  masterSubGroup.addNetElement(&masterField2);
+  EXPECT_TRUE(master.netChangeVersion().isValid());
+
+  masterField1.set(30);
+  masterField2.set(40);
+  update = master.writeNetState(update.second);
+  EXPECT_FALSE(update.first.empty());
+  update = master.writeNetState(update.second);
+  EXPECT_TRUE(update.first.empty());
+
+  // Copies of an element are not part of the group it was added to.
+  NetElementInt copiedField = masterField1;
+  copiedField.set(50);
+  update = master.writeNetState(update.second);
+  EXPECT_TRUE(update.first.empty());
+}
+
+TEST(NetElements, GroupLifetime) {
+  // Elements destroyed before their group leave it.
+  NetElementTop<NetElementGroup> group;
+  NetElementInt field;
+  group.addNetElement(&field);
+  {
+    NetElementInt temporaryField;
+    group.addNetElement(&temporaryField);
+  }
+  field.set(10);
+  auto update = group.writeNetState();
+
+  NetElementTop<NetElementGroup> slave;
+  NetElementInt slaveField;
+  slave.addNetElement(&slaveField);
+  slave.readNetState(update.first);
+  EXPECT_EQ(slaveField.get(), 10);
+
+  // Elements that outlive their group no longer report changes to it.
+  NetElementInt outlivingField;
+  {
+    NetElementTop<NetElementGroup> temporaryGroup;
+    temporaryGroup.addNetElement(&outlivingField);
+  }
+  outlivingField.set(20);
+  EXPECT_EQ(outlivingField.get(), 20);
+}
+
+// Microbenchmark of writing deltas for many entities with nested groups of
+// fields, where either nothing or one field changes every step.  Prints the
+// time per delta write, and only checks the deltas that were written.
+TEST(NetElements, DeltaWriteBenchmark) {
+  size_t const EntityCount = 1000;
+  size_t const GroupCount = 8;
+  size_t const FieldCount = 16;
+  size_t const Steps = 100;
+
+  struct BenchmarkEntity {
+    NetElementTop<NetElementGroup> top;
+    NetElementGroup groups[GroupCount];
+    NetElementInt fields[GroupCount][FieldCount];
+    uint64_t version = 0;
+  };
+
+  List<unique_ptr<BenchmarkEntity>> entities;
+  for (size_t i = 0; i < EntityCount; ++i) {
+    auto entity = make_unique<BenchmarkEntity>();
+    for (size_t g = 0; g < GroupCount; ++g) {
+      for (size_t f = 0; f < FieldCount; ++f)
+        entity->groups[g].addNetElement(&entity->fields[g][f]);
+      entity->top.addNetElement(&entity->groups[g]);
+    }
+    entity->version = entity->top.writeNetState().second;
+    entities.append(std::move(entity));
+  }
+
+  auto run = [&](String const& name, bool active) {
+    size_t deltas = 0;
+    double start = Time::monotonicTime();
+    for (size_t step = 0; step < Steps; ++step) {
+      for (auto& entity : entities) {
+        if (active)
+          entity->fields[step % GroupCount][step % FieldCount].set(step + 1);
+        auto update = entity->top.writeNetState(entity->version);
+        entity->version = update.second;
+        if (!update.first.empty())
+          ++deltas;
+      }
+    }
+    double time = Time::monotonicTime() - start;
+    coutf("NetElements DeltaWriteBenchmark {}: {:.1f}ns per delta write\n", name, time * 1e9 / (Steps * EntityCount));
+    return deltas;
+  };
+
+  EXPECT_EQ(run("idle", false), 0u);
+  EXPECT_EQ(run("active", true), Steps * EntityCount);
+}
@@ -0,0 +1,38 @@
+#include "StarPerlin.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+template <typename Float>
+void testBatchedPerlin(PerlinType type) {
+  Perlin<Float> perlin(type, 4, 0.013, 1.5, 0.25, 2.0, 2.0, 4321);
+
+  // Spans negative and positive coordinates, with a count that is not a
+  // multiple of any batch or vector size.
+  List<Float> xs;
+  List<Float> ys;
+  for (int y = -40; y < 43; ++y) {
+    for (int x = -70; x < 67; ++x) {
+      xs.append(x * 1.37);
+      ys.append(y * 0.91);
+    }
+  }
+
+  List<Float> results(xs.size(), 0);
+  perlin.get(xs.size(), xs.ptr(), ys.ptr(), results.ptr());
+  for (size_t i = 0; i < xs.size(); ++i)
+    ASSERT_EQ(results[i], perlin.get(xs[i], ys[i])) << "at " << xs[i] << ", " << ys[i];
+}
+
+TEST(PerlinTest, Batched) {
+  for (auto type : {PerlinType::Perlin, PerlinType::Billow, PerlinType::RidgedMulti}) {
+    testBatchedPerlin<float>(type);
+    testBatchedPerlin<double>(type);
+  }
+
+  PerlinF uninitialized;
+  float x = 0.0f;
+  float result;
+  EXPECT_THROW(uninitialized.get(1, &x, &x, &result), PerlinException);
+}
@@ -0,0 +1,67 @@
+#include "StarSocket.hpp"
+#include "StarTcp.hpp"
+#include "StarTime.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+TEST(SocketPollerTest, Readiness) {
+  TcpServer tcpServer(HostAddressWithPort(HostAddress::localhost(), 0));
+  auto client = TcpSocket::connectTo(tcpServer.listenAddress());
+  auto server = tcpServer.accept(10000);
+  ASSERT_TRUE(server);
+  server->setNonBlocking(true);
+
+  SocketPoller poller;
+  poller.set(server, {true, false});
+  EXPECT_TRUE(poller.contains(server));
+  EXPECT_TRUE(poller.wait(0).empty());
+
+  client->send("abc", 3);
+  auto result = poller.wait(10000);
+  ASSERT_TRUE(result.contains(server));
+  EXPECT_TRUE(result.get(server).readable);
+  EXPECT_FALSE(result.get(server).writable);
+
+  // Stays ready until the data is read.
+  EXPECT_TRUE(poller.wait(0).contains(server));
+  char buffer[3];
+  EXPECT_EQ(server->receive(buffer, 3), 3u);
+  EXPECT_TRUE(poller.wait(0).empty());
+
+  poller.set(server, {true, true});
+  result = poller.wait(10000);
+  ASSERT_TRUE(result.contains(server));
+  EXPECT_TRUE(result.get(server).writable);
+
+  poller.remove(server);
+  EXPECT_FALSE(poller.contains(server));
+  client->send("abc", 3);
+  EXPECT_TRUE(poller.wait(10).empty());
+
+  // Closed sockets may be left in the set.
+  poller.set(server, {true, false});
+  server->close();
+  EXPECT_TRUE(poller.wait(10).empty());
+  poller.remove(server);
+  EXPECT_EQ(poller.size(), 0u);
+}
+
+TEST(SocketPollerTest, Wake) {
+  SocketPoller poller;
+
+  poller.wake();
+  double start = Time::monotonicTime();
+  EXPECT_TRUE(poller.wait(10000).empty());
+  EXPECT_LT(Time::monotonicTime() - start, 5.0);
+
+  auto waker = Thread::invoke("SocketPollerTest::waker", [&poller]() {
+      Thread::sleep(20);
+      poller.wake();
+    });
+  start = Time::monotonicTime();
+  EXPECT_TRUE(poller.wait(10000).empty());
+  EXPECT_LT(Time::monotonicTime() - start, 5.0);
+  waker.finish();
+}
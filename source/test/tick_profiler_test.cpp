@@ -0,0 +1,105 @@
+#include "StarTickProfiler.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+TEST(TickProfilerTest, Disabled) {
+  TickProfiler profiler;
+  auto section = profiler.section("section");
+
+  profiler.beginTick();
+  {
+    TickProfiler::Scope scope(profiler, section);
+  }
+  profiler.endTick();
+
+  EXPECT_EQ(profiler.summary().getUInt("ticks"), 0u);
+  EXPECT_EQ(profiler.traceEvents(1, "process").size(), 1u);
+}
+
+TEST(TickProfilerTest, Summary) {
+  TickProfiler profiler(4);
+  profiler.setEnabled(true);
+  auto fast = profiler.section("fast");
+  auto slow = profiler.section("slow");
+  EXPECT_EQ(profiler.section("fast"), fast);
+
+  for (int i = 0; i < 6; ++i) {
+    profiler.beginTick();
+    profiler.record(fast, 0.0, 0.001);
+    profiler.record(slow, 0.0, 0.002);
+    profiler.record(slow, 1.0, 1.002);
+    profiler.endTick();
+  }
+
+  auto summary = profiler.summary();
+  EXPECT_EQ(summary.getUInt("ticks"), 4u);
+
+  // The recorded sections are much slower than the ticks themselves.
+  auto sections = summary.getArray("sections");
+  ASSERT_EQ(sections.size(), 3u);
+  EXPECT_EQ(sections[0].getString("name"), "slow");
+  EXPECT_NEAR(sections[0].getFloat("meanMs"), 4.0, 0.001);
+  EXPECT_NEAR(sections[0].getFloat("p99Ms"), 4.0, 0.001);
+  EXPECT_EQ(sections[1].getString("name"), "fast");
+  EXPECT_NEAR(sections[1].getFloat("maxMs"), 1.0, 0.001);
+  EXPECT_EQ(sections[2].getString("name"), "tick");
+
+  profiler.setEnabled(false);
+  profiler.setEnabled(true);
+  EXPECT_EQ(profiler.summary().getUInt("ticks"), 0u);
+}
+
+TEST(TickProfilerTest, TraceEvents) {
+  TickProfiler profiler(10, 2);
+  profiler.setEnabled(true);
+  auto section = profiler.section("section");
+
+  for (int i = 0; i < 3; ++i) {
+    profiler.beginTick();
+    profiler.record(section, i, i + 0.5, i);
+    profiler.endTick();
+  }
+
+  // The metadata event, then a section and tick event for the last two ticks.
+  auto events = profiler.traceEvents(7, "process");
+  ASSERT_EQ(events.size(), 5u);
+  EXPECT_EQ(events[0].getString("ph"), "M");
+  EXPECT_EQ(events[0].getString("name"), "process_name");
+  EXPECT_EQ(events[1].getString("name"), "section");
+  EXPECT_EQ(events[1].getString("ph"), "X");
+  EXPECT_EQ(events[1].getInt("pid"), 7);
+  EXPECT_EQ(events[1].get("args").getInt("id"), 1);
+  EXPECT_NEAR(events[1].getDouble("ts"), 1000000.0, 0.001);
+  EXPECT_NEAR(events[1].getDouble("dur"), 500000.0, 0.001);
+  EXPECT_EQ(events[2].getString("name"), "tick");
+}
+
+TEST(TickProfilerTest, ParallelRecording) {
+  TickProfiler profiler;
+  profiler.setEnabled(true);
+  auto section = profiler.section("section");
+
+  profiler.beginTick();
+  List<ThreadFunction<void>> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.append(Thread::invoke("TickProfilerTest", [&profiler, section]() {
+        for (int j = 0; j < 100; ++j)
+          profiler.record(section, 0.0, 0.0001);
+      }));
+  }
+  for (auto& thread : threads)
+    thread.finish();
+  profiler.endTick();
+
+  Maybe<Json> sectionSummary;
+  for (auto const& s : profiler.summary().getArray("sections")) {
+    if (s.getString("name") == "section") {
+      sectionSummary = s;
+      break;
+    }
+  }
+  ASSERT_TRUE(sectionSummary.isValid());
+  EXPECT_NEAR(sectionSummary->getFloat("meanMs"), 40.0, 0.01);
+}
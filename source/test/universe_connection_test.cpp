@@ -14,6 +14,7 @@ unsigned const ASyncSleepMillis = 5;
 
 unsigned const NumLocalSyncConnections = 5;
 unsigned const NumRemoteSyncConnections = 5;
+unsigned const NumRemoteStreamCompressedConnections = 5;
 unsigned const SyncWaitMillis = 10000;
 
 class ASyncClientThread : public Thread {
@@ -136,6 +137,15 @@ TEST(UniverseConnections, All) {
     remoteSyncClients.emplaceAppend(UniverseConnection(TcpPacketSocket::open(std::move(socket))));
   }
 
+  LinkedList<SyncClientThread> remoteStreamCompressedClients;
+  for (unsigned i = 0; i < NumRemoteStreamCompressedConnections; ++i) {
+    auto socket = TcpSocket::connectTo({HostAddress::localhost(), ServerPort});
+    socket->setNonBlocking(true);
+    auto connection = UniverseConnection(TcpPacketSocket::open(std::move(socket)));
+    connection.setStreamCompression(true);
+    remoteStreamCompressedClients.emplaceAppend(std::move(connection));
+  }
+
   for (auto& c : localASyncClients)
     c.join();
 
@@ -148,5 +158,8 @@ TEST(UniverseConnections, All) {
   for (auto& c : remoteSyncClients)
     c.join();
 
+  for (auto& c : remoteStreamCompressedClients)
+    c.join();
+
   server.removeAllConnections();
 }
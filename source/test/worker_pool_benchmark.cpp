@@ -0,0 +1,81 @@
+#include "StarWorkerPool.hpp"
+#include "StarTime.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace Star;
+
+// Microbenchmark of WorkerPool scheduling overhead, queueing many jobs that
+// each do next to no work.  Prints the throughput of every case, and only
+// checks that all of the work was done.
+
+namespace {
+  size_t const BenchmarkJobs = 100000;
+
+  void reportThroughput(String const& name, size_t jobs, double seconds) {
+    coutf("WorkerPoolBenchmark {}: {} jobs in {:.1f}ms, {:.0f} jobs/s\n", name, jobs, seconds * 1000.0, jobs / seconds);
+  }
+}
+
+TEST(WorkerPoolBenchmark, ExternalProducers) {
+  unsigned threads = max(Thread::numberOfProcessors(), 2u);
+  WorkerPool workerPool("WorkerPoolBenchmark", threads);
+
+  atomic<size_t> counter(0);
+  double start = Time::monotonicTime();
+  List<WorkerPoolPromise<size_t>> promises;
+  promises.reserve(BenchmarkJobs);
+  for (size_t i = 0; i < BenchmarkJobs; ++i)
+    promises.append(workerPool.addProducer<size_t>([&counter, i]() { ++counter; return i; }));
+
+  size_t sum = 0;
+  for (auto& promise : promises)
+    sum += promise.get();
+  reportThroughput("external producers", BenchmarkJobs, Time::monotonicTime() - start);
+
+  EXPECT_EQ(counter, BenchmarkJobs);
+  EXPECT_EQ(sum, BenchmarkJobs * (BenchmarkJobs - 1) / 2);
+}
+
+TEST(WorkerPoolBenchmark, NestedWork) {
+  unsigned threads = max(Thread::numberOfProcessors(), 2u);
+  WorkerPool workerPool("WorkerPoolBenchmark", threads);
+
+  // Each outer job fans out into inner jobs from a worker thread, which are
+  // queued locally and stolen by the other threads.
+  size_t const outerJobs = 100;
+  size_t const innerJobs = BenchmarkJobs / outerJobs;
+
+  atomic<size_t> counter(0);
+  double start = Time::monotonicTime();
+  List<WorkerPoolPromise<List<WorkerPoolHandle>>> outer;
+  for (size_t i = 0; i < outerJobs; ++i) {
+    outer.append(workerPool.addProducer<List<WorkerPoolHandle>>([&]() {
+        List<WorkerPoolHandle> inner;
+        inner.reserve(innerJobs);
+        for (size_t j = 0; j < innerJobs; ++j)
+          inner.append(workerPool.addWork([&counter]() { ++counter; }));
+        return inner;
+      }));
+  }
+
+  for (auto& promise : outer) {
+    for (auto const& handle : promise.get())
+      handle.finish();
+  }
+  reportThroughput("nested work", outerJobs * innerJobs, Time::monotonicTime() - start);
+
+  EXPECT_EQ(counter, outerJobs * innerJobs);
+}
+
+TEST(WorkerPoolBenchmark, ContinuationChain) {
+  WorkerPool workerPool("WorkerPoolBenchmark", 2);
+
+  size_t const chainLength = BenchmarkJobs / 10;
+  double start = Time::monotonicTime();
+  auto promise = workerPool.addProducer<size_t>([]() { return (size_t)0; });
+  for (size_t i = 0; i < chainLength; ++i)
+    promise = promise.then([](size_t& value) { return value + 1; });
+  EXPECT_EQ(promise.get(), chainLength);
+  reportThroughput("continuation chain", chainLength, Time::monotonicTime() - start);
+}
@@ -1,4 +1,5 @@
 #include "StarWorkerPool.hpp"
+#include "StarArray.hpp"
 
 #include "gtest/gtest.h"
 
@@ -32,3 +33,111 @@ TEST(WorkerPoolTest, All) {
 
   EXPECT_EQ(counter, 100);
 }
+
+TEST(WorkerPoolTest, Priority) {
+  List<int> order;
+  Mutex orderMutex;
+
+  WorkerPool workerPool("WorkerPoolTest");
+  List<WorkerPoolHandle> handles;
+  for (int i = 0; i < 3; ++i) {
+    for (auto priority : {WorkerPoolPriority::Low, WorkerPoolPriority::Normal, WorkerPoolPriority::High}) {
+      handles.append(workerPool.addWork([&order, &orderMutex, priority]() {
+          MutexLocker locker(orderMutex);
+          order.append((int)priority);
+        }, priority));
+    }
+  }
+
+  // A single thread started after all work is queued must run it strictly in
+  // priority order.
+  workerPool.start(1);
+  for (auto const& handle : handles)
+    handle.finish();
+
+  EXPECT_EQ(order, List<int>({2, 2, 2, 1, 1, 1, 0, 0, 0}));
+}
+
+TEST(WorkerPoolTest, Continuations) {
+  WorkerPool workerPool("WorkerPoolTest", 4);
+
+  auto promise = workerPool.addProducer<int>([]() { return 20; })
+      .then([](int& value) { return value + 1; })
+      .then([](int& value) { return toString(value * 2); });
+  EXPECT_EQ(promise.get(), "42");
+
+  // Continuations added after the work is already finished still run.
+  auto finished = workerPool.addProducer<int>([]() { return 1; });
+  finished.get();
+  EXPECT_EQ(finished.then([](int& value) { return value + 1; }).get(), 2);
+
+  atomic<int> counter(0);
+  auto handle = workerPool.addWork([&counter]() { ++counter; })
+      .then([&counter]() { ++counter; });
+  handle.finish();
+  EXPECT_EQ(counter, 2);
+
+  // Exceptions skip continuations and are forwarded to the end of the chain.
+  bool called = false;
+  auto failed = workerPool.addProducer<int>([]() -> int { throw WorkerPoolException("failed"); })
+      .then([&called](int& value) { called = true; return value; });
+  EXPECT_THROW(failed.get(), WorkerPoolException);
+  EXPECT_FALSE(called);
+
+  // Continuations follow the pool when it is moved.
+  auto moved = workerPool.addProducer<int>([]() { return 3; });
+  moved.get();
+  WorkerPool movedPool = std::move(workerPool);
+  EXPECT_EQ(moved.then([](int& value) { return value + 1; }).get(), 4);
+
+  // Continuations can no longer be queued once the pool is destroyed, and
+  // finish with an exception instead of being called.
+  auto orphanedPool = make_unique<WorkerPool>("WorkerPoolTest", 1);
+  auto orphaned = orphanedPool->addProducer<int>([]() { return 5; });
+  EXPECT_EQ(orphaned.get(), 5);
+  orphanedPool.reset();
+  bool orphanedCalled = false;
+  auto orphanedContinuation = orphaned.then([&orphanedCalled](int& value) { orphanedCalled = true; return value; });
+  EXPECT_THROW(orphanedContinuation.get(), WorkerPoolException);
+  EXPECT_THROW(orphanedContinuation.then([](int&) {}).finish(), WorkerPoolException);
+  EXPECT_FALSE(orphanedCalled);
+}
+
+TEST(WorkerPoolTest, NestedWork) {
+  WorkerPool workerPool("WorkerPoolTest", 4);
+
+  // Work queued from a worker thread goes to that thread's own queue and must
+  // be stolen by the others to make progress.
+  atomic<int> counter(0);
+  List<WorkerPoolHandle> handles;
+  Mutex handlesMutex;
+  for (int i = 0; i < 10; ++i) {
+    workerPool.addWork([&]() {
+        for (int j = 0; j < 100; ++j) {
+          auto handle = workerPool.addWork([&counter]() { ++counter; });
+          MutexLocker locker(handlesMutex);
+          handles.append(std::move(handle));
+        }
+      }).finish();
+  }
+
+  for (auto const& handle : handles)
+    handle.finish();
+  EXPECT_EQ(counter, 1000);
+}
+
+TEST(WorkerPoolTest, JobStorage) {
+  int value = 0;
+  WorkerPoolJob small([&value]() { ++value; });
+  EXPECT_FALSE(small.heapAllocated());
+
+  Array<int64_t, 32> payload = Array<int64_t, 32>::filled(1);
+  WorkerPoolJob large([&value, payload]() { value += payload[0]; });
+  EXPECT_TRUE(large.heapAllocated());
+
+  WorkerPoolJob moved = std::move(large);
+  EXPECT_FALSE(large);
+  small();
+  moved();
+  EXPECT_EQ(value, 2);
+}
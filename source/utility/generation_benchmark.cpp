@@ -2,6 +2,8 @@
 #include "StarCelestialDatabase.hpp"
 #include "StarWorldTemplate.hpp"
 #include "StarWorldServer.hpp"
+#include "StarTerrainDatabase.hpp"
+#include "StarAssets.hpp"
 
 using namespace Star;
 
@@ -12,6 +14,8 @@ int main(int argc, char** argv) {
     rootLoader.addParameter("regions", "regions", OptionParser::Optional, "number of regions to generate, default 1000");
     rootLoader.addParameter("regionsize", "size", OptionParser::Optional, "width / height of each generation region, default 10");
     rootLoader.addParameter("reportevery", "report regions", OptionParser::Optional, "number of generation regions before each progress report, default 20");
+    rootLoader.addParameter("selectorcolumns", "columns", OptionParser::Optional, "number of sector high columns to evaluate each terrain selector over, default 200");
+    rootLoader.addParameter("beamdowns", "beamdowns", OptionParser::Optional, "number of beam-downs to new surface positions to time, default 20");
 
     RootUPtr root;
     OptionParser::Options options;
@@ -44,6 +48,14 @@ int main(int argc, char** argv) {
     if (auto reportEveryOption = options.parameters.maybe("reportevery"))
       reportEvery = lexicalCast<unsigned>(reportEveryOption->first());
 
+    unsigned selectorColumns = 200;
+    if (auto selectorColumnsOption = options.parameters.maybe("selectorcolumns"))
+      selectorColumns = lexicalCast<unsigned>(selectorColumnsOption->first());
+
+    unsigned beamDowns = 20;
+    if (auto beamDownsOption = options.parameters.maybe("beamdowns"))
+      beamDowns = lexicalCast<unsigned>(beamDownsOption->first());
+
     coutf("testing generation on coordinate {}\n", coordinate);
 
     auto worldParameters = celestialDatabase.parameters(coordinate).take();
@@ -51,10 +63,91 @@ int main(int argc, char** argv) {
 
     auto rand = RandomSource(worldTemplate->worldSeed());
 
+    // Compares evaluating the terrain selectors one tile at a time against
+    // filling whole sector columns at once.  Each way uses its own columns, so
+    // that neither benefits from selector caches warmed up by the other.
+    if (auto worldLayout = worldTemplate->worldLayout()) {
+      auto worldSize = worldTemplate->size();
+      size_t tiles = selectorColumns * WorldSectorSize;
+      double tileTime = 0.0;
+      double columnTime = 0.0;
+      size_t mismatches = 0;
+
+      for (auto const& selector : worldLayout->terrainSelectors()) {
+        auto randomColumns = [&]() {
+          List<Vec2I> columns;
+          for (unsigned i = 0; i < selectorColumns; ++i)
+            columns.append(Vec2I(rand.randInt(0, worldSize[0] - 1), rand.randInt(0, worldSize[1] / WorldSectorSize - 1) * WorldSectorSize));
+          return columns;
+        };
+        List<Vec2I> tileColumns = randomColumns();
+        List<Vec2I> batchColumns = randomColumns();
+        List<float> values(WorldSectorSize, 0.0f);
+        List<float> expected(WorldSectorSize, 0.0f);
+
+        double start = Time::monotonicTime();
+        for (auto const& column : tileColumns) {
+          for (size_t y = 0; y < WorldSectorSize; ++y)
+            values[y] = selector->get(column[0], column[1] + y);
+        }
+        double selectorTileTime = Time::monotonicTime() - start;
+
+        start = Time::monotonicTime();
+        for (auto const& column : batchColumns)
+          selector->getColumn(column[0], column[1], WorldSectorSize, values.ptr());
+        double selectorColumnTime = Time::monotonicTime() - start;
+
+        for (auto const& column : tileColumns) {
+          selector->getColumn(column[0], column[1], WorldSectorSize, values.ptr());
+          for (size_t y = 0; y < WorldSectorSize; ++y)
+            expected[y] = selector->get(column[0], column[1] + y);
+          if (values != expected)
+            ++mismatches;
+        }
+
+        coutf("Terrain selector '{}': {:.0f} tiles/s per tile, {:.0f} tiles/s per column\n",
+            selector->type, tiles / selectorTileTime, tiles / selectorColumnTime);
+        tileTime += selectorTileTime;
+        columnTime += selectorColumnTime;
+      }
+
+      size_t totalTiles = tiles * worldLayout->terrainSelectors().size();
+      coutf("All terrain selectors: {:.0f} tiles/s per tile, {:.0f} tiles/s per column, {:.2f}x\n",
+          totalTiles / tileTime, totalTiles / columnTime, tileTime / columnTime);
+      if (mismatches != 0)
+        coutf("WARNING: {} columns differ from evaluating each tile\n", mismatches);
+    }
+
+    // Beaming down generates every sector around the player start before the
+    // player can enter, so the time until those sectors are ready is what the
+    // player waits for.  The first beam-down is the world's initial
+    // generation, the others generate the same area at new surface positions.
+    auto generationConfig = root->assets()->json("/worldstorage.config").get("parallelSectorGeneration", JsonObject());
+    int beamDownRadius = root->assets()->json("/worldserver.config:playerStartInitialGenRadius").toInt();
+    int surfaceLevel = worldTemplate->surfaceLevel();
+
+    double start = Time::monotonicTime();
     WorldServer worldServer(std::move(worldTemplate), File::ephemeralFile());
+    double initialBeamDown = Time::monotonicTime() - start;
     Vec2U worldSize = worldServer.geometry().size();
 
-    double start = Time::monotonicTime();
+    List<double> beamDownLatencies;
+    for (unsigned i = 0; i < beamDowns; ++i) {
+      Vec2I position(rand.randInt(0, worldSize[0] - 1), surfaceLevel);
+      start = Time::monotonicTime();
+      worldServer.generateRegion(RectI::withCenter(position, Vec2I()).padded(beamDownRadius));
+      beamDownLatencies.append(Time::monotonicTime() - start);
+    }
+    sort(beamDownLatencies);
+
+    coutf("Beam-down sector-ready latency (parallel sector generation {}, {} threads): initial {:.1f}ms",
+        generationConfig.getBool("enabled", false) ? "enabled" : "disabled", generationConfig.getUInt("threads", 2), initialBeamDown * 1000.0);
+    if (!beamDownLatencies.empty())
+      coutf(", median {:.1f}ms, max {:.1f}ms over {} beam-downs",
+          beamDownLatencies[beamDownLatencies.size() / 2] * 1000.0, beamDownLatencies.last() * 1000.0, beamDownLatencies.size());
+    coutf("\n");
+
+    start = Time::monotonicTime();
     double lastReport = Time::monotonicTime();
 
     coutf("Starting world generation for {} regions\n", regionsToGenerate);
@@ -70,7 +163,9 @@ int main(int argc, char** argv) {
       worldServer.generateRegion(region);
     }
 
-    coutf("Finished generating {} regions with size {}x{} in world '{}' in {} seconds", regionsToGenerate, regionSize, regionSize, coordinate, Time::monotonicTime() - start);
+    double totalTime = Time::monotonicTime() - start;
+    coutf("Finished generating {} regions with size {}x{} in world '{}' in {} seconds, {:.0f} tiles/s\n",
+        regionsToGenerate, regionSize, regionSize, coordinate, totalTime, regionsToGenerate * regionSize * regionSize / totalTime);
 
     return 0;
 
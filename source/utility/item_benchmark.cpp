@@ -0,0 +1,83 @@
+#include "StarRootLoader.hpp"
+#include "StarItemDatabase.hpp"
+#include "StarItem.hpp"
+#include "StarLexicalCast.hpp"
+#include "StarRandom.hpp"
+
+using namespace Star;
+
+// Builds the given number of items, split between the given number of
+// threads, and returns the time taken in seconds.  Each item is a random one
+// of the given items with a random level and seed, so that its builder script
+// generates it from scratch.
+double buildItems(List<String> const& itemNames, unsigned items, unsigned threads) {
+  auto itemDatabase = Root::singleton().itemDatabase();
+
+  double start = Time::monotonicTime();
+  List<ThreadFunction<void>> builders;
+  for (unsigned t = 0; t < threads; ++t) {
+    unsigned threadItems = items / threads + (t < items % threads ? 1 : 0);
+    builders.append(Thread::invoke("ItemBenchmark", [&itemNames, itemDatabase, threadItems, t]() {
+        RandomSource rand(t);
+        for (unsigned i = 0; i < threadItems; ++i) {
+          auto const& name = rand.randFrom(itemNames);
+          itemDatabase->item(ItemDescriptor(name, 1), rand.randf(1.0f, 10.0f), rand.randu64());
+        }
+      }));
+  }
+  for (auto& builder : builders)
+    builder.finish();
+  return Time::monotonicTime() - start;
+}
+
+int main(int argc, char** argv) {
+  try {
+    RootLoader rootLoader({{}, {}, {}, LogLevel::Error, false, {}});
+    rootLoader.addParameter("items", "items", OptionParser::Optional, "number of items to build, default 100000");
+    rootLoader.addParameter("threads", "threads", OptionParser::Optional, "number of threads to build items from, default the number of processors");
+
+    RootUPtr root;
+    OptionParser::Options options;
+    tie(root, options) = rootLoader.commandInitOrDie(argc, argv);
+
+    unsigned items = 100000;
+    if (auto itemsOption = options.parameters.maybe("items"))
+      items = lexicalCast<unsigned>(itemsOption->first());
+
+    unsigned threads = Thread::numberOfProcessors();
+    if (auto threadsOption = options.parameters.maybe("threads"))
+      threads = max(lexicalCast<unsigned>(threadsOption->first()), 1u);
+
+    auto itemDatabase = root->itemDatabase();
+    List<String> weapons;
+    for (auto const& name : itemDatabase->allItems()) {
+      if (itemDatabase->itemTags(name).contains("weapon"))
+        weapons.append(name);
+    }
+    if (weapons.empty()) {
+      cerrf("No weapons found\n");
+      return 1;
+    }
+
+    // Warms up the builder contexts of every Lua slot, so that neither run
+    // includes loading the builder scripts.
+    buildItems(weapons, weapons.size() * threads, threads);
+
+    coutf("Building {} items from {} weapons, {} Lua slots\n",
+        items, weapons.size(), root->configuration()->get("assetLuaRoots").optUInt().value(min(Thread::numberOfProcessors(), 8u)));
+
+    double singleTime = buildItems(weapons, items, 1);
+    coutf("1 thread: {:.2f}s, {:.0f} items/s\n", singleTime, items / singleTime);
+
+    if (threads > 1) {
+      double multiTime = buildItems(weapons, items, threads);
+      coutf("{} threads: {:.2f}s, {:.0f} items/s, {:.2f}x\n", threads, multiTime, items / multiTime, singleTime / multiTime);
+    }
+
+    return 0;
+
+  } catch (std::exception const& e) {
+    cerrf("Exception caught: {}\n", outputException(e, true));
+    return 1;
+  }
+}
@@ -0,0 +1,90 @@
+#include "StarDirectoryAssetSource.hpp"
+#include "StarPackedAssetSource.hpp"
+#include "StarJsonBuilder.hpp"
+#include "StarLexicalCast.hpp"
+#include "StarTime.hpp"
+#include "StarFile.hpp"
+#include "StarMathCommon.hpp"
+
+using namespace Star;
+
+// Parses every JSON asset in the given asset sources with both the UTF-32
+// JsonParser and the byte oriented UTF-8 parser, checks that the results are
+// identical, and reports the time each parser took.
+int main(int argc, char** argv) {
+  try {
+    if (argc < 2) {
+      cerrf("Usage: {} <assets directory or pak>... [-r repetitions]\n", argv[0]);
+      return 1;
+    }
+
+    unsigned repetitions = 5;
+    List<AssetSourcePtr> sources;
+    for (int i = 1; i < argc; ++i) {
+      String arg = argv[i];
+      if (arg == "-r" && i + 1 < argc)
+        repetitions = lexicalCast<unsigned>(String(argv[++i]));
+      else if (File::isDirectory(arg))
+        sources.append(make_shared<DirectoryAssetSource>(arg));
+      else
+        sources.append(make_shared<PackedAssetSource>(arg));
+    }
+
+    // Anything the existing parser accepts counts as a JSON asset, whatever
+    // its extension.
+    List<ByteArray> documents;
+    size_t totalBytes = 0;
+    size_t skipped = 0;
+    for (auto const& source : sources) {
+      for (auto const& path : source->assetPaths()) {
+        ByteArray data = source->read(path);
+        try {
+          inputUtf32Json(U8ToU32Iterator<char const*>(data.ptr()), U8ToU32Iterator<char const*>(data.ptr() + data.size()), false);
+        } catch (std::exception const&) {
+          ++skipped;
+          continue;
+        }
+        totalBytes += data.size();
+        documents.append(std::move(data));
+      }
+    }
+    coutf("Found {} JSON assets totalling {:.1f}MB, skipped {} other files\n", documents.size(), totalBytes / 1048576.0, skipped);
+
+    size_t mismatches = 0;
+    for (auto const& data : documents) {
+      Json reference = inputUtf32Json(U8ToU32Iterator<char const*>(data.ptr()), U8ToU32Iterator<char const*>(data.ptr() + data.size()), false);
+      Json result = parseUtf8Json(data.ptr(), data.ptr() + data.size(), false);
+      if (result != reference || result.repr(0, true) != reference.repr(0, true))
+        ++mismatches;
+    }
+    if (mismatches != 0) {
+      cerrf("{} assets parsed differently\n", mismatches);
+      return 1;
+    }
+
+    auto benchmark = [&](String const& name, function<Json(ByteArray const&)> parse) {
+      double bestTime = highest<double>();
+      for (unsigned r = 0; r < repetitions; ++r) {
+        double start = Time::monotonicTime();
+        for (auto const& data : documents)
+          parse(data);
+        bestTime = min(bestTime, Time::monotonicTime() - start);
+      }
+      coutf("{}: best of {} in {:.1f}ms, {:.1f}MB/s\n", name, repetitions, bestTime * 1000.0, totalBytes / 1048576.0 / bestTime);
+      return bestTime;
+    };
+
+    double utf32Time = benchmark("JsonParser (UTF-32)", [](ByteArray const& data) {
+        return inputUtf32Json(U8ToU32Iterator<char const*>(data.ptr()), U8ToU32Iterator<char const*>(data.ptr() + data.size()), false);
+      });
+    double utf8Time = benchmark("parseUtf8Json", [](ByteArray const& data) {
+        return parseUtf8Json(data.ptr(), data.ptr() + data.size(), false);
+      });
+    coutf("Speedup: {:.2f}x\n", utf32Time / utf8Time);
+
+    return 0;
+  } catch (std::exception const& e) {
+    cerrf("Exception caught: {}\n", outputException(e, true));
+    return 1;
+  }
+}
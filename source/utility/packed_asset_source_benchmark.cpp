@@ -0,0 +1,108 @@
+#include "StarPackedAssetSource.hpp"
+#include "StarDirectoryAssetSource.hpp"
+#include "StarBuffer.hpp"
+#include "StarCasting.hpp"
+#include "StarFile.hpp"
+#include "StarRandom.hpp"
+#include "StarTime.hpp"
+#include "StarLexicalCast.hpp"
+
+#ifdef STAR_SYSTEM_LINUX
+#include <fstream>
+#include <unistd.h>
+#endif
+
+using namespace Star;
+
+// Compares loading every asset of a pak through file reads with loading them
+// through a memory mapping, the way compressed audio is loaded: devices that
+// are ExternalBuffers are used in place, anything else is read into memory.
+// Prints the time taken and the private memory held by the loaded assets.
+
+// Resident memory that is not backed by files, or 0 where unavailable.
+int64_t privateMemory() {
+#ifdef STAR_SYSTEM_LINUX
+  std::ifstream statm("/proc/self/statm");
+  int64_t size, resident, shared;
+  if (statm >> size >> resident >> shared)
+    return (resident - shared) * sysconf(_SC_PAGESIZE);
+#endif
+  return 0;
+}
+
+struct LoadedAsset {
+  IODevicePtr device;
+  ByteArray data;
+
+  char const* ptr() const {
+    if (auto buffer = as<ExternalBuffer>(device))
+      return buffer->ptr();
+    return data.ptr();
+  }
+};
+
+LoadedAsset load(IODevicePtr device) {
+  if (is<ExternalBuffer>(device))
+    return {device, {}};
+  return {{}, device->readBytes(device->size())};
+}
+
+int main(int argc, char** argv) {
+  try {
+    size_t assetCount = 32;
+    size_t assetSize = 1 << 20;
+    if (argc > 1)
+      assetCount = lexicalCast<size_t>(String(argv[1]));
+    if (argc > 2)
+      assetSize = lexicalCast<size_t>(String(argv[2]));
+
+    auto dir = File::temporaryDirectory();
+    auto removeGuard = finally([&dir]() { File::removeDirectoryRecursive(dir); });
+
+    String assetsDir = File::relativeTo(dir, "assets");
+    File::makeDirectory(assetsDir);
+    RandomSource random(1234);
+    for (size_t i = 0; i < assetCount; ++i)
+      File::writeFile(random.randBytes(assetSize), File::relativeTo(assetsDir, strf("{}.ogg", i)));
+
+    String pakPath = File::relativeTo(dir, "assets.pak");
+    DirectoryAssetSource directorySource(assetsDir);
+    PackedAssetSource::build(directorySource, pakPath);
+
+    List<uint64_t> checksums;
+    for (bool memoryMapped : {false, true}) {
+      PackedAssetSource source(pakPath, memoryMapped);
+      if (source.isMemoryMapped() != memoryMapped)
+        coutf("Could not memory map '{}', reading it instead\n", pakPath);
+
+      int64_t memoryBefore = privateMemory();
+      double start = Time::monotonicTime();
+      List<LoadedAsset> assets;
+      uint64_t checksum = 0;
+      for (auto const& path : source.assetPaths()) {
+        assets.append(load(source.open(path)));
+        // Touches every page, like a decoder would.
+        char const* ptr = assets.last().ptr();
+        for (size_t i = 0; i < assetSize; i += 4096)
+          checksum += (uint8_t)ptr[i];
+      }
+      double time = Time::monotonicTime() - start;
+      int64_t memoryHeld = privateMemory() - memoryBefore;
+
+      coutf("{}: loaded {} assets in {:.1f}ms, private memory held {:.1f}MB\n",
+          memoryMapped ? "mapped" : "read", assets.size(), time * 1000.0, memoryHeld / 1048576.0);
+      checksums.append(checksum);
+    }
+
+    if (checksums[0] != checksums[1]) {
+      cerrf("Mapped and read assets differ\n");
+      return 1;
+    }
+
+    return 0;
+
+  } catch (std::exception const& e) {
+    cerrf("Exception caught: {}\n", outputException(e, true));
+    return 1;
+  }
+}
@@ -0,0 +1,95 @@
+#include "StarRootLoader.hpp"
+#include "StarWorldServer.hpp"
+#include "StarMovementController.hpp"
+#include "StarMaterialDatabase.hpp"
+#include "StarRandom.hpp"
+#include "StarFile.hpp"
+#include "StarTime.hpp"
+#include "StarLexicalCast.hpp"
+
+using namespace Star;
+
+// Microbenchmark of MovementController collision, with many small bodies
+// bouncing around inside a walled arena scattered with blocks, so every body
+// queries and resolves collisions every tick.  Prints the time per body tick.
+
+float const BenchmarkBodySpeed = 20.0f;
+
+int main(int argc, char** argv) {
+  try {
+    RootLoader rootLoader({{}, {}, {}, LogLevel::Error, false, {}});
+    rootLoader.addParameter("bodies", "bodies", OptionParser::Optional, "number of bouncing bodies, default 500");
+    rootLoader.addParameter("steps", "steps", OptionParser::Optional, "number of ticks to run, default 200");
+
+    RootUPtr root;
+    OptionParser::Options options;
+    tie(root, options) = rootLoader.commandInitOrDie(argc, argv);
+
+    unsigned bodyCount = 500;
+    if (auto bodiesOption = options.parameters.maybe("bodies"))
+      bodyCount = max(lexicalCast<unsigned>(bodiesOption->first()), 1u);
+
+    unsigned steps = 200;
+    if (auto stepsOption = options.parameters.maybe("steps"))
+      steps = max(lexicalCast<unsigned>(stepsOption->first()), 1u);
+
+    WorldServer world(Vec2U(512, 512), File::ephemeralFile());
+    RectI arena(Vec2I(128, 128), Vec2I(256, 256));
+    world.generateRegion(arena.padded(WorldSectorSize));
+
+    MaterialId material = root->materialDatabase()->materialId("dirt");
+    TileModificationList modifications;
+    for (int x = arena.xMin(); x < arena.xMax(); ++x) {
+      for (int y = arena.yMin(); y < arena.yMax(); ++y) {
+        bool wall = x == arena.xMin() || x == arena.xMax() - 1 || y == arena.yMin() || y == arena.yMax() - 1;
+        if (wall || (x % 8 == 0 && y % 8 == 0))
+          modifications.append({Vec2I(x, y), PlaceMaterial{TileLayer::Foreground, material, {}}});
+      }
+    }
+    world.applyTileModifications(modifications, true);
+
+    MovementParameters parameters(JsonObject{
+        {"collisionPoly", JsonArray{JsonArray{-0.5, -0.5}, JsonArray{0.5, -0.5}, JsonArray{0.5, 0.5}, JsonArray{-0.5, 0.5}}},
+        {"bounceFactor", 1.0},
+        {"gravityEnabled", false},
+        {"frictionEnabled", false}
+      });
+
+    RandomSource random(1234);
+    RectF inside = RectF(arena).padded(-2.0f);
+    List<unique_ptr<MovementController>> bodies;
+    for (unsigned i = 0; i < bodyCount; ++i) {
+      auto body = make_unique<MovementController>(parameters);
+      body->init(&world);
+      body->setPosition(Vec2F(random.randf(inside.xMin(), inside.xMax()), random.randf(inside.yMin(), inside.yMax())));
+      body->setVelocity(Vec2F::withAngle(random.randf() * 2 * Constants::pi, BenchmarkBodySpeed));
+      bodies.append(std::move(body));
+    }
+
+    double start = Time::monotonicTime();
+    for (unsigned step = 0; step < steps; ++step) {
+      for (auto& body : bodies)
+        body->tickMaster(GlobalTimestep);
+    }
+    double time = Time::monotonicTime() - start;
+    coutf("{} bouncing bodies, {} steps: {:.0f}ns per body tick\n", bodyCount, steps, time * 1e9 / ((double)bodyCount * steps));
+
+    RectF outerBounds = RectF(arena);
+    size_t escaped = 0;
+    for (auto& body : bodies) {
+      if (!outerBounds.contains(body->position()))
+        ++escaped;
+      body->uninit();
+    }
+    if (escaped != 0) {
+      cerrf("{} bodies escaped the arena\n", escaped);
+      return 1;
+    }
+
+    return 0;
+
+  } catch (std::exception const& e) {
+    cerrf("Exception caught: {}\n", outputException(e, true));
+    return 1;
+  }
+}
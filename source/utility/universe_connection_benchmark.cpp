@@ -0,0 +1,120 @@
+#include "StarUniverseConnection.hpp"
+#include "StarTcp.hpp"
+#include "StarTime.hpp"
+#include "StarLexicalCast.hpp"
+
+#include <ctime>
+
+using namespace Star;
+
+// Loopback benchmark of UniverseConnectionServer, with many simulated clients
+// that each send a packet to an echoing server every round and wait for the
+// reply.  Prints the round trip latency and the process CPU time used while
+// active and while idle.
+
+unsigned const BenchmarkRounds = 50;
+// Time between rounds, roughly a server tick.
+unsigned const BenchmarkRoundInterval = 16;
+unsigned const BenchmarkIdleTime = 500;
+unsigned const BenchmarkReplyTimeout = 10000;
+
+double processCpuTime() {
+  return (double)std::clock() / CLOCKS_PER_SEC;
+}
+
+void benchmarkClients(unsigned clientCount) {
+  UniverseConnectionServer server([](UniverseConnectionServer* server, ConnectionId clientId, List<PacketPtr> packets) {
+      server->sendPackets(clientId, std::move(packets));
+    });
+
+  atomic<ConnectionId> nextClientId(ServerConnectionId);
+  TcpServer tcpServer(HostAddressWithPort(HostAddress::localhost(), 0));
+  tcpServer.setAcceptCallback([&server, &nextClientId](TcpSocketPtr socket) {
+      server.addConnection(++nextClientId, UniverseConnection(TcpPacketSocket::open(std::move(socket))));
+    });
+
+  List<PacketSocketUPtr> clients;
+  SocketPoller clientPoller;
+  HashMap<Socket*, size_t> clientIndexes;
+  for (unsigned i = 0; i < clientCount; ++i) {
+    clients.append(TcpPacketSocket::open(TcpSocket::connectTo(tcpServer.listenAddress())));
+    clientPoller.set(clients.last()->pollSocket(), {true, false});
+    clientIndexes[clients.last()->pollSocket().get()] = i;
+  }
+
+  auto timer = Timer::withMilliseconds(BenchmarkReplyTimeout);
+  while (server.allConnections().size() < clientCount && !timer.timeUp())
+    Thread::sleep(1);
+  if (server.allConnections().size() != clientCount)
+    throw StarException::format("Only {} of {} clients connected", server.allConnections().size(), clientCount);
+
+  List<double> latencies;
+  double wallStart = Time::monotonicTime();
+  double cpuStart = processCpuTime();
+  for (unsigned round = 0; round < BenchmarkRounds; ++round) {
+    List<double> sendTimes;
+    for (auto& client : clients) {
+      sendTimes.append(Time::monotonicTime());
+      client->sendPackets({make_shared<ProtocolRequestPacket>(round)});
+      client->writeData();
+    }
+
+    size_t replies = 0;
+    timer = Timer::withMilliseconds(BenchmarkReplyTimeout);
+    while (replies < clientCount && !timer.timeUp()) {
+      for (auto const& p : clientPoller.wait(10)) {
+        size_t index = clientIndexes.get(p.first.get());
+        clients[index]->readData();
+        for (auto const& packet : clients[index]->receivePackets()) {
+          if (convert<ProtocolRequestPacket>(packet)->requestProtocolVersion != round)
+            throw StarException::format("Client {} received a reply from the wrong round", index);
+          latencies.append(Time::monotonicTime() - sendTimes[index]);
+          ++replies;
+        }
+      }
+    }
+    if (replies != clientCount)
+      throw StarException::format("Only {} of {} replies received in round {}", replies, clientCount, round);
+
+    Thread::sleep(BenchmarkRoundInterval);
+  }
+  double activeWall = Time::monotonicTime() - wallStart;
+  double activeCpu = processCpuTime() - cpuStart;
+
+  wallStart = Time::monotonicTime();
+  cpuStart = processCpuTime();
+  Thread::sleep(BenchmarkIdleTime);
+  double idleWall = Time::monotonicTime() - wallStart;
+  double idleCpu = processCpuTime() - cpuStart;
+
+  sort(latencies);
+  double meanLatency = 0.0;
+  for (double latency : latencies)
+    meanLatency += latency / latencies.size();
+  double p99Latency = latencies[min(latencies.size() - 1, latencies.size() * 99 / 100)];
+
+  coutf("{} clients: round trip mean {:.3f}ms p99 {:.3f}ms, cpu active {:.1f}% idle {:.1f}%\n",
+      clientCount, meanLatency * 1000.0, p99Latency * 1000.0, activeCpu / activeWall * 100.0, idleCpu / idleWall * 100.0);
+
+  tcpServer.stop();
+  server.removeAllConnections();
+}
+
+int main(int argc, char** argv) {
+  try {
+    List<unsigned> clientCounts;
+    for (int i = 1; i < argc; ++i)
+      clientCounts.append(lexicalCast<unsigned>(String(argv[i])));
+    if (clientCounts.empty())
+      clientCounts = {50, 100, 200};
+
+    for (auto clientCount : clientCounts)
+      benchmarkClients(clientCount);
+
+    return 0;
+
+  } catch (std::exception const& e) {
+    cerrf("Exception caught: {}\n", outputException(e, true));
+    return 1;
+  }
+}
@@ -2,10 +2,231 @@
 #include "StarLogging.hpp"
 #include "StarRootLoader.hpp"
 #include "StarWorldServer.hpp"
+#include "StarWorldServerThread.hpp"
 #include "StarWorldTemplate.hpp"
+#include "StarWorldClientState.hpp"
+#include "StarNetPacketSocket.hpp"
+#include "StarMonsterDatabase.hpp"
+#include "StarMonster.hpp"
+#include "StarProjectileDatabase.hpp"
+#include "StarProjectile.hpp"
+#include "StarDataStreamDevices.hpp"
+#include "StarFile.hpp"
+
+#ifdef STAR_SYSTEM_LINUX
+#include <fstream>
+#include <unistd.h>
+#endif
 
 using namespace Star;
 
+// Width and height of the window each fake client monitors, in tiles.
+Vec2I const FakeClientWindowSize = Vec2I(100, 60);
+// Fake clients walk back and forth this far either side of where they spawned,
+// so that sectors keep being loaded and unloaded.
+float const FakeClientWalkRange = 300.0f;
+float const FakeClientWalkPeriod = 60.0f;
+
+// A client connected to a world over a pair of local packet sockets, which
+// acknowledges the world start and then only moves its window around.
+struct FakeClient {
+  FakeClient(ConnectionId clientId) : clientId(clientId), packetsReceived(0), bytesReceived(0) {
+    tie(serverSocket, clientSocket) = LocalPacketSocket::openPair();
+  }
+
+  void update(double time) {
+    List<PacketPtr> outgoing;
+    for (auto const& packet : clientSocket->receivePackets()) {
+      DataStreamBuffer ds;
+      packet->write(ds);
+      ++packetsReceived;
+      bytesReceived += ds.size();
+
+      if (auto worldStart = as<WorldStartPacket>(packet)) {
+        start = worldStart->playerStart;
+        outgoing.append(make_shared<WorldStartAcknowledgePacket>());
+      }
+    }
+
+    if (start) {
+      float offset = std::sin(time * 2 * Constants::pi / FakeClientWalkPeriod) * FakeClientWalkRange;
+      state.setWindow(RectI::withCenter(Vec2I::round(*start + Vec2F(offset, 0.0f)), FakeClientWindowSize));
+      outgoing.append(make_shared<WorldClientStateUpdatePacket>(state.writeDelta()));
+    }
+
+    clientSocket->sendPackets(std::move(outgoing));
+  }
+
+  ConnectionId clientId;
+  LocalPacketSocketUPtr serverSocket;
+  LocalPacketSocketUPtr clientSocket;
+  WorldClientState state;
+  Maybe<Vec2F> start;
+  uint64_t packetsReceived;
+  uint64_t bytesReceived;
+};
+typedef shared_ptr<FakeClient> FakeClientPtr;
+
+// Resident memory of the whole process, or 0 where unavailable.
+int64_t residentMemory() {
+#ifdef STAR_SYSTEM_LINUX
+  std::ifstream statm("/proc/self/statm");
+  int64_t size, resident;
+  if (statm >> size >> resident)
+    return resident * sysconf(_SC_PAGESIZE);
+#endif
+  return 0;
+}
+
+Json tickTimesJson(WorldServerTickTimes const& times) {
+  double perUpdate = times.updates == 0 ? 0.0 : 1000.0 / times.updates;
+  JsonObject phases;
+  for (size_t i = 0; i < WorldServerTickPhaseCount; ++i)
+    phases[WorldServerTickPhaseNames.getRight((WorldServerTickPhase)i)] = times.phases[i] * perUpdate;
+  return JsonObject{{"updates", times.updates}, {"totalMs", times.total() * perUpdate}, {"phasesMs", phases}};
+}
+
+// Runs the given number of copies of the world each on its own
+// WorldServerThread, as the universe server does, with fake clients connected
+// to every world.  Every world gets its own template, since placing dungeons
+// modifies it.  Tick times are per update, averaged over the run.
+//
+// With a projectile type, every world also spawns that many indiscriminate
+// projectiles per step around its first client, a projectile storm for
+// measuring the damage phase.
+Json runScaling(function<WorldTemplatePtr()> makeWorldTemplate, unsigned worldCount, unsigned clientsPerWorld,
+    Maybe<String> const& monsterType, unsigned monstersPerWorld, Maybe<String> const& projectileType,
+    unsigned projectilesPerStep, uint64_t steps, uint64_t reportEvery) {
+  struct BenchmarkWorld {
+    WorldServerThreadPtr thread;
+    List<FakeClientPtr> clients;
+    shared_ptr<atomic<uint64_t>> updates;
+    bool monstersSpawned;
+    bool stormStarted;
+  };
+
+  int64_t memoryBefore = residentMemory();
+  double bootStart = Time::monotonicTime();
+  List<BenchmarkWorld> worlds;
+  for (unsigned i = 0; i < worldCount; ++i) {
+    auto worldServer = make_shared<WorldServer>(makeWorldTemplate(), File::ephemeralFile());
+    BenchmarkWorld world{make_shared<WorldServerThread>(worldServer, InstanceWorldId(strf("benchmark{}", i))), {}, make_shared<atomic<uint64_t>>(0), false, false};
+    world.thread->setUpdateAction([updates = world.updates](WorldServerThread*, WorldServer*) { ++*updates; });
+    for (unsigned j = 0; j < clientsPerWorld; ++j) {
+      auto client = make_shared<FakeClient>(ServerConnectionId + 1 + j);
+      world.thread->addClient(client->clientId, {}, false);
+      world.clients.append(std::move(client));
+    }
+    worlds.append(std::move(world));
+  }
+  double bootTime = Time::monotonicTime() - bootStart;
+  coutf("Booted {} worlds with {} clients each in {:.2f}s\n", worldCount, clientsPerWorld, bootTime);
+
+  auto monsterDatabase = Root::singleton().monsterDatabase();
+  auto projectileDatabase = Root::singleton().projectileDatabase();
+  for (auto& world : worlds)
+    world.thread->start();
+
+  double start = Time::monotonicTime();
+  double lastReport = start;
+  while (true) {
+    double time = Time::monotonicTime() - start;
+    uint64_t slowestUpdates = highest<uint64_t>();
+    for (auto& world : worlds) {
+      for (auto const& client : world.clients) {
+        world.thread->pushIncomingPackets(client->clientId, client->serverSocket->receivePackets());
+        client->serverSocket->sendPackets(world.thread->pullOutgoingPackets(client->clientId));
+        client->update(time);
+      }
+
+      if (monsterType && !world.monstersSpawned && !world.clients.empty() && world.clients.first()->start) {
+        Vec2F spawnPosition = *world.clients.first()->start;
+        world.thread->executeAction([&](WorldServerThread*, WorldServer* worldServer) {
+            for (unsigned i = 0; i < monstersPerWorld; ++i) {
+              auto monster = monsterDatabase->createMonster(monsterDatabase->randomMonster(*monsterType));
+              monster->setPosition(spawnPosition + Vec2F(Random::randf(-FakeClientWindowSize[0], FakeClientWindowSize[0]) / 2, 0.0f));
+              worldServer->addEntity(monster);
+            }
+          });
+        world.monstersSpawned = true;
+      }
+
+      if (projectileType && !world.stormStarted && !world.clients.empty() && world.clients.first()->start) {
+        Vec2F stormCenter = *world.clients.first()->start;
+        Json parameters = JsonObject{{"damageTeam", JsonObject{{"type", "indiscriminate"}}}};
+        world.thread->setUpdateAction([=, updates = world.updates](WorldServerThread*, WorldServer* worldServer) {
+            ++*updates;
+            for (unsigned i = 0; i < projectilesPerStep; ++i) {
+              auto projectile = projectileDatabase->createProjectile(*projectileType, parameters);
+              projectile->setInitialPosition(stormCenter + Vec2F(Random::randf(-1, 1) * FakeClientWindowSize[0], Random::randf(-1, 1) * FakeClientWindowSize[1]) / 2);
+              projectile->setInitialDirection(Vec2F::withAngle(Random::randf() * 2 * Constants::pi));
+              worldServer->addEntity(projectile);
+            }
+          });
+        world.stormStarted = true;
+      }
+
+      if (world.thread->serverErrorOccurred())
+        throw StarException("World thread stopped with an error");
+      slowestUpdates = min<uint64_t>(slowestUpdates, *world.updates);
+    }
+
+    if (reportEvery != 0 && Time::monotonicTime() - lastReport >= reportEvery / 60.0) {
+      lastReport = Time::monotonicTime();
+      coutf("{:.1f}s | slowest world at step {} of {}\n", lastReport - start, slowestUpdates, steps);
+    }
+
+    if (slowestUpdates >= steps)
+      break;
+    Thread::sleep(1);
+  }
+  double wallTime = Time::monotonicTime() - start;
+
+  JsonArray worldResults;
+  WorldServerTickTimes totalTimes;
+  for (auto& world : worlds) {
+    world.thread->stop();
+
+    Json worldResult;
+    world.thread->executeAction([&](WorldServerThread*, WorldServer* worldServer) {
+        uint64_t entities = 0;
+        worldServer->forEachEntity(RectF(Vec2F(), Vec2F(worldServer->geometry().size())), [&](auto const&) { ++entities; });
+
+        auto const& times = worldServer->tickTimes();
+        totalTimes.updates += times.updates;
+        for (size_t i = 0; i < WorldServerTickPhaseCount; ++i)
+          totalTimes.phases[i] += times.phases[i];
+
+        JsonArray clients;
+        for (auto const& client : world.clients)
+          clients.append(JsonObject{{"packetsReceived", client->packetsReceived}, {"bytesReceived", client->bytesReceived}});
+
+        worldResult = JsonObject{
+          {"updateRate", times.updates / wallTime},
+          {"entities", entities},
+          {"luaMemory", worldServer->luaRoot()->luaMemoryUsage()},
+          {"tickTime", tickTimesJson(times)},
+          {"clients", clients}
+        };
+      });
+    worldResults.append(worldResult);
+  }
+
+  return JsonObject{
+    {"worlds", worldCount},
+    {"clientsPerWorld", clientsPerWorld},
+    {"monstersPerWorld", monsterType ? monstersPerWorld : 0},
+    {"projectilesPerStep", projectileType ? projectilesPerStep : 0},
+    {"steps", steps},
+    {"bootTime", bootTime},
+    {"wallTime", wallTime},
+    {"residentMemory", residentMemory()},
+    {"residentMemoryGrowth", residentMemory() - memoryBefore},
+    {"tickTime", tickTimesJson(totalTimes)},
+    {"perWorld", worldResults}
+  };
+}
+
 int main(int argc, char** argv) {
   try {
     RootLoader rootLoader({{}, {}, {}, LogLevel::Error, false, {}});
@@ -16,6 +237,13 @@ int main(int argc, char** argv) {
     rootLoader.addParameter("signalevery", "signal steps", OptionParser::Optional, "number of steps to wait between scanning and signaling all entities to stay alive, default 120");
     rootLoader.addParameter("reportevery", "report steps", OptionParser::Optional, "number of steps between each progress report, default 0 (do not report progress)");
     rootLoader.addParameter("fidelity", "server fidelity", OptionParser::Optional, "fidelity to run the server with, default high");
+    rootLoader.addParameter("worlds", "worlds", OptionParser::Optional, "run this many copies of the world at once on world server threads, with fake clients, and report per-phase tick times");
+    rootLoader.addParameter("clients", "clients", OptionParser::Optional, "number of fake clients connected to each world when running several worlds, default 1");
+    rootLoader.addParameter("monster", "monster type", OptionParser::Optional, "type of monster to spawn around the first client of each world when running several worlds");
+    rootLoader.addParameter("monsters", "monsters", OptionParser::Optional, "number of monsters to spawn in each world, default 20");
+    rootLoader.addParameter("projectile", "projectile type", OptionParser::Optional, "type of projectile to keep spawning around the first client of each world when running several worlds");
+    rootLoader.addParameter("projectiles", "projectiles", OptionParser::Optional, "number of projectiles to spawn in each world every step, default 10");
+    rootLoader.addParameter("json", "file", OptionParser::Optional, "file to write the results of running several worlds to as JSON, by default they are printed");
     rootLoader.addSwitch("profiling", "whether to use lua profiling, prints the profile with info logging");
     rootLoader.addSwitch("unsafe", "enables unsafe lua libraries");
     RootUPtr root;
@@ -59,6 +287,37 @@ int main(int argc, char** argv) {
     if (options.parameters.contains("reportevery"))
       reportEvery = lexicalCast<uint64_t>(options.parameters.get("reportevery").first());
 
+    if (auto worldsOption = options.parameters.maybe("worlds")) {
+      unsigned worldCount = lexicalCast<unsigned>(worldsOption->first());
+      unsigned clientsPerWorld = options.parameters.maybe("clients").apply([](StringList const& p) { return lexicalCast<unsigned>(p.first()); }).value(1);
+      unsigned monstersPerWorld = options.parameters.maybe("monsters").apply([](StringList const& p) { return lexicalCast<unsigned>(p.first()); }).value(20);
+      auto monsterType = options.parameters.maybe("monster").apply([](StringList const& p) { return p.first(); });
+      unsigned projectilesPerStep = options.parameters.maybe("projectiles").apply([](StringList const& p) { return lexicalCast<unsigned>(p.first()); }).value(10);
+      auto projectileType = options.parameters.maybe("projectile").apply([](StringList const& p) { return p.first(); });
+
+      JsonArray runs;
+      for (uint64_t i = 0; i < times; ++i) {
+        coutf("Starting {} worlds for {} steps\n", worldCount, steps);
+        auto makeWorldTemplate = [&]() {
+          return make_shared<WorldTemplate>(worldParameters, SkyParameters(), worldSeed);
+        };
+        auto run = runScaling(makeWorldTemplate, worldCount, clientsPerWorld, monsterType, monstersPerWorld, projectileType, projectilesPerStep, steps, reportEvery);
+        auto const& tickTime = run.get("tickTime");
+        coutf("Finished run in {:.2f}s, {:.3f}ms per tick:", run.getDouble("wallTime"), tickTime.getDouble("totalMs"));
+        for (auto const& phase : tickTime.getObject("phasesMs"))
+          coutf(" {} {:.3f}ms", phase.first, phase.second.toDouble());
+        coutf("\n");
+        runs.append(std::move(run));
+      }
+
+      Json results = JsonObject{{"dungeon", dungeon}, {"seed", worldSeed}, {"fidelity", fidelity.value("high")}, {"runs", runs}};
+      if (auto jsonOption = options.parameters.maybe("json"))
+        File::writeFile(results.printJson(2, true), jsonOption->first());
+      else
+        coutf("{}\n", results.printJson(2, true));
+      return 0;
+    }
+
     double sumTime = 0.0;
     for (uint64_t i = 0; i < times; ++i) {
       WorldServer worldServer(worldTemplate, File::ephemeralFile());